@@ -28,6 +28,7 @@
 #include "hphp/runtime/base/macros.h"
 #include "hphp/runtime/base/shared/shared_map.h"
 #include "hphp/runtime/base/array/policy_array.h"
+#include "hphp/runtime/base/array/packed_array.h"
 #include "hphp/runtime/base/comparisons.h"
 
 namespace HPHP {
@@ -107,6 +108,21 @@ ArrayData *ArrayData::CreateRef(CVarRef name, CVarRef value) {
   return init.create();
 }
 
+HOT_FUNC_VM
+ArrayData* ArrayData::MakeTuple(uint size, const TypedValue* values) {
+  if (RuntimeOption::EvalEnablePackedArrays) {
+    return NEW(PackedArray)(size, values);
+  }
+  return Make(size, values);
+}
+
+ArrayData* ArrayData::MakeVector(uint size, const TypedValue* values) {
+  if (RuntimeOption::EvalEnablePackedArrays) {
+    return PackedArray::MakeVector(size, values);
+  }
+  return HphpArray::MakeVector(size, values);
+}
+
 ArrayData *ArrayData::nonSmartCopy() const {
   throw FatalErrorException("nonSmartCopy not implemented.");
 }
@@ -128,6 +144,11 @@ void ArrayData::release() {
     that->release();
     return;
   }
+  if (isPackedArray()) {
+    auto that = static_cast<PackedArray*>(this);
+    that->release();
+    return;
+  }
   assert(m_kind == ArrayKind::kNameValueTableWrapper);
   // NameValueTableWrapper: nop.
 }
@@ -419,9 +440,17 @@ ssize_t ArrayData::iter_rewind(ssize_t prev) const {
 
 void ArrayData::serializeImpl(VariableSerializer *serializer) const {
   serializer->writeArrayHeader(size(), isVectorData());
-  for (ArrayIter iter(this); iter; ++iter) {
-    serializer->writeArrayKey(iter.first());
-    serializer->writeArrayValue(iter.secondRef());
+  if (serializer->skipsArrayKeys()) {
+    for (ssize_t pos = iter_begin(); pos != invalid_index;
+         pos = iter_advance(pos)) {
+      serializer->writeCollectionKeylessPrefix();
+      serializer->writeArrayValue(getValueRef(pos));
+    }
+  } else {
+    for (ArrayIter iter(this); iter; ++iter) {
+      serializer->writeArrayKey(iter.first());
+      serializer->writeArrayValue(iter.secondRef());
+    }
   }
   serializer->writeArrayFooter();
 }
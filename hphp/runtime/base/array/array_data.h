@@ -43,6 +43,7 @@ class ArrayData : public Countable {
     kSharedMap,
     kNameValueTableWrapper,
     kPolicyArray,
+    kPackedArray,
   };
 
 public:
@@ -83,6 +84,18 @@ public:
   static HphpArray* Make(uint capacity);
   static HphpArray* Make(uint size, const TypedValue*);
 
+  /**
+   * Like Make(size, values), but makes a PackedArray when
+   * Eval.EnablePackedArrays is on.
+   */
+  static ArrayData* MakeTuple(uint size, const TypedValue*);
+
+  /**
+   * Like MakeTuple(), but the values are in order, and are copied, with
+   * their refcounts bumped, rather than moved. None of them may be a ref.
+   */
+  static ArrayData* MakeVector(uint size, const TypedValue*);
+
   virtual ~ArrayData() {
     // If there are any strong iterators pointing to this array, they need
     // to be invalidated.
@@ -167,12 +180,20 @@ public:
    * Specific derived class type querying operators.
    */
   bool isPolicyArray() const { return m_kind == ArrayKind::kPolicyArray; }
+  bool isPackedArray() const { return m_kind == ArrayKind::kPackedArray; }
   bool isHphpArray() const { return m_kind == ArrayKind::kHphpArray; }
   bool isSharedMap() const { return m_kind == ArrayKind::kSharedMap; }
   bool isNameValueTableWrapper() const {
     return m_kind == ArrayKind::kNameValueTableWrapper;
   }
 
+  /*
+   * HphpArrays and PackedArrays keep their values in TypedValue slots that
+   * builtins can read in place, without going through ArrayIter and
+   * Variants.
+   */
+  bool hasValueSlots() const { return isHphpArray() || isPackedArray(); }
+
 
   /*
    * Returns whether or not this array contains "vector-like" data.
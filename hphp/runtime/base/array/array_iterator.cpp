@@ -17,6 +17,7 @@
 #include "hphp/runtime/base/array/array_iterator.h"
 #include "hphp/runtime/base/array/array_data.h"
 #include "hphp/runtime/base/array/hphp_array.h"
+#include "hphp/runtime/base/array/packed_array.h"
 #include "hphp/runtime/base/complex_types.h"
 #include "hphp/runtime/base/object_data.h"
 #include "hphp/runtime/ext/ext_collections.h"
@@ -1038,6 +1039,34 @@ int64_t iter_next_cold(Iter* iter, TypedValue* valOut, TypedValue* keyOut) {
   return 1;
 }
 
+/*
+ * The PackedArray part of iter_next: like the HphpArray part, but there are
+ * no tombstones to skip.
+ */
+NEVER_INLINE
+int64_t iter_next_packed(Iter* iter, TypedValue* valOut) {
+  ArrayIter* arrIter = &iter->arr();
+  const PackedArray* arr = (PackedArray*)arrIter->getArrayData();
+  ssize_t pos = arrIter->getPos() + 1;
+  if (size_t(pos) >= size_t(arr->getSize())) {
+    if (UNLIKELY(arr->getCount() == 1)) {
+      return iter_next_cold<false>(iter, valOut, nullptr);
+    }
+    arr->decRefCount();
+    if (debug) {
+      iter->arr().setIterType(ArrayIter::TypeUndefined);
+    }
+    return 0;
+  }
+  if (UNLIKELY(tvWillBeReleased(valOut))) {
+    return iter_next_cold<false>(iter, valOut, nullptr);
+  }
+  tvDecRefOnly(valOut);
+  arrIter->setPos(pos);
+  tvDupCell(tvToCell(arr->getElm(pos)), valOut);
+  return 1;
+}
+
 HOT_FUNC
 int64_t iter_next(Iter* iter, TypedValue* valOut) {
   TRACE(2, "iter_next: I %p\n", iter);
@@ -1051,6 +1080,7 @@ int64_t iter_next(Iter* iter, TypedValue* valOut) {
   {
     const ArrayData* ad = arrIter->getArrayData();
     if (UNLIKELY(!ad->isHphpArray())) {
+      if (ad->isPackedArray()) return iter_next_packed(iter, valOut);
       goto cold;
     }
     const HphpArray* arr = (HphpArray*)ad;
@@ -15,6 +15,7 @@
 */
 
 #include "hphp/runtime/base/array/array_util.h"
+#include "hphp/runtime/base/array/array_init.h"
 #include "hphp/runtime/base/array/array_iterator.h"
 #include "hphp/runtime/base/string_util.h"
 #include "hphp/runtime/base/builtin_functions.h"
@@ -247,15 +248,27 @@ Variant ArrayUtil::Range(unsigned char low, unsigned char high,
 
 #define DOUBLE_DRIFT_FIX 0.000000000000001
 
+/*
+ * Room for the elements of a numeric range, so that building it doesn't
+ * have to grow the array. Absurd ranges fail with an error (or run out of
+ * memory) after some appending; don't reserve it all up front.
+ */
+static ssize_t rangeCapacity(double low, double high, double step) {
+  const double kMaxCapacity = 1 << 20;
+  double n = fabs(high - low) / step + 1;
+  if (!(step > 0) || !(n >= 1)) return 1;
+  return n < kMaxCapacity ? ssize_t(n) : ssize_t(kMaxCapacity);
+}
+
 Variant ArrayUtil::Range(double low, double high, double step /* = 1.0 */) {
-  Array ret;
+  ArrayInit ret(rangeCapacity(low, high, step));
   if (low > high) { // Negative steps
     if (low - high < step || step <= 0) {
       throw_invalid_argument("step exceeds the specified range");
       return false;
     }
     for (; low >= (high - DOUBLE_DRIFT_FIX); low -= step) {
-      ret.append(low);
+      ret.set(low);
     }
   } else if (high > low) { // Positive steps
     if (high - low < step || step <= 0) {
@@ -263,23 +276,23 @@ Variant ArrayUtil::Range(double low, double high, double step /* = 1.0 */) {
       return false;
     }
     for (; low <= (high + DOUBLE_DRIFT_FIX); low += step) {
-      ret.append(low);
+      ret.set(low);
     }
   } else {
-    ret.append(low);
+    ret.set(low);
   }
-  return ret;
+  return ret.create();
 }
 
 Variant ArrayUtil::Range(double low, double high, int64_t step /* = 1 */) {
-  Array ret;
+  ArrayInit ret(rangeCapacity(low, high, step));
   if (low > high) { // Negative steps
     if (low - high < step || step <= 0) {
       throw_invalid_argument("step exceeds the specified range");
       return false;
     }
     for (; low >= high; low -= step) {
-      ret.append((int64_t)low);
+      ret.set((int64_t)low);
     }
   } else if (high > low) { // Positive steps
     if (high - low < step || step <= 0) {
@@ -287,12 +300,12 @@ Variant ArrayUtil::Range(double low, double high, int64_t step /* = 1 */) {
       return false;
     }
     for (; low <= high; low += step) {
-      ret.append((int64_t)low);
+      ret.set((int64_t)low);
     }
   } else {
-    ret.append((int64_t)low);
+    ret.set((int64_t)low);
   }
-  return ret;
+  return ret.create();
 }
 
 const StaticString s_default("(default)");
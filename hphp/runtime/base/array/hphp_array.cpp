@@ -19,6 +19,7 @@
 #include "hphp/runtime/base/array/hphp_array.h"
 #include "hphp/runtime/base/array/array_init.h"
 #include "hphp/runtime/base/array/array_iterator.h"
+#include "hphp/runtime/base/array/packed_array.h"
 #include "hphp/runtime/base/complex_types.h"
 #include "hphp/runtime/base/runtime_option.h"
 #include "hphp/runtime/base/runtime_error.h"
@@ -33,6 +34,10 @@
 #include "hphp/runtime/vm/member_operations.h"
 #include "hphp/runtime/base/stats.h"
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 // If PEDANTIC is defined, extra checks are performed to ensure correct
 // function even as an array approaches 2^31 elements.  In practice this is
 // just wasted effort though, since such an array would require on the order of
@@ -116,7 +121,7 @@ inline uint32_t HphpArray::initWithoutHash(uint capacity) {
 inline void HphpArray::init(uint capacity) {
   assert(m_size == 0);
   const auto tableSize = initWithoutHash(capacity);
-  initHash(m_hash, tableSize);
+  initHash(tableSize);
 }
 
 HphpArray::HphpArray(uint capacity)
@@ -151,6 +156,11 @@ HphpArray::HphpArray(uint size, const TypedValue* values)
   assert(m_size == size && m_hLoad == size && m_nextKI == size);
   ElmInd* hash = m_hash;
   Elm* data = m_data;
+  uint8_t* ctrlBytes = nullptr;
+  if (m_groupProbe) {
+    ctrlBytes = ctrl();
+    memset(ctrlBytes, CtrlEmpty, computeTableSize(m_tableMask));
+  }
   uint i = 0;
   for (; i < size; i++) {
     const TypedValue& tv = values[size - i - 1];
@@ -158,6 +168,7 @@ HphpArray::HphpArray(uint size, const TypedValue* values)
     data[i].data.m_type = tv.m_type;
     data[i].setIntKey(i);
     hash[i] = i;
+    if (ctrlBytes) ctrlBytes[i] = ctrlTag(i);
   }
   // Initialize the leftover hash
   for (; i <= m_tableMask; i++) {
@@ -170,6 +181,25 @@ HphpArray::HphpArray(uint size, const TypedValue* values)
   assert(size == 0 || m_pos == 0);
 }
 
+HphpArray* HphpArray::MakeVector(uint size, const TypedValue* values) {
+  HphpArray* a = NEW(HphpArray)(size);
+  assert(size <= a->m_tableMask + 1);
+  // Hand-specialized from nextInsert(), like the tuple constructor; the
+  // hash table is already cleared, and key i hashes to slot i.
+  ElmInd* hash = a->m_hash;
+  Elm* data = a->m_data;
+  uint8_t* ctrlBytes = a->m_groupProbe ? a->ctrl() : nullptr;
+  for (uint i = 0; i < size; i++) {
+    tvDupCell(&values[i], &data[i].data);
+    data[i].setIntKey(i);
+    hash[i] = i;
+    if (ctrlBytes) ctrlBytes[i] = ctrlTag(i);
+  }
+  a->m_size = a->m_used = a->m_hLoad = a->m_nextKI = size;
+  a->m_pos = size ? 0 : ArrayData::invalid_index;
+  return a;
+}
+
 HphpArray::HphpArray(EmptyMode)
     : ArrayData(ArrayKind::kHphpArray, AllocationMode::smart, 0)
     , m_used(0)
@@ -441,6 +471,111 @@ static bool hitIntKey(const HphpArray::Elm* e, int64_t ki) {
   return e->ikey == ki && e->hasIntKey();
 }
 
+NEVER_INLINE
+HphpArray::ElmInd* warnUnbalanced(size_t n, HphpArray::ElmInd* ei) {
+  raise_error("Array is too unbalanced (%lu)", n);
+  return ei;
+}
+
+bool HphpArray::useGroupProbe(size_t tableSize) {
+  return RuntimeOption::EvalHphpArrayGroupProbe &&
+         tableSize >= CtrlGroupSize;
+}
+
+// Bitmasks of the entries in a group whose control byte is tag, and of the
+// free (empty or tombstone) entries; only those have the high bit set.
+#ifdef __SSE2__
+static inline uint32_t ctrlMatch(const uint8_t* group, uint8_t tag) {
+  __m128i bytes = _mm_loadu_si128((const __m128i*)group);
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(tag)));
+}
+
+static inline uint32_t ctrlMatchFree(const uint8_t* group) {
+  return _mm_movemask_epi8(_mm_loadu_si128((const __m128i*)group));
+}
+#else
+static inline uint32_t ctrlMatch(const uint8_t* group, uint8_t tag) {
+  uint32_t bits = 0;
+  for (uint32_t i = 0; i < HphpArray::CtrlGroupSize; ++i) {
+    bits |= uint32_t(group[i] == tag) << i;
+  }
+  return bits;
+}
+
+static inline uint32_t ctrlMatchFree(const uint8_t* group) {
+  uint32_t bits = 0;
+  for (uint32_t i = 0; i < HphpArray::CtrlGroupSize; ++i) {
+    bits |= uint32_t(group[i] >> 7) << i;
+  }
+  return bits;
+}
+#endif
+
+// Groups are probed quadratically too; the number of groups is a power of
+// 2 as well, so every group gets visited.
+template <class Hit>
+inline ALWAYS_INLINE
+ssize_t HphpArray::findInGroups(size_t h0, Hit hit) const {
+  const uint8_t* ctrlBytes = ctrl();
+  uint8_t tag = ctrlTag(h0);
+  size_t groupMask = m_tableMask / CtrlGroupSize;
+  size_t base = h0 & m_tableMask & ~size_t(CtrlGroupSize - 1);
+  for (size_t i = 1;; ++i) {
+    const uint8_t* group = ctrlBytes + base;
+    for (uint32_t bits = ctrlMatch(group, tag); bits; bits &= bits - 1) {
+      ssize_t pos = m_hash[base + __builtin_ctz(bits)];
+      if (hit(pos)) return pos;
+    }
+    if (ctrlMatch(group, CtrlEmpty)) return ssize_t(ElmIndEmpty);
+    assert(i <= groupMask);
+    base = (base + i * CtrlGroupSize) & m_tableMask;
+  }
+}
+
+template <class Hit>
+inline ALWAYS_INLINE
+HphpArray::ElmInd* HphpArray::findForInsertInGroups(size_t h0,
+                                                    Hit hit) const {
+  ElmInd* ret = nullptr;
+  const uint8_t* ctrlBytes = ctrl();
+  uint8_t tag = ctrlTag(h0);
+  size_t groupMask = m_tableMask / CtrlGroupSize;
+  size_t base = h0 & m_tableMask & ~size_t(CtrlGroupSize - 1);
+  for (size_t i = 1;; ++i) {
+    const uint8_t* group = ctrlBytes + base;
+    for (uint32_t bits = ctrlMatch(group, tag); bits; bits &= bits - 1) {
+      ElmInd* ei = &m_hash[base + __builtin_ctz(bits)];
+      if (hit(*ei)) return ei;
+    }
+    if (!ret) {
+      uint32_t free = ctrlMatchFree(group);
+      if (free) ret = &m_hash[base + __builtin_ctz(free)];
+    }
+    if (ctrlMatch(group, CtrlEmpty)) {
+      assert(m_hLoad <= computeMaxElms(m_tableMask));
+      size_t probes = i * CtrlGroupSize;
+      return LIKELY(probes <= 100) ||
+        LIKELY(probes <= size_t(RuntimeOption::MaxArrayChain)) ?
+        ret : warnUnbalanced(probes, ret);
+    }
+    assert(i <= groupMask);
+    base = (base + i * CtrlGroupSize) & m_tableMask;
+  }
+}
+
+NEVER_INLINE HphpArray::ElmInd*
+HphpArray::findForNewInsertInGroups(size_t h0) const {
+  const uint8_t* ctrlBytes = ctrl();
+  size_t groupMask = m_tableMask / CtrlGroupSize;
+  size_t base = h0 & m_tableMask & ~size_t(CtrlGroupSize - 1);
+  for (size_t i = 1;; ++i) {
+    uint32_t free = ctrlMatchFree(ctrlBytes + base);
+    if (free) return &m_hash[base + __builtin_ctz(free)];
+    assert(i <= groupMask);
+    base = (base + i * CtrlGroupSize) & m_tableMask;
+  }
+}
+
 // Quadratic probe is:
 //
 //   h(k, i) = (k + c1*i + c2*(i^2)) % tableSize
@@ -475,7 +610,7 @@ ssize_t HphpArray::find(int64_t ki) const {
     Elm* e = m_data + uint64_t(ki);
     if (e->data.m_type != HphpArray::KindOfTombstone && hitIntKey(e, ki)) {
       Stats::inc(Stats::HA_FindIntFast);
-      assert([&] {
+      assert(m_groupProbe || [&] {
           // Our results had better match the other path
           FIND_BODY(ki, hitIntKey(&elms[pos], ki));
       }() == ki);
@@ -483,6 +618,11 @@ ssize_t HphpArray::find(int64_t ki) const {
     }
   }
   Stats::inc(Stats::HA_FindIntSlow);
+  if (m_groupProbe) {
+    return findInGroups(ki, [&](ssize_t pos) {
+      return hitIntKey(&m_data[pos], ki);
+    });
+  }
   FIND_BODY(ki, hitIntKey(&elms[pos], ki));
 }
 
@@ -490,16 +630,15 @@ NEVER_INLINE
 ssize_t HphpArray::find(const StringData* s,
                                    strhash_t prehash) const {
   int32_t h = STRING_HASH(prehash);
+  if (m_groupProbe) {
+    return findInGroups(prehash, [&](ssize_t pos) {
+      return hitStringKey(&m_data[pos], s, h);
+    });
+  }
   FIND_BODY(prehash, hitStringKey(&elms[pos], s, h));
 }
 #undef FIND_BODY
 
-NEVER_INLINE
-HphpArray::ElmInd* warnUnbalanced(size_t n, HphpArray::ElmInd* ei) {
-  raise_error("Array is too unbalanced (%lu)", n);
-  return ei;
-}
-
 #define FIND_FOR_INSERT_BODY(h0, hit)                                   \
   ElmInd* ret = nullptr;                                                \
   size_t tableMask = m_tableMask;                                       \
@@ -536,6 +675,11 @@ HphpArray::ElmInd* warnUnbalanced(size_t n, HphpArray::ElmInd* ei) {
 
 NEVER_INLINE
 HphpArray::ElmInd* HphpArray::findForInsert(int64_t ki) const {
+  if (m_groupProbe) {
+    return findForInsertInGroups(ki, [&](ssize_t pos) {
+      return hitIntKey(&m_data[pos], ki);
+    });
+  }
   FIND_FOR_INSERT_BODY(ki, hitIntKey(&elms[pos], ki));
 }
 
@@ -543,12 +687,18 @@ NEVER_INLINE
 HphpArray::ElmInd* HphpArray::findForInsert(const StringData* s,
                                             strhash_t prehash) const {
   int32_t h = STRING_HASH(prehash);
+  if (m_groupProbe) {
+    return findForInsertInGroups(prehash, [&](ssize_t pos) {
+      return hitStringKey(&m_data[pos], s, h);
+    });
+  }
   FIND_FOR_INSERT_BODY(prehash, hitStringKey(&elms[pos], s, h));
 }
 #undef FIND_FOR_INSERT_BODY
 
 NEVER_INLINE HphpArray::ElmInd*
 HphpArray::findForNewInsertLoop(size_t tableMask, size_t h0) const {
+  if (m_groupProbe) return findForNewInsertInGroups(h0);
   /* Quadratic probe. */
   size_t probeIndex = h0 & tableMask;
   for (size_t i = 1;; ++i) {
@@ -600,7 +750,8 @@ inline ALWAYS_INLINE bool HphpArray::isFull() const {
   return m_used == maxElms || m_hLoad == maxElms;
 }
 
-inline ALWAYS_INLINE HphpArray::Elm* HphpArray::allocElmFast(ElmInd* ei) {
+inline ALWAYS_INLINE
+HphpArray::Elm* HphpArray::allocElmFast(ElmInd* ei, size_t h0) {
   assert(!validElmInd(*ei) && !isFull());
   assert(m_size != 0 || m_used == 0);
 #ifdef PEDANTIC
@@ -612,12 +763,13 @@ inline ALWAYS_INLINE HphpArray::Elm* HphpArray::allocElmFast(ElmInd* ei) {
   ++m_size;
   m_hLoad += (*ei == ElmIndEmpty);
   ElmInd i = m_used++;
-  (*ei) = i;
+  setHashEntry(ei, i, h0);
   return &m_data[i];
 }
 
-inline ALWAYS_INLINE HphpArray::Elm* HphpArray::allocElm(ElmInd* ei) {
-  Elm* e = allocElmFast(ei);
+inline ALWAYS_INLINE
+HphpArray::Elm* HphpArray::allocElm(ElmInd* ei, size_t h0) {
+  Elm* e = allocElmFast(ei, h0);
   if (m_pos == ArrayData::invalid_index) m_pos = ssize_t(*ei);
   return e;
 }
@@ -625,13 +777,13 @@ inline ALWAYS_INLINE HphpArray::Elm* HphpArray::allocElm(ElmInd* ei) {
 inline ALWAYS_INLINE
 HphpArray::Elm* HphpArray::newElm(ElmInd* ei, size_t h0) {
   if (isFull()) return newElmGrow(h0);
-  return allocElm(ei);
+  return allocElm(ei, h0);
 }
 
 NEVER_INLINE
 HphpArray::Elm* HphpArray::newElmGrow(size_t h0) {
   resize();
-  return allocElm(findForNewInsert(h0));
+  return allocElm(findForNewInsert(h0), h0);
 }
 
 inline ALWAYS_INLINE
@@ -670,11 +822,13 @@ void HphpArray::newElmStr(ElmInd* ei, strhash_t h, StringData* key,
 
 void HphpArray::allocData(size_t maxElms, size_t tableSize) {
   if (maxElms <= SmallSize) {
+    m_groupProbe = false;
     m_data = m_inline_data.slots;
     m_hash = m_inline_data.hash;
     return;
   }
-  size_t hashSize = tableSize * sizeof(ElmInd);
+  m_groupProbe = useGroupProbe(tableSize);
+  size_t hashSize = computeHashSize(tableSize, m_groupProbe);
   size_t dataSize = maxElms * sizeof(Elm);
   size_t allocSize = hashSize <= sizeof(m_inline_hash) ? dataSize :
                      dataSize + hashSize;
@@ -689,7 +843,8 @@ void HphpArray::allocData(size_t maxElms, size_t tableSize) {
 
 void HphpArray::reallocData(size_t maxElms, size_t tableSize, uint oldMask) {
   assert(m_data && oldMask > 0 && maxElms > SmallSize);
-  size_t hashSize = tableSize * sizeof(ElmInd);
+  m_groupProbe = useGroupProbe(tableSize);
+  size_t hashSize = computeHashSize(tableSize, m_groupProbe);
   size_t dataSize = maxElms * sizeof(Elm);
   size_t allocSize = hashSize <= sizeof(m_inline_hash) ? dataSize :
                      dataSize + hashSize;
@@ -754,7 +909,7 @@ void HphpArray::grow() {
   reallocData(maxElms, tableSize, oldMask);
   // All the elements have been copied and their offsets from the base are
   // still the same, so we just need to build the new hash table.
-  initHash(m_hash, tableSize);
+  initHash(tableSize);
 #ifdef DEBUG
   // Wait to set m_hLoad to m_size until after rebuilding is complete,
   // in order to maintain invariants in findForNewInsert().
@@ -769,8 +924,8 @@ void HphpArray::grow() {
       if (e->data.m_type == KindOfTombstone) {
         continue;
       }
-      ElmInd* ei = findForNewInsert(e->hasIntKey() ? e->ikey : e->hash());
-      *ei = pos;
+      size_t h0 = e->hasIntKey() ? e->ikey : e->hash();
+      setHashEntry(findForNewInsert(h0), pos, h0);
     }
 #ifdef DEBUG
     m_hLoad = m_size;
@@ -805,7 +960,7 @@ void HphpArray::compact(bool renumber /* = false */) {
   }
   Elm* elms = m_data;
   size_t tableSize = computeTableSize(m_tableMask);
-  initHash(m_hash, tableSize);
+  initHash(tableSize);
 #ifdef DEBUG
   // Wait to set m_hLoad to m_size until after rebuilding is complete,
   // in order to maintain invariants in findForNewInsert().
@@ -825,8 +980,8 @@ void HphpArray::compact(bool renumber /* = false */) {
     if (renumber && !toE.hasStrKey()) {
       toE.ikey = m_nextKI++;
     }
-    ElmInd* ie = findForNewInsert(toE.hasIntKey() ? toE.ikey : toE.hash());
-    *ie = toPos;
+    size_t h0 = toE.hasIntKey() ? toE.ikey : toE.hash();
+    setHashEntry(findForNewInsert(h0), toPos, h0);
   }
   m_used = m_size;
 #ifdef DEBUG
@@ -874,7 +1029,7 @@ bool HphpArray::nextInsert(CVarRef data) {
   ElmInd* ei = findForNewInsert(ki);
   assert(!validElmInd(*ei));
   // Allocate and initialize a new element.
-  initElmInt(allocElm(ei), ki, data);
+  initElmInt(allocElm(ei, ki), ki, data);
   // Update next free element.
   ++m_nextKI;
   return true;
@@ -892,7 +1047,7 @@ ArrayData* HphpArray::nextInsertRef(CVarRef data) {
   // know that m_nextKI is not present in the array, so it is safe
   // to use findForNewInsert()
   ElmInd* ei = findForNewInsert(ki);
-  initElmInt(allocElm(ei), ki, data, true /*byRef*/);
+  initElmInt(allocElm(ei, ki), ki, data, true /*byRef*/);
   // Update next free element.
   ++m_nextKI;
   return this;
@@ -905,7 +1060,7 @@ ArrayData* HphpArray::nextInsertWithRef(CVarRef data) {
   assert(!validElmInd(*ei));
 
   // Allocate a new element.
-  Elm* e = allocElm(ei);
+  Elm* e = allocElm(ei, ki);
   tvWriteNull(&e->data);
   tvAsVariant(&e->data).setWithRef(data);
   // Set key.
@@ -957,7 +1112,7 @@ inline ArrayData* HphpArray::addVal(int64_t ki, CVarRef data) {
   assert(!exists(ki));
   resizeIfNeeded();
   ElmInd* ei = findForNewInsert(ki);
-  Elm* e = allocElm(ei);
+  Elm* e = allocElm(ei, ki);
   TypedValue* fr = (TypedValue*)(&data);
   TypedValue* to = (TypedValue*)(&e->data);
   elemConstruct(fr, to);
@@ -973,7 +1128,7 @@ inline ArrayData* HphpArray::addVal(StringData* key, CVarRef data) {
   resizeIfNeeded();
   strhash_t h = key->hash();
   ElmInd* ei = findForNewInsert(h);
-  Elm *e = allocElm(ei);
+  Elm *e = allocElm(ei, h);
   // Set the element
   TypedValue* to = (TypedValue*)(&e->data);
   TypedValue* fr = (TypedValue*)(&data);
@@ -988,7 +1143,7 @@ inline ArrayData* HphpArray::addValWithRef(int64_t ki, CVarRef data) {
   resizeIfNeeded();
   ElmInd* ei = findForInsert(ki);
   if (!validElmInd(*ei)) {
-    Elm* e = allocElm(ei);
+    Elm* e = allocElm(ei, ki);
     tvWriteNull(&e->data);
     tvAsVariant(&e->data).setWithRef(data);
     e->setIntKey(ki);
@@ -1004,7 +1159,7 @@ inline ArrayData* HphpArray::addValWithRef(StringData* key, CVarRef data) {
   strhash_t h = key->hash();
   ElmInd* ei = findForInsert(key, h);
   if (!validElmInd(*ei)) {
-    Elm* e = allocElm(ei);
+    Elm* e = allocElm(ei, h);
     tvWriteNull(&e->data);
     tvAsVariant(&e->data).setWithRef(data);
     e->setStrKey(key, h);
@@ -1240,6 +1395,7 @@ ArrayData* HphpArray::erase(ElmInd* ei, bool updateNext /* = false */) {
   }
   // Mark the hash entry as "deleted".
   *ei = ElmIndTombstone;
+  if (m_groupProbe) ctrl()[ei - m_hash] = CtrlTombstone;
   assert(m_used <= computeMaxElms(m_tableMask));
   assert(m_hLoad <= computeMaxElms(m_tableMask));
 
@@ -1387,13 +1543,16 @@ ArrayData* HphpArray::AddNewElemC(ArrayData* a, TypedValue value) {
       ((ei = &h->m_hash[k & h->m_tableMask]), LIKELY(!validElmInd(*ei)))) {
     // Fast path is a streamlined copy of Variant.constructValHelper()
     // with no incref+decref because we're moving (data,type) to this array.
-    Elm* e = h->allocElmFast(ei);
+    Elm* e = h->allocElmFast(ei, k);
     e->data.m_type = typeInitNull(value.m_type);
     e->data.m_data.num = value.m_data.num;
     e->setIntKey(k);
     h->m_nextKI = k + 1;
     return a;
   }
+  if (a->isPackedArray() && a->getCount() <= 1) {
+    return PackedArray::AddNewElemC(a, value);
+  }
   return genericAddNewElemC(a, value);
 }
 
@@ -1592,6 +1751,7 @@ ALWAYS_INLINE HphpArray* HphpArray::clone(AllocationMode am) const {
   target->m_size = 0;
   target->m_hLoad = 0;
   target->m_used = 0;
+  target->m_groupProbe = false;
   target->m_data = target->m_inline_data.slots;
   auto const ht = target->m_inline_data.hash;
   target->m_hash = ht;
@@ -1622,8 +1782,13 @@ NEVER_INLINE void HphpArray::cloneNonEmpty(HphpArray* target) const {
   const auto tableSize = computeTableSize(m_tableMask);
   const auto maxElms = computeMaxElms(m_tableMask);
   target->allocData(maxElms, tableSize);
-  // Copy the hash.
-  memcpy(target->m_hash, m_hash, tableSize * sizeof(ElmInd));
+  // Copy the hash, control bytes included. If the copy didn't get the same
+  // layout (Eval.HphpArrayGroupProbe wasn't set yet when this array was
+  // made), it is rebuilt below instead.
+  bool sameLayout = target->m_groupProbe == m_groupProbe;
+  if (sameLayout) {
+    memcpy(target->m_hash, m_hash, computeHashSize(tableSize, m_groupProbe));
+  }
 
   // Copy the elements and bump up refcounts as needed.
   Elm* elms = m_data;
@@ -1654,7 +1819,7 @@ NEVER_INLINE void HphpArray::cloneNonEmpty(HphpArray* target) const {
   }
   // If the element density dropped below 50% due to indirect elements
   // being converted into tombstones, we should do a compaction
-  if (target->m_size < target->m_used / 2) {
+  if (!sameLayout || target->m_size < target->m_used / 2) {
     target->compact();
   }
 }
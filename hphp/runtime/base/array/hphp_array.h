@@ -55,6 +55,10 @@ public:
   // moving (without refcounting) and reversing vals.
   HphpArray(uint size, const TypedValue* vals); // make tuple
 
+  // Create an array with size elements, copied in order from vals, which
+  // must all be cells, and incref'd.
+  static HphpArray* MakeVector(uint size, const TypedValue* vals);
+
   virtual ~HphpArray();
 
   // unlike ArrayData::size(), this functions doesn't delegate
@@ -219,6 +223,10 @@ private:
 
   void postSort(bool resetKeys);
 
+  template <typename AccessorT>
+  bool fastSort(const AccessorT& acc, SortFlavor flav, int sort_flags,
+                bool ascending, bool resetKeys);
+
 public:
   ArrayData* escalateForSort();
   void ksort(int sort_flags, bool ascending);
@@ -300,6 +308,24 @@ public:
     ElmInd hash[SmallHashSize];
   };
 
+  /**
+   * Group probing. Each hash table entry has a control byte: CtrlEmpty,
+   * CtrlTombstone, or the 7-bit ctrlTag() of the key's hash. The probe
+   * sequence visits aligned groups of CtrlGroupSize entries quadratically,
+   * comparing all of a group's control bytes against the tag at once (with
+   * SSE2 where available), so only entries whose tag matches are checked
+   * against the key. A probe ends at the first group with an empty entry;
+   * new keys go in the first free entry of the first group that has one.
+   */
+  static const uint32_t CtrlGroupSize = 16;
+  static const uint8_t CtrlEmpty = 0x80;
+  static const uint8_t CtrlTombstone = 0xfe;
+
+  static uint8_t ctrlTag(size_t h0) {
+    // Integer keys, prehashes and Elm::hash() only agree on the low 31 bits.
+    return ((uint32_t(h0) & 0x7fffffffU) * 0x9e3779b1U) >> 25;
+  }
+
   uint32_t iterLimit() const { return m_used; }
   Elm* getElm(ssize_t pos) const {
     assert(size_t(pos) < m_used);
@@ -352,10 +378,16 @@ private:
   //            +--------------------+
   // m_hash --> |                    | 2^K hash table entries.
   //            +--------------------+
+  //
+  // Group probing: with Eval.HphpArrayGroupProbe, hash tables of at least
+  // CtrlGroupSize entries are followed by one control byte per entry (see
+  // ctrl()), and lookups scan CtrlGroupSize-entry groups instead of single
+  // entries.
 
   uint32_t m_used;       // number of used elements (values or tombstones)
   uint32_t m_tableMask;  // Bitmask used when indexing into the hash table.
   uint32_t m_hLoad;      // Hash table load (# of non-empty slots).
+  bool     m_groupProbe; // Hash table has control bytes.
   int64_t  m_nextKI;     // Next integer key to use for append.
   Elm*     m_data;       // Contains elements and hash table.
   ElmInd*  m_hash;       // Hash table.
@@ -380,6 +412,26 @@ private:
   ElmInd* findForInsert(int64_t ki) const;
   ElmInd* findForInsert(const StringData* k, strhash_t prehash) const;
 
+  // The control bytes follow the hash table entries.
+  uint8_t* ctrl() const {
+    assert(m_groupProbe);
+    return (uint8_t*)(m_hash + computeTableSize(m_tableMask));
+  }
+  void setHashEntry(ElmInd* ei, ElmInd pos, size_t h0) {
+    *ei = pos;
+    if (m_groupProbe) ctrl()[ei - m_hash] = ctrlTag(h0);
+  }
+  static bool useGroupProbe(size_t tableSize);
+  static size_t computeHashSize(size_t tableSize, bool groupProbe) {
+    return tableSize * (sizeof(ElmInd) + (groupProbe ? 1 : 0));
+  }
+
+  template <class Hit>
+  ssize_t findInGroups(size_t h0, Hit hit) const;
+  template <class Hit>
+  ElmInd* findForInsertInGroups(size_t h0, Hit hit) const;
+  ElmInd* findForNewInsertInGroups(size_t h0) const;
+
   ssize_t iter_advance_helper(ssize_t prev) const ATTRIBUTE_COLD;
 
   /**
@@ -420,8 +472,8 @@ private:
   bool isFull() const;
   Elm* newElm(ElmInd* e, size_t h0);
   Elm* newElmGrow(size_t h0);
-  Elm* allocElm(ElmInd* ei);
-  Elm* allocElmFast(ElmInd* ei);
+  Elm* allocElm(ElmInd* ei, size_t h0);
+  Elm* allocElmFast(ElmInd* ei, size_t h0);
   void initElmInt(Elm* e, int64_t ki, CVarRef data, bool byRef=false);
   void initElmStr(Elm* e, strhash_t h, StringData* key, CVarRef data,
                   bool byRef=false);
@@ -476,9 +528,10 @@ private:
   // isHphpArray implementation; HphpArray should be effectively final.
   static HphpArray s_theEmptyArray;
 
-  static void initHash(HphpArray::ElmInd* hash, size_t tableSize) {
+  void initHash(size_t tableSize) {
     assert(HphpArray::ElmIndEmpty == -1);
-    memset(hash, 0xffU, tableSize * sizeof(HphpArray::ElmInd));
+    memset(m_hash, 0xffU, tableSize * sizeof(HphpArray::ElmInd));
+    if (m_groupProbe) memset(ctrl(), CtrlEmpty, tableSize);
   }
 
 public:
@@ -20,7 +20,13 @@
 #include "hphp/runtime/base/array/sort_helpers.h"
 #include "hphp/runtime/base/complex_types.h"
 #include "hphp/runtime/base/execution_context.h"
+#include "hphp/runtime/base/runtime_option.h"
 #include "hphp/runtime/vm/jit/translator-inline.h"
+#include "hphp/util/async_func.h"
+#include "hphp/util/process.h"
+#include "hphp/util/radix_sort.h"
+
+#include <cmath>
 
 namespace HPHP {
 ///////////////////////////////////////////////////////////////////////////////
@@ -38,6 +44,17 @@ struct KeyAccessor {
     assert(isStr(elm));
     return getStr(elm);
   }
+  TypedValue getCell(ElmT elm) const {
+    TypedValue tv;
+    if (isInt(elm)) {
+      tv.m_data.num = getInt(elm);
+      tv.m_type = KindOfInt64;
+    } else {
+      tv.m_data.pstr = getStr(elm);
+      tv.m_type = KindOfString;
+    }
+    return tv;
+  }
 };
 
 struct ValAccessor {
@@ -47,6 +64,7 @@ struct ValAccessor {
   int64_t getInt(ElmT elm) const { return elm.data.m_data.num; }
   StringData* getStr(ElmT elm) const { return elm.data.m_data.pstr; }
   Variant getValue(ElmT elm) const { return tvAsCVarRef(&elm.data); }
+  TypedValue getCell(ElmT elm) const { return elm.data; }
 };
 
 /**
@@ -116,26 +134,228 @@ done:
 void HphpArray::postSort(bool resetKeys) {
   assert(m_size > 0);
   size_t tableSize = computeTableSize(m_tableMask);
-  initHash(m_hash, tableSize);
+  initHash(tableSize);
   m_hLoad = 0;
   if (resetKeys) {
     for (uint32_t pos = 0; pos < m_used; ++pos) {
       Elm* e = &m_data[pos];
       if (e->hasStrKey()) decRefStr(e->key);
       e->setIntKey(pos);
-      m_hash[pos] = pos;
+      setHashEntry(&m_hash[pos], pos, pos);
     }
     m_nextKI = m_size;
   } else {
     for (uint32_t pos = 0; pos < m_used; ++pos) {
       Elm* e = &m_data[pos];
-      ElmInd* ei = findForNewInsert(e->hasIntKey() ? e->ikey : e->hash());
-      *ei = pos;
+      size_t h0 = e->hasIntKey() ? e->ikey : e->hash();
+      setHashEntry(findForNewInsert(h0), pos, h0);
     }
   }
   m_hLoad = m_size;
 }
 
+// Arrays smaller than this are left to the comparison sort.
+static const uint32_t kRadixSortMinSize = 256;
+// The least number of elements given to each parallel sort thread.
+static const uint32_t kParallelSortMinChunk = 1 << 16;
+static const int kParallelSortMaxThreads = 16;
+
+namespace {
+
+struct SortScratch {
+  explicit SortScratch(uint32_t size)
+    : elms((HphpArray::Elm*)smart_malloc(size * sizeof(HphpArray::Elm))) {}
+  ~SortScratch() { smart_free(elms); }
+  HphpArray::Elm* elms;
+};
+
+/*
+ * Under SORT_REGULAR, strings compare numerically only if both of them are
+ * numeric. With at most one numeric string, the order is bytewise.
+ */
+template <typename AccessorT>
+bool stringsCompareBytewise(const AccessorT& acc, const HphpArray::Elm* elms,
+                            uint32_t size) {
+  bool seenNumeric = false;
+  for (uint32_t i = 0; i < size; ++i) {
+    if (acc.getStr(elms[i])->isNumeric()) {
+      if (seenNumeric) return false;
+      seenNumeric = true;
+    }
+  }
+  return true;
+}
+
+/*
+ * Whether every sort value is a double other than NAN or -0.0. Mixed types
+ * aren't compared consistently (a < b and b < c doesn't imply a < c), so the
+ * order the comparison sort leaves them in depends on how it got there. With
+ * one type and no NAN the order is total, and equal doubles are the same
+ * value, so any correct sort gives the same result.
+ */
+template <typename AccessorT>
+bool allPlainDoubles(const AccessorT& acc, const HphpArray::Elm* elms,
+                     uint32_t size) {
+  for (uint32_t i = 0; i < size; ++i) {
+    TypedValue tv = acc.getCell(elms[i]);
+    if (tv.m_type != KindOfDouble || std::isnan(tv.m_data.dbl) ||
+        (tv.m_data.dbl == 0 && std::signbit(tv.m_data.dbl))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/*
+ * One thread's share of a parallel merge sort: sorting [begin, end), or
+ * merging [begin, mid) with [mid, end) into out.
+ */
+template <typename CompareT>
+struct SortJob {
+  HphpArray::Elm* begin;
+  HphpArray::Elm* mid;
+  HphpArray::Elm* end;
+  HphpArray::Elm* out;
+  CompareT comp;
+
+  void sort() {
+    HPHP::Sort::sort(begin, end, comp);
+  }
+  void merge() {
+    std::merge(begin, mid, mid, end, out, comp);
+  }
+};
+
+template <typename CompareT>
+void runSortJobs(std::vector<SortJob<CompareT>>& jobs,
+                 void (SortJob<CompareT>::*fn)()) {
+  std::vector<std::unique_ptr<AsyncFunc<SortJob<CompareT>>>> threads;
+  for (size_t i = 1; i < jobs.size(); ++i) {
+    threads.emplace_back(new AsyncFunc<SortJob<CompareT>>(&jobs[i], fn));
+    // Comparing doubles doesn't need a request context.
+    threads.back()->setNoInit();
+    threads.back()->start();
+  }
+  (jobs[0].*fn)();
+  for (auto& thread : threads) {
+    thread->waitForEnd();
+  }
+}
+
+/*
+ * Sorts [begin, end) by having each of nthreads threads sort a chunk of it,
+ * then merging pairs of sorted runs in parallel, alternating between the
+ * array and scratch.
+ */
+template <typename CompareT>
+void parallelSort(HphpArray::Elm* begin, HphpArray::Elm* end,
+                  HphpArray::Elm* scratch, CompareT comp, int nthreads) {
+  size_t size = end - begin;
+  std::vector<HphpArray::Elm*> bounds;
+  std::vector<SortJob<CompareT>> jobs;
+  for (int i = 0; i <= nthreads; ++i) {
+    bounds.push_back(begin + size * i / nthreads);
+  }
+  for (int i = 0; i < nthreads; ++i) {
+    jobs.push_back(SortJob<CompareT>{bounds[i], nullptr, bounds[i + 1],
+                                     nullptr, comp});
+  }
+  runSortJobs(jobs, &SortJob<CompareT>::sort);
+
+  HphpArray::Elm* from = begin;
+  HphpArray::Elm* to = scratch;
+  while (bounds.size() > 2) {
+    std::vector<HphpArray::Elm*> merged;
+    jobs.clear();
+    for (size_t i = 0; i + 1 < bounds.size(); i += 2) {
+      // An odd run out is merged with nothing, i.e. copied.
+      HphpArray::Elm* mid = bounds[i + 1];
+      HphpArray::Elm* runEnd = i + 2 < bounds.size() ? bounds[i + 2] : mid;
+      HphpArray::Elm* out = to + (bounds[i] - from);
+      jobs.push_back(SortJob<CompareT>{bounds[i], mid, runEnd, out, comp});
+      merged.push_back(out);
+    }
+    merged.push_back(to + size);
+    runSortJobs(jobs, &SortJob<CompareT>::merge);
+    bounds.swap(merged);
+    std::swap(from, to);
+  }
+  if (from != begin) memcpy(begin, from, size * sizeof(HphpArray::Elm));
+}
+
+}
+
+/*
+ * Whether elements whose values compare equal are still told apart by their
+ * keys. The radix and merge sorts order those differently from the comparison
+ * sort, so asort() and arsort() always take the comparison sort.
+ */
+static bool equalElmsDiffer(const KeyAccessor& acc, bool resetKeys) {
+  return false;
+}
+static bool equalElmsDiffer(const ValAccessor& acc, bool resetKeys) {
+  return !resetKeys;
+}
+
+/**
+ * fastSort() takes over sorts of large arrays that can be done without the
+ * comparison sort and still come out in the order it would give: with
+ * Eval.EnableRadixSort, ints compared as ints and strings compared bytewise
+ * get a radix sort, and in the CLI, arrays of at least
+ * Eval.ParallelSortMinSize doubles compared with SORT_REGULAR get a parallel
+ * merge sort. It returns false if the array still needs to be sorted.
+ */
+template <typename AccessorT>
+bool HphpArray::fastSort(const AccessorT& acc, SortFlavor flav,
+                         int sort_flags, bool ascending, bool resetKeys) {
+  if (equalElmsDiffer(acc, resetKeys)) return false;
+  Elm* begin = m_data;
+  Elm* end = m_data + m_size;
+  if (RuntimeOption::EvalEnableRadixSort && m_size >= kRadixSortMinSize) {
+    if (flav == IntegerSort &&
+        (sort_flags == SORT_REGULAR || sort_flags == SORT_NUMERIC)) {
+      SortScratch scratch(m_size);
+      HPHP::Sort::radix_sort_int(begin, end, scratch.elms,
+                                 [&](const Elm& e) { return acc.getInt(e); });
+      if (!ascending) std::reverse(begin, end);
+      return true;
+    }
+    if (flav == StringSort &&
+        (sort_flags == SORT_STRING ||
+         (sort_flags == SORT_REGULAR &&
+          stringsCompareBytewise(acc, begin, m_size)))) {
+      SortScratch scratch(m_size);
+      HPHP::Sort::radix_sort_str(begin, end, scratch.elms,
+                                 [&](const Elm& e) {
+                                   StringData* s = acc.getStr(e);
+                                   return HPHP::Sort::RadixString{
+                                     s->data(), size_t(s->size())};
+                                 });
+      if (!ascending) std::reverse(begin, end);
+      return true;
+    }
+  }
+  if (flav == GenericSort && sort_flags == SORT_REGULAR &&
+      RuntimeOption::EvalParallelSortMinSize &&
+      m_size >= RuntimeOption::EvalParallelSortMinSize &&
+      RuntimeOption::ClientExecutionMode()) {
+    int nthreads = std::min<int64_t>(
+      std::min(Process::GetCPUCount(), kParallelSortMaxThreads),
+      m_size / kParallelSortMinChunk);
+    if (nthreads < 2 || !allPlainDoubles(acc, begin, m_size)) return false;
+    SortScratch scratch(m_size);
+    if (ascending) {
+      parallelSort(begin, end, scratch.elms,
+                   ScalarElmCompare<AccessorT, true>(), nthreads);
+    } else {
+      parallelSort(begin, end, scratch.elms,
+                   ScalarElmCompare<AccessorT, false>(), nthreads);
+    }
+    return true;
+  }
+  return false;
+}
+
 ArrayData* HphpArray::escalateForSort() {
   // task #1910931 only do this for refCount() > 1
   return copyImpl();
@@ -182,7 +402,10 @@ ArrayData* HphpArray::escalateForSort() {
     SortFlavor flav = preSort<acc_type>(acc_type(), true); \
     m_pos = ssize_t(0); \
     try { \
-      CALL_SORT(acc_type); \
+      if (!fastSort<acc_type>(acc_type(), flav, sort_flags, ascending, \
+                              resetKeys)) { \
+        CALL_SORT(acc_type); \
+      } \
     } catch (...) { \
       /* Make sure we leave the array in a consistent state */ \
       postSort(resetKeys); \
@@ -0,0 +1,364 @@
+/*
+   +----------------------------------------------------------------------+
+   | HipHop for PHP                                                       |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2010-2013 Facebook, Inc. (http://www.facebook.com)     |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 3.01 of the PHP license,      |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available through the world-wide-web at the following url:           |
+   | http://www.php.net/license/3_01.txt                                  |
+   | If you did not receive a copy of the PHP license and are unable to   |
+   | obtain it through the world-wide-web, please send a note to          |
+   | license@php.net so we can mail you a copy immediately.               |
+   +----------------------------------------------------------------------+
+*/
+
+#define INLINE_VARIANT_HELPER 1
+
+#include "hphp/runtime/base/array/packed_array.h"
+#include "hphp/runtime/base/array/array_iterator.h"
+#include "hphp/runtime/base/array/hphp_array.h"
+#include "hphp/runtime/base/memory/memory_manager.h"
+
+namespace HPHP {
+
+IMPLEMENT_SMART_ALLOCATION_HOT(PackedArray);
+///////////////////////////////////////////////////////////////////////////////
+
+PackedArray::PackedArray(uint capacity)
+    : ArrayData(ArrayKind::kPackedArray, AllocationMode::smart, 0)
+    , m_cap(std::max(capacity, MinCapacity)) {
+  m_data = (TypedValue*)smart_malloc(m_cap * sizeof(TypedValue));
+}
+
+HOT_FUNC_VM
+PackedArray::PackedArray(uint size, const TypedValue* values)
+    : ArrayData(ArrayKind::kPackedArray, AllocationMode::smart, size)
+    , m_cap(std::max(size, MinCapacity)) {
+  m_data = (TypedValue*)smart_malloc(m_cap * sizeof(TypedValue));
+  // Values are moved, and in reverse order since they come from the stack,
+  // which grows down.
+  for (uint i = 0; i < size; i++) {
+    const TypedValue& tv = values[size - i - 1];
+    m_data[i].m_data = tv.m_data;
+    m_data[i].m_type = tv.m_type;
+  }
+}
+
+PackedArray* PackedArray::MakeVector(uint size, const TypedValue* values) {
+  PackedArray* a = NEW(PackedArray)(size);
+  TypedValue* data = a->m_data;
+  for (uint i = 0; i < size; i++) {
+    tvDupCell(&values[i], &data[i]);
+  }
+  a->m_size = size;
+  a->m_pos = size ? 0 : ArrayData::invalid_index;
+  return a;
+}
+
+HOT_FUNC_VM
+PackedArray::~PackedArray() {
+  for (uint32_t i = 0; i < m_size; ++i) {
+    tvRefcountedDecRef(&m_data[i]);
+  }
+  smart_free(m_data);
+}
+
+ssize_t PackedArray::vsize() const {
+  assert(false && "vsize() called, but m_size should "
+                  "never be -1 in PackedArray");
+  return m_size;
+}
+
+Variant PackedArray::getKey(ssize_t pos) const {
+  assert(size_t(pos) < m_size);
+  return (int64_t)pos;
+}
+
+Variant PackedArray::getValue(ssize_t pos) const {
+  assert(size_t(pos) < m_size);
+  return tvAsCVarRef(&m_data[pos]);
+}
+
+CVarRef PackedArray::getValueRef(ssize_t pos) const {
+  assert(size_t(pos) < m_size);
+  return tvAsCVarRef(&m_data[pos]);
+}
+
+CVarRef PackedArray::get(int64_t k, bool error /* = false */) const {
+  if (LIKELY(uint64_t(k) < m_size)) return tvAsCVarRef(&m_data[k]);
+  return error ? getNotFound(k) : null_variant;
+}
+
+CVarRef PackedArray::get(const StringData* k, bool error /* = false */) const {
+  return error ? getNotFound(k) : null_variant;
+}
+
+void PackedArray::nvGetKey(TypedValue* out, ssize_t pos) {
+  assert(size_t(pos) < m_size);
+  // copy w/out clobbering out->_count.
+  out->m_type = KindOfInt64;
+  out->m_data.num = pos;
+}
+
+TypedValue* PackedArray::stealValues(uint32_t& size, uint32_t& capacity) {
+  assert(getCount() <= 1);
+  for (uint32_t i = 0; i < m_size; ++i) {
+    if (m_data[i].m_type == KindOfRef) return nullptr;
+  }
+  TypedValue* ret = m_data;
+  size = m_size;
+  capacity = m_cap;
+  m_cap = MinCapacity;
+  m_data = (TypedValue*)smart_malloc(m_cap * sizeof(TypedValue));
+  m_size = 0;
+  m_pos = ArrayData::invalid_index;
+  return ret;
+}
+
+//=============================================================================
+// Growing and escalation.
+
+NEVER_INLINE void PackedArray::grow() {
+  m_cap *= 2;
+  m_data = (TypedValue*)smart_realloc(m_data, m_cap * sizeof(TypedValue));
+}
+
+inline ALWAYS_INLINE TypedValue* PackedArray::nextSlot() {
+  if (UNLIKELY(m_size == m_cap)) grow();
+  if (m_pos == ArrayData::invalid_index) m_pos = m_size;
+  return &m_data[m_size++];
+}
+
+/*
+ * A fresh HphpArray with the same elements, refs included, and the same
+ * internal cursor. This array is left alone.
+ */
+HphpArray* PackedArray::toHphpArray() const {
+  HphpArray* ret = ArrayData::Make(m_size);
+  for (uint32_t i = 0; i < m_size; ++i) {
+    CVarRef v = tvAsCVarRef(&m_data[i]);
+    if (m_data[i].m_type == KindOfRef) {
+      ret->appendRef(v, false);
+    } else {
+      ret->append(v, false);
+    }
+  }
+  ret->setPosition(m_pos);
+  return ret;
+}
+
+ArrayData* PackedArray::escalate() const {
+  return toHphpArray();
+}
+
+ArrayData* PackedArray::escalateForSort() {
+  return toHphpArray();
+}
+
+/* if a2 is modified copy of a1 (i.e. != a1), then release a1 and return a2 */
+static inline ArrayData* releaseIfCopied(ArrayData* a1, ArrayData* a2) {
+  if (a1 != a2) a1->release();
+  return a2;
+}
+
+//=============================================================================
+// Writes.
+
+ArrayData* PackedArray::lval(int64_t k, Variant*& ret, bool copy,
+                             bool checkExist /* = false */) {
+  if (LIKELY(uint64_t(k) < m_size)) {
+    PackedArray* a = this;
+    if (copy) {
+      Variant& v = tvAsVariant(&m_data[k]);
+      if (checkExist && (v.isReferenced() || v.isObject())) {
+        ret = &v;
+        return this;
+      }
+      a = copyImpl();
+    }
+    ret = &tvAsVariant(&a->m_data[k]);
+    return a;
+  }
+  if (uint64_t(k) == m_size) return lvalNew(ret, copy);
+  ArrayData* escalated = toHphpArray();
+  return releaseIfCopied(escalated, escalated->lval(k, ret, false));
+}
+
+ArrayData* PackedArray::lval(StringData* k, Variant*& ret, bool copy,
+                             bool checkExist /* = false */) {
+  ArrayData* escalated = toHphpArray();
+  return releaseIfCopied(escalated, escalated->lval(k, ret, false));
+}
+
+ArrayData* PackedArray::lvalNew(Variant*& ret, bool copy) {
+  PackedArray* a = !copy ? this : copyImpl();
+  TypedValue* tv = a->nextSlot();
+  tvWriteNull(tv);
+  ret = &tvAsVariant(tv);
+  return a;
+}
+
+ArrayData* PackedArray::set(int64_t k, CVarRef v, bool copy) {
+  if (LIKELY(uint64_t(k) < m_size)) {
+    PackedArray* a = !copy ? this : copyImpl();
+    tvAsVariant(&a->m_data[k]).assignValHelper(v);
+    return a;
+  }
+  if (uint64_t(k) == m_size) return append(v, copy);
+  ArrayData* escalated = toHphpArray();
+  return releaseIfCopied(escalated, escalated->set(k, v, false));
+}
+
+ArrayData* PackedArray::set(StringData* k, CVarRef v, bool copy) {
+  ArrayData* escalated = toHphpArray();
+  return releaseIfCopied(escalated, escalated->set(k, v, false));
+}
+
+ArrayData* PackedArray::setRef(int64_t k, CVarRef v, bool copy) {
+  if (LIKELY(uint64_t(k) < m_size)) {
+    PackedArray* a = !copy ? this : copyImpl();
+    tvAsVariant(&a->m_data[k]).assignRefHelper(v);
+    return a;
+  }
+  if (uint64_t(k) == m_size) return appendRef(v, copy);
+  ArrayData* escalated = toHphpArray();
+  return releaseIfCopied(escalated, escalated->setRef(k, v, false));
+}
+
+ArrayData* PackedArray::setRef(StringData* k, CVarRef v, bool copy) {
+  ArrayData* escalated = toHphpArray();
+  return releaseIfCopied(escalated, escalated->setRef(k, v, false));
+}
+
+ArrayData* PackedArray::remove(int64_t k, bool copy) {
+  if (uint64_t(k) >= m_size) return this;
+  // Even removing the last element has to escalate: the next append still
+  // uses the old next key.
+  ArrayData* escalated = toHphpArray();
+  return releaseIfCopied(escalated, escalated->remove(k, false));
+}
+
+ArrayData* PackedArray::remove(const StringData* k, bool copy) {
+  return this;
+}
+
+ArrayData* PackedArray::copy() const {
+  return copyImpl();
+}
+
+NEVER_INLINE PackedArray* PackedArray::copyImpl() const {
+  PackedArray* a = NEW(PackedArray)(m_size);
+  for (uint32_t i = 0; i < m_size; ++i) {
+    tvDupFlattenVars(&m_data[i], &a->m_data[i], this);
+  }
+  a->m_size = m_size;
+  a->m_pos = m_pos;
+  return a;
+}
+
+ArrayData* PackedArray::nonSmartCopy() const {
+  // Static arrays are always HphpArrays.
+  HphpArray* escalated = toHphpArray();
+  ArrayData* ret = escalated->nonSmartCopy();
+  escalated->release();
+  return ret;
+}
+
+ArrayData* PackedArray::append(CVarRef v, bool copy) {
+  PackedArray* a = !copy ? this : copyImpl();
+  tvAsUninitializedVariant(a->nextSlot()).constructValHelper(v);
+  return a;
+}
+
+ArrayData* PackedArray::appendRef(CVarRef v, bool copy) {
+  PackedArray* a = !copy ? this : copyImpl();
+  tvAsUninitializedVariant(a->nextSlot()).constructRefHelper(v);
+  return a;
+}
+
+ArrayData* PackedArray::appendWithRef(CVarRef v, bool copy) {
+  PackedArray* a = !copy ? this : copyImpl();
+  TypedValue* tv = a->nextSlot();
+  tvWriteNull(tv);
+  tvAsVariant(tv).setWithRef(v);
+  return a;
+}
+
+ArrayData* PackedArray::AddNewElemC(ArrayData* a, TypedValue value) {
+  assert(a->isPackedArray() && a->getCount() <= 1);
+  assert(value.m_type != KindOfRef);
+  // Moving (data,type) into the array: no incref+decref.
+  TypedValue* tv = static_cast<PackedArray*>(a)->nextSlot();
+  tv->m_type = typeInitNull(value.m_type);
+  tv->m_data.num = value.m_data.num;
+  return a;
+}
+
+ArrayData* PackedArray::plus(const ArrayData* elems, bool copy) {
+  ArrayData* escalated = toHphpArray();
+  return releaseIfCopied(escalated, escalated->plus(elems, false));
+}
+
+ArrayData* PackedArray::merge(const ArrayData* elems, bool copy) {
+  if (!elems->isVectorData()) {
+    ArrayData* escalated = toHphpArray();
+    return releaseIfCopied(escalated, escalated->merge(elems, false));
+  }
+  // Only int keys, which merge renumbers: it's a series of appends.
+  PackedArray* a = !copy ? this : copyImpl();
+  for (ArrayIter it(elems); !it.end(); it.next()) {
+    TypedValue* tv = a->nextSlot();
+    tvWriteNull(tv);
+    tvAsVariant(tv).setWithRef(it.secondRef());
+  }
+  return a;
+}
+
+ArrayData* PackedArray::pop(Variant& value) {
+  PackedArray* a = getCount() <= 1 ? this : copyImpl();
+  if (a->m_size) {
+    TypedValue* tv = &a->m_data[--a->m_size];
+    value = tvAsCVarRef(tv);
+    tvRefcountedDecRef(tv);
+  } else {
+    value = uninit_null();
+  }
+  // To conform to PHP behavior, the pop operation resets the array's
+  // internal iterator.
+  a->m_pos = a->m_size ? 0 : ArrayData::invalid_index;
+  return a;
+}
+
+ArrayData* PackedArray::dequeue(Variant& value) {
+  PackedArray* a = getCount() <= 1 ? this : copyImpl();
+  if (a->m_size) {
+    TypedValue old = a->m_data[0];
+    value = tvAsCVarRef(&old);
+    --a->m_size;
+    memmove(&a->m_data[0], &a->m_data[1], a->m_size * sizeof(TypedValue));
+    tvRefcountedDecRef(&old);
+  } else {
+    value = uninit_null();
+  }
+  // To conform to PHP behavior, the dequeue operation resets the array's
+  // internal iterator
+  a->m_pos = a->m_size ? 0 : ArrayData::invalid_index;
+  return a;
+}
+
+ArrayData* PackedArray::prepend(CVarRef v, bool copy) {
+  PackedArray* a = getCount() <= 1 ? this : copyImpl();
+  if (a->m_size == a->m_cap) a->grow();
+  memmove(&a->m_data[1], &a->m_data[0], a->m_size * sizeof(TypedValue));
+  ++a->m_size;
+  tvAsUninitializedVariant(&a->m_data[0]).constructValHelper(v);
+  // To conform to PHP behavior, the prepend operation resets the array's
+  // internal iterator
+  a->m_pos = 0;
+  return a;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+}
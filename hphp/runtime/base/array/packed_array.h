@@ -0,0 +1,170 @@
+/*
+   +----------------------------------------------------------------------+
+   | HipHop for PHP                                                       |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2010-2013 Facebook, Inc. (http://www.facebook.com)     |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 3.01 of the PHP license,      |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available through the world-wide-web at the following url:           |
+   | http://www.php.net/license/3_01.txt                                  |
+   | If you did not receive a copy of the PHP license and are unable to   |
+   | obtain it through the world-wide-web, please send a note to          |
+   | license@php.net so we can mail you a copy immediately.               |
+   +----------------------------------------------------------------------+
+*/
+
+#ifndef incl_HPHP_PACKED_ARRAY_H_
+#define incl_HPHP_PACKED_ARRAY_H_
+
+#include "hphp/runtime/base/array/array_data.h"
+#include "hphp/runtime/base/complex_types.h"
+#include "hphp/runtime/base/memory/smart_allocator.h"
+
+namespace HPHP {
+///////////////////////////////////////////////////////////////////////////////
+
+class HphpArray;
+
+/**
+ * Array whose keys are exactly 0..size-1, in order. Values are kept in a
+ * plain TypedValue vector, without keys or a hash table, so lookups are an
+ * index and appends a store.
+ *
+ * Anything that would break the key invariant (a string key, an int key
+ * other than the next one, removing an element, sorting) escalates to an
+ * HphpArray holding the same elements, the way SharedMap does. So does
+ * escalate(), which is how mutable iteration and the other users of strong
+ * iterators get an HphpArray; strong iterators are never registered with a
+ * PackedArray.
+ */
+class PackedArray : public ArrayData {
+public:
+  // Create an empty array with room for capacity elements.
+  explicit PackedArray(uint capacity);
+
+  // Create and initialize an array with size elements, populated by
+  // moving (without refcounting) and reversing vals.
+  PackedArray(uint size, const TypedValue* vals); // make tuple
+
+  // Create an array with size elements, copied in order from vals, which
+  // must all be cells, and incref'd.
+  static PackedArray* MakeVector(uint size, const TypedValue* vals);
+
+  ~PackedArray();
+
+  // these using directives ensure the full set of overloaded functions
+  // are visible in this class, to avoid triggering implicit conversions
+  // from a CVarRef key to int64.
+  using ArrayData::exists;
+  using ArrayData::get;
+  using ArrayData::lval;
+  using ArrayData::lvalNew;
+  using ArrayData::set;
+  using ArrayData::setRef;
+  using ArrayData::add;
+  using ArrayData::addLval;
+  using ArrayData::remove;
+
+  // implements ArrayData
+  ssize_t vsize() const;
+  Variant getKey(ssize_t pos) const;
+  Variant getValue(ssize_t pos) const;
+  CVarRef getValueRef(ssize_t pos) const;
+  bool isVectorData() const { return true; }
+
+  bool exists(int64_t k) const { return uint64_t(k) < m_size; }
+  bool exists(const StringData* k) const { return false; }
+
+  CVarRef get(int64_t k, bool error = false) const;
+  CVarRef get(const StringData* k, bool error = false) const;
+
+  ArrayData* lval(int64_t k, Variant*& ret, bool copy,
+                  bool checkExist = false);
+  ArrayData* lval(StringData* k, Variant*& ret, bool copy,
+                  bool checkExist = false);
+  ArrayData* lvalNew(Variant*& ret, bool copy);
+
+  ArrayData* set(int64_t k, CVarRef v, bool copy);
+  ArrayData* set(StringData* k, CVarRef v, bool copy);
+  ArrayData* setRef(int64_t k, CVarRef v, bool copy);
+  ArrayData* setRef(StringData* k, CVarRef v, bool copy);
+
+  ArrayData* remove(int64_t k, bool copy);
+  ArrayData* remove(const StringData* k, bool copy);
+
+  ArrayData* copy() const;
+  ArrayData* nonSmartCopy() const;
+  PackedArray* copyImpl() const;
+
+  ArrayData* append(CVarRef v, bool copy);
+  ArrayData* appendRef(CVarRef v, bool copy);
+  ArrayData* appendWithRef(CVarRef v, bool copy);
+  ArrayData* plus(const ArrayData* elems, bool copy);
+  ArrayData* merge(const ArrayData* elems, bool copy);
+  ArrayData* pop(Variant& value);
+  ArrayData* dequeue(Variant& value);
+  ArrayData* prepend(CVarRef v, bool copy);
+
+  // overrides ArrayData
+  TypedValue* nvGet(int64_t k) const {
+    return LIKELY(uint64_t(k) < m_size) ? &m_data[k] : nullptr;
+  }
+  TypedValue* nvGet(const StringData* k) const { return nullptr; }
+  void nvGetKey(TypedValue* out, ssize_t pos);
+  TypedValue* nvGetValueRef(ssize_t pos) {
+    assert(size_t(pos) < m_size);
+    return &m_data[pos];
+  }
+  TypedValue* nvGetCell(int64_t k) const {
+    return LIKELY(uint64_t(k) < m_size) ? tvToCell(&m_data[k])
+                                        : nvGetNotFound(k);
+  }
+  TypedValue* nvGetCell(const StringData* k) const {
+    return nvGetNotFound(k);
+  }
+
+  ArrayData* escalate() const;
+  ArrayData* escalateForSort();
+
+  /**
+   * Fast path for HphpArray::AddNewElemC: moves value into a, which must
+   * be a PackedArray that isn't shared.
+   */
+  static ArrayData* AddNewElemC(ArrayData* a, TypedValue value);
+
+  // These are for the iterator fast paths.
+  TypedValue* getElm(ssize_t pos) const {
+    assert(size_t(pos) < m_size);
+    return &m_data[pos];
+  }
+  uint32_t getSize() const { return m_size; }
+
+  /**
+   * Hands the value buffer of this array, which must not be shared, to the
+   * caller, who then owns it and its values and must release it with
+   * smart_free(). The array is left empty. Returns nullptr and leaves the
+   * array alone if any of the values is a ref.
+   */
+  TypedValue* stealValues(uint32_t& size, uint32_t& capacity);
+
+  /**
+   * Memory allocator methods.
+   */
+  DECLARE_SMART_ALLOCATION(PackedArray);
+
+private:
+  HphpArray* toHphpArray() const;
+  TypedValue* nextSlot();
+  void grow();
+
+  static const uint32_t MinCapacity = 4;
+
+  TypedValue* m_data;
+  uint32_t m_cap;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+}
+
+#endif // incl_HPHP_PACKED_ARRAY_H_
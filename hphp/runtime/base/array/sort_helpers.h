@@ -234,6 +234,24 @@ struct ElmCompare {
   }
 };
 
+/**
+ * SORT_REGULAR comparison of elements whose values are null, booleans,
+ * numbers or strings. It doesn't refcount, allocate or run PHP code, but
+ * comparing strings may set their numeric-string flags, so only arrays of
+ * plain doubles are safe to sort with it from several threads at once.
+ */
+template <typename AccessorT, bool ascending>
+struct ScalarElmCompare {
+  typedef typename AccessorT::ElmT ElmT;
+  AccessorT acc;
+  bool operator()(ElmT left, ElmT right) const {
+    TypedValue tvLeft = acc.getCell(left);
+    TypedValue tvRight = acc.getCell(right);
+    return ascending ? tvLess(&tvLeft, &tvRight) :
+                       tvGreater(&tvLeft, &tvRight);
+  }
+};
+
 template <typename AccessorT>
 struct ElmUCompare {
   typedef typename AccessorT::ElmT ElmT;
@@ -39,6 +39,7 @@
 #include "hphp/runtime/vm/jit/translator-inline.h"
 #include "hphp/runtime/vm/unit.h"
 #include "hphp/runtime/vm/event_hook.h"
+#include "hphp/runtime/vm/cycle_collector.h"
 #include "hphp/system/systemlib.h"
 
 #include <limits>
@@ -512,13 +513,14 @@ void pause_forever() {
 
 ssize_t check_request_surprise(ThreadInfo *info) {
   RequestInjectionData &p = info->m_reqInjectionData;
-  bool do_timedout, do_memExceeded, do_signaled;
+  bool do_timedout, do_memExceeded, do_signaled, do_gc;
 
   ssize_t flags = p.fetchAndClearFlags();
   do_timedout = (flags & RequestInjectionData::TimedOutFlag) &&
     !p.getDebugger();
   do_memExceeded = (flags & RequestInjectionData::MemExceededFlag);
   do_signaled = (flags & RequestInjectionData::SignaledFlag);
+  do_gc = (flags & RequestInjectionData::PendingGCFlag);
 
   // Start with any pending exception that might be on the thread.
   Exception* pendingException = info->m_pendingException;
@@ -531,6 +533,7 @@ ssize_t check_request_surprise(ThreadInfo *info) {
     pendingException = generate_memory_exceeded_exception();
   }
   if (do_signaled) f_pcntl_signal_dispatch();
+  if (do_gc && !pendingException) CycleCollector::CollectPending();
 
   if (pendingException) {
     pendingException->throwException();
@@ -25,6 +25,7 @@
 #include "hphp/runtime/base/memory/memory_manager.h"
 #include "hphp/runtime/base/memory/smart_allocator.h"
 #include "hphp/runtime/base/memory/leak_detectable.h"
+#include "hphp/runtime/base/memory/request_heap_profiler.h"
 #include "hphp/runtime/base/memory/sweepable.h"
 #include "hphp/runtime/base/builtin_functions.h"
 #include "hphp/runtime/base/runtime_option.h"
@@ -33,6 +34,8 @@
 #include "hphp/util/process.h"
 #include "hphp/util/trace.h"
 
+#include <sys/mman.h>
+
 namespace HPHP {
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -161,7 +164,7 @@ void MemoryManager::AllocIterator::next() {
 }
 
 MemoryManager::MemoryManager() : m_front(0), m_limit(0),
-  m_enabled(RuntimeOption::EnableMemoryManager) {
+  m_enabled(RuntimeOption::EnableMemoryManager), m_hugeSlabs(false) {
 #ifdef USE_JEMALLOC
   threadStats(m_allocated, m_deallocated, m_cactive, m_cactiveLimit);
 #endif
@@ -171,12 +174,19 @@ MemoryManager::MemoryManager() : m_front(0), m_limit(0),
   m_sweep.next = m_sweep.prev = &m_sweep;
 }
 
+MemoryManager::~MemoryManager() {
+  trimSlabPool();
+}
+
 void MemoryManager::resetStats() {
   m_stats.usage = 0;
   m_stats.alloc = 0;
   m_stats.peakUsage = 0;
   m_stats.peakAlloc = 0;
   m_stats.totalAlloc = 0;
+  int64_t interval = RequestHeapProfiler::Interval();
+  m_sampleCountdown = interval ? interval : INT64_MAX;
+  m_cycleCollectThreshold = INT64_MAX;
 #ifdef USE_JEMALLOC
   if (s_statsEnabled) {
     m_stats.jemallocDebt = 0;
@@ -191,11 +201,32 @@ void MemoryManager::refreshStatsHelper() {
   refreshStats();
 }
 
+NEVER_INLINE
+void MemoryManager::sampleAlloc(size_t nbytes) {
+  int64_t interval = RequestHeapProfiler::Interval();
+  if (!interval) {
+    m_sampleCountdown = INT64_MAX;
+    return;
+  }
+  // an allocation bigger than the interval stands for several samples
+  int64_t samples = 1 + -m_sampleCountdown / interval;
+  m_sampleCountdown += samples * interval;
+  RequestHeapProfiler::Sample(nbytes, samples);
+}
+
 void MemoryManager::refreshStatsHelperExceeded() {
   ThreadInfo* info = ThreadInfo::s_threadInfo.getNoCheck();
   info->m_reqInjectionData.setMemExceededFlag();
 }
 
+NEVER_INLINE
+void MemoryManager::requestCycleCollect() {
+  // the collector sets the next threshold once it has run
+  m_cycleCollectThreshold = INT64_MAX;
+  ThreadInfo* info = ThreadInfo::s_threadInfo.getNoCheck();
+  info->m_reqInjectionData.setPendingGCFlag();
+}
+
 #ifdef USE_JEMALLOC
 void MemoryManager::refreshStatsHelperStop() {
   HttpServer::Server->stop();
@@ -224,9 +255,13 @@ void MemoryManager::rollback() {
   for (unsigned int i = 0, n = m_smartAllocators.size(); i < n; i++) {
     m_smartAllocators[i]->clear();
   }
-  // free smart-malloc slabs
+  // free smart-malloc slabs, keeping some of them warm for the next request
   for (SlabIter i = m_slabs.begin(), end = m_slabs.end(); i != end; ++i) {
-    free(*i);
+    if ((int)m_slabPool.size() < RuntimeOption::SlabRetainCount) {
+      m_slabPool.push_back(*i);
+    } else {
+      freeSlab(*i);
+    }
   }
   m_slabs.clear();
   // free large allocation blocks
@@ -256,6 +291,15 @@ void MemoryManager::checkMemory() {
   printf("Peak Alloc: %" PRId64 " bytes\n", m_stats.peakAlloc);
 
   printf("Slabs: %lu KiB\n", m_slabs.size() * SLAB_SIZE / 1024);
+  printf("Retained Slabs: %lu KiB\n", m_slabPool.size() * SLAB_SIZE / 1024);
+}
+
+void MemoryManager::trimSlabPool() {
+  for (SlabIter i = m_slabPool.begin(), end = m_slabPool.end(); i != end;
+       ++i) {
+    freeSlab(*i);
+  }
+  m_slabPool.clear();
 }
 
 //
@@ -279,6 +323,7 @@ inline void* MemoryManager::smartMalloc(size_t nbytes) {
   size_t padbytes = (nbytes + sizeof(SmallNode) + kMask) & ~kMask;
   if (LIKELY(padbytes <= kMaxSmartSize)) {
     m_stats.usage += padbytes;
+    countAlloc(padbytes);
     unsigned i = (padbytes - 1) >> kLgSizeQuantum;
     assert(i < kNumSizes);
     void* p = m_smartfree[i].maybePop();
@@ -336,15 +381,60 @@ inline void* MemoryManager::smartRealloc(void* ptr, size_t nbytes) {
 }
 
 /**
- * Get a new slab, then allocate nbytes from it and install it in our
- * slab list.  Return the newly allocated nbytes-sized block.
+ * Allocate a slab from the system. With HugeSlabs, every slab gets its own
+ * SLAB_SIZE aligned mapping, so that it can be backed by a single huge page.
+ */
+char* MemoryManager::allocSlab() {
+  if (m_slabs.empty() && m_slabPool.empty()) {
+    // only switch modes while we don't hold any slab
+    m_hugeSlabs = RuntimeOption::HugeSlabs;
+  }
+  if (!m_hugeSlabs) {
+    char* slab = (char*) Util::safe_malloc(SLAB_SIZE);
+    JEMALLOC_STATS_ADJUST(&m_stats, SLAB_SIZE);
+    return slab;
+  }
+  size_t len = SLAB_SIZE * 2;
+  char* mem = (char*) mmap(nullptr, len, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (mem == MAP_FAILED) throw OutOfMemoryException(SLAB_SIZE);
+  char* slab = (char*) ((uintptr_t(mem) + SLAB_SIZE - 1) &
+                        ~uintptr_t(SLAB_SIZE - 1));
+  if (slab != mem) munmap(mem, slab - mem);
+  if (slab + SLAB_SIZE != mem + len) {
+    munmap(slab + SLAB_SIZE, mem + len - (slab + SLAB_SIZE));
+  }
+  hintHuge(slab, SLAB_SIZE);
+  return slab;
+}
+
+void MemoryManager::freeSlab(char* slab) {
+  if (m_hugeSlabs) {
+    munmap(slab, SLAB_SIZE);
+  } else {
+    free(slab);
+  }
+}
+
+/**
+ * Get a new slab, from the retained ones if possible, then allocate nbytes
+ * from it and install it in our slab list.  Return the newly allocated
+ * nbytes-sized block.
  */
 NEVER_INLINE char* MemoryManager::newSlab(size_t nbytes) {
   if (UNLIKELY(m_stats.usage > m_stats.maxBytes)) {
     refreshStatsHelper();
   }
-  char* slab = (char*) Util::safe_malloc(SLAB_SIZE);
-  JEMALLOC_STATS_ADJUST(&m_stats, SLAB_SIZE);
+  if (UNLIKELY(m_stats.usage > m_cycleCollectThreshold)) {
+    requestCycleCollect();
+  }
+  char* slab;
+  if (!m_slabPool.empty()) {
+    slab = m_slabPool.back();
+    m_slabPool.pop_back();
+  } else {
+    slab = allocSlab();
+  }
   m_stats.alloc += SLAB_SIZE;
   if (m_stats.alloc > m_stats.peakAlloc) {
     m_stats.peakAlloc = m_stats.alloc;
@@ -366,6 +456,9 @@ inline void* MemoryManager::smartEnlist(SweepNode* n) {
   if (UNLIKELY(m_stats.usage > m_stats.maxBytes)) {
     refreshStatsHelper();
   }
+  if (UNLIKELY(m_stats.usage > m_cycleCollectThreshold)) {
+    requestCycleCollect();
+  }
   // link after m_sweep
   SweepNode* next = m_sweep.next;
   n->next = next;
@@ -379,6 +472,7 @@ NEVER_INLINE
 void* MemoryManager::smartMallocBig(size_t nbytes) {
   assert(nbytes > 0);
   SweepNode* n = (SweepNode*) Util::safe_malloc(nbytes + sizeof(SweepNode));
+  countAlloc(nbytes);
   return smartEnlist(n);
 }
 
@@ -387,6 +481,7 @@ void* MemoryManager::smartCallocBig(size_t totalbytes) {
   assert(totalbytes > 0);
   SweepNode* n = (SweepNode*)Util::safe_calloc(totalbytes + sizeof(SweepNode),
                                                1);
+  countAlloc(totalbytes);
   return smartEnlist(n);
 }
 
@@ -448,10 +543,12 @@ void smart_free(void* ptr) {
 HOT_FUNC
 void* SmartAllocatorImpl::alloc(size_t nbytes) {
   assert(nbytes == size_t(m_itemSize));
-  MM().getStats().usage += nbytes;
+  MemoryManager& mm = MM();
+  mm.getStats().usage += nbytes;
+  mm.countAlloc(nbytes);
   void* ptr = m_free.maybePop();
   if (UNLIKELY(!ptr)) {
-    ptr = MM().slabAlloc(nbytes);
+    ptr = mm.slabAlloc(nbytes);
   }
   TRACE(1, "alloc %zu -> %p\n", nbytes, ptr);
   return ptr;
@@ -163,6 +163,7 @@ public:
   }
 
   MemoryManager();
+  ~MemoryManager();
 
   // State for iteration over all the smart allocators registered in a
   // memory manager.
@@ -198,6 +199,13 @@ public:
   void sweepAll();
   void rollback();
 
+  /**
+   * Free the slabs that rollback() kept around for the next request. Called
+   * when the thread has been idle for a while, see
+   * RuntimeOption::ServerThreadDropCacheTimeoutSeconds.
+   */
+  void trimSlabPool();
+
   /**
    * Write stats to ServerStats.
    */
@@ -323,6 +331,22 @@ public:
     }
   };
 
+  /**
+   * Count nbytes towards the next RequestHeapProfiler sample.
+   */
+  void countAlloc(size_t nbytes) {
+    m_sampleCountdown -= nbytes;
+    if (UNLIKELY(m_sampleCountdown <= 0)) sampleAlloc(nbytes);
+  }
+
+  /**
+   * Ask for a cycle collection at the next surprise check once usage goes
+   * past threshold bytes. See CycleCollector.
+   */
+  void setCycleCollectThreshold(int64_t threshold) {
+    m_cycleCollectThreshold = threshold;
+  }
+
   void* smartMalloc(size_t nbytes);
   void* smartRealloc(void* ptr, size_t nbytes);
   void* smartCallocBig(size_t totalbytes);
@@ -334,11 +358,15 @@ public:
 
 private:
   char* newSlab(size_t nbytes);
+  char* allocSlab();
+  void freeSlab(char* slab);
   void* smartEnlist(SweepNode*);
   void* smartMallocSlab(size_t padbytes);
   void* smartMallocBig(size_t nbytes);
   void  smartFreeBig(SweepNode*);
   void refreshStatsHelperExceeded();
+  void sampleAlloc(size_t nbytes);
+  void requestCycleCollect();
 #ifdef USE_JEMALLOC
   void refreshStatsHelperStop();
 #endif
@@ -354,9 +382,16 @@ private:
   SweepNode m_sweep;   // oversize smart_malloc'd blocks
   MemoryUsageStats m_stats;
   bool m_enabled;
+  // bytes left until the next heap profile sample
+  int64_t m_sampleCountdown;
+  int64_t m_cycleCollectThreshold;
 
   std::vector<SmartAllocatorImpl*> m_smartAllocators;
   std::vector<char*> m_slabs;
+  // slabs retained across requests, see RuntimeOption::SlabRetainCount
+  std::vector<char*> m_slabPool;
+  // whether m_slabs and m_slabPool are huge page mappings or malloc()ed
+  bool m_hugeSlabs;
 
 #ifdef USE_JEMALLOC
   uint64_t* m_allocated;
@@ -0,0 +1,220 @@
+/*
+   +----------------------------------------------------------------------+
+   | HipHop for PHP                                                       |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2010-2013 Facebook, Inc. (http://www.facebook.com)     |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 3.01 of the PHP license,      |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available through the world-wide-web at the following url:           |
+   | http://www.php.net/license/3_01.txt                                  |
+   | If you did not receive a copy of the PHP license and are unable to   |
+   | obtain it through the world-wide-web, please send a note to          |
+   | license@php.net so we can mail you a copy immediately.               |
+   +----------------------------------------------------------------------+
+*/
+
+#include "hphp/runtime/base/memory/request_heap_profiler.h"
+
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <execinfo.h>
+
+#include <map>
+#include <set>
+#include <vector>
+
+#include "hphp/runtime/base/execution_context.h"
+#include "hphp/runtime/vm/bytecode.h"
+#include "hphp/runtime/vm/func.h"
+#include "hphp/runtime/vm/jit/translator.h"
+#include "hphp/util/alloc.h"
+#include "hphp/util/lock.h"
+#include "hphp/util/util.h"
+
+namespace HPHP {
+///////////////////////////////////////////////////////////////////////////////
+
+std::atomic<int64_t> RequestHeapProfiler::s_interval(0);
+
+namespace {
+
+// Only the innermost native frames are kept; the PHP stack stands in for
+// the interpreter and TC frames below them.
+const int kMaxNativeFrames = 16;
+const int kMaxPHPFrames = 64;
+// frames of Sample() and MemoryManager::sampleAlloc() itself
+const int kSkipNativeFrames = 2;
+
+// PHP functions get fake addresses in a range no code is mapped at, so
+// that they can share pprof's stacks with native frames.
+const uintptr_t kPHPFrameBase = 0x7ff0000000000000ULL;
+const uintptr_t kPHPFrameStep = 16;
+
+typedef std::vector<uintptr_t> HeapStack;
+
+struct HeapBucket {
+  HeapBucket() : count(0), bytes(0) {}
+  int64_t count;
+  int64_t bytes;
+};
+
+Mutex s_lock;
+std::map<HeapStack, HeapBucket> s_buckets;
+hphp_string_map<uintptr_t> s_phpFrameIds;
+std::vector<std::string> s_phpFrameNames;
+
+/*
+ * The innermost PHP frame, without syncing the VM registers: we may be in
+ * the middle of a helper called from the TC that has no fixup. When the
+ * registers are dirty, find the first frame on the rbp chain that lives
+ * outside the native stack, the way TranslatorX64::fixupWork() does.
+ */
+const ActRec* innermostVMFrame() {
+  if (g_context.isNull()) return nullptr;
+  if (Transl::tl_regState == Transl::REGSTATE_CLEAN) {
+    return g_vmContext->m_fp;
+  }
+  if (!Util::s_stackSize) return nullptr;
+  DECLARE_FRAME_POINTER(framePtr);
+  const ActRec* rbp = framePtr;
+  for (int i = 0; rbp && i < kMaxNativeFrames * 4; i++) {
+    const ActRec* next = (const ActRec*)rbp->m_savedRbp;
+    if (uintptr_t(next) - Util::s_stackLimit >= Util::s_stackSize) {
+      return next;
+    }
+    // callers' frames sit higher up on the native stack
+    if (next <= rbp) return nullptr;
+    rbp = next;
+  }
+  return nullptr;
+}
+
+uintptr_t phpFrameId(const Func* func) {
+  const char* name = func->fullName()->data();
+  hphp_string_map<uintptr_t>::const_iterator it = s_phpFrameIds.find(name);
+  if (it != s_phpFrameIds.end()) return it->second;
+  uintptr_t id = kPHPFrameBase + s_phpFrameNames.size() * kPHPFrameStep;
+  s_phpFrameIds[name] = id;
+  s_phpFrameNames.push_back(*name ? name : "{pseudomain}");
+  return id;
+}
+
+std::string nativeSymbol(uintptr_t addr) {
+  Dl_info info;
+  if (!dladdr((void*)addr, &info) || !info.dli_sname) return std::string();
+  int status;
+  char* demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr,
+                                        &status);
+  if (!demangled) return info.dli_sname;
+  std::string ret(demangled);
+  free(demangled);
+  return ret;
+}
+
+}
+
+void RequestHeapProfiler::Start(int64_t interval) {
+  assert(interval > 0);
+  Reset();
+  s_interval.store(interval, std::memory_order_relaxed);
+}
+
+void RequestHeapProfiler::Stop() {
+  s_interval.store(0, std::memory_order_relaxed);
+}
+
+void RequestHeapProfiler::Reset() {
+  Lock lock(s_lock);
+  s_buckets.clear();
+}
+
+void RequestHeapProfiler::Sample(size_t nbytes, int64_t samples) {
+  int64_t interval = Interval();
+  if (!interval) return;
+
+  void* native[kMaxNativeFrames + kSkipNativeFrames];
+  int nativeCount = backtrace(native, kMaxNativeFrames + kSkipNativeFrames);
+
+  // Funcs may go away once the request ends, so PHP frames are recorded by
+  // name right away.
+  Lock lock(s_lock);
+  HeapStack stack;
+  stack.reserve(nativeCount + kMaxPHPFrames);
+  for (int i = kSkipNativeFrames; i < nativeCount; i++) {
+    stack.push_back(uintptr_t(native[i]));
+  }
+  int depth = 0;
+  for (const ActRec* fp = innermostVMFrame(); fp && depth < kMaxPHPFrames;
+       fp = g_vmContext->getPrevVMState(fp), depth++) {
+    stack.push_back(phpFrameId(fp->m_func));
+  }
+
+  HeapBucket& bucket = s_buckets[stack];
+  // Each sample stands for one interval's worth of bytes, made of
+  // allocations of this size.
+  bucket.bytes += samples * interval;
+  bucket.count += std::max<int64_t>(1, samples * interval / nbytes);
+}
+
+std::string RequestHeapProfiler::Report() {
+  std::map<HeapStack, HeapBucket> buckets;
+  std::vector<std::string> phpNames;
+  {
+    Lock lock(s_lock);
+    buckets = s_buckets;
+    phpNames = s_phpFrameNames;
+  }
+
+  // pprof looks up every frame but the leaf at addr - 1, so that return
+  // addresses map to the call instruction; list both.
+  std::set<uintptr_t> addrs;
+  HeapBucket total;
+  for (std::map<HeapStack, HeapBucket>::const_iterator it = buckets.begin();
+       it != buckets.end(); ++it) {
+    addrs.insert(it->first.begin(), it->first.end());
+    total.count += it->second.count;
+    total.bytes += it->second.bytes;
+  }
+
+  std::string out;
+  char buf[64];
+  out += "--- symbol\nbinary=hhvm\n";
+  for (std::set<uintptr_t>::const_iterator it = addrs.begin();
+       it != addrs.end(); ++it) {
+    std::string name;
+    if (*it >= kPHPFrameBase) {
+      size_t index = (*it - kPHPFrameBase) / kPHPFrameStep;
+      if (index < phpNames.size()) name = phpNames[index];
+    } else {
+      name = nativeSymbol(*it);
+    }
+    if (name.empty()) continue;
+    snprintf(buf, sizeof(buf), "0x%016lx ", (unsigned long)*it);
+    out += buf + name + "\n";
+    snprintf(buf, sizeof(buf), "0x%016lx ", (unsigned long)(*it - 1));
+    out += buf + name + "\n";
+  }
+  out += "---\n--- heap\n";
+
+  snprintf(buf, sizeof(buf), "%" PRId64 ": %" PRId64, total.count,
+           total.bytes);
+  out += std::string("heap profile: ") + buf + " [" + buf + "]" +
+         " @ heapprofile\n";
+  for (std::map<HeapStack, HeapBucket>::const_iterator it = buckets.begin();
+       it != buckets.end(); ++it) {
+    snprintf(buf, sizeof(buf), "%" PRId64 ": %" PRId64, it->second.count,
+             it->second.bytes);
+    out += std::string(buf) + " [" + buf + "] @";
+    for (HeapStack::const_iterator f = it->first.begin();
+         f != it->first.end(); ++f) {
+      snprintf(buf, sizeof(buf), " 0x%016lx", (unsigned long)*f);
+      out += buf;
+    }
+    out += "\n";
+  }
+  return out;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+}
@@ -0,0 +1,71 @@
+/*
+   +----------------------------------------------------------------------+
+   | HipHop for PHP                                                       |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2010-2013 Facebook, Inc. (http://www.facebook.com)     |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 3.01 of the PHP license,      |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available through the world-wide-web at the following url:           |
+   | http://www.php.net/license/3_01.txt                                  |
+   | If you did not receive a copy of the PHP license and are unable to   |
+   | obtain it through the world-wide-web, please send a note to          |
+   | license@php.net so we can mail you a copy immediately.               |
+   +----------------------------------------------------------------------+
+*/
+
+#ifndef incl_HPHP_REQUEST_HEAP_PROFILER_H_
+#define incl_HPHP_REQUEST_HEAP_PROFILER_H_
+
+#include <atomic>
+#include <string>
+
+#include "hphp/util/base.h"
+
+namespace HPHP {
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Sampling profiler for the request heap, i.e. memory handed out by
+ * smart_malloc() and the smart allocators.
+ *
+ * Every thread's MemoryManager counts down the bytes it allocates, and once
+ * Interval() bytes went by it records the current PHP stack followed by the
+ * native stack. Each sample stands for Interval() bytes of allocations.
+ * Samples are aggregated by stack across all requests until Reset(), and
+ * Report() renders them as a symbolized pprof heap profile. Since request
+ * memory is all freed at request end, the profile shows where memory was
+ * allocated, not what is still live.
+ */
+class RequestHeapProfiler {
+public:
+  /**
+   * Sampling interval in bytes, 0 when the profiler is off. Threads pick up
+   * a change at their next request.
+   */
+  static int64_t Interval() {
+    return s_interval.load(std::memory_order_relaxed);
+  }
+  static void Start(int64_t interval);
+  static void Stop();
+  static void Reset();
+
+  /**
+   * Records the current stack for an allocation of nbytes that crossed
+   * "samples" sampling intervals.
+   */
+  static void Sample(size_t nbytes, int64_t samples);
+
+  /**
+   * The samples so far, as a pprof heap profile with a symbol section.
+   */
+  static std::string Report();
+
+private:
+  static std::atomic<int64_t> s_interval;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+}
+
+#endif // incl_HPHP_REQUEST_HEAP_PROFILER_H_
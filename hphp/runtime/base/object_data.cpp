@@ -49,6 +49,9 @@ static StaticString s_serialize("serialize");
 
 ObjectData::~ObjectData() {
   if (ArrayData* a = o_properties.get()) decRefArr(a);
+  if (UNLIKELY(getAttribute(IsCycleRoot))) {
+    CycleCollector::RemoveRoot(this);
+  }
   int &pmax = *os_max_id;
   if (o_id && o_id == pmax) {
     --pmax;
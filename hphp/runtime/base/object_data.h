@@ -22,6 +22,7 @@
 #include "hphp/runtime/base/types.h"
 #include "hphp/runtime/base/macros.h"
 #include "hphp/runtime/base/runtime_error.h"
+#include "hphp/runtime/vm/cycle_collector.h"
 #include "hphp/system/systemlib.h"
 
 #include <boost/mpl/eval_if.hpp>
@@ -61,6 +62,7 @@ class ObjectData : public CountableNF {
     HasCall       = 0x0080, // defines __call
     HasCallStatic = 0x0100, // defines __callStatic
     CallToImpl    = 0x0200, // call o_to{Boolean,Int64,Double}Impl
+    IsCycleRoot   = 0x0400, // buffered by the CycleCollector
     // The top 3 bits of o_attributes are reserved to indicate the
     // type of collection
     CollectionTypeAttrMask = (7 << 13),
@@ -83,6 +85,9 @@ class ObjectData : public CountableNF {
     assert(uintptr_t(this) % sizeof(TypedValue) == 0);
     if (!noId) {
       o_id = ++(*os_max_id);
+      if (UNLIKELY(CycleCollector::IsTracking())) {
+        CycleCollector::AddRoot(this);
+      }
     }
   }
 
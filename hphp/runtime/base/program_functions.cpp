@@ -63,6 +63,7 @@
 #include "hphp/runtime/base/file_repository.h"
 
 #include "hphp/runtime/vm/runtime.h"
+#include "hphp/runtime/vm/cycle_collector.h"
 #include "hphp/runtime/vm/repo.h"
 #include "hphp/runtime/vm/jit/translator.h"
 #include "hphp/compiler/builtin_symbols.h"
@@ -1249,6 +1250,7 @@ void hphp_process_init() {
   int64_t save = RuntimeOption::SerializationSizeLimit;
   RuntimeOption::SerializationSizeLimit = StringData::MaxSize;
   apc_load(RuntimeOption::ApcLoadThread);
+  apc_load_snapshot();
   RuntimeOption::SerializationSizeLimit = save;
 
   Transl::TargetCache::requestExit();
@@ -1327,6 +1329,7 @@ void hphp_session_init() {
   StatCache::requestInit();
 
   g_vmContext->requestInit();
+  CycleCollector::RequestInit();
 
   EnvConstants *g = get_env_constants();
   g->k_PHP_SAPI = StringData::GetStaticString(RuntimeOption::ExecutionMode);
@@ -1429,6 +1432,7 @@ void hphp_session_exit() {
   g_context.destroy();
 
   ThreadInfo::s_threadInfo->clearPendingException();
+  CycleCollector::RequestExit();
 
   MemoryManager *mm = MemoryManager::TheMemoryManager();
   if (RuntimeOption::CheckMemory) {
@@ -22,6 +22,9 @@ IMPLEMENT_SMART_ALLOCATION(RefData);
 
 RefData::~RefData() {
   assert(m_magic == kMagic);
+  if (UNLIKELY(CycleCollector::IsTracking())) {
+    CycleCollector::RemoveRoot(this);
+  }
   tvAsVariant(&m_tv).~Variant();
 }
 
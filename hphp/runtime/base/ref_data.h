@@ -22,6 +22,8 @@
 #ifndef incl_HPHP_REF_DATA_H
 #define incl_HPHP_REF_DATA_H
 
+#include "hphp/runtime/vm/cycle_collector.h"
+
 namespace HPHP {
 
 /**
@@ -33,15 +35,20 @@ class RefData {
   enum Magic : uint64_t { kMagic = 0xfacefaceb00cb00c };
 public:
   enum NullInit { nullinit };
-  RefData() { assert(m_magic = kMagic); }
+  RefData() {
+    assert(m_magic = kMagic);
+    addCycleRoot();
+  }
   RefData(NullInit) {
     assert(m_magic = kMagic);
     _count = 1;
     m_tv.m_type = KindOfNull;
+    addCycleRoot();
   }
   RefData(DataType t, int64_t datum) {
     assert(m_magic = kMagic);
     init(t, datum);
+    addCycleRoot();
   }
   ~RefData();
 
@@ -78,6 +85,10 @@ public:
   }
 
 private:
+  void addCycleRoot() {
+    if (UNLIKELY(CycleCollector::IsTracking())) CycleCollector::AddRoot(this);
+  }
+
   // initialize this value by laundering uninitNull -> Null
   void init(DataType t, int64_t datum) {
     _count = 1;
@@ -29,6 +29,7 @@
 #include "hphp/runtime/base/shared/shared_store_base.h"
 #include "hphp/runtime/base/server/access_log.h"
 #include "hphp/runtime/base/memory/leak_detectable.h"
+#include "hphp/runtime/base/memory/request_heap_profiler.h"
 #include "hphp/runtime/base/util/extended_logger.h"
 #include "hphp/runtime/base/util/simple_counter.h"
 #include "hphp/util/util.h"
@@ -85,6 +86,9 @@ int64_t RuntimeOption::StringOffsetLimit = 10 * 1024 * 1024; // 10MB
 
 std::string RuntimeOption::AccessLogDefaultFormat;
 std::vector<AccessLogFileData> RuntimeOption::AccessLogs;
+bool RuntimeOption::AccessLogAsync = false;
+int RuntimeOption::AccessLogBufferSize = 256 * 1024;
+int RuntimeOption::AccessLogFlushInterval = 10;
 
 std::string RuntimeOption::AdminLogFormat;
 std::string RuntimeOption::AdminLogFile;
@@ -108,6 +112,12 @@ int RuntimeOption::ServerWarmupThrottleRequestCount =
   kDefaultWarmupThrottleRequestCount;
 int RuntimeOption::ServerThreadDropCacheTimeoutSeconds = 0;
 bool RuntimeOption::ServerThreadJobLIFO = false;
+bool RuntimeOption::ServerThreadWorkStealing = false;
+bool RuntimeOption::ServerThreadNuma = false;
+int RuntimeOption::ServerAcceptorCount = 1;
+int RuntimeOption::ServerQueueDelayTarget = 0;
+int RuntimeOption::ServerQueueDelayInterval = 100;
+bool RuntimeOption::ServerAcceptorAffinity = false;
 bool RuntimeOption::ServerThreadDropStack = false;
 bool RuntimeOption::ServerHttpSafeMode = false;
 bool RuntimeOption::ServerStatCache = true;
@@ -116,6 +126,7 @@ int RuntimeOption::PageletServerThreadCount = 0;
 bool RuntimeOption::PageletServerThreadRoundRobin = false;
 int RuntimeOption::PageletServerThreadDropCacheTimeoutSeconds = 0;
 int RuntimeOption::PageletServerQueueLimit = 0;
+int RuntimeOption::PageletServerQueueDelayTarget = 0;
 bool RuntimeOption::PageletServerThreadDropStack = false;
 int RuntimeOption::FiberCount = 1;
 int RuntimeOption::RequestTimeoutSeconds = 0;
@@ -177,6 +188,7 @@ SatelliteServerInfoPtrVec RuntimeOption::SatelliteServerInfos;
 
 int RuntimeOption::XboxServerThreadCount = 10;
 int RuntimeOption::XboxServerMaxQueueLength = INT_MAX;
+int RuntimeOption::XboxServerQueueDelayTarget = 0;
 int RuntimeOption::XboxServerPort = 0;
 int RuntimeOption::XboxDefaultLocalTimeoutMilliSeconds = 500;
 int RuntimeOption::XboxDefaultRemoteTimeoutSeconds = 5;
@@ -204,6 +216,7 @@ bool RuntimeOption::EnableStaticContentCache = true;
 bool RuntimeOption::EnableStaticContentFromDisk = true;
 bool RuntimeOption::EnableOnDemandUncompress = true;
 bool RuntimeOption::EnableStaticContentMMap = true;
+bool RuntimeOption::EnableStaticContentSendFile = false;
 
 bool RuntimeOption::Utf8izeReplace = true;
 
@@ -317,6 +330,9 @@ int RuntimeOption::SocketDefaultTimeout = 5;
 bool RuntimeOption::LockCodeMemory = false;
 bool RuntimeOption::EnableMemoryManager = true;
 bool RuntimeOption::CheckMemory = false;
+int RuntimeOption::SlabRetainCount = 0;
+bool RuntimeOption::HugeSlabs = false;
+int64_t RuntimeOption::RequestHeapProfileInterval = 0;
 int RuntimeOption::MaxArrayChain = INT_MAX;
 bool RuntimeOption::StrictCollections = true;
 bool RuntimeOption::WarnOnCollectionToArray = false;
@@ -328,9 +344,13 @@ std::string RuntimeOption::ApcPrimeLibrary;
 int RuntimeOption::ApcLoadThread = 1;
 std::set<std::string> RuntimeOption::ApcCompletionKeys;
 RuntimeOption::ApcTableTypes RuntimeOption::ApcTableType = ApcConcurrentTable;
+int RuntimeOption::ApcShardCount = 0;
 bool RuntimeOption::EnableApcSerialize = true;
 time_t RuntimeOption::ApcKeyMaturityThreshold = 20;
 size_t RuntimeOption::ApcMaximumCapacity = 0;
+int64_t RuntimeOption::ApcMemoryLimit = 0;
+std::string RuntimeOption::ApcSnapshotFile;
+int RuntimeOption::ApcCompressThreshold = 0;
 int RuntimeOption::ApcKeyFrequencyUpdatePeriod = 1000;
 bool RuntimeOption::ApcExpireOnSets = false;
 int RuntimeOption::ApcPurgeFrequency = 4096;
@@ -623,6 +643,10 @@ void RuntimeOption::Load(Hdf &config, StringVec *overwrites /* = NULL */,
                                       getString(AccessLogDefaultFormat)));
       }
     }
+    AccessLogAsync = logger["AccessLogAsync"].getBool(false);
+    AccessLogBufferSize = logger["AccessLogBufferSize"].getInt32(256 * 1024);
+    AccessLogFlushInterval = logger["AccessLogFlushInterval"].getInt32(10);
+    if (AccessLogFlushInterval < 1) AccessLogFlushInterval = 1;
 
     AdminLogFormat = logger["AdminLog.Format"].getString("%h %t %s %U");
     AdminLogFile = logger["AdminLog.File"].getString();
@@ -687,6 +711,14 @@ void RuntimeOption::Load(Hdf &config, StringVec *overwrites /* = NULL */,
     ServerThreadDropCacheTimeoutSeconds =
       server["ThreadDropCacheTimeoutSeconds"].getInt32(0);
     ServerThreadJobLIFO = server["ThreadJobLIFO"].getBool();
+    ServerThreadWorkStealing = server["ThreadWorkStealing"].getBool();
+    ServerThreadNuma = server["ThreadNuma"].getBool();
+    ServerAcceptorCount = server["AcceptorCount"].getInt32(1);
+    if (ServerAcceptorCount < 1) ServerAcceptorCount = 1;
+    ServerAcceptorAffinity = server["AcceptorAffinity"].getBool();
+    ServerQueueDelayTarget = server["QueueDelayTarget"].getInt32(0);
+    ServerQueueDelayInterval = server["QueueDelayInterval"].getInt32(100);
+    if (ServerQueueDelayInterval <= 0) ServerQueueDelayInterval = 100;
     ServerThreadDropStack = server["ThreadDropStack"].getBool();
     ServerHttpSafeMode = server["HttpSafeMode"].getBool();
     ServerStatCache = server["StatCache"].getBool(true);
@@ -775,6 +807,8 @@ void RuntimeOption::Load(Hdf &config, StringVec *overwrites /* = NULL */,
     if (EnableStaticContentMMap) {
       EnableOnDemandUncompress = true;
     }
+    EnableStaticContentSendFile =
+      server["EnableStaticContentSendFile"].getBool(false);
     Utf8izeReplace = server["Utf8izeReplace"].getBool(true);
 
     StartupDocument = server["StartupDocument"].getString();
@@ -813,6 +847,13 @@ void RuntimeOption::Load(Hdf &config, StringVec *overwrites /* = NULL */,
       MemoryManager::TheMemoryManager()->disable();
     }
     CheckMemory = server["CheckMemory"].getBool();
+    SlabRetainCount = server["SlabRetainCount"].getInt32(0);
+    HugeSlabs = server["HugeSlabs"].getBool(false);
+    RequestHeapProfileInterval =
+      server["RequestHeapProfileInterval"].getInt64(0);
+    if (RequestHeapProfileInterval > 0) {
+      RequestHeapProfiler::Start(RequestHeapProfileInterval);
+    }
     MaxArrayChain = server["MaxArrayChain"].getInt32(INT_MAX);
     if (MaxArrayChain != INT_MAX) {
       // HphpArray needs a higher threshold to avoid false-positives.
@@ -836,10 +877,14 @@ void RuntimeOption::Load(Hdf &config, StringVec *overwrites /* = NULL */,
     string apcTableType = apc["TableType"].getString("concurrent");
     if (strcasecmp(apcTableType.c_str(), "concurrent") == 0) {
       ApcTableType = ApcConcurrentTable;
+    } else if (strcasecmp(apcTableType.c_str(), "sharded") == 0) {
+      ApcTableType = ApcShardedTable;
     } else {
       throw InvalidArgumentException("apc table type",
                                      "Invalid table type");
     }
+    ApcShardCount = apc["ShardCount"].getInt32(Process::GetCPUCount());
+    if (ApcShardCount < 1) ApcShardCount = 1;
     EnableApcSerialize = apc["EnableApcSerialize"].getBool(true);
     ApcExpireOnSets = apc["ExpireOnSets"].getBool();
     ApcPurgeFrequency = apc["PurgeFrequency"].getInt32(4096);
@@ -847,6 +892,9 @@ void RuntimeOption::Load(Hdf &config, StringVec *overwrites /* = NULL */,
 
     ApcAllowObj = apc["AllowObject"].getBool();
     ApcTTLLimit = apc["TTLLimit"].getInt32(-1);
+    ApcMemoryLimit = apc["MemoryLimit"].getInt64(0);
+    ApcSnapshotFile = apc["SnapshotFile"].getString();
+    ApcCompressThreshold = apc["CompressThreshold"].getInt32(0);
     Hdf fileStorage = apc["FileStorage"];
     ApcUseFileStorage = fileStorage["Enable"].getBool();
     ApcFileStorageChunkSize = fileStorage["ChunkSize"].getInt64(1LL << 29);
@@ -950,6 +998,8 @@ void RuntimeOption::Load(Hdf &config, StringVec *overwrites /* = NULL */,
     XboxServerMaxQueueLength =
       xbox["ServerInfo.MaxQueueLength"].getInt32(INT_MAX);
     if (XboxServerMaxQueueLength < 0) XboxServerMaxQueueLength = INT_MAX;
+    XboxServerQueueDelayTarget =
+      xbox["ServerInfo.QueueDelayTarget"].getInt32(0);
     XboxServerPort = xbox["ServerInfo.Port"].getInt32(0);
     XboxDefaultLocalTimeoutMilliSeconds =
       xbox["DefaultLocalTimeoutMilliSeconds"].getInt32(500);
@@ -973,6 +1023,7 @@ void RuntimeOption::Load(Hdf &config, StringVec *overwrites /* = NULL */,
     PageletServerThreadDropCacheTimeoutSeconds =
       pagelet["ThreadDropCacheTimeoutSeconds"].getInt32(0);
     PageletServerQueueLimit = pagelet["QueueLimit"].getInt32(0);
+    PageletServerQueueDelayTarget = pagelet["QueueDelayTarget"].getInt32(0);
   }
   {
     FiberCount = config["Fiber.ThreadCount"].getInt32(Process::GetCPUCount());
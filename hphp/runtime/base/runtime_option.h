@@ -81,6 +81,9 @@ public:
 
   static std::string AccessLogDefaultFormat;
   static std::vector<AccessLogFileData> AccessLogs;
+  static bool AccessLogAsync;
+  static int AccessLogBufferSize;
+  static int AccessLogFlushInterval;
 
   static std::string AdminLogFormat;
   static std::string AdminLogFile;
@@ -101,6 +104,12 @@ public:
   static bool ServerThreadRoundRobin;
   static int ServerThreadDropCacheTimeoutSeconds;
   static bool ServerThreadJobLIFO;
+  static bool ServerThreadWorkStealing;
+  static bool ServerThreadNuma;
+  static int ServerAcceptorCount;
+  static bool ServerAcceptorAffinity;
+  static int ServerQueueDelayTarget;
+  static int ServerQueueDelayInterval;
   static bool ServerThreadDropStack;
   static bool ServerHttpSafeMode;
   static bool ServerStatCache;
@@ -109,6 +118,7 @@ public:
   static bool PageletServerThreadRoundRobin;
   static int PageletServerThreadDropCacheTimeoutSeconds;
   static int PageletServerQueueLimit;
+  static int PageletServerQueueDelayTarget;
   static bool PageletServerThreadDropStack;
 
   static int FiberCount;
@@ -172,6 +182,7 @@ public:
 
   static int XboxServerThreadCount;
   static int XboxServerMaxQueueLength;
+  static int XboxServerQueueDelayTarget;
   static int XboxServerPort;
   static int XboxDefaultLocalTimeoutMilliSeconds;
   static int XboxDefaultRemoteTimeoutSeconds;
@@ -199,6 +210,7 @@ public:
   static bool EnableStaticContentFromDisk;
   static bool EnableOnDemandUncompress;
   static bool EnableStaticContentMMap;
+  static bool EnableStaticContentSendFile;
 
   static bool Utf8izeReplace;
 
@@ -311,6 +323,9 @@ public:
   static bool LockCodeMemory;
   static bool EnableMemoryManager;
   static bool CheckMemory;
+  static int SlabRetainCount;
+  static bool HugeSlabs;
+  static int64_t RequestHeapProfileInterval;
   static int MaxArrayChain;
   static bool StrictCollections;
   static bool WarnOnCollectionToArray;
@@ -322,12 +337,17 @@ public:
   static int ApcLoadThread;
   static std::set<std::string> ApcCompletionKeys;
   enum ApcTableTypes {
-    ApcConcurrentTable
+    ApcConcurrentTable,
+    ApcShardedTable
   };
   static ApcTableTypes ApcTableType;
+  static int ApcShardCount;
   static bool EnableApcSerialize;
   static time_t ApcKeyMaturityThreshold;
   static size_t ApcMaximumCapacity;
+  static int64_t ApcMemoryLimit;
+  static std::string ApcSnapshotFile;
+  static int ApcCompressThreshold;
   static int ApcKeyFrequencyUpdatePeriod;
   static bool ApcExpireOnSets;
   static int ApcPurgeFrequency;
@@ -453,6 +473,13 @@ public:
   F(uint32_t, InitialNamedEntityTableSize,  30000)                      \
   F(uint32_t, InitialStaticStringTableSize, 100000)                     \
   F(uint32_t, PCRETableSize, kPCREInitialTableSize)                     \
+  F(bool, EnableCycleCollector,        false)                           \
+  F(uint64_t, CycleCollectorThreshold, 32 << 20)                        \
+  F(bool, EnablePackedArrays,          false)                           \
+  F(bool, HphpArrayGroupProbe,         false)                           \
+  F(bool, EnableRadixSort,             false)                           \
+  F(uint32_t, ParallelSortMinSize,     0)                               \
+  F(bool, FastJsonDecode,              true)                            \
   /* */                                                                 \
 
 #define F(type, name, unused) \
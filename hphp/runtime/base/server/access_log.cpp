@@ -26,6 +26,9 @@
 #include "hphp/util/compatibility.h"
 #include "hphp/util/util.h"
 #include "hphp/runtime/base/hardware_counter.h"
+#include <algorithm>
+#include <sys/uio.h>
+#include <limits.h>
 
 using std::endl;
 
@@ -34,6 +37,7 @@ namespace HPHP {
 ///////////////////////////////////////////////////////////////////////////////
 
 AccessLog::~AccessLog() {
+  stopFlusher();
   signal(SIGCHLD, SIG_DFL);
   for (uint i = 0; i < m_output.size(); ++i) {
     if (m_output[i].log) {
@@ -104,6 +108,9 @@ void AccessLog::openFiles(const string &username) {
       m_output.emplace_back(fp);
     }
   }
+  if (RuntimeOption::AccessLogAsync) {
+    startFlusher();
+  }
 }
 
 void AccessLog::log(Transport *transport, const VirtualHost *vhost) {
@@ -120,39 +127,172 @@ void AccessLog::log(Transport *transport, const VirtualHost *vhost) {
                              threadData->prevBytesWritten,
                              threadLog);
   }
+  if (m_flusher) {
+    logAsync(transport, vhost);
+    return;
+  }
+  for (uint i = 0; i < m_files.size(); ++i) {
+    FILE *outFile = getOutputFile(i);
+    if (!outFile) continue;
+    const char *format = m_files[i].format.c_str();
+    int bytes = writeLog(transport, vhost, outFile, format);
+    onBytesWritten(i, outFile, bytes);
+  }
+}
+
+FILE *AccessLog::getOutputFile(int i) {
   if (Logger::UseCronolog) {
-    for (uint i = 0; i < m_cronOutput.size(); ++i) {
-      Cronolog &cronOutput = *m_cronOutput[i];
-      FILE *outFile = cronOutput.getOutputFile();
-      if (!outFile) continue;
-      const char *format = m_files[i].format.c_str();
-      int bytes = writeLog(transport, vhost, outFile, format);
-      cronOutput.m_bytesWritten.fetch_add(bytes, std::memory_order_relaxed);
-      cronOutput.m_prevBytesWritten = Logger::checkDropCache(
-        cronOutput.m_bytesWritten.load(std::memory_order_relaxed),
-        cronOutput.m_prevBytesWritten,
-        outFile);
-    }
+    return m_cronOutput[i]->getOutputFile();
+  }
+  return m_output[i].log;
+}
+
+void AccessLog::onBytesWritten(int i, FILE *outFile, int bytes) {
+  if (Logger::UseCronolog) {
+    Cronolog &cronOutput = *m_cronOutput[i];
+    cronOutput.m_bytesWritten.fetch_add(bytes, std::memory_order_relaxed);
+    cronOutput.m_prevBytesWritten = Logger::checkDropCache(
+      cronOutput.m_bytesWritten.load(std::memory_order_relaxed),
+      cronOutput.m_prevBytesWritten,
+      outFile);
   } else {
-    for (uint i = 0; i < m_output.size(); ++i) {
-      LogFileData& output = m_output[i];
-      FILE *outFile = output.log;
-      if (!outFile) continue;
-      const char *format = m_files[i].format.c_str();
-      int bytes = writeLog(transport, vhost, outFile, format);
-      output.bytesWritten.fetch_add(bytes, std::memory_order_relaxed);
-      if (m_files[i].file[0] != '|') {
-        output.prevBytesWritten =
-          Logger::checkDropCache(output.bytesWritten,
-                                 output.prevBytesWritten,
-                                 outFile);
-      }
+    LogFileData& output = m_output[i];
+    output.bytesWritten.fetch_add(bytes, std::memory_order_relaxed);
+    if (m_files[i].file[0] != '|') {
+      output.prevBytesWritten =
+        Logger::checkDropCache(output.bytesWritten,
+                               output.prevBytesWritten,
+                               outFile);
+    }
+  }
+}
+
+void AccessLog::logAsync(Transport *transport, const VirtualHost *vhost) {
+  ThreadData *threadData = m_fGetThreadData();
+  if (!threadData->ring) {
+    threadData->ring = std::make_shared<LogRingBuffer>(
+      RuntimeOption::AccessLogBufferSize);
+    Lock l(m_ringsLock);
+    m_rings.push_back(threadData->ring);
+  }
+  for (uint i = 0; i < m_files.size(); ++i) {
+    const char *format = m_files[i].format.c_str();
+    string line = formatLog(transport, vhost, format);
+    if (!threadData->ring->write(i, line.data(), line.size())) {
+      ServerStats::Log("accesslog.dropped", 1);
+      ServerStats::Log("accesslog.dropped_bytes", line.size());
+    }
+  }
+}
+
+void AccessLog::startFlusher() {
+  assert(!m_flusher);
+  m_stopping.store(false, std::memory_order_relaxed);
+  m_flusher.reset(new AsyncFunc<AccessLog>(this, &AccessLog::flusherLoop));
+  m_flusher->start();
+}
+
+void AccessLog::stopFlusher() {
+  if (!m_flusher) return;
+  m_stopping.store(true, std::memory_order_release);
+  m_flusher->waitForEnd();
+  m_flusher.reset();
+}
+
+void AccessLog::flusherLoop() {
+  while (!m_stopping.load(std::memory_order_acquire)) {
+    if (!flushRings()) {
+      usleep(RuntimeOption::AccessLogFlushInterval * 1000);
+    }
+  }
+  // drain whatever was logged before we were asked to stop
+  while (flushRings()) {}
+}
+
+static int writev_all(int fd, std::vector<iovec> &iovs) {
+  int total = 0;
+  size_t i = 0;
+  while (i < iovs.size()) {
+    int count = std::min<size_t>(iovs.size() - i, IOV_MAX);
+    ssize_t n = writev(fd, &iovs[i], count);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      Logger::Error("Failed to write access log: %s",
+                    Util::safe_strerror(errno).c_str());
+      break;
+    }
+    total += n;
+    while (i < iovs.size() && (size_t)n >= iovs[i].iov_len) {
+      n -= iovs[i++].iov_len;
+    }
+    if (n > 0) {
+      iovs[i].iov_base = (char*)iovs[i].iov_base + n;
+      iovs[i].iov_len -= n;
     }
   }
+  return total;
+}
+
+/*
+ * Writes out one batch from every thread's ring. Returns true if some ring
+ * still had more records than fit in a batch.
+ */
+bool AccessLog::flushRings() {
+  static const size_t kMaxBatch = 1024;
+
+  std::vector<std::shared_ptr<LogRingBuffer> > rings;
+  {
+    Lock l(m_ringsLock);
+    // rings of threads that have exited can go once they are drained
+    m_rings.erase(std::remove_if(m_rings.begin(), m_rings.end(),
+                                 [] (const std::shared_ptr<LogRingBuffer> &r) {
+                                   return r.unique() && r->empty();
+                                 }),
+                  m_rings.end());
+    rings = m_rings;
+  }
+
+  std::vector<std::vector<iovec> > iovs(m_files.size());
+  std::vector<LogRingBuffer::Record> records;
+  bool more = false;
+  for (auto &ring : rings) {
+    records.clear();
+    ring->read(records, kMaxBatch);
+    for (auto &rec : records) {
+      if (rec.tag >= iovs.size()) continue;
+      iovec iov;
+      iov.iov_base = const_cast<char*>(rec.data);
+      iov.iov_len = rec.len;
+      iovs[rec.tag].push_back(iov);
+    }
+    more = more || !ring->empty();
+  }
+
+  for (uint i = 0; i < iovs.size(); ++i) {
+    if (iovs[i].empty()) continue;
+    // may rotate cronolog files, which is better done here than on requests
+    FILE *outFile = getOutputFile(i);
+    if (!outFile) continue;
+    int bytes = writev_all(fileno(outFile), iovs[i]);
+    onBytesWritten(i, outFile, bytes);
+  }
+
+  for (auto &ring : rings) {
+    ring->consume();
+  }
+  return more;
 }
 
 int AccessLog::writeLog(Transport *transport, const VirtualHost *vhost,
                         FILE *outFile, const char *format) {
+  string output = formatLog(transport, vhost, format);
+  int nbytes = fprintf(outFile, "%s", output.c_str());
+  fflush(outFile);
+  return nbytes;
+}
+
+string AccessLog::formatLog(Transport *transport, const VirtualHost *vhost,
+                            const char *format) {
    char c;
    std::ostringstream out;
    while ((c = *format++)) {
@@ -172,10 +312,7 @@ int AccessLog::writeLog(Transport *transport, const VirtualHost *vhost,
      }
    }
    out << endl;
-   string output = out.str();
-   int nbytes = fprintf(outFile, "%s", output.c_str());
-   fflush(outFile);
-   return nbytes;
+   return out.str();
 }
 
 bool AccessLog::parseConditions(const char* &format, int code) {
@@ -21,6 +21,8 @@
 #include "hphp/util/logger.h"
 #include "hphp/util/lock.h"
 #include "hphp/util/cronolog.h"
+#include "hphp/util/log_ring_buffer.h"
+#include "hphp/util/async_func.h"
 
 namespace HPHP {
 ///////////////////////////////////////////////////////////////////////////////
@@ -45,10 +47,12 @@ public:
     int64_t startTime;
     int bytesWritten;
     int prevBytesWritten;
+    // shared with the flusher, which writes out what's left after we exit
+    std::shared_ptr<LogRingBuffer> ring;
   };
   typedef ThreadData* (*GetThreadDataFunc)();
   AccessLog(GetThreadDataFunc f) :
-      m_initialized(false), m_fGetThreadData(f) {}
+      m_initialized(false), m_fGetThreadData(f), m_stopping(false) {}
   ~AccessLog();
   void init(const std::string &defaultFormat,
             std::vector<AccessLogFileData> &files,
@@ -68,8 +72,13 @@ private:
                 Transport *transport, const VirtualHost *vhost,
                 const std::string &arg);
   void skipField(const char* &format);
+  std::string formatLog(Transport *transport, const VirtualHost *vhost,
+                        const char *format);
   int writeLog(Transport *transport, const VirtualHost *vhost,
                FILE *outFile, const char *format);
+  void logAsync(Transport *transport, const VirtualHost *vhost);
+  FILE *getOutputFile(int i);
+  void onBytesWritten(int i, FILE *outFile, int bytes);
 
   std::vector<LogFileData> m_output;
   std::vector<CronologPtr> m_cronOutput;
@@ -80,6 +89,22 @@ private:
 
   void openFiles(const std::string &username);
   Mutex m_lock;
+
+  /*
+   * With Log.AccessLogAsync, request threads only format their lines and
+   * push them into per-thread rings; the flusher thread drains all the rings
+   * and writes each file with writev(). A full ring drops the line rather
+   * than blocking the request.
+   */
+  void startFlusher();
+  void stopFlusher();
+  void flusherLoop();
+  bool flushRings();
+
+  std::unique_ptr<AsyncFunc<AccessLog> > m_flusher;
+  std::atomic<bool> m_stopping;
+  Mutex m_ringsLock;
+  std::vector<std::shared_ptr<LogRingBuffer> > m_rings;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
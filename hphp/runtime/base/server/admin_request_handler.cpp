@@ -31,6 +31,7 @@
 #include "hphp/runtime/base/program_functions.h"
 #include "hphp/runtime/base/shared/shared_store_base.h"
 #include "hphp/runtime/base/memory/leak_detectable.h"
+#include "hphp/runtime/base/memory/request_heap_profiler.h"
 #include "hphp/runtime/ext/mysql_stats.h"
 #include "hphp/runtime/base/shared/shared_store_stats.h"
 #include "hphp/runtime/vm/repo.h"
@@ -177,6 +178,7 @@ void AdminRequestHandler::handleRequest(Transport *transport) {
         "/apc-ss:          get apc size stats\n"
         "/apc-ss-flat:     get apc size stats in flat format\n"
         "/apc-ss-keys:     get apc size break-down on keys\n"
+        "/apc-ss-evict:    get apc evictions by key group\n"
         "/apc-ss-dump:     dump the size info on each key to /tmp/APC_details\n"
         "                  only valid when EnableAPCSizeDetail is true\n"
         "    keysample     optional, only dump keys that belongs to the same\n"
@@ -184,6 +186,9 @@ void AdminRequestHandler::handleRequest(Transport *transport) {
         "/const-ss:        get const_map_size\n"
         "/static-strings:  get number of static strings\n"
         "/dump-apc:        dump all current value in APC to /tmp/apc_dump\n"
+        "/dump-apc-snapshot: write an APC snapshot for the next server\n"
+        "                  to load\n"
+        "    file          optional, defaults to Server.APC.SnapshotFile\n"
         "/dump-const:      dump all constant value in constant map to\n"
         "                  /tmp/const_map_dump\n"
         "/dump-file-repo:  dump file repository to /tmp/file_repo_dump\n"
@@ -207,6 +212,11 @@ void AdminRequestHandler::handleRequest(Transport *transport) {
 #ifdef EXECUTION_PROFILER
         "/prof-exe:        returns sampled execution profile\n"
 #endif
+        "/prof-request-heap-on: sample request heap allocations\n"
+        "    interval      optional, bytes between samples, defaults to\n"
+        "                  Server.RequestHeapProfileInterval or 512KB\n"
+        "/prof-request-heap-off: stop sampling request heap allocations\n"
+        "/prof-request-heap: request heap samples so far, in pprof format\n"
         "/vm-tcspace:      show space used by translator caches\n"
         "/vm-dump-tc:      dump translation cache to /tmp/tc_dump_a and\n"
         "                  /tmp/tc_dump_astub\n"
@@ -729,6 +739,23 @@ bool AdminRequestHandler::handleStatsRequest(const std::string &cmd,
 
 bool AdminRequestHandler::handleProfileRequest(const std::string &cmd,
                                                Transport *transport) {
+  if (cmd == "prof-request-heap-on") {
+    int64_t interval = transport->getInt64Param("interval");
+    if (interval <= 0) interval = RuntimeOption::RequestHeapProfileInterval;
+    if (interval <= 0) interval = 512 * 1024;
+    RequestHeapProfiler::Start(interval);
+    transport->sendString("OK\n");
+    return true;
+  }
+  if (cmd == "prof-request-heap-off") {
+    RequestHeapProfiler::Stop();
+    transport->sendString("OK\n");
+    return true;
+  }
+  if (cmd == "prof-request-heap") {
+    transport->sendString(RequestHeapProfiler::Report());
+    return true;
+  }
   if (cmd == "prof-exe") {
     std::map<ThreadInfo::Executing, int> counts;
     ThreadInfo::GetExecutionSamples(counts);
@@ -905,6 +932,11 @@ bool AdminRequestHandler::handleAPCSizeRequest (const std::string &cmd,
     transport->sendString(result);
     return true;
   }
+  if (cmd == "apc-ss-evict") {
+    std::string result = SharedStoreStats::report_evictions();
+    transport->sendString(result);
+    return true;
+  }
   if (cmd == "apc-ss-dump") {
     if (!RuntimeOption::EnableAPCSizeDetail) {
       transport->sendString("Not Enabled\n");
@@ -1027,6 +1059,28 @@ bool AdminRequestHandler::handleDumpCacheRequest(const std::string &cmd,
     transport->sendString("Done");
     return true;
   }
+  if (cmd == "dump-apc-snapshot") {
+    if (!RuntimeOption::EnableApc) {
+      transport->sendString("No APC\n");
+      return true;
+    }
+    string file = transport->getParam("file");
+    if (file.empty()) {
+      file = RuntimeOption::ApcSnapshotFile;
+    }
+    if (file.empty()) {
+      transport->sendString("No snapshot file\n");
+      return true;
+    }
+    int waitSeconds = transport->getIntParam("waitseconds");
+    if (!waitSeconds) {
+      waitSeconds = RuntimeOption::RequestTimeoutSeconds > 0 ?
+                    RuntimeOption::RequestTimeoutSeconds : 10;
+    }
+    transport->sendString(apc_write_snapshot(file, waitSeconds) ?
+                          "Done\n" : "Failed\n");
+    return true;
+  }
   if (cmd == "dump-file-repo") {
     if (file_dump) {
       (*file_dump)("/tmp/file_repo_dump");
@@ -32,6 +32,9 @@
 #include "hphp/runtime/base/time/datetime.h"
 #include "hphp/runtime/debugger/debugger.h"
 #include "hphp/util/alloc.h"
+#include <climits>
+#include <fcntl.h>
+#include <sys/stat.h>
 
 namespace HPHP {
 ///////////////////////////////////////////////////////////////////////////////
@@ -52,6 +55,29 @@ void HttpRequestHandler::sendStaticContent(Transport *transport,
                                            bool compressed,
                                            const std::string &cmd,
                                            const char *ext) {
+  prepareStaticContent(transport, mtime, cmd, ext);
+  transport->sendRaw((void*)data, len, 200, compressed);
+}
+
+bool HttpRequestHandler::sendStaticFile(Transport *transport,
+                                        int fd, off_t offset, int len,
+                                        time_t mtime,
+                                        bool compressed,
+                                        const std::string &cmd,
+                                        const char *ext) {
+  // check first, so a fallback to sendStaticContent() won't add headers twice
+  transport->disableCompression();
+  if (!transport->canSendFile(compressed)) return false;
+  prepareStaticContent(transport, mtime, cmd, ext);
+  bool sent = transport->sendFile(fd, offset, len, 200, compressed);
+  assert(sent);
+  return sent;
+}
+
+void HttpRequestHandler::prepareStaticContent(Transport *transport,
+                                              time_t mtime,
+                                              const std::string &cmd,
+                                              const char *ext) {
   assert(ext);
   assert(cmd.rfind('.') != string::npos);
   assert(strcmp(ext, cmd.c_str() + cmd.rfind('.') + 1) == 0);
@@ -103,8 +129,6 @@ void HttpRequestHandler::sendStaticContent(Transport *transport,
   // misnomer, it means we have made decision on compression, transport
   // should not attempt to compress it.
   transport->disableCompression();
-
-  transport->sendRaw((void*)data, len, 200, compressed);
 }
 
 void HttpRequestHandler::handleRequest(Transport *transport) {
@@ -172,6 +196,20 @@ void HttpRequestHandler::handleRequest(Transport *transport) {
   if (ext && strcasecmp(ext, "php") != 0) {
     if (RuntimeOption::EnableStaticContentCache) {
       bool original = compressed;
+      int fd; off_t offset;
+      if (RuntimeOption::EnableStaticContentSendFile &&
+          StaticContentCache::TheCache.findRange(path, fd, offset, len,
+                                                 compressed)) {
+        // only send as is; entries that need unzipping go the slow way
+        if ((original || !compressed) &&
+            sendStaticFile(transport, fd, offset, len, 0, compressed, path,
+                           ext)) {
+          ServerStats::LogPage(path, 200);
+          GetAccessLog().log(transport, vhost);
+          return;
+        }
+        compressed = original;
+      }
       // check against static content cache
       if (StaticContentCache::TheCache.find(path, data, len, compressed)) {
         Util::ScopedMem decompressed_data;
@@ -197,6 +235,22 @@ void HttpRequestHandler::handleRequest(Transport *transport) {
 
     if (RuntimeOption::EnableStaticContentFromDisk) {
       String translated = File::TranslatePath(String(absPath));
+      if (!translated.empty() && RuntimeOption::EnableStaticContentSendFile) {
+        int fd = open(translated.data(), O_RDONLY);
+        if (fd >= 0) {
+          struct stat st;
+          bool sent = fstat(fd, &st) == 0 && S_ISREG(st.st_mode) &&
+            st.st_size > 0 && st.st_size <= INT_MAX &&
+            sendStaticFile(transport, fd, 0, st.st_size, st.st_mtime, false,
+                           path, ext);
+          close(fd);
+          if (sent) {
+            ServerStats::LogPage(path, 200);
+            GetAccessLog().log(transport, vhost);
+            return;
+          }
+        }
+      }
       if (!translated.empty()) {
         CstrBuffer sb(translated.data());
         if (sb.valid()) {
@@ -49,6 +49,12 @@ private:
                          time_t mtime, bool compressed,
                          const std::string &cmd,
                          const char *ext);
+  bool sendStaticFile(Transport *transport, int fd, off_t offset, int len,
+                      time_t mtime, bool compressed,
+                      const std::string &cmd,
+                      const char *ext);
+  void prepareStaticContent(Transport *transport, time_t mtime,
+                            const std::string &cmd, const char *ext);
   bool executePHPRequest(Transport *transport, RequestURI &reqURI,
                          SourceRootInfo &sourceRootInfo,
                          bool cachableDynamicContent);
@@ -75,8 +75,13 @@ HttpServer::HttpServer(void *sslCTX /* = NULL */)
   options.m_serverFD = RuntimeOption::ServerPortFd;
   options.m_sslFD = RuntimeOption::SSLPortFd;
   options.m_takeoverFilename = RuntimeOption::TakeoverFilename;
+  options.m_acceptorCount = RuntimeOption::ServerAcceptorCount;
   m_pageServer = serverFactory->createServer(options);
   m_pageServer->addTakeoverListener(this);
+  if (RuntimeOption::ServerQueueDelayTarget > 0) {
+    m_pageServer->setQueueDelayTarget(RuntimeOption::ServerQueueDelayTarget,
+                                      RuntimeOption::ServerQueueDelayInterval);
+  }
 
   if (additionalThreads) {
     auto handlerFactory = boost::make_shared<WarmupRequestHandlerFactory>(
@@ -21,6 +21,7 @@
 #include "hphp/runtime/base/server/server_stats.h"
 #include "hphp/runtime/base/server/http_protocol.h"
 #include "hphp/runtime/debugger/debugger.h"
+#include "hphp/util/alloc.h"
 #include "hphp/util/compatibility.h"
 #include "hphp/util/logger.h"
 
@@ -45,11 +46,22 @@ static void on_thread_stop(int fd, short events, void *context) {
   event_base_loopbreak((struct event_base *)context);
 }
 
+static void on_acceptor_request(struct evhttp_request *request, void *obj) {
+  assert(obj);
+  ((HPHP::LibEventAcceptor*)obj)->onRequest(request);
+}
+
+static void on_acceptor_command(int fd, short events, void *obj) {
+  assert(obj);
+  ((HPHP::LibEventAcceptor*)obj)->onCommand();
+}
+
 namespace HPHP {
 ///////////////////////////////////////////////////////////////////////////////
 // LibEventJob
 
-LibEventJob::LibEventJob(evhttp_request *req) : request(req) {
+LibEventJob::LibEventJob(evhttp_request *req, int acceptorId)
+    : request(req), acceptorId(acceptorId) {
   gettime(CLOCK_MONOTONIC, &start);
 }
 
@@ -73,6 +85,30 @@ void LibEventJob::stopTimer() {
   }
 }
 
+/*
+ * With Server.ThreadNuma, event loop N runs on NUMA node N % nodes, so that
+ * it hands requests to that node's workers first. With
+ * Server.AcceptorAffinity, event loop N is further pinned to cpu N so that a
+ * connection's accept, parse and response writes stay on one core.
+ */
+static void set_acceptor_affinity(int acceptorId) {
+  if (RuntimeOption::ServerThreadNuma) {
+    Util::numa_bind_thread(acceptorId % Util::numa_num_nodes());
+  }
+#ifdef __linux__
+  if (!RuntimeOption::ServerAcceptorAffinity) return;
+  long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+  if (ncpu <= 0) return;
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+  CPU_SET(acceptorId % ncpu, &cpus);
+  if (pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) != 0) {
+    Logger::Warning("Unable to pin event loop %d to cpu %ld", acceptorId,
+                    acceptorId % ncpu);
+  }
+#endif
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // LibEventWorker
 
@@ -88,12 +124,18 @@ void LibEventWorker::doJob(LibEventJobPtr job) {
   assert(m_opaque);
   LibEventServer *server = (LibEventServer*)m_opaque;
 
-  LibEventTransport transport(server, request, m_id);
+  LibEventTransport transport(server, request, m_id, job->acceptorId);
 #ifdef _EVENT_USE_OPENSSL
   if (evhttp_is_connection_ssl(job->request->evcon)) {
     transport.setSSL();
   }
 #endif
+  CoDel *queueDelay = server->getQueueDelayMonitor();
+  if (queueDelay && queueDelay->onDequeue(job->getStartTimer())) {
+    ServerStats::Log("queue.shed", 1);
+    transport.sendString("Service Unavailable", 503);
+    return;
+  }
   bool error = true;
   std::string errorMsg;
   try {
@@ -130,6 +172,10 @@ void LibEventWorker::doJob(LibEventJobPtr job) {
 
 void LibEventWorker::onThreadEnter() {
   assert(m_opaque);
+  if (RuntimeOption::ServerThreadNuma) {
+    // the same partitioning as the dispatcher's JobQueue
+    Util::numa_bind_thread(m_id % Util::numa_num_nodes());
+  }
   LibEventServer *server = (LibEventServer*)m_opaque;
   server->onThreadEnter();
   if (RuntimeOption::EnableDebugger) {
@@ -149,7 +195,8 @@ void LibEventWorker::onThreadExit() {
 // constructor and destructor
 
 LibEventServer::LibEventServer(const std::string &address, int port,
-                               int thread, int timeoutSeconds)
+                               int thread, int timeoutSeconds,
+                               int acceptorCount /* = 1 */)
   : Server(address, port, thread),
     m_accept_sock(-1),
     m_accept_sock_ssl(-1),
@@ -158,8 +205,11 @@ LibEventServer::LibEventServer(const std::string &address, int port,
     m_dispatcher(thread, RuntimeOption::ServerThreadRoundRobin,
                  RuntimeOption::ServerThreadDropCacheTimeoutSeconds,
                  RuntimeOption::ServerThreadDropStack,
-                 this, RuntimeOption::ServerThreadJobLIFO),
-    m_dispatcherThread(this, &LibEventServer::dispatch) {
+                 this, RuntimeOption::ServerThreadJobLIFO,
+                 RuntimeOption::ServerThreadWorkStealing,
+                 RuntimeOption::ServerThreadNuma ? Util::numa_num_nodes() : 1),
+    m_dispatcherThread(this, &LibEventServer::dispatch),
+    m_acceptorCount(acceptorCount) {
   m_eventBase = event_base_new();
   m_server = evhttp_new(m_eventBase);
   m_server_ssl = nullptr;
@@ -199,7 +249,11 @@ int LibEventServer::getAcceptSocket() {
 }
 
 int LibEventServer::getLibEventConnectionCount() {
-  return evhttp_get_connection_count(m_server);
+  int count = evhttp_get_connection_count(m_server);
+  for (auto &acceptor : m_acceptors) {
+    count += acceptor->getConnectionCount();
+  }
+  return count;
 }
 
 void LibEventServer::start() {
@@ -223,6 +277,7 @@ void LibEventServer::start() {
   setStatus(RUNNING);
   m_dispatcher.start();
   m_dispatcherThread.start();
+  startAcceptors();
   m_timeoutThread.start();
 }
 
@@ -249,6 +304,7 @@ void LibEventServer::dispatchWithTimeout(int timeoutSeconds) {
 }
 
 void LibEventServer::dispatch() {
+  set_acceptor_affinity(0);
   m_pipeStop.open();
   event_set(&m_eventStop, m_pipeStop.getOut(), EV_READ|EV_PERSIST,
             on_thread_stop, m_eventBase);
@@ -322,6 +378,7 @@ void LibEventServer::stop() {
     // an error occured but we're in shutdown already, so ignore
   }
   m_dispatcherThread.waitForEnd();
+  stopAcceptors();
 
   // wait for the timeout thread to stop
   m_timeoutThreadData.stop();
@@ -378,7 +435,8 @@ void LibEventServer::onThreadExit() {
     (&ThreadInfo::s_threadInfo->m_reqInjectionData);
 }
 
-void LibEventServer::onRequest(struct evhttp_request *request) {
+void LibEventServer::onRequest(struct evhttp_request *request,
+                               int acceptorId) {
   if (RuntimeOption::EnableKeepAlive &&
       RuntimeOption::ConnectionTimeoutSeconds > 0) {
     // before processing request, set the connection timeout
@@ -387,7 +445,8 @@ void LibEventServer::onRequest(struct evhttp_request *request) {
                                   RuntimeOption::ConnectionTimeoutSeconds);
   }
   if (getStatus() == RUNNING) {
-    m_dispatcher.enqueue(LibEventJobPtr(new LibEventJob(request)));
+    m_dispatcher.enqueue(LibEventJobPtr(new LibEventJob(request,
+                                                        acceptorId)));
   } else {
     Logger::Error("throwing away one new request while shutting down");
   }
@@ -423,18 +482,219 @@ void LibEventServer::onResponse(int worker, evhttp_request *request,
     transport->onFlushBegin(totalSize);
     transport->onFlushProgress(nwritten, delay);
   }
-  m_responseQueue.enqueue(worker, request, code, nwritten);
+  getResponseQueue(transport->getAcceptorId())
+    .enqueue(worker, request, code, nwritten,
+             RuntimeOption::LibEventSyncSend && !skip_sync);
+}
+
+void LibEventServer::onFileResponse(int worker, evhttp_request *request,
+                                    int code, int fd, off_t offset, int size,
+                                    LibEventTransport *transport) {
+  if (request->evcon == nullptr) {
+    evhttp_request_free(request);
+    return;
+  }
+
+#ifdef EVHTTP_SYNC_SENDFILE
+  const char *reason = HttpProtocol::GetReasonString(code);
+  timespec begin, end;
+  gettime(CLOCK_MONOTONIC, &begin);
+  int nwritten = evhttp_send_reply_sync_sendfile(request, code, reason, fd,
+                                                 offset, size);
+  gettime(CLOCK_MONOTONIC, &end);
+  transport->onFlushBegin(size);
+  transport->onFlushProgress(nwritten, gettime_diff_us(begin, end));
+  getResponseQueue(transport->getAcceptorId())
+    .enqueue(worker, request, code, nwritten, true);
+#else
+  not_reached();
+#endif
 }
 
-void LibEventServer::onChunkedResponse(int worker, evhttp_request *request,
-                                       int code, evbuffer *chunk,
-                                       bool firstChunk) {
-  m_responseQueue.enqueue(worker, request, code, chunk, firstChunk);
+void LibEventServer::onChunkedResponse(int worker, int acceptorId,
+                                       evhttp_request *request, int code,
+                                       evbuffer *chunk, bool firstChunk) {
+  getResponseQueue(acceptorId)
+    .enqueue(worker, request, code, chunk, firstChunk);
 }
 
-void LibEventServer::onChunkedResponseEnd(int worker,
+void LibEventServer::onChunkedResponseEnd(int worker, int acceptorId,
                                           evhttp_request *request) {
-  m_responseQueue.enqueue(worker, request);
+  getResponseQueue(acceptorId).enqueue(worker, request);
+}
+
+PendingResponseQueue &LibEventServer::getResponseQueue(int acceptorId) {
+  if (acceptorId == 0) return m_responseQueue;
+  assert(acceptorId <= (int)m_acceptors.size());
+  return m_acceptors[acceptorId - 1]->getResponseQueue();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// multiple acceptors
+
+void LibEventServer::startAcceptors() {
+  if (m_acceptorCount <= 1) return;
+  for (int i = 1; i < m_acceptorCount; i++) {
+    std::unique_ptr<LibEventAcceptor> acceptor(new LibEventAcceptor(this, i));
+    if (!acceptor->listen(m_accept_sock)) {
+      Logger::Error("Unable to start acceptor %d on port %d", i, m_port);
+      break;
+    }
+    m_acceptors.push_back(std::move(acceptor));
+  }
+  // started only after m_acceptors stops changing, since their requests'
+  // responses are routed through it
+  for (auto &acceptor : m_acceptors) {
+    acceptor->start();
+  }
+}
+
+void LibEventServer::stopAcceptors() {
+  for (auto &acceptor : m_acceptors) {
+    acceptor->signalStop();
+  }
+  for (auto &acceptor : m_acceptors) {
+    acceptor->waitForEnd();
+  }
+}
+
+void LibEventServer::closeAcceptorSockets() {
+  for (auto &acceptor : m_acceptors) {
+    acceptor->closeAcceptSocket();
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// LibEventAcceptor
+
+LibEventAcceptor::LibEventAcceptor(LibEventServer *server, int id)
+  : m_server(server), m_id(id), m_accept_sock(-1),
+    m_thread(this, &LibEventAcceptor::dispatch) {
+  m_eventBase = event_base_new();
+  m_http = evhttp_new(m_eventBase);
+  evhttp_set_connection_limit(m_http, RuntimeOption::ServerConnectionLimit);
+  evhttp_set_gencb(m_http, on_acceptor_request, this);
+#ifdef EVHTTP_PORTABLE_READ_LIMITING
+  evhttp_set_read_limit(m_http, RuntimeOption::RequestBodyReadLimit);
+#endif
+  m_responseQueue.create(m_eventBase);
+
+  if (!m_pipeCommand.open()) {
+    throw FatalErrorException("unable to create pipe for acceptor commands");
+  }
+  event_set(&m_eventCommand, m_pipeCommand.getOut(), EV_READ|EV_PERSIST,
+            on_acceptor_command, this);
+  event_base_set(m_eventBase, &m_eventCommand);
+  event_add(&m_eventCommand, nullptr);
+}
+
+LibEventAcceptor::~LibEventAcceptor() {
+  if (m_http) {
+    // never started, or failed to listen
+    evhttp_free(m_http);
+    event_del(&m_eventCommand);
+    m_responseQueue.close();
+    event_base_free(m_eventBase);
+  }
+  // Otherwise, like LibEventServer, leak the event base: stop() may have
+  // given up waiting on a stuck thread that still uses it.
+}
+
+bool LibEventAcceptor::listen(int sharedSock) {
+  // Every acceptor's accept() races for the server's one accept queue, but
+  // parsing and dispatch happen on this loop.
+  if (sharedSock < 0) return false;
+  m_accept_sock = dup(sharedSock);
+  if (m_accept_sock < 0) return false;
+  if (fcntl(m_accept_sock, F_SETFL, O_NONBLOCK) != 0) {
+    close(m_accept_sock);
+    m_accept_sock = -1;
+    return false;
+  }
+  if (evhttp_accept_socket(m_http, m_accept_sock) < 0) {
+    Logger::Error("evhttp_accept_socket: %s",
+                  Util::safe_strerror(errno).c_str());
+    close(m_accept_sock);
+    m_accept_sock = -1;
+    return false;
+  }
+  Logger::Info("acceptor %d accepting on socket %d", m_id, sharedSock);
+  return true;
+}
+
+void LibEventAcceptor::start() {
+  m_thread.start();
+}
+
+void LibEventAcceptor::signalStop() {
+  // server status is already STOPPED; just wake up the loop to notice it
+  if (write(m_pipeCommand.getIn(), "s", 1) < 0) {
+    // an error occured but we're in shutdown already, so ignore
+  }
+}
+
+void LibEventAcceptor::waitForEnd() {
+  m_thread.waitForEnd();
+  evhttp_free(m_http);
+  m_http = nullptr;
+  m_accept_sock = -1;
+}
+
+void LibEventAcceptor::closeAcceptSocket() {
+  if (write(m_pipeCommand.getIn(), "c", 1) < 0) {
+    Logger::Error("Unable to ask acceptor %d to close its socket", m_id);
+  }
+}
+
+int LibEventAcceptor::getConnectionCount() {
+  return m_http ? evhttp_get_connection_count(m_http) : 0;
+}
+
+void LibEventAcceptor::onRequest(evhttp_request *request) {
+  m_server->onRequest(request, m_id);
+}
+
+void LibEventAcceptor::onCommand() {
+  char buf[64];
+  int n = read(m_pipeCommand.getOut(), buf, sizeof(buf));
+  for (int i = 0; i < n; i++) {
+    if (buf[i] == 'c' && m_accept_sock != -1) {
+      if (evhttp_del_accept_socket(m_http, m_accept_sock) < 0) {
+        Logger::Error("Unable to delete accept socket of acceptor %d", m_id);
+      }
+      close(m_accept_sock);
+      m_accept_sock = -1;
+    }
+  }
+  event_base_loopbreak(m_eventBase);
+}
+
+void LibEventAcceptor::dispatch() {
+  set_acceptor_affinity(m_id);
+  while (m_server->getStatus() != Server::STOPPED) {
+    event_base_loop(m_eventBase, EVLOOP_ONCE);
+  }
+
+  event_del(&m_eventCommand);
+
+  // flushing all responses
+  if (!m_responseQueue.empty()) {
+    m_responseQueue.process();
+  }
+  m_responseQueue.close();
+
+  // flusing all remaining events
+  if (RuntimeOption::ServerGracefulShutdownWait) {
+    struct timeval timeout;
+    timeout.tv_sec = RuntimeOption::ServerGracefulShutdownWait;
+    timeout.tv_usec = 0;
+    event eventTimeout;
+    event_set(&eventTimeout, -1, 0, on_timer, m_eventBase);
+    event_base_set(m_eventBase, &eventTimeout);
+    event_add(&eventTimeout, &timeout);
+    event_base_loop(m_eventBase, EVLOOP_ONCE);
+    event_del(&eventTimeout);
+  }
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -484,11 +744,12 @@ void PendingResponseQueue::enqueue(int worker, ResponsePtr response) {
 }
 
 void PendingResponseQueue::enqueue(int worker, evhttp_request *request,
-                                   int code, int nwritten) {
+                                   int code, int nwritten, bool sync) {
   ResponsePtr res(new Response());
   res->request = request;
   res->code = code;
   res->nwritten = nwritten;
+  res->sync = sync;
   enqueue(worker, res);
 }
 
@@ -538,11 +799,6 @@ void PendingResponseQueue::process() {
       continue;
     }
 
-    bool skip_sync = false;
-#ifdef _EVENT_USE_OPENSSL
-    skip_sync = evhttp_is_connection_ssl(request->evcon);
-#endif
-
     if (res.chunked) {
       if (res.chunk) {
         if (res.firstChunk) {
@@ -553,7 +809,7 @@ void PendingResponseQueue::process() {
       } else {
         evhttp_send_reply_end(request);
       }
-    } else if (RuntimeOption::LibEventSyncSend && !skip_sync) {
+    } else if (res.sync) {
       evhttp_send_reply_sync_end(res.nwritten, request);
     } else {
       const char *reason = HttpProtocol::GetReasonString(code);
@@ -563,7 +819,7 @@ void PendingResponseQueue::process() {
 }
 
 PendingResponseQueue::Response::Response()
-  : request(nullptr), code(0), nwritten(0),
+  : request(nullptr), code(0), nwritten(0), sync(false),
     chunked(false), firstChunk(false), chunk(nullptr) {
 }
 
@@ -34,12 +34,13 @@ namespace HPHP {
 DECLARE_BOOST_TYPES(LibEventJob);
 class LibEventJob {
 public:
-  explicit LibEventJob(evhttp_request *req);
+  explicit LibEventJob(evhttp_request *req, int acceptorId = 0);
 
   const timespec &getStartTimer() const { return start;}
   void stopTimer();
 
   evhttp_request *request;
+  int acceptorId; // which event loop the request came from
 
 private:
   timespec start;
@@ -80,7 +81,8 @@ public:
 
   bool empty();
   void create(event_base *eventBase);
-  void enqueue(int worker, evhttp_request *request, int code, int nwritten);
+  void enqueue(int worker, evhttp_request *request, int code, int nwritten,
+               bool sync);
   void enqueue(int worker, evhttp_request *request, int code, evbuffer *chunk,
                bool firstChunk);
   void enqueue(int worker, evhttp_request *request); // chunked encoding ended
@@ -97,6 +99,7 @@ private:
     evhttp_request *request;
     int code;
     int nwritten;
+    bool sync; // started with evhttp_send_reply_sync_*()
 
     bool chunked;
     bool firstChunk;
@@ -118,9 +121,72 @@ private:
   void enqueue(int worker, ResponsePtr response);
 };
 
+class LibEventServer;
+
+/**
+ * An extra accept and dispatch loop for a LibEventServer running with
+ * Server.AcceptorCount > 1. Each acceptor has its own event_base and evhttp
+ * on its own thread, so accepting and parsing requests scale with cores.
+ * Requests go to the server's shared job queue and their responses come back
+ * through the acceptor's own PendingResponseQueue.
+ *
+ * An acceptor accepts from a dup of the server's socket, so all loops share
+ * one accept queue. Handing that socket over in a takeover hands over every
+ * queued connection, and closing the acceptors' dups drops none.
+ */
+class LibEventAcceptor {
+public:
+  LibEventAcceptor(LibEventServer *server, int id);
+  ~LibEventAcceptor();
+
+  bool listen(int sharedSock);
+  void start();
+
+  /**
+   * Stopping is split in two so that the server can signal all of its
+   * acceptors before waiting for any, letting their graceful shutdown waits
+   * overlap.
+   */
+  void signalStop();
+  void waitForEnd();
+
+  int getAcceptSocket() const { return m_accept_sock; }
+  int getConnectionCount();
+  PendingResponseQueue &getResponseQueue() { return m_responseQueue; }
+
+  /**
+   * Asks the acceptor's thread to stop accepting and close its socket.
+   * Safe to call from any thread.
+   */
+  void closeAcceptSocket();
+
+  /**
+   * Called on the acceptor's own thread.
+   */
+  void onRequest(evhttp_request *request);
+  void onCommand();
+  void dispatch();
+
+private:
+  LibEventServer *m_server;
+  int m_id;
+  int m_accept_sock;
+  event_base *m_eventBase;
+  evhttp *m_http;
+
+  // commands from other threads: stop accepting, or check for shutdown
+  event m_eventCommand;
+  CPipe m_pipeCommand;
+
+  PendingResponseQueue m_responseQueue;
+  AsyncFunc<LibEventAcceptor> m_thread;
+};
+
 /**
  * Implementing an evhttp based HTTP server with JobQueueDispatcher. This
- * server will have one dispather thread and multiple worker threads.
+ * server will have one dispather thread and multiple worker threads. With
+ * an acceptorCount above 1 (Server.AcceptorCount, for the page server) it
+ * also runs LibEventAcceptors next to the dispatcher thread.
  */
 class LibEventServer : public Server {
 public:
@@ -128,7 +194,7 @@ public:
    * Constructor and destructor.
    */
   LibEventServer(const std::string &address, int port, int thread,
-                 int timeoutSeconds);
+                 int timeoutSeconds, int acceptorCount = 1);
   ~LibEventServer();
 
   // implementing Server
@@ -150,9 +216,10 @@ public:
   void onThreadExit();
 
   /**
-   * Request handler called by evhttp library.
+   * Request handler called by evhttp library, on the dispatcher thread for
+   * acceptorId 0 and on the acceptor's own thread otherwise.
    */
-  void onRequest(evhttp_request *request);
+  void onRequest(evhttp_request *request, int acceptorId = 0);
   void onChunkedRead();
 
   /**
@@ -160,9 +227,12 @@ public:
    */
   void onResponse(int worker, evhttp_request *request, int code,
                   LibEventTransport* transport);
-  void onChunkedResponse(int worker, evhttp_request *request, int code,
-                         evbuffer *chunk, bool firstChunk);
-  void onChunkedResponseEnd(int worker, evhttp_request *request);
+  void onFileResponse(int worker, evhttp_request *request, int code, int fd,
+                      off_t offset, int size, LibEventTransport* transport);
+  void onChunkedResponse(int worker, int acceptorId, evhttp_request *request,
+                         int code, evbuffer *chunk, bool firstChunk);
+  void onChunkedResponseEnd(int worker, int acceptorId,
+                            evhttp_request *request);
   void onChunkedRequest(evhttp_request *request);
 
   /**
@@ -175,6 +245,12 @@ protected:
   virtual int getAcceptSocket();
   virtual int getAcceptSocketSSL();
 
+  /**
+   * Stops all acceptors from accepting new connections, for handing our
+   * listen socket over to another server.
+   */
+  void closeAcceptorSockets();
+
 protected:
   int m_accept_sock;
   int m_accept_sock_ssl;
@@ -197,6 +273,13 @@ private:
 
   PendingResponseQueue m_responseQueue;
 
+  int m_acceptorCount; // event loops in all, counting the dispatcher's
+  std::vector<std::unique_ptr<LibEventAcceptor> > m_acceptors;
+
+  PendingResponseQueue &getResponseQueue(int acceptorId);
+  void startAcceptors();
+  void stopAcceptors();
+
   // dispatcher thread runs this function
   void dispatch();
 
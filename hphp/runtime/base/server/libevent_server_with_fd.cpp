@@ -24,8 +24,9 @@
 namespace HPHP {
 
 LibEventServerWithFd::LibEventServerWithFd
-(const std::string &address, int port, int thread, int timeoutSeconds)
-  : LibEventServer(address, port, thread, timeoutSeconds)
+(const std::string &address, int port, int thread, int timeoutSeconds,
+ int acceptorCount /* = 1 */)
+  : LibEventServer(address, port, thread, timeoutSeconds, acceptorCount)
 {
 }
 
@@ -28,7 +28,7 @@ namespace HPHP {
 class LibEventServerWithFd : public LibEventServer {
 public:
   LibEventServerWithFd(const std::string &address, int port, int thread,
-                       int timeoutSeconds);
+                       int timeoutSeconds, int acceptorCount = 1);
 
   void setServerSocketFd(int sock_fd) {
     m_accept_sock = sock_fd;
@@ -83,8 +83,9 @@ static int fd_transfer_request_handler(
 }
 
 LibEventServerWithTakeover::LibEventServerWithTakeover
-(const std::string &address, int port, int thread, int timeoutSeconds)
-  : LibEventServer(address, port, thread, timeoutSeconds),
+(const std::string &address, int port, int thread, int timeoutSeconds,
+ int acceptorCount /* = 1 */)
+  : LibEventServer(address, port, thread, timeoutSeconds, acceptorCount),
     m_delete_handle(nullptr),
     m_took_over(false),
     m_takeover_state(TakeoverState::NotStarted)
@@ -108,6 +109,9 @@ int LibEventServerWithTakeover::afdtRequest(String request, String* response) {
       // log message is not too harmful.
       Logger::Error("Unable to delete accept socket");
     }
+    // Acceptors accept from dups of this socket; they must stop too. Their
+    // queued connections are this socket's, so the new server gets them.
+    closeAcceptorSockets();
     m_takeover_state = TakeoverState::Started;
     return m_accept_sock;
   } else if (request == P_VERSION C_TERM_REQ) {
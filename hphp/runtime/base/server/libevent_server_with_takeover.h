@@ -29,7 +29,7 @@ namespace HPHP {
 class LibEventServerWithTakeover : public LibEventServer {
 public:
   LibEventServerWithTakeover(const std::string &address, int port, int thread,
-                             int timeoutSeconds);
+                             int timeoutSeconds, int acceptorCount = 1);
 
   virtual void stop();
 
@@ -31,9 +31,10 @@ struct m_evkeyvalq {
 
 LibEventTransport::LibEventTransport(LibEventServer *server,
                                      evhttp_request *request,
-                                     int workerId)
+                                     int workerId, int acceptorId)
   : m_server(server), m_request(request), m_eventBasePostData(nullptr),
-    m_workerId(workerId), m_sendStarted(false), m_sendEnded(false) {
+    m_workerId(workerId), m_acceptorId(acceptorId), m_sendStarted(false),
+    m_sendEnded(false) {
   // HttpProtocol::PrepareSystemVariables needs this
   evbuffer *buf = m_request->input_buffer;
   assert(buf);
@@ -275,8 +276,8 @@ void LibEventTransport::sendImpl(const void *data, int size, int code,
      * very useful.
      */
     onChunkedProgress(size);
-    m_server->onChunkedResponse(m_workerId, m_request, code, chunk,
-                               !m_sendStarted);
+    m_server->onChunkedResponse(m_workerId, m_acceptorId, m_request, code,
+                                chunk, !m_sendStarted);
   } else {
     if (m_method != HEAD) {
       evbuffer_add(m_request->output_buffer, data, size);
@@ -292,9 +293,28 @@ void LibEventTransport::sendImpl(const void *data, int size, int code,
   m_sendStarted = true;
 }
 
+bool LibEventTransport::supportsSendFile() {
+#ifdef EVHTTP_SYNC_SENDFILE
+  // SSL connections have to encrypt in user space anyway
+  return RuntimeOption::EnableStaticContentSendFile &&
+    m_method != HEAD && !isSSL();
+#else
+  return false;
+#endif
+}
+
+void LibEventTransport::sendFileImpl(int fd, off_t offset, int size,
+                                     int code) {
+  assert(!m_sendStarted && !m_sendEnded);
+  m_server->onFileResponse(m_workerId, m_request, code, fd, offset, size,
+                           this);
+  m_sendStarted = true;
+  m_sendEnded = true;
+}
+
 void LibEventTransport::onSendEndImpl() {
   if (m_chunkedEncoding) {
-    m_server->onChunkedResponseEnd(m_workerId, m_request);
+    m_server->onChunkedResponseEnd(m_workerId, m_acceptorId, m_request);
     m_sendEnded = true;
   } else {
     assert(m_sendEnded); // otherwise, we didn't call send for this request
@@ -27,7 +27,9 @@ class LibEventServer;
 class LibEventTransport : public Transport {
 public:
   LibEventTransport(LibEventServer *server, evhttp_request *request,
-                    int workerId);
+                    int workerId, int acceptorId = 0);
+
+  int getAcceptorId() const { return m_acceptorId; }
 
   /**
    * Implementing Transport...
@@ -49,6 +51,8 @@ public:
   virtual void removeRequestHeaderImpl(const char *name);
   virtual void sendImpl(const void *data, int size, int code, bool chunked);
   virtual void onSendEndImpl();
+  virtual bool supportsSendFile();
+  virtual void sendFileImpl(int fd, off_t offset, int size, int code);
   virtual bool isServerStopping();
   virtual int getRequestSize() const;
 
@@ -58,6 +62,7 @@ private:
   struct event_base *m_eventBasePostData;
   struct event m_moreDataRead;
   int m_workerId;
+  int m_acceptorId;
   std::string m_url;
   std::string m_remote_host;
   uint16_t m_remote_port;
@@ -18,11 +18,13 @@
 #include "hphp/runtime/base/server/transport.h"
 #include "hphp/runtime/base/server/http_request_handler.h"
 #include "hphp/runtime/base/server/upload.h"
+#include "hphp/runtime/base/server/server_stats.h"
 #include "hphp/runtime/base/server/job_queue_vm_stack.h"
 #include "hphp/runtime/base/util/string_buffer.h"
 #include "hphp/runtime/base/runtime_option.h"
 #include "hphp/runtime/base/resource_data.h"
 #include "hphp/runtime/ext/ext_server.h"
+#include "hphp/util/codel.h"
 #include "hphp/util/job_queue.h"
 #include "hphp/util/lock.h"
 #include "hphp/util/logger.h"
@@ -232,11 +234,20 @@ private:
 
 ///////////////////////////////////////////////////////////////////////////////
 
+static CoDel *s_queueDelay;
+
 struct PageletWorker
   : JobQueueWorker<PageletTransport*,true,false,JobQueueDropVMStack>
 {
   virtual void doJob(PageletTransport *job) {
     try {
+      if (s_queueDelay && s_queueDelay->onDequeue(job->getStartTimer())) {
+        ServerStats::Log("pagelet.queue.shed", 1);
+        job->sendString("Service Unavailable", 503);
+        job->onSendEnd();
+        job->decRefCount();
+        return;
+      }
       job->onRequestStart(job->getStartTimer());
       HttpRequestHandler().handleRequest(job);
       job->decRefCount();
@@ -296,6 +307,10 @@ void PageletServer::Restart() {
        RuntimeOption::PageletServerThreadDropCacheTimeoutSeconds,
        RuntimeOption::PageletServerThreadDropStack,
        nullptr);
+    if (RuntimeOption::PageletServerQueueDelayTarget > 0) {
+      s_queueDelay = new CoDel(RuntimeOption::PageletServerQueueDelayTarget,
+                               RuntimeOption::ServerQueueDelayInterval);
+    }
     Logger::Info("pagelet server started");
     s_dispatcher->start();
   }
@@ -307,6 +322,8 @@ void PageletServer::Stop() {
     delete s_dispatcher;
     s_dispatcher = nullptr;
   }
+  delete s_queueDelay;
+  s_queueDelay = nullptr;
 }
 
 Object PageletServer::TaskStart(CStrRef url, CArrRef headers,
@@ -365,5 +382,9 @@ int PageletServer::GetQueuedJobs() {
   return s_dispatcher->getQueuedJobs();
 }
 
+CoDel *PageletServer::GetQueueDelayMonitor() {
+  return s_queueDelay;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 }
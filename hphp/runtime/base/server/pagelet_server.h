@@ -22,6 +22,8 @@
 namespace HPHP {
 ///////////////////////////////////////////////////////////////////////////////
 
+class CoDel;
+
 class PageletServer {
 public:
   static bool Enabled();
@@ -62,6 +64,11 @@ public:
    */
   static int GetActiveWorker();
   static int GetQueuedJobs();
+
+  /**
+   * Queue delay tracking, if PageletServer.QueueDelayTarget is set.
+   */
+  static CoDel *GetQueueDelayMonitor();
 };
 
 ///////////////////////////////////////////////////////////////////////////////
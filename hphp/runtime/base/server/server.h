@@ -18,6 +18,7 @@
 #define incl_HPHP_HTTP_SERVER_SERVER_H_
 
 #include "hphp/runtime/base/server/transport.h"
+#include "hphp/util/codel.h"
 #include "hphp/util/exception.h"
 #include "hphp/util/lock.h"
 
@@ -171,6 +172,16 @@ public:
    */
   virtual void addWorkers(int numWorkers) = 0;
 
+  /**
+   * Turn on queue-delay based load shedding (see CoDel): when the request
+   * queue stays above targetMs for intervalMs, requests that waited too long
+   * get a 503 instead of being run. Call before start().
+   */
+  void setQueueDelayTarget(int targetMs, int intervalMs) {
+    m_queueDelay.reset(new CoDel(targetMs, intervalMs));
+  }
+  CoDel *getQueueDelayMonitor() const { return m_queueDelay.get(); }
+
   /**
    * Informational.
    */
@@ -247,6 +258,7 @@ protected:
   mutable Mutex m_mutex;
   RequestHandlerFactory m_handlerFactory;
   URLChecker m_urlChecker;
+  std::unique_ptr<CoDel> m_queueDelay;
 
 private:
   RunStatus m_status;
@@ -264,7 +276,8 @@ public:
       m_timeout(timeout),
       m_serverFD(-1),
       m_sslFD(-1),
-      m_takeoverFilename() {
+      m_takeoverFilename(),
+      m_acceptorCount(1) {
   }
 
   std::string m_address;
@@ -274,6 +287,7 @@ public:
   int m_serverFD;
   int m_sslFD;
   std::string m_takeoverFilename;
+  int m_acceptorCount;
 };
 
 /**
@@ -16,6 +16,8 @@
 
 #include "hphp/runtime/base/server/server_stats.h"
 #include "hphp/runtime/base/server/http_server.h"
+#include "hphp/runtime/base/server/pagelet_server.h"
+#include "hphp/runtime/base/server/xbox_server.h"
 #include "hphp/runtime/base/runtime_option.h"
 #include "hphp/runtime/base/program_functions.h"
 #include "hphp/runtime/base/memory/memory_manager.h"
@@ -249,6 +251,8 @@ void ServerStats::Aggregate(list<TimeSlot*> &slots, const std::string &agg,
   int load = HttpServer::Server->getPageServer()->getActiveWorker();
   int idle = RuntimeOption::ServerThreadCount - load;
   int queued = HttpServer::Server->getPageServer()->getQueuedJobs();
+  const CoDel *queueDelay =
+    HttpServer::Server->getPageServer()->getQueueDelayMonitor();
 
   for (list<TimeSlot*>::const_iterator iter = slots.begin();
        iter != slots.end(); ++iter) {
@@ -273,6 +277,15 @@ void ServerStats::Aggregate(list<TimeSlot*> &slots, const std::string &agg,
       if (wantedKeys.find("queued") != wantedKeys.end()) {
         values["queued"] = queued;
       }
+      if (queueDelay) {
+        const QueueDelayHistogram &delays = queueDelay->getLastInterval();
+        if (wantedKeys.find("queue.delay.p50") != wantedKeys.end()) {
+          values["queue.delay.p50"] = delays.percentile(50);
+        }
+        if (wantedKeys.find("queue.delay.p99") != wantedKeys.end()) {
+          values["queue.delay.p99"] = delays.percentile(99);
+        }
+      }
 
       for (map<string, int>::const_iterator iter = udfKeys.begin();
            iter != udfKeys.end(); ++iter) {
@@ -830,6 +843,19 @@ static std::string format_duration(timeval &duration) {
   return ret;
 }
 
+static void write_queue_delay(Writer *w, const char *name,
+                              const CoDel *queueDelay) {
+  if (!queueDelay) return;
+  const QueueDelayHistogram &delays = queueDelay->getLastInterval();
+  w->beginObject(name);
+  w->writeEntry("overloaded", queueDelay->isOverloaded() ? "yes" : "no");
+  w->writeEntry("shed", queueDelay->getShedCount());
+  w->writeEntry("delay p50 us", delays.percentile(50));
+  w->writeEntry("delay p90 us", delays.percentile(90));
+  w->writeEntry("delay p99 us", delays.percentile(99));
+  w->endObject(name);
+}
+
 void ServerStats::ReportStatus(std::string &output, Format format) {
   std::ostringstream out;
   Writer *w;
@@ -875,6 +901,16 @@ void ServerStats::ReportStatus(std::string &output, Format format) {
   w->writeEntry("up", format_duration(up));
   w->endObject("process");
 
+  w->beginObject("queues");
+  if (HttpServer::Server) {
+    write_queue_delay(w, "page",
+                      HttpServer::Server->getPageServer()->
+                      getQueueDelayMonitor());
+  }
+  write_queue_delay(w, "pagelet", PageletServer::GetQueueDelayMonitor());
+  write_queue_delay(w, "xbox", XboxServer::GetQueueDelayMonitor());
+  w->endObject("queues");
+
   w->beginList("threads");
   Lock lock(s_lock, false);
   for (unsigned int i = 0; i < s_loggers.size(); i++) {
@@ -135,5 +135,12 @@ bool StaticContentCache::find(const std::string &name, const char *&data,
   return false;
 }
 
+bool StaticContentCache::findRange(const std::string &name, int &fd,
+                                   off_t &offset, int &len,
+                                   bool &compressed) const {
+  return TheFileCache &&
+    TheFileCache->readRange(name.c_str(), fd, offset, len, compressed);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 }
@@ -42,6 +42,13 @@ public:
   bool find(const std::string &name, const char *&data, int &len,
             bool &compressed) const;
 
+  /**
+   * Find a file's location in the mmap-ed FileCache, for sending it with
+   * sendfile(2) instead of from memory.
+   */
+  bool findRange(const std::string &name, int &fd, off_t &offset, int &len,
+                 bool &compressed) const;
+
 private:
   int m_totalSize;
 
@@ -800,6 +800,43 @@ void Transport::sendRaw(void *data, int size, int code /* = 200 */,
   sendRawLocked(data, size, code, compressed, chunked, codeInfo);
 }
 
+bool Transport::canSendFile(bool compressed) {
+  return supportsSendFile() && !m_headerSent && !m_chunkedEncoding &&
+    (compressed || !RuntimeOption::ForceChunkedEncoding) &&
+    m_headerCallback.isNull() &&
+    // we can neither compress file contents nor recompute their MD5
+    (compressed || !isCompressionEnabled() ||
+     m_compressionDecision == ShouldNotCompress) &&
+    m_responseHeaders.find("Content-MD5") == m_responseHeaders.end();
+}
+
+bool Transport::sendFile(int fd, off_t offset, int size,
+                         int code /* = 200 */,
+                         bool compressed /* = false */) {
+  if (!canSendFile(compressed)) return false;
+
+  ServerStatsHelper ssh("send");
+  if (m_responseCode < 0) {
+    m_responseCode = code;
+    m_responseCodeInfo = "";
+  }
+  prepareHeaders(compressed, false, String(), String());
+  m_headerSent = true;
+
+  m_responseSize += size;
+  ServerStats::SetThreadMode(ServerStats::Writing);
+  sendFileImpl(fd, offset, size, m_responseCode);
+  ServerStats::SetThreadMode(ServerStats::Processing);
+
+  ServerStats::LogBytes(size);
+  if (RuntimeOption::EnableStats && RuntimeOption::EnableWebStats) {
+    ServerStats::Log("network.uncompressed", size);
+    ServerStats::Log("network.compressed", size);
+    ServerStats::Log("network.sendfile", size);
+  }
+  return true;
+}
+
 void Transport::onSendEnd() {
   if (m_compressor && m_chunkedEncoding) {
     bool compressed = false;
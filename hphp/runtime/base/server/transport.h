@@ -200,6 +200,14 @@ public:
    */
   virtual void onSendEndImpl() {}
 
+  /**
+   * Override to send file contents without copying them through user space,
+   * e.g. with sendfile(2). sendFileImpl() is only called when
+   * supportsSendFile() said yes.
+   */
+  virtual bool supportsSendFile() { return false; }
+  virtual void sendFileImpl(int fd, off_t offset, int size, int code) {}
+
   /**
    * Need this implementation to break keep-alive connections.
    */
@@ -323,6 +331,16 @@ public:
   }
   void redirect(const char *location, int code, const char *info );
 
+  /**
+   * Sending back "size" bytes of file "fd" from "offset" as the whole
+   * response, without reading them into memory. Returns false without
+   * sending anything if that's not possible, e.g. the transport doesn't
+   * support it or the response still needs compressing; use sendRaw() then.
+   */
+  bool sendFile(int fd, off_t offset, int size, int code = 200,
+                bool compressed = false);
+  bool canSendFile(bool compressed);
+
   // TODO: support rfc1867
   virtual bool isUploadedFile(CStrRef filename);
   virtual bool moveUploadedFile(CStrRef filename, CStrRef destination);
@@ -18,9 +18,11 @@
 #include "hphp/runtime/base/runtime_option.h"
 #include "hphp/runtime/base/server/rpc_request_handler.h"
 #include "hphp/runtime/base/server/satellite_server.h"
+#include "hphp/runtime/base/server/server_stats.h"
 #include "hphp/runtime/base/util/libevent_http_client.h"
 #include "hphp/runtime/base/server/job_queue_vm_stack.h"
 #include "hphp/runtime/ext/ext_json.h"
+#include "hphp/util/codel.h"
 #include "hphp/util/job_queue.h"
 #include "hphp/util/lock.h"
 #include "hphp/util/logger.h"
@@ -155,6 +157,7 @@ bool XboxRequestHandler::Info = false;
 static IMPLEMENT_THREAD_LOCAL(XboxServerInfoPtr, s_xbox_server_info);
 static IMPLEMENT_THREAD_LOCAL(XboxRequestHandler, s_xbox_request_handler);
 static IMPLEMENT_THREAD_LOCAL(string, s_xbox_prev_req_init_doc);
+static CoDel *s_queueDelay;
 ///////////////////////////////////////////////////////////////////////////////
 
 struct XboxWorker
@@ -162,6 +165,14 @@ struct XboxWorker
 {
   virtual void doJob(XboxTransport *job) {
     try {
+      if (s_queueDelay && s_queueDelay->onDequeue(job->getStartTimer())) {
+        ServerStats::Log("xbox.queue.shed", 1);
+        job->sendString("Service Unavailable", 503);
+        job->onSendEnd();
+        job->decRefCount();
+        return;
+      }
+
       // If this job or the previous job that ran on this thread have
       // a custom initial document, make sure we do a reset
       string reqInitDoc = job->getHeader("ReqInitDoc");
@@ -213,6 +224,10 @@ void XboxServer::Restart() {
        RuntimeOption::ServerThreadDropCacheTimeoutSeconds,
        RuntimeOption::ServerThreadDropStack,
        nullptr);
+    if (RuntimeOption::XboxServerQueueDelayTarget > 0) {
+      s_queueDelay = new CoDel(RuntimeOption::XboxServerQueueDelayTarget,
+                               RuntimeOption::ServerQueueDelayInterval);
+    }
     if (RuntimeOption::XboxServerLogInfo) {
       Logger::Info("xbox server started");
     }
@@ -226,6 +241,12 @@ void XboxServer::Stop() {
     delete s_dispatcher;
     s_dispatcher = nullptr;
   }
+  delete s_queueDelay;
+  s_queueDelay = nullptr;
+}
+
+CoDel *XboxServer::GetQueueDelayMonitor() {
+  return s_queueDelay;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -26,6 +26,7 @@ namespace HPHP {
 
 DECLARE_BOOST_TYPES(XboxServerInfo);
 
+class CoDel;
 class RPCRequestHandler;
 
 class XboxServer {
@@ -49,6 +50,11 @@ public:
    */
   static bool Available();
 
+  /**
+   * Queue delay tracking, if Xbox.ServerInfo.QueueDelayTarget is set.
+   */
+  static CoDel *GetQueueDelayMonitor();
+
   /**
    * Local tasklet for parallel processing.
    */
@@ -15,6 +15,7 @@
 */
 
 #include "hphp/runtime/base/shared/concurrent_shared_store.h"
+#include "hphp/runtime/base/shared/shared_store_snapshot.h"
 #include "hphp/runtime/base/variable_serializer.h"
 #include "hphp/runtime/ext/ext_apc.h"
 #include "hphp/util/logger.h"
@@ -111,6 +112,16 @@ bool ConcurrentTableSharedStore::clear() {
     free((void *)iter->first);
   }
   m_vars.clear();
+  ClockEntry entry;
+  while (m_clockQueue.try_pop(entry)) {
+    free((void *)entry.first);
+  }
+  m_memUsage = 0;
+  for (LeaseMap::iterator iter = m_leases.begin(); iter != m_leases.end();
+       ++iter) {
+    free((void *)iter->first);
+  }
+  m_leases.clear();
   return true;
 }
 
@@ -135,14 +146,15 @@ bool ConcurrentTableSharedStore::eraseImpl(CStrRef key, bool expired) {
       g_vmContext->enqueueSharedVar(acc->second.var);
     } else {
       assert(acc->second.inFile());
-      assert(acc->second.expiry == 0);
+      assert(acc->second.expiry == 0 || acc->second.fileExpires);
     }
-    if (expired && acc->second.inFile()) {
+    if (expired && acc->second.inFile() && !acc->second.fileExpires) {
       // a primed key expired, do not erase the table entry
       acc->second.var = nullptr;
       acc->second.size = 0;
       acc->second.expiry = 0;
     } else {
+      m_memUsage.fetch_sub(acc->second.charge, std::memory_order_relaxed);
       eraseAcc(acc);
     }
     return true;
@@ -189,6 +201,47 @@ void ConcurrentTableSharedStore::purgeExpired() {
   SharedStoreStats::setExpireQueueSize(m_expQueue.size());
 }
 
+static string std_apc_evict = "apc.evict";
+
+void ConcurrentTableSharedStore::evict() {
+  std::unique_lock<std::mutex> guard(m_evictLock, std::try_to_lock);
+  if (!guard.owns_lock()) {
+    // another thread is already moving the hand
+    return;
+  }
+  // Each pass clears every reference bit it skips, so a victim shows up
+  // within two passes unless other threads keep touching keys.
+  size_t steps = 2 * m_clockQueue.unsafe_size() + 1;
+  ClockEntry entry;
+  while (steps-- > 0 && needEviction() && m_clockQueue.try_pop(entry)) {
+    Map::accessor acc;
+    if (!m_vars.find(acc, entry.first) ||
+        acc->second.clockStamp != entry.second) {
+      // deleted or expired since it was queued
+      free((void *)entry.first);
+      continue;
+    }
+    StoreValue *sval = &acc->second;
+    if (sval->referenced ||
+        m_memUsage.load(std::memory_order_relaxed) <= m_memLimit) {
+      // second chance, or only here to drop stale entries
+      sval->referenced = false;
+      acc.release();
+      m_clockQueue.push(entry);
+      continue;
+    }
+    assert(sval->inMem());
+    StackStringData sd(entry.first);
+    stats_on_delete(&sd, sval, false);
+    SharedStoreStats::onEvict(entry.first, sval->charge);
+    m_memUsage.fetch_sub(sval->charge, std::memory_order_relaxed);
+    g_vmContext->enqueueSharedVar(sval->var);
+    eraseAcc(acc);
+    free((void *)entry.first);
+    log_apc(std_apc_evict);
+  }
+}
+
 void ConcurrentTableSharedStore::addToExpirationQueue(const char* key, int64_t etime) {
   ExpMap::accessor acc;
   if (m_expMap.find(acc, key)) {
@@ -294,6 +347,10 @@ bool ConcurrentTableSharedStore::get(CStrRef key, Variant &value) {
           svar = sval->var;
         }
 
+        if (m_memLimit && !sval->referenced) {
+          sval->referenced = true;
+        }
+
         if (RuntimeOption::ApcAllowObj && svar->is(KindOfObject)) {
           promoteObj = true;
         }
@@ -315,6 +372,74 @@ bool ConcurrentTableSharedStore::get(CStrRef key, Variant &value) {
   return true;
 }
 
+static string std_apc_stale = "apc.stale";
+static string std_apc_lease = "apc.lease";
+
+static int64_t now_ms() {
+  timespec ts;
+  gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+}
+
+bool ConcurrentTableSharedStore::tryLease(const char *key, int64_t leaseMs) {
+  int64_t now = now_ms();
+  LeaseMap::accessor acc;
+  if (!m_leases.find(acc, key)) {
+    const char *copy = strdup(key);
+    if (m_leases.insert(acc, copy)) {
+      acc->second = now + leaseMs;
+      return true;
+    }
+    free((void *)copy);
+  }
+  if (acc->second > now) {
+    return false;
+  }
+  // the previous holder never stored the key, take the lease over
+  acc->second = now + leaseMs;
+  return true;
+}
+
+void ConcurrentTableSharedStore::releaseLease(const char *key) {
+  if (m_leases.empty()) return;
+  LeaseMap::accessor acc;
+  if (m_leases.find(acc, key)) {
+    const char *pkey = acc->first;
+    m_leases.erase(acc);
+    free((void *)pkey);
+  }
+}
+
+SharedStore::FetchResult
+ConcurrentTableSharedStore::getOrLease(CStrRef key, Variant &value,
+                                       int64_t leaseMs) {
+  {
+    ConditionalReadLock l(m_lock, !RuntimeOption::ApcConcurrentTableLockFree ||
+                                  m_lockingFlag);
+    Map::const_accessor acc;
+    if (m_vars.find(acc, key.data()) && acc->second.expired() &&
+        acc->second.inMem()) {
+      // Leave the expired value in place, so that it can be served while
+      // the lease holder recomputes it.
+      if (tryLease(key.data(), leaseMs)) {
+        log_apc(std_apc_lease);
+        return FetchLeased;
+      }
+      value = acc->second.var->toLocal();
+      log_apc(std_apc_stale);
+      return FetchStale;
+    }
+  }
+  if (get(key, value)) {
+    return FetchHit;
+  }
+  if (tryLease(key.data(), leaseMs)) {
+    log_apc(std_apc_lease);
+    return FetchLeased;
+  }
+  return FetchBusy;
+}
+
 static int64_t get_int64_value(StoreValue* sval) {
   Variant v;
   if (sval->inMem()) {
@@ -342,6 +467,9 @@ int64_t ConcurrentTableSharedStore::inc(CStrRef key, int64_t step, bool &found)
         SharedVariant *svar = construct(Variant(ret));
         g_vmContext->enqueueSharedVar(sval->var);
         sval->var = svar;
+        if (sval->clockStamp) {
+          updateCharge(sval, key.size() + svar->getSpaceUsage());
+        }
         found = true;
         log_apc(std_apc_hit);
       }
@@ -363,6 +491,9 @@ bool ConcurrentTableSharedStore::cas(CStrRef key, int64_t old, int64_t val) {
         SharedVariant *var = construct(Variant(val));
         g_vmContext->enqueueSharedVar(sval->var);
         sval->var = var;
+        if (sval->clockStamp) {
+          updateCharge(sval, key.size() + var->getSpaceUsage());
+        }
         success = true;
         log_apc(std_apc_cas);
       }
@@ -388,6 +519,9 @@ bool ConcurrentTableSharedStore::exists(CStrRef key) {
         // expiration has to happen after the lock is released
         expired = true;
       } else {
+        if (m_memLimit && !sval->referenced) {
+          sval->referenced = true;
+        }
         // No need toLocal() here, avoiding the copy
         if (sval->inMem()) {
           stats_on_get(key.get(), sval->var);
@@ -417,12 +551,14 @@ bool ConcurrentTableSharedStore::store(CStrRef key, CVarRef value, int64_t ttl,
                                        bool overwrite /* = true */) {
   StoreValue *sval;
   SharedVariant* svar = construct(value);
+  int32_t charge = m_memLimit ? key.size() + svar->getSpaceUsage() : 0;
   ConditionalReadLock l(m_lock, !RuntimeOption::ApcConcurrentTableLockFree ||
                                 m_lockingFlag);
   const char *kcp = strdup(key.data());
   bool present;
   time_t expiry = 0;
   bool overwritePrime = false;
+  uint32_t clockStamp = 0;
   {
     Map::accessor acc;
     present = !m_vars.insert(acc, kcp);
@@ -457,6 +593,25 @@ bool ConcurrentTableSharedStore::store(CStrRef key, CVarRef value, int64_t ttl,
     if (!update) {
       stats_on_add(key.get(), sval, adjustedTtl, false, false);
     }
+    if (m_memLimit) {
+      if (!sval->clockStamp) {
+        // Stamp 0 marks keys that are never evicted: those primed from a
+        // snapshot, until they get a value of their own here.
+        do {
+          clockStamp = m_clockStamp.fetch_add(1, std::memory_order_relaxed);
+        } while (!clockStamp);
+        sval->clockStamp = clockStamp;
+      }
+      updateCharge(sval, charge);
+      sval->referenced = present;
+    }
+  }
+  if (clockStamp) {
+    m_clockQueue.push(ClockEntry(strdup(key.data()), clockStamp));
+  }
+  releaseLease(key.data());
+  if (m_memLimit && needEviction()) {
+    evict();
   }
   if (expiry) {
     addToExpirationQueue(key.data(), expiry);
@@ -491,6 +646,12 @@ void ConcurrentTableSharedStore::prime
     } else {
       acc->second.sAddr = item.sAddr;
       acc->second.sSize = item.sSize;
+      if (item.expiry) {
+        acc->second.expiry = item.expiry;
+        acc->second.fileExpires = true;
+        acc.release();
+        addToExpirationQueue(item.key, item.expiry);
+      }
       continue;
     }
     if (RuntimeOption::APCSizeCountPrime) {
@@ -540,6 +701,15 @@ bool ConcurrentTableSharedStore::constructPrime(CVarRef v,
 }
 
 void ConcurrentTableSharedStore::primeDone() {
+  sealFileStorage();
+  for (set<string>::const_iterator iter =
+         RuntimeOption::ApcCompletionKeys.begin();
+       iter != RuntimeOption::ApcCompletionKeys.end(); ++iter) {
+    addCompletionKey(*iter);
+  }
+}
+
+void ConcurrentTableSharedStore::sealFileStorage() {
   if (s_apc_file_storage.getState() != SharedStoreFileStorage::StateInvalid) {
     s_apc_file_storage.seal();
     s_apc_file_storage.hashCheck();
@@ -551,15 +721,15 @@ void ConcurrentTableSharedStore::primeDone() {
                          time(nullptr) +
                          RuntimeOption::ApcFileStorageAdviseOutPeriod);
   }
+}
 
-  for (set<string>::const_iterator iter =
-         RuntimeOption::ApcCompletionKeys.begin();
-       iter != RuntimeOption::ApcCompletionKeys.end(); ++iter) {
-    Map::accessor acc;
-    const char *copy = strdup(iter->c_str());
-    if (m_vars.insert(acc, copy)) {
-      acc->second.set(this->construct(1), 0);
-    }
+void ConcurrentTableSharedStore::addCompletionKey(const std::string &key) {
+  Map::accessor acc;
+  const char *copy = strdup(key.c_str());
+  if (m_vars.insert(acc, copy)) {
+    acc->second.set(this->construct(1), 0);
+  } else {
+    free((void *)copy);
   }
 }
 
@@ -573,15 +743,67 @@ void ConcurrentTableSharedStore::dump(std::ostream & out, bool keyOnly,
   // This functionality is for debugging and should not be called regularly
   if (RuntimeOption::ApcConcurrentTableLockFree) {
     m_lockingFlag = true;
-    int begin = time(nullptr);
-    Logger::Info("waiting %d seconds before dump", waitSeconds);
-    while (time(nullptr) - begin < waitSeconds) {
-      sleep(1);
-    }
+    WaitForLockFreeOps(waitSeconds);
   }
   WriteLock l(m_lock);
   Logger::Info("dumping apc");
   out << "Total " << m_vars.size() << std::endl;
+  dumpEntries(out, keyOnly);
+  Logger::Info("dumping apc done");
+  if (RuntimeOption::ApcConcurrentTableLockFree) {
+    m_lockingFlag = false;
+  }
+}
+
+bool ConcurrentTableSharedStore::writeSnapshot(
+    SharedStoreSnapshotWriter &writer, int waitSeconds) {
+  // same locking as dump()
+  if (RuntimeOption::ApcConcurrentTableLockFree) {
+    m_lockingFlag = true;
+    WaitForLockFreeOps(waitSeconds);
+  }
+  {
+    WriteLock l(m_lock);
+    snapshotEntries(writer);
+  }
+  if (RuntimeOption::ApcConcurrentTableLockFree) {
+    m_lockingFlag = false;
+  }
+  return true;
+}
+
+void ConcurrentTableSharedStore::snapshotEntries(
+    SharedStoreSnapshotWriter &writer) {
+  for (Map::iterator iter = m_vars.begin(); iter != m_vars.end(); ++iter) {
+    const char *key = iter->first;
+    const StoreValue *sval = &iter->second;
+    if (sval->expired()) continue;
+    if (!sval->inMem()) {
+      // already in apc_serialize() format
+      assert(sval->inFile());
+      writer.add(key, strlen(key), sval->sAddr, sval->sSize, sval->expiry);
+      continue;
+    }
+    try {
+      String s = apc_serialize(sval->var->toLocal());
+      writer.add(key, strlen(key), s.data(), s.size(), sval->expiry);
+    } catch (const Exception &e) {
+      Logger::Warning("Skipping apc key %s in snapshot: %s", key, e.what());
+    }
+  }
+}
+
+void ConcurrentTableSharedStore::WaitForLockFreeOps(int waitSeconds) {
+  int begin = time(nullptr);
+  Logger::Info("waiting %d seconds before dump", waitSeconds);
+  while (time(nullptr) - begin < waitSeconds) {
+    sleep(1);
+  }
+}
+
+// Caller holds m_lock for write
+void ConcurrentTableSharedStore::dumpEntries(std::ostream & out,
+                                             bool keyOnly) {
   for (Map::iterator iter = m_vars.begin(); iter != m_vars.end(); ++iter) {
     const char *key = iter->first;
     out << key;
@@ -610,10 +832,6 @@ void ConcurrentTableSharedStore::dump(std::ostream & out, bool keyOnly,
     }
     out << std::endl;
   }
-  Logger::Info("dumping apc done");
-  if (RuntimeOption::ApcConcurrentTableLockFree) {
-    m_lockingFlag = false;
-  }
 }
 
 ///////////////////////////////////////////////////////////////////////////////
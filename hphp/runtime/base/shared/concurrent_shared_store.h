@@ -19,6 +19,8 @@
 
 #define TBB_PREVIEW_CONCURRENT_PRIORITY_QUEUE 1
 
+#include <mutex>
+
 #include "hphp/runtime/base/shared/shared_store_base.h"
 #include "hphp/runtime/base/complex_types.h"
 #include "hphp/runtime/base/shared/shared_variant.h"
@@ -28,6 +30,7 @@
 #include "hphp/runtime/base/server/server_stats.h"
 #include "tbb/concurrent_hash_map.h"
 #include "tbb/concurrent_priority_queue.h"
+#include "tbb/concurrent_queue.h"
 #include "hphp/runtime/base/shared/shared_store_stats.h"
 
 namespace HPHP {
@@ -37,9 +40,15 @@ namespace HPHP {
 // ConcurrentThreadSharedStore
 
 class ConcurrentTableSharedStore : public SharedStore {
+  friend class ShardedSharedStore;
 public:
-  explicit ConcurrentTableSharedStore(int id)
-    : SharedStore(id), m_lockingFlag(false), m_purgeCounter(0) {}
+  /**
+   * memLimit bounds the bytes taken by keys added through store(); once it
+   * is exceeded, those keys are evicted in CLOCK order. 0 means no limit.
+   */
+  ConcurrentTableSharedStore(int id, int64_t memLimit)
+    : SharedStore(id), m_lockingFlag(false), m_purgeCounter(0),
+      m_memLimit(memLimit), m_memUsage(0), m_clockStamp(0) {}
 
   virtual int size() {
     return m_vars.size();
@@ -50,6 +59,8 @@ public:
   virtual int64_t inc(CStrRef key, int64_t step, bool &found);
   virtual bool cas(CStrRef key, int64_t old, int64_t val);
   virtual bool exists(CStrRef key);
+  virtual FetchResult getOrLease(CStrRef key, Variant &value,
+                                 int64_t leaseMs);
 
   virtual void prime(const std::vector<SharedStore::KeyValuePair> &vars);
   virtual bool constructPrime(CStrRef v, KeyValuePair& item,
@@ -60,6 +71,14 @@ public:
   // debug support
   virtual void dump(std::ostream & out, bool keyOnly, int waitSeconds);
 
+  virtual bool writeSnapshot(SharedStoreSnapshotWriter &writer,
+                             int waitSeconds);
+
+  // testing support
+  int64_t memUsage() const {
+    return m_memUsage.load(std::memory_order_relaxed);
+  }
+
 protected:
   virtual SharedVariant* construct(CVarRef v) {
     return new SharedVariant(v, false);
@@ -111,13 +130,50 @@ protected:
 
   std::atomic<uint64_t> m_purgeCounter;
 
+  // key => end of the lease in ms, see getOrLease()
+  typedef tbb::concurrent_hash_map<const char*, int64_t, charHashCompare>
+    LeaseMap;
+  LeaseMap m_leases;
+
+  bool tryLease(const char *key, int64_t leaseMs);
+  void releaseLease(const char *key);
+
   // Should be called outside m_lock
   void purgeExpired();
 
   void addToExpirationQueue(const char* key, int64_t etime);
 
+  // CLOCK eviction, only used with a memory limit. Every evictable key has
+  // exactly one queue entry with a matching stamp; entries of deleted or
+  // replaced keys are dropped when the hand reaches them.
+  typedef std::pair<const char*, uint32_t> ClockEntry;
+  tbb::concurrent_queue<ClockEntry> m_clockQueue;
+  int64_t m_memLimit;
+  std::atomic<int64_t> m_memUsage;
+  std::atomic<uint32_t> m_clockStamp;
+  std::mutex m_evictLock;
+
+  void updateCharge(StoreValue *sval, int32_t charge) {
+    m_memUsage.fetch_add(charge - sval->charge, std::memory_order_relaxed);
+    sval->charge = charge;
+  }
+  bool needEviction() {
+    return m_memUsage.load(std::memory_order_relaxed) > m_memLimit ||
+      m_clockQueue.unsafe_size() > 2 * m_vars.size() + 1024;
+  }
+  // Should be called outside any Map accessor
+  void evict();
+
   bool handleUpdate(CStrRef key, SharedVariant* svar);
   bool handlePromoteObj(CStrRef key, SharedVariant* svar, CVarRef valye);
+
+  // pieces of primeDone(), dump() and writeSnapshot(), also used by
+  // ShardedSharedStore
+  void sealFileStorage();
+  void addCompletionKey(const std::string &key);
+  static void WaitForLockFreeOps(int waitSeconds);
+  void dumpEntries(std::ostream & out, bool keyOnly);
+  void snapshotEntries(SharedStoreSnapshotWriter &writer);
 private:
   SharedVariant* unserialize(CStrRef key, const StoreValue* sval);
 };
@@ -0,0 +1,135 @@
+/*
+   +----------------------------------------------------------------------+
+   | HipHop for PHP                                                       |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2010-2013 Facebook, Inc. (http://www.facebook.com)     |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 3.01 of the PHP license,      |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available through the world-wide-web at the following url:           |
+   | http://www.php.net/license/3_01.txt                                  |
+   | If you did not receive a copy of the PHP license and are unable to   |
+   | obtain it through the world-wide-web, please send a note to          |
+   | license@php.net so we can mail you a copy immediately.               |
+   +----------------------------------------------------------------------+
+*/
+
+#include "hphp/runtime/base/shared/sharded_shared_store.h"
+#include "hphp/util/logger.h"
+
+using std::set;
+
+namespace HPHP {
+///////////////////////////////////////////////////////////////////////////////
+
+ShardedSharedStore::ShardedSharedStore(int id, int shardCount)
+    : SharedStore(id) {
+  assert(shardCount > 0);
+  // shards split the memory limit evenly
+  int64_t memLimit = RuntimeOption::ApcMemoryLimit;
+  if (memLimit) {
+    memLimit = std::max<int64_t>(memLimit / shardCount, 1);
+  }
+  m_shards.reserve(shardCount);
+  for (int i = 0; i < shardCount; i++) {
+    m_shards.push_back(new ConcurrentTableSharedStore(id, memLimit));
+  }
+}
+
+ShardedSharedStore::~ShardedSharedStore() {
+  for (unsigned int i = 0; i < m_shards.size(); i++) {
+    delete m_shards[i];
+  }
+}
+
+int ShardedSharedStore::size() {
+  int total = 0;
+  for (unsigned int i = 0; i < m_shards.size(); i++) {
+    total += m_shards[i]->size();
+  }
+  return total;
+}
+
+bool ShardedSharedStore::clear() {
+  bool cleared = true;
+  for (unsigned int i = 0; i < m_shards.size(); i++) {
+    cleared = m_shards[i]->clear() && cleared;
+  }
+  return cleared;
+}
+
+void ShardedSharedStore::prime
+(const std::vector<SharedStore::KeyValuePair> &vars) {
+  std::vector<std::vector<SharedStore::KeyValuePair> >
+    shardVars(m_shards.size());
+  for (unsigned int i = 0; i < vars.size(); i++) {
+    const SharedStore::KeyValuePair &item = vars[i];
+    shardVars[shardIndex(item.key, item.len)].push_back(item);
+  }
+  for (unsigned int i = 0; i < m_shards.size(); i++) {
+    if (!shardVars[i].empty()) {
+      m_shards[i]->prime(shardVars[i]);
+    }
+  }
+}
+
+void ShardedSharedStore::primeDone() {
+  // the file storage is shared, so only one shard tracks its advise-out
+  m_shards[0]->sealFileStorage();
+  for (set<string>::const_iterator iter =
+         RuntimeOption::ApcCompletionKeys.begin();
+       iter != RuntimeOption::ApcCompletionKeys.end(); ++iter) {
+    m_shards[shardIndex(iter->c_str(), iter->size())]->addCompletionKey(*iter);
+  }
+}
+
+void ShardedSharedStore::lockAll(int waitSeconds) {
+  if (RuntimeOption::ApcConcurrentTableLockFree) {
+    for (unsigned int i = 0; i < m_shards.size(); i++) {
+      m_shards[i]->m_lockingFlag = true;
+    }
+    ConcurrentTableSharedStore::WaitForLockFreeOps(waitSeconds);
+  }
+  for (unsigned int i = 0; i < m_shards.size(); i++) {
+    m_shards[i]->m_lock.acquireWrite();
+  }
+}
+
+void ShardedSharedStore::unlockAll() {
+  for (unsigned int i = 0; i < m_shards.size(); i++) {
+    m_shards[i]->m_lock.release();
+    if (RuntimeOption::ApcConcurrentTableLockFree) {
+      m_shards[i]->m_lockingFlag = false;
+    }
+  }
+}
+
+void ShardedSharedStore::dump(std::ostream & out, bool keyOnly,
+                              int waitSeconds) {
+  // Lock every shard up front so the total matches the entries.
+  lockAll(waitSeconds);
+  Logger::Info("dumping apc");
+  int total = 0;
+  for (unsigned int i = 0; i < m_shards.size(); i++) {
+    total += m_shards[i]->m_vars.size();
+  }
+  out << "Total " << total << std::endl;
+  for (unsigned int i = 0; i < m_shards.size(); i++) {
+    m_shards[i]->dumpEntries(out, keyOnly);
+  }
+  Logger::Info("dumping apc done");
+  unlockAll();
+}
+
+bool ShardedSharedStore::writeSnapshot(SharedStoreSnapshotWriter &writer,
+                                       int waitSeconds) {
+  lockAll(waitSeconds);
+  for (unsigned int i = 0; i < m_shards.size(); i++) {
+    m_shards[i]->snapshotEntries(writer);
+  }
+  unlockAll();
+  return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+}
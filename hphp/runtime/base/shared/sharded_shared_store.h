@@ -0,0 +1,110 @@
+/*
+   +----------------------------------------------------------------------+
+   | HipHop for PHP                                                       |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2010-2013 Facebook, Inc. (http://www.facebook.com)     |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 3.01 of the PHP license,      |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available through the world-wide-web at the following url:           |
+   | http://www.php.net/license/3_01.txt                                  |
+   | If you did not receive a copy of the PHP license and are unable to   |
+   | obtain it through the world-wide-web, please send a note to          |
+   | license@php.net so we can mail you a copy immediately.               |
+   +----------------------------------------------------------------------+
+*/
+
+#ifndef incl_HPHP_SHARDED_SHARED_STORE_H_
+#define incl_HPHP_SHARDED_SHARED_STORE_H_
+
+#include "hphp/runtime/base/shared/concurrent_shared_store.h"
+
+namespace HPHP {
+///////////////////////////////////////////////////////////////////////////////
+// ShardedSharedStore
+
+/**
+ * Splits the key space over several ConcurrentTableSharedStores picked by
+ * key hash. Every shard has its own table, expiration queue and purge
+ * counter, so stores with a TTL and the purging they trigger only contend
+ * with operations on the same shard.
+ */
+class ShardedSharedStore : public SharedStore {
+public:
+  ShardedSharedStore(int id, int shardCount);
+  virtual ~ShardedSharedStore();
+
+  virtual int size();
+  virtual bool get(CStrRef key, Variant &value) {
+    return shardFor(key).get(key, value);
+  }
+  virtual bool store(CStrRef key, CVarRef val, int64_t ttl,
+                     bool overwrite = true) {
+    return shardFor(key).store(key, val, ttl, overwrite);
+  }
+  virtual int64_t inc(CStrRef key, int64_t step, bool &found) {
+    return shardFor(key).inc(key, step, found);
+  }
+  virtual bool cas(CStrRef key, int64_t old, int64_t val) {
+    return shardFor(key).cas(key, old, val);
+  }
+  virtual bool exists(CStrRef key) {
+    return shardFor(key).exists(key);
+  }
+  virtual FetchResult getOrLease(CStrRef key, Variant &value,
+                                 int64_t leaseMs) {
+    return shardFor(key).getOrLease(key, value, leaseMs);
+  }
+
+  virtual void prime(const std::vector<SharedStore::KeyValuePair> &vars);
+  virtual bool constructPrime(CStrRef v, KeyValuePair& item,
+                              bool serialized) {
+    return m_shards[0]->constructPrime(v, item, serialized);
+  }
+  virtual bool constructPrime(CVarRef v, KeyValuePair& item) {
+    return m_shards[0]->constructPrime(v, item);
+  }
+  virtual void primeDone();
+
+  // debug support
+  virtual void dump(std::ostream & out, bool keyOnly, int waitSeconds);
+
+  virtual bool writeSnapshot(SharedStoreSnapshotWriter &writer,
+                             int waitSeconds);
+
+  // testing support
+  int shardCount() const { return m_shards.size(); }
+  int shardSize(int shard) { return m_shards[shard]->size(); }
+
+protected:
+  virtual bool clear();
+  virtual bool eraseImpl(CStrRef key, bool expired) {
+    if (key.isNull()) return false;
+    return shardFor(key).eraseImpl(key, expired);
+  }
+  virtual SharedVariant* construct(CVarRef v) {
+    return new SharedVariant(v, false);
+  }
+
+private:
+  size_t shardIndex(const char *key, int len) const {
+    // The tables bucket by the low bits of the same hash, so pick the shard
+    // with the high bits to keep every table evenly spread. hash_string()
+    // only yields 31 bits (STRHASH_MASK), hence the shift by 31.
+    uint32_t h = hash_string(key, len);
+    return ((uint64_t)h * m_shards.size()) >> 31;
+  }
+  ConcurrentTableSharedStore &shardFor(CStrRef key) const {
+    return *m_shards[shardIndex(key.data(), key.size())];
+  }
+
+  void lockAll(int waitSeconds);
+  void unlockAll();
+
+  std::vector<ConcurrentTableSharedStore*> m_shards;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+}
+
+#endif /* incl_HPHP_SHARDED_SHARED_STORE_H_ */
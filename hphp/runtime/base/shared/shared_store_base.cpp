@@ -22,6 +22,7 @@
 #include "hphp/runtime/base/memory/leak_detectable.h"
 #include "hphp/runtime/base/server/server_stats.h"
 #include "hphp/runtime/base/shared/concurrent_shared_store.h"
+#include "hphp/runtime/base/shared/sharded_shared_store.h"
 #include "hphp/util/timer.h"
 #include "hphp/util/logger.h"
 #include <sys/mman.h>
@@ -86,7 +87,11 @@ void SharedStores::create() {
   for (int i = 0; i < MAX_SHARED_STORE; i++) {
     switch (RuntimeOption::ApcTableType) {
       case RuntimeOption::ApcConcurrentTable:
-        m_stores[i] = new ConcurrentTableSharedStore(i);
+        m_stores[i] = new ConcurrentTableSharedStore(
+          i, RuntimeOption::ApcMemoryLimit);
+        break;
+      case RuntimeOption::ApcShardedTable:
+        m_stores[i] = new ShardedSharedStore(i, RuntimeOption::ApcShardCount);
         break;
       default:
         assert(false);
@@ -186,6 +191,17 @@ void SharedStoreFileStorage::adviseOut() {
       Logger::Error("Failed to madvise chunk %d", i);
     }
   }
+  for (int i = 0; i < (int)m_snapshots.size(); i++) {
+    if (madvise(m_snapshots[i].first, m_snapshots[i].second,
+                MADV_DONTNEED) < 0) {
+      Logger::Error("Failed to madvise snapshot %d", i);
+    }
+  }
+}
+
+void SharedStoreFileStorage::addSnapshot(void *addr, int64_t size) {
+  Lock lock(m_lock);
+  m_snapshots.push_back(std::make_pair(addr, size));
 }
 
 bool SharedStoreFileStorage::hashCheck() {
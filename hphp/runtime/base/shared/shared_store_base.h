@@ -30,12 +30,19 @@
 namespace HPHP {
 ///////////////////////////////////////////////////////////////////////////////
 
+class SharedStoreSnapshotWriter;
+
 class StoreValue {
 public:
-  StoreValue() : var(nullptr), sAddr(nullptr), expiry(0), size(0), sSize(0) {}
+  StoreValue() : var(nullptr), sAddr(nullptr), expiry(0), size(0), sSize(0),
+                 charge(0), clockStamp(0), referenced(false),
+                 fileExpires(false) {}
   StoreValue(const StoreValue& v) : var(v.var), sAddr(v.sAddr),
                                     expiry(v.expiry), size(v.size),
-                                    sSize(v.sSize) {}
+                                    sSize(v.sSize), charge(v.charge),
+                                    clockStamp(v.clockStamp),
+                                    referenced(v.referenced),
+                                    fileExpires(v.fileExpires) {}
   void set(SharedVariant *v, int64_t ttl);
   bool expired() const;
 
@@ -49,6 +56,16 @@ public:
   int32_t sSize; // For file storage, negative means serailized object
   mutable SmallLock lock;
 
+  // For eviction under Server.APC.MemoryLimit: the bytes this entry counts
+  // against the limit, the stamp of its eviction queue entry (0 for keys
+  // that are never evicted, e.g. primed ones) and the CLOCK reference bit.
+  int32_t charge;
+  uint32_t clockStamp;
+  mutable bool referenced;
+  // The file copy goes away when the entry expires, instead of being served
+  // again like a primed key's (keys loaded from a snapshot with a TTL).
+  bool fileExpires;
+
   bool inMem() const {
     return var != nullptr;
   }
@@ -85,14 +102,33 @@ public:
     return get(key, tmp);
   }
 
+  /**
+   * Single-flight fetch. On a miss, the first caller gets a lease on the key
+   * for leaseMs and is expected to compute and store the value, which drops
+   * the lease. Until then, other callers get the expired value if it is
+   * still around, or FetchBusy.
+   */
+  enum FetchResult {
+    FetchHit,
+    FetchStale,   // expired value, someone else holds the lease
+    FetchLeased,  // miss, the caller now holds the lease
+    FetchBusy     // miss, someone else holds the lease
+  };
+  virtual FetchResult getOrLease(CStrRef key, Variant &value,
+                                 int64_t leaseMs) {
+    // Default implementation has no leases: every miss recomputes
+    return get(key, value) ? FetchHit : FetchLeased;
+  }
+
   // for priming only
   struct KeyValuePair {
-    KeyValuePair() : value(nullptr), sAddr(nullptr) {}
+    KeyValuePair() : value(nullptr), sAddr(nullptr), expiry(0) {}
     litstr key;
     int len;
     SharedVariant *value;
     char *sAddr;
     int32_t sSize;
+    int64_t expiry; // only for sAddr, see SharedStoreSnapshot
 
     bool inMem() const {
       return value != nullptr;
@@ -113,6 +149,12 @@ public:
     /* Default does nothing*/
   }
 
+  // see SharedStoreSnapshot
+  virtual bool writeSnapshot(SharedStoreSnapshotWriter &writer,
+                             int waitSeconds) {
+    return false;
+  }
+
 protected:
   int m_id;
 
@@ -167,6 +209,9 @@ public:
   void cleanup();
   StorageState getState() { return m_state; }
 
+  // Takes over a mapped snapshot, so adviseOut() covers it too.
+  void addSnapshot(void *addr, int64_t size);
+
 private:
   bool addFile();
 
@@ -179,6 +224,7 @@ private:
   char *m_current;
   int32_t m_chunkRemain;
   std::vector<std::string> m_fileNames;
+  std::vector<std::pair<void*, int64_t> > m_snapshots;
 
   Mutex m_lock;
   static const strhash_t TombHash = 0xdeadbeef;
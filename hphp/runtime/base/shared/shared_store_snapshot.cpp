@@ -0,0 +1,234 @@
+/*
+   +----------------------------------------------------------------------+
+   | HipHop for PHP                                                       |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2010-2013 Facebook, Inc. (http://www.facebook.com)     |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 3.01 of the PHP license,      |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available through the world-wide-web at the following url:           |
+   | http://www.php.net/license/3_01.txt                                  |
+   | If you did not receive a copy of the PHP license and are unable to   |
+   | obtain it through the world-wide-web, please send a note to          |
+   | license@php.net so we can mail you a copy immediately.               |
+   +----------------------------------------------------------------------+
+*/
+
+#include "hphp/runtime/base/shared/shared_store_snapshot.h"
+#include "hphp/runtime/base/runtime_option.h"
+#include "hphp/util/logger.h"
+#include "hphp/util/timer.h"
+
+#include <climits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace HPHP {
+///////////////////////////////////////////////////////////////////////////////
+
+static const char SnapshotMagic[8] = { 'H', 'H', 'A', 'P', 'C', 'S', 'N', 'P' };
+
+static uint32_t current_flags() {
+  return RuntimeOption::EnableApcSerialize ?
+    SharedStoreSnapshot::FlagApcSerialize : 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// SharedStoreSnapshotWriter
+
+SharedStoreSnapshotWriter::~SharedStoreSnapshotWriter() {
+  if (m_fp) {
+    fclose(m_fp);
+    unlink(m_tmpPath.c_str());
+  }
+}
+
+bool SharedStoreSnapshotWriter::open(const std::string &path) {
+  assert(!m_fp);
+  m_path = path;
+  m_tmpPath = path + ".XXXXXX";
+  int fd = mkstemp(&m_tmpPath[0]);
+  if (fd < 0) {
+    Logger::Error("Failed to create apc snapshot %s", m_tmpPath.c_str());
+    return false;
+  }
+  m_fp = fdopen(fd, "w");
+  if (!m_fp) {
+    close(fd);
+    unlink(m_tmpPath.c_str());
+    return false;
+  }
+  // the header is filled in by commit()
+  SharedStoreSnapshot::Header header;
+  memset(&header, 0, sizeof(header));
+  if (fwrite(&header, sizeof(header), 1, m_fp) != 1) {
+    m_failed = true;
+  }
+  m_offset = sizeof(header);
+  return !m_failed;
+}
+
+uint64_t SharedStoreSnapshotWriter::append(const char *data, int64_t len) {
+  uint64_t offset = m_offset;
+  if (fwrite(data, 1, len, m_fp) != (size_t)len || fputc('\0', m_fp) == EOF) {
+    m_failed = true;
+  }
+  m_offset += len + 1;
+  return offset;
+}
+
+void SharedStoreSnapshotWriter::add(const char *key, int32_t keyLen,
+                                    const char *value, int32_t valueSize,
+                                    int64_t expiry) {
+  assert(m_fp);
+  SharedStoreSnapshot::Entry entry;
+  entry.keyOffset = append(key, keyLen);
+  entry.valueOffset = append(value, abs(valueSize));
+  entry.expiry = expiry;
+  entry.keyLen = keyLen;
+  entry.valueSize = valueSize;
+  m_entries.push_back(entry);
+}
+
+bool SharedStoreSnapshotWriter::commit() {
+  assert(m_fp);
+  // keep the index aligned for the loader
+  static const char padding[8] = { 0 };
+  uint64_t pad = (8 - m_offset % 8) % 8;
+  if (pad && fwrite(padding, 1, pad, m_fp) != pad) {
+    m_failed = true;
+  }
+  m_offset += pad;
+
+  SharedStoreSnapshot::Header header;
+  memcpy(header.magic, SnapshotMagic, sizeof(header.magic));
+  header.version = SharedStoreSnapshot::Version;
+  header.flags = current_flags();
+  header.count = m_entries.size();
+  header.indexOffset = m_offset;
+  header.fileSize =
+    m_offset + m_entries.size() * sizeof(SharedStoreSnapshot::Entry);
+  header.created = time(nullptr);
+
+  if (!m_entries.empty() &&
+      fwrite(&m_entries[0], sizeof(SharedStoreSnapshot::Entry),
+             m_entries.size(), m_fp) !=
+      m_entries.size()) {
+    m_failed = true;
+  }
+  if (fseek(m_fp, 0, SEEK_SET) != 0 ||
+      fwrite(&header, sizeof(header), 1, m_fp) != 1 ||
+      fflush(m_fp) != 0 || fsync(fileno(m_fp)) != 0) {
+    m_failed = true;
+  }
+  if (fclose(m_fp) != 0) {
+    m_failed = true;
+  }
+  m_fp = nullptr;
+
+  if (m_failed || rename(m_tmpPath.c_str(), m_path.c_str()) != 0) {
+    Logger::Error("Failed to write apc snapshot %s", m_path.c_str());
+    unlink(m_tmpPath.c_str());
+    return false;
+  }
+  return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+int SharedStoreSnapshot::Write(SharedStore &store, const std::string &path,
+                               int waitSeconds) {
+  Timer timer(Timer::WallTime, "writing APC snapshot");
+  SharedStoreSnapshotWriter writer;
+  if (!writer.open(path) ||
+      !store.writeSnapshot(writer, waitSeconds) ||
+      !writer.commit()) {
+    return -1;
+  }
+  Logger::Info("wrote %d keys to apc snapshot %s", (int)writer.count(),
+               path.c_str());
+  return writer.count();
+}
+
+static bool check_entry(const SharedStoreSnapshot::Entry &entry,
+                        const char *base, uint64_t size) {
+  if (entry.keyLen < 0 || entry.valueSize == INT_MIN ||
+      entry.keyOffset >= size || entry.keyLen >= size - entry.keyOffset ||
+      base[entry.keyOffset + entry.keyLen] != '\0') {
+    return false;
+  }
+  uint64_t valueSize = abs(entry.valueSize);
+  return entry.valueOffset < size && valueSize < size - entry.valueOffset;
+}
+
+int SharedStoreSnapshot::Load(SharedStore &store, const std::string &path) {
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return -1;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(Header)) {
+    Logger::Error("Invalid apc snapshot %s", path.c_str());
+    close(fd);
+    return -1;
+  }
+  uint64_t size = st.st_size;
+  char *base = (char *)mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (base == (char *)MAP_FAILED) {
+    Logger::Error("Failed to mmap apc snapshot %s", path.c_str());
+    return -1;
+  }
+
+  const Header *header = (const Header *)base;
+  if (memcmp(header->magic, SnapshotMagic, sizeof(header->magic)) != 0 ||
+      header->version != Version || header->flags != current_flags() ||
+      header->fileSize != size || header->indexOffset < sizeof(Header) ||
+      header->indexOffset % 8 != 0 || header->indexOffset > size ||
+      header->count > (size - header->indexOffset) / sizeof(Entry)) {
+    Logger::Error("Invalid or incompatible apc snapshot %s", path.c_str());
+    munmap(base, size);
+    return -1;
+  }
+
+  Timer timer(Timer::WallTime, "loading APC snapshot");
+  const Entry *entries = (const Entry *)(base + header->indexOffset);
+  time_t now = time(nullptr);
+  std::vector<SharedStore::KeyValuePair> vars;
+  vars.reserve(std::min<uint64_t>(header->count, 4096));
+  int count = 0;
+  for (uint64_t i = 0; i < header->count; i++) {
+    const Entry &entry = entries[i];
+    if (!check_entry(entry, base, size)) {
+      Logger::Error("Invalid entry %llu in apc snapshot %s",
+                    (unsigned long long)i, path.c_str());
+      break;
+    }
+    if (entry.expiry && entry.expiry <= now) continue;
+    SharedStore::KeyValuePair item;
+    item.key = base + entry.keyOffset;
+    item.len = entry.keyLen;
+    item.sAddr = base + entry.valueOffset;
+    item.sSize = entry.valueSize;
+    item.expiry = entry.expiry;
+    vars.push_back(item);
+    if (vars.size() == 4096) {
+      store.prime(vars);
+      count += vars.size();
+      vars.clear();
+    }
+  }
+  if (!vars.empty()) {
+    store.prime(vars);
+    count += vars.size();
+  }
+  // primed keys point into the mapping, so it is never unmapped
+  s_apc_file_storage.addSnapshot(base, size);
+  Logger::Info("loaded %d keys from apc snapshot %s", count, path.c_str());
+  return count;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+}
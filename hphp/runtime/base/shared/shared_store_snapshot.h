@@ -0,0 +1,114 @@
+/*
+   +----------------------------------------------------------------------+
+   | HipHop for PHP                                                       |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2010-2013 Facebook, Inc. (http://www.facebook.com)     |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 3.01 of the PHP license,      |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available through the world-wide-web at the following url:           |
+   | http://www.php.net/license/3_01.txt                                  |
+   | If you did not receive a copy of the PHP license and are unable to   |
+   | obtain it through the world-wide-web, please send a note to          |
+   | license@php.net so we can mail you a copy immediately.               |
+   +----------------------------------------------------------------------+
+*/
+
+#ifndef incl_HPHP_SHARED_STORE_SNAPSHOT_H_
+#define incl_HPHP_SHARED_STORE_SNAPSHOT_H_
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "hphp/runtime/base/shared/shared_store_base.h"
+
+namespace HPHP {
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * APC snapshots let a new server process start with the APC contents of the
+ * one it replaces, without re-priming or re-populating from backends.
+ *
+ * The file is position independent and meant to be mapped, not read:
+ *
+ *   Header
+ *   keys and values, each followed by '\0'
+ *   Entry[count], at Header::indexOffset
+ *
+ * Values are stored in the format apc_serialize() produces. Loading maps the
+ * file and primes the store with entries pointing into the mapping, so a
+ * value is only paged in and unserialized when it is first fetched, the same
+ * way keys primed into SharedStoreFileStorage are. Integers are in native
+ * byte order: a snapshot is only meant for the same build on the same box.
+ */
+class SharedStoreSnapshot {
+public:
+  static const uint32_t Version = 1;
+  static const uint32_t FlagApcSerialize = 1;
+
+  struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t flags;
+    uint64_t count;
+    uint64_t indexOffset;
+    uint64_t fileSize;
+    int64_t created;
+  };
+
+  struct Entry {
+    uint64_t keyOffset;
+    uint64_t valueOffset;
+    int64_t expiry; // absolute, 0 for none
+    int32_t keyLen;
+    int32_t valueSize; // negative means serialized object, like sSize
+  };
+
+  /**
+   * Dumps store into a snapshot at path. Returns the number of keys
+   * written, or -1 on failure.
+   */
+  static int Write(SharedStore &store, const std::string &path,
+                   int waitSeconds);
+
+  /**
+   * Primes store with the unexpired keys of the snapshot at path. Returns
+   * the number of keys loaded, or -1 if the file is missing or invalid.
+   */
+  static int Load(SharedStore &store, const std::string &path);
+};
+
+/**
+ * Streams entries into a new snapshot file.
+ */
+class SharedStoreSnapshotWriter {
+public:
+  SharedStoreSnapshotWriter() : m_fp(nullptr), m_offset(0), m_failed(false) {}
+  ~SharedStoreSnapshotWriter();
+
+  /**
+   * Writes go to a temporary file next to path, which commit() renames
+   * into place, so readers never see a partial snapshot.
+   */
+  bool open(const std::string &path);
+  void add(const char *key, int32_t keyLen, const char *value,
+           int32_t valueSize, int64_t expiry);
+  bool commit();
+  size_t count() const { return m_entries.size(); }
+
+private:
+  uint64_t append(const char *data, int64_t len);
+
+  std::string m_path;
+  std::string m_tmpPath;
+  FILE *m_fp;
+  uint64_t m_offset;
+  bool m_failed;
+  std::vector<SharedStoreSnapshot::Entry> m_entries;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+}
+
+#endif /* incl_HPHP_SHARED_STORE_SNAPSHOT_H_ */
@@ -244,6 +244,12 @@ std::atomic<int32_t> SharedStoreStats::s_fromFileCount(0);
 std::atomic<int32_t> SharedStoreStats::s_updateCount(0);
 std::atomic<int32_t> SharedStoreStats::s_deleteCount(0);
 std::atomic<int32_t> SharedStoreStats::s_expireCount(0);
+std::atomic<int32_t> SharedStoreStats::s_evictCount(0);
+std::atomic<int64_t> SharedStoreStats::s_evictSize(0);
+
+std::atomic<int64_t> SharedStoreStats::s_compressedCount(0);
+std::atomic<int64_t> SharedStoreStats::s_compressedRawSize(0);
+std::atomic<int64_t> SharedStoreStats::s_compressedSize(0);
 
 int32_t SharedStoreStats::s_expireQueueSize = 0;
 std::atomic<int64_t> SharedStoreStats::s_purgingTime(0);
@@ -252,6 +258,7 @@ ReadWriteMutex SharedStoreStats::s_rwlock;
 
 SharedStoreStats::StatsMap SharedStoreStats::s_statsMap,
                            SharedStoreStats::s_detailMap;
+SharedStoreStats::EvictMap SharedStoreStats::s_evictMap;
 
 //////////////////////////////////////////////////////////////////////////////
 // Helpers for reporting and global aggregation
@@ -269,6 +276,12 @@ string SharedStoreStats::report_basic() {
   writeEntryInt(out, "Update_Count", s_updateCount, false, 1, true);
   writeEntryInt(out, "Delete_Count", s_deleteCount, false, 1, true);
   writeEntryInt(out, "Expire_Count", s_expireCount, false, 1, true);
+  writeEntryInt(out, "Evict_Count", s_evictCount, false, 1, true);
+  writeEntryInt(out, "Evict_Size", s_evictSize, false, 1, true);
+  writeEntryInt(out, "Compressed_Count", s_compressedCount, false, 1, true);
+  writeEntryInt(out, "Compressed_Raw_Size", s_compressedRawSize,
+                false, 1, true);
+  writeEntryInt(out, "Compressed_Size", s_compressedSize, false, 1, true);
   writeEntryInt(out, "Expire_Queue_Size", s_expireQueueSize, false, 1, true);
   writeEntryInt(out, "Purging_Time", s_purgingTime, true, 1, true);
   out << "}\n";
@@ -287,6 +300,11 @@ string SharedStoreStats::report_basic_flat() {
       << ", " << "\"hphp.apc.update_count\":" << s_updateCount
       << ", " << "\"hphp.apc.delete_count\":" << s_deleteCount
       << ", " << "\"hphp.apc.expire_count\":" << s_expireCount
+      << ", " << "\"hphp.apc.evict_count\":" << s_evictCount
+      << ", " << "\"hphp.apc.evict_size\":" << s_evictSize
+      << ", " << "\"hphp.apc.compressed_count\":" << s_compressedCount
+      << ", " << "\"hphp.apc.compressed_raw_size\":" << s_compressedRawSize
+      << ", " << "\"hphp.apc.compressed_size\":" << s_compressedSize
       << ", " << "\"hphp.apc.expire_queue_size\":" << s_expireQueueSize
       << ", " << "\"hphp.apc.purging_time\":" << s_purgingTime
       << "}\n";
@@ -312,6 +330,20 @@ string SharedStoreStats::report_keys() {
   return out.str();
 }
 
+string SharedStoreStats::report_evictions() {
+  ostringstream out;
+  ReadLock l(s_rwlock);
+  for (EvictMap::const_iterator iter = s_evictMap.begin();
+       iter != s_evictMap.end(); ++iter) {
+    out << "{";
+    writeEntryStr(out, "GroupName", iter->first.c_str());
+    writeEntryInt(out, "Count", iter->second.count);
+    writeEntryInt(out, "Size", iter->second.size, true);
+    out << "}\n";
+  }
+  return out.str();
+}
+
 bool SharedStoreStats::snapshot(const char *filename, std::string& keySample) {
   std::ofstream out(filename);
   if (out.fail()) {
@@ -419,6 +451,19 @@ void SharedStoreStats::addPurgingTime(int64_t purgingTime) {
   s_purgingTime.fetch_add(purgingTime, std::memory_order_relaxed);
 }
 
+void SharedStoreStats::addCompressed(int32_t rawSize, int32_t compressedSize) {
+  s_compressedCount.fetch_add(1, std::memory_order_relaxed);
+  s_compressedRawSize.fetch_add(rawSize, std::memory_order_relaxed);
+  s_compressedSize.fetch_add(compressedSize, std::memory_order_relaxed);
+}
+
+void SharedStoreStats::removeCompressed(int32_t rawSize,
+                                        int32_t compressedSize) {
+  s_compressedCount.fetch_sub(1, std::memory_order_relaxed);
+  s_compressedRawSize.fetch_sub(rawSize, std::memory_order_relaxed);
+  s_compressedSize.fetch_sub(compressedSize, std::memory_order_relaxed);
+}
+
 void SharedStoreStats::onDelete(const StringData *key, const SharedVariant *var,
                                 bool replace, bool noTTL) {
   char normalizedKey[MAX_KEY_LEN + 1];
@@ -457,6 +502,20 @@ void SharedStoreStats::onDelete(const StringData *key, const SharedVariant *var,
   }
 }
 
+void SharedStoreStats::onEvict(const char *key, int32_t size) {
+  s_evictCount.fetch_add(1, std::memory_order_relaxed);
+  s_evictSize.fetch_add(size, std::memory_order_relaxed);
+
+  char normalizedKey[MAX_KEY_LEN + 1];
+  normalizeKey(key, normalizedKey, MAX_KEY_LEN);
+  normalizedKey[MAX_KEY_LEN] = '\0';
+  ReadLock l(s_rwlock);
+  EvictMap::accessor acc;
+  s_evictMap.insert(acc, std::string(normalizedKey));
+  acc->second.count++;
+  acc->second.size += size;
+}
+
 void SharedStoreStats::onGet(const StringData *key, const SharedVariant *var) {
   ReadLock l(s_rwlock);
   StatsMap::const_accessor cacc;
@@ -95,10 +95,12 @@ public:
   static void onDelete(const StringData *key, const SharedVariant *var,
                        bool replace, bool noTTL);
   static void onGet(const StringData *key, const SharedVariant *var);
+  static void onEvict(const char *key, int32_t size);
 
   static std::string report_basic();
   static std::string report_basic_flat();
   static std::string report_keys();
+  static std::string report_evictions();
   static bool snapshot(const char *filename, std::string& keySample);
 
   static void addDirect(int32_t keySize, int32_t dataTotal, bool prime, bool file);
@@ -110,6 +112,13 @@ public:
   }
   static void addPurgingTime(int64_t purgingTime);
 
+  // live LZ4 compressed values, see SharedVariant::initCompressed()
+  static void addCompressed(int32_t rawSize, int32_t compressedSize);
+  static void removeCompressed(int32_t rawSize, int32_t compressedSize);
+  static int64_t getCompressedCount() { return s_compressedCount; }
+  static int64_t getCompressedRawSize() { return s_compressedRawSize; }
+  static int64_t getCompressedSize() { return s_compressedSize; }
+
 protected:
   static ReadWriteMutex s_rwlock;
 
@@ -128,6 +137,12 @@ protected:
   static std::atomic<int32_t> s_updateCount;
   static std::atomic<int32_t> s_deleteCount;
   static std::atomic<int32_t> s_expireCount;
+  static std::atomic<int32_t> s_evictCount;
+  static std::atomic<int64_t> s_evictSize;
+
+  static std::atomic<int64_t> s_compressedCount;
+  static std::atomic<int64_t> s_compressedRawSize;
+  static std::atomic<int64_t> s_compressedSize;
 
   static int32_t s_expireQueueSize;
   static std::atomic<int64_t> s_purgingTime;
@@ -150,6 +165,15 @@ protected:
                                    charHashCompare> StatsMap;
 
   static StatsMap s_statsMap, s_detailMap;
+
+  // evictions by normalized key group
+  struct EvictionCount {
+    EvictionCount() : count(0), size(0) {}
+    int64_t count;
+    int64_t size;
+  };
+  typedef tbb::concurrent_hash_map<std::string, EvictionCount> EvictMap;
+  static EvictMap s_evictMap;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -19,6 +19,8 @@
 #include "hphp/runtime/ext/ext_apc.h"
 #include "hphp/runtime/base/shared/shared_map.h"
 #include "hphp/runtime/base/runtime_option.h"
+#include "hphp/runtime/base/shared/shared_store_stats.h"
+#include <lz4.h>
 
 namespace HPHP {
 ///////////////////////////////////////////////////////////////////////////////
@@ -68,6 +70,7 @@ StringCase:
         m_type = KindOfStaticString;
         break;
       }
+      if (!inner && initCompressed(s)) break;
       m_data.str = s->copy(true);
       break;
     }
@@ -81,6 +84,7 @@ StringCase:
         if (arr->hasInternalReference(seen)) {
           setSerializedArray();
           String s = apc_serialize(source);
+          if (initCompressed(s)) break;
           m_data.str = new StringData(s.data(), s.size(), CopyMalloc);
           break;
         }
@@ -112,6 +116,7 @@ StringCase:
         setIsObj();
       } else {
         String s = apc_serialize(source);
+        if (!inner && initCompressed(s)) break;
         m_data.str = new StringData(s.data(), s.size(), CopyMalloc);
       }
       break;
@@ -119,6 +124,43 @@ StringCase:
   }
 }
 
+/*
+ * Top level strings, serialized arrays and serialized objects of at least
+ * ApcCompressThreshold bytes are kept LZ4 compressed, as the uncompressed
+ * length followed by the LZ4 block. Inner strings are left alone since
+ * SharedMap hands them out without copying.
+ */
+bool SharedVariant::initCompressed(CStrRef s) {
+  int threshold = RuntimeOption::ApcCompressThreshold;
+  if (threshold <= 0 || s.size() < threshold) return false;
+
+  uint32_t len = s.size();
+  char *buf = (char *)malloc(sizeof(len) + LZ4_compressBound(len));
+  memcpy(buf, &len, sizeof(len));
+  int csize = LZ4_compress(s.data(), buf + sizeof(len), len);
+  // not worth decompressing on every fetch unless it saves 1/8
+  if (csize <= 0 || sizeof(len) + csize > len - len / 8) {
+    free(buf);
+    return false;
+  }
+  m_data.str = new StringData(buf, sizeof(len) + csize, CopyMalloc);
+  free(buf);
+  setCompressed();
+  SharedStoreStats::addCompressed(len, m_data.str->size());
+  return true;
+}
+
+String SharedVariant::uncompress() const {
+  assert(getCompressed());
+  const char *data = m_data.str->data();
+  uint32_t len;
+  memcpy(&len, data, sizeof(len));
+  String s(len, ReserveString);
+  int read = LZ4_uncompress(data + sizeof(len), s.mutableSlice().ptr, len);
+  always_assert(read == m_data.str->size() - (int)sizeof(len));
+  return s.setSize(len);
+}
+
 HOT_FUNC
 Variant SharedVariant::toLocal() {
   switch (m_type) {
@@ -140,11 +182,17 @@ Variant SharedVariant::toLocal() {
     }
   case KindOfString:
     {
+      if (getCompressed()) {
+        return uncompress();
+      }
       return NEW(StringData)(this);
     }
   case KindOfArray:
     {
       if (getSerializedArray()) {
+        if (getCompressed()) {
+          return apc_unserialize(uncompress());
+        }
         return apc_unserialize(String(m_data.str->data(), m_data.str->size(),
                                       AttachLiteral));
       }
@@ -161,6 +209,9 @@ Variant SharedVariant::toLocal() {
       if (getIsObj()) {
         return m_data.obj->getObject();
       }
+      if (getCompressed()) {
+        return apc_unserialize(uncompress());
+      }
       return apc_unserialize(String(m_data.str->data(), m_data.str->size(),
                                     AttachLiteral));
     }
@@ -171,6 +222,12 @@ void SharedVariant::dump(std::string &out) {
   out += "ref(";
   out += boost::lexical_cast<string>(m_count);
   out += ") ";
+  if (getCompressed()) {
+    out += "compressed(";
+    out += boost::lexical_cast<string>(m_data.str->size());
+    out += ")\n";
+    return;
+  }
   switch (m_type) {
   case KindOfBoolean:
     out += "boolean: ";
@@ -212,6 +269,11 @@ void SharedVariant::dump(std::string &out) {
 }
 
 SharedVariant::~SharedVariant() {
+  if (getCompressed()) {
+    uint32_t len;
+    memcpy(&len, m_data.str->data(), sizeof(len));
+    SharedStoreStats::removeCompressed(len, m_data.str->size());
+  }
   switch (m_type) {
   case KindOfObject:
     if (getIsObj()) {
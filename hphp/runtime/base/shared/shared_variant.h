@@ -143,6 +143,7 @@ private:
   const static uint8_t IsVector = (1<<1);
   const static uint8_t IsObj = (1<<2);
   const static uint8_t ObjAttempted = (1<<3);
+  const static uint8_t Compressed = (1<<4);
 
   static void compileTimeAssertions() {
     static_assert(offsetof(SharedVariant, m_data) == offsetof(TypedValue, m_data),
@@ -170,6 +171,12 @@ private:
   void setObjAttempted() { m_flags |= ObjAttempted;}
   void clearObjAttempted() { m_flags &= ~ObjAttempted;}
 
+  bool getCompressed() const { return (bool)(m_flags & Compressed);}
+  void setCompressed() { m_flags |= Compressed;}
+
+  bool initCompressed(CStrRef s);
+  String uncompress() const;
+
 public:
   bool getIsVector() const { return (bool)(m_flags & IsVector);}
   ImmutableMap* getMap() const { return m_data.map; }
@@ -204,7 +204,8 @@ public:
   static const ssize_t EventHookFlag        = 1 << 3;
   static const ssize_t PendingExceptionFlag = 1 << 4;
   static const ssize_t InterceptFlag        = 1 << 5;
-  static const ssize_t LastFlag             = InterceptFlag;
+  static const ssize_t PendingGCFlag        = 1 << 6;
+  static const ssize_t LastFlag             = PendingGCFlag;
 
   RequestInjectionData()
     : cflagsPtr(nullptr), surprisePage(nullptr), started(0), timeoutSeconds(-1),
@@ -269,6 +270,7 @@ public:
   void clearPendingExceptionFlag();
   void setInterceptFlag();
   void clearInterceptFlag();
+  void setPendingGCFlag();
   ssize_t fetchAndClearFlags();
 
   void onSessionInit();
@@ -22,6 +22,7 @@
 #include "hphp/runtime/ext/JSON_parser.h"
 
 #include "hphp/util/alloc.h"
+#include "hphp/util/byte_set.h"
 
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -29,6 +30,10 @@
 
 #include <algorithm>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 namespace HPHP {
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -224,110 +229,148 @@ void StringBuffer::appendHelper(const char *s, int len) {
   (((us & 0xf) << 12)      | (((us >> 4) & 0xf) << 8) |   \
   (((us >> 8) & 0xf) << 4) | ((us >> 12) & 0xf))          \
 
+/*
+ * Bytes that may need escaping in a JSON string, whatever the options:
+ * control characters, non-ASCII bytes, and the ASCII characters the switch
+ * in append_json_char() looks at.
+ */
+static const char s_json_special[] = "\"\\/<>&'@%";
+
+static const ByteRangeSet s_json_escaped(' ', s_json_special,
+                                         sizeof(s_json_special) - 1);
+
+static void append_json_char(StringBuffer &sb, unsigned short us,
+                             int options) {
+  static const char digits[] = "0123456789abcdef";
+
+  switch (us) {
+  case '"':
+    if (options & k_JSON_HEX_QUOT) {
+      sb.append("\\u0022", 6);
+    } else {
+      sb.append("\\\"", 2);
+    }
+    break;
+  case '\\': sb.append("\\\\", 2); break;
+  case '/':
+    if (options & k_JSON_UNESCAPED_SLASHES) {
+      sb.append('/');
+    } else {
+      sb.append("\\/", 2);
+    }
+    break;
+  case '\b': sb.append("\\b", 2);  break;
+  case '\f': sb.append("\\f", 2);  break;
+  case '\n': sb.append("\\n", 2);  break;
+  case '\r': sb.append("\\r", 2);  break;
+  case '\t': sb.append("\\t", 2);  break;
+  case '<':
+    if (options & k_JSON_HEX_TAG || options & k_JSON_FB_EXTRA_ESCAPES) {
+      sb.append("\\u003C", 6);
+    } else {
+      sb.append('<');
+    }
+    break;
+  case '>':
+    if (options & k_JSON_HEX_TAG) {
+      sb.append("\\u003E", 6);
+    } else {
+      sb.append('>');
+    }
+    break;
+  case '&':
+    if (options & k_JSON_HEX_AMP) {
+      sb.append("\\u0026", 6);
+    } else {
+      sb.append('&');
+    }
+    break;
+  case '\'':
+    if (options & k_JSON_HEX_APOS) {
+      sb.append("\\u0027", 6);
+    } else {
+      sb.append('\'');
+    }
+    break;
+  case '@':
+    if (options & k_JSON_FB_EXTRA_ESCAPES) {
+      sb.append("\\u0040", 6);
+    } else {
+      sb.append('@');
+    }
+    break;
+  case '%':
+    if (options & k_JSON_FB_EXTRA_ESCAPES) {
+      sb.append("\\u0025", 6);
+    } else {
+      sb.append('%');
+    }
+    break;
+  default:
+    if (us >= ' ' && options & k_JSON_UNESCAPED_UNICODE) {
+      utf16_to_utf8(sb, us);
+    } else if (us >= ' ' && (us & 127) == us) {
+      sb.append((char)us);
+    } else {
+      sb.append("\\u", 2);
+      us = REVERSE16(us);
+      sb.append(digits[us & ((1 << 4) - 1)]); us >>= 4;
+      sb.append(digits[us & ((1 << 4) - 1)]); us >>= 4;
+      sb.append(digits[us & ((1 << 4) - 1)]); us >>= 4;
+      sb.append(digits[us & ((1 << 4) - 1)]);
+    }
+    break;
+  }
+}
+
 void StringBuffer::appendJsonEscape(const char *s, int len, int options) {
   if (len == 0) {
     append("\"\"", 2);
-  } else {
-    static const char digits[] = "0123456789abcdef";
+    return;
+  }
 
-    int start = size();
-    append('"');
+  int start = size();
+  append('"');
+
+  // Runs of plain ASCII are copied as they are; everything else goes through
+  // append_json_char(), with multibyte characters decoded one at a time.
+  const char *p = s;
+  const char *end = s + len;
+  for (;;) {
+    const char *run = s_json_escaped.find(p, end);
+    append(p, run - p);
+    p = run;
+    if (p == end) break;
+
+    unsigned char c = *p;
+    if (c < 0x80) {
+      append_json_char(*this, c, options);
+      p++;
+      continue;
+    }
 
-    UTF8To16Decoder decoder(s, len, options & k_JSON_FB_LOOSE);
-    for (;;) {
-      int c = decoder.decode();
-      if (c == UTF8_END) {
-        append('"');
-        break;
-      }
-      if (c == UTF8_ERROR) {
-        // discard the part that has been already decoded.
-        resize(start);
-        append("null", 4);
-        break;
-      }
-      assert(c >= 0);
-      unsigned short us = (unsigned short)c;
-      switch (us) {
-      case '"':
-        if (options & k_JSON_HEX_QUOT) {
-          append("\\u0022", 6);
-        } else {
-          append("\\\"", 2);
-        }
-        break;
-      case '\\': append("\\\\", 2); break;
-      case '/':
-        if (options & k_JSON_UNESCAPED_SLASHES) {
-          append('/');
-        } else {
-          append("\\/", 2);
-        }
-        break;
-      case '\b': append("\\b", 2);  break;
-      case '\f': append("\\f", 2);  break;
-      case '\n': append("\\n", 2);  break;
-      case '\r': append("\\r", 2);  break;
-      case '\t': append("\\t", 2);  break;
-      case '<':
-        if (options & k_JSON_HEX_TAG || options & k_JSON_FB_EXTRA_ESCAPES) {
-          append("\\u003C", 6);
-        } else {
-          append('<');
-        }
-        break;
-      case '>':
-        if (options & k_JSON_HEX_TAG) {
-          append("\\u003E", 6);
-        } else {
-          append('>');
-        }
-        break;
-      case '&':
-        if (options & k_JSON_HEX_AMP) {
-          append("\\u0026", 6);
-        } else {
-          append('&');
-        }
-        break;
-      case '\'':
-        if (options & k_JSON_HEX_APOS) {
-          append("\\u0027", 6);
-        } else {
-          append('\'');
-        }
-        break;
-      case '@':
-        if (options & k_JSON_FB_EXTRA_ESCAPES) {
-          append("\\u0040", 6);
-        } else {
-          append('@');
-        }
-        break;
-      case '%':
-        if (options & k_JSON_FB_EXTRA_ESCAPES) {
-          append("\\u0025", 6);
-        } else {
-          append('%');
-        }
-        break;
-      default:
-        if (us >= ' ' && options & k_JSON_UNESCAPED_UNICODE) {
-          utf16_to_utf8(*this, us);
-        } else if (us >= ' ' && (us & 127) == us) {
-          append((char)us);
-        } else {
-          append("\\u", 2);
-          us = REVERSE16(us);
-          append(digits[us & ((1 << 4) - 1)]); us >>= 4;
-          append(digits[us & ((1 << 4) - 1)]); us >>= 4;
-          append(digits[us & ((1 << 4) - 1)]); us >>= 4;
-          append(digits[us & ((1 << 4) - 1)]);
-        }
-        break;
+    UTF8To16Decoder decoder(p, end - p, options & k_JSON_FB_LOOSE);
+    int us = decoder.decode();
+    if (us == UTF8_ERROR) {
+      // discard the part that has been already decoded.
+      resize(start);
+      append("null", 4);
+      return;
+    }
+    assert(us >= 0);
+    if (us != '?' && options & k_JSON_UNESCAPED_UNICODE) {
+      // A valid character would be re-encoded to the same bytes.
+      append(p, decoder.position());
+    } else {
+      append_json_char(*this, us, options);
+      if ((us & 0xfc00) == 0xd800) {
+        // the low surrogate of a character beyond the BMP
+        append_json_char(*this, decoder.decode(), options);
       }
     }
+    p += decoder.position();
   }
+  append('"');
 }
 
 void StringBuffer::printf(const char *format, ...) {
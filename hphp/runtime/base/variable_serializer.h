@@ -109,6 +109,14 @@ public:
   void getResourceInfo(String &rsrcName, int &rsrcId);
   Type getType() const { return m_type; }
 
+  /**
+   * Whether the keys of the array being written are dropped, as json_encode()
+   * does for lists.
+   */
+  bool skipsArrayKeys() const {
+    return m_type == JSON && m_arrayInfos.back().is_vector;
+  }
+
 private:
   typedef smart::hash_map<void*, int, pointer_hash<void> > SmartPtrCtrMap;
   Type m_type;
@@ -38,6 +38,16 @@ public:
   UTF8To16Decoder(const char *utf8, int length, bool loose);
   int decode();
 
+  /*
+   * How many bytes of the input have been decoded.
+   */
+  int position() const { return m_decode.the_index; }
+
+  /*
+   * Skips n bytes of ASCII input without decoding them.
+   */
+  void skip(int n) { m_decode.the_index += n; }
+
 private:
   json_utf8_decode m_decode;
   int m_loose; // Faceook: json_utf8_loose
@@ -20,9 +20,14 @@
 #include "hphp/runtime/base/zend/zend_math.h"
 
 #include "hphp/util/lock.h"
+#include "hphp/util/byte_set.h"
 #include <math.h>
 #include <monetary.h>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 #include "hphp/runtime/base/bstring.h"
 #include "hphp/runtime/base/util/exceptions.h"
 #include "hphp/runtime/base/complex_types.h"
@@ -534,6 +539,28 @@ const char *string_memnstr(const char *haystack, const char *needle,
   const char *p = haystack;
   char ne = needle[needle_len-1];
 
+#ifdef __SSE2__
+  if (needle_len > 1) {
+    // Check 16 candidate positions at a time for both the first and the
+    // last byte of the needle, and compare the rest only where both match.
+    __m128i first = _mm_set1_epi8(*needle);
+    __m128i last = _mm_set1_epi8(ne);
+    for (; end - p >= needle_len + 15; p += 16) {
+      __m128i head = _mm_loadu_si128((const __m128i*)p);
+      __m128i tail = _mm_loadu_si128((const __m128i*)(p + needle_len - 1));
+      unsigned mask = _mm_movemask_epi8(
+        _mm_and_si128(_mm_cmpeq_epi8(head, first), _mm_cmpeq_epi8(tail, last)));
+      while (mask) {
+        int i = __builtin_ctz(mask);
+        if (!memcmp(p + i + 1, needle + 1, needle_len - 2)) {
+          return p + i;
+        }
+        mask &= mask - 1;
+      }
+    }
+  }
+#endif
+
   end -= needle_len;
   while (p <= end) {
     if ((p = (char *)memchr(p, *needle, (end-p+1))) && ne == p[needle_len-1]) {
@@ -1206,29 +1233,36 @@ char *string_addcslashes(const char *str, int &length, const char *what,
   char flags[256];
   string_charmask(what, wlength, flags);
 
+  ByteSet escaped;
+  for (int c = 0; c < 256; c++) {
+    if (flags[c]) escaped.add(c);
+  }
+
   char *new_str = (char *)malloc((length << 2) + 1);
   const char *source;
   const char *end;
   char *target;
   for (source = str, end = source + length, target = new_str; source < end;
        source++) {
+    const char *run = escaped.find(source, end);
+    memcpy(target, source, run - source);
+    target += run - source;
+    source = run;
+    if (source == end) break;
     char c = *source;
-    if (flags[(unsigned char)c]) {
-      if ((unsigned char) c < 32 || (unsigned char) c > 126) {
-        *target++ = '\\';
-        switch (c) {
-        case '\n': *target++ = 'n'; break;
-        case '\t': *target++ = 't'; break;
-        case '\r': *target++ = 'r'; break;
-        case '\a': *target++ = 'a'; break;
-        case '\v': *target++ = 'v'; break;
-        case '\b': *target++ = 'b'; break;
-        case '\f': *target++ = 'f'; break;
-        default: target += sprintf(target, "%03o", (unsigned char) c);
-        }
-        continue;
+    *target++ = '\\';
+    if ((unsigned char) c < 32 || (unsigned char) c > 126) {
+      switch (c) {
+      case '\n': *target++ = 'n'; break;
+      case '\t': *target++ = 't'; break;
+      case '\r': *target++ = 'r'; break;
+      case '\a': *target++ = 'a'; break;
+      case '\v': *target++ = 'v'; break;
+      case '\b': *target++ = 'b'; break;
+      case '\f': *target++ = 'f'; break;
+      default: target += sprintf(target, "%03o", (unsigned char) c);
       }
-      *target++ = '\\';
+      continue;
     }
     *target++ = c;
   }
@@ -1306,12 +1340,18 @@ char *string_addslashes(const char *str, int &length) {
     return nullptr;
   }
 
+  static const ByteSet escaped("\0'\"\\", 4);
   char *new_str = (char *)malloc((length << 1) + 1);
   const char *source = str;
   const char *end = source + length;
   char *target = new_str;
 
   while (source < end) {
+    const char *run = escaped.find(source, end);
+    memcpy(target, source, run - source);
+    target += run - source;
+    source = run;
+    if (source == end) break;
     switch (*source) {
     case '\0':
       *target++ = '\\';
@@ -1341,12 +1381,20 @@ char *string_stripslashes(const char *input, int &l) {
     return nullptr;
   }
 
+  static const ByteSet slash("\\", 1);
   char *str = string_duplicate(input, l);
   char *s, *t;
   s = str;
   t = str;
 
   while (l > 0) {
+    // Until the first slash s == t, and the run needn't move.
+    const char *run = slash.find(t, t + l);
+    if (s != t) memmove(s, t, run - t);
+    s += run - t;
+    l -= run - t;
+    t += run - t;
+    if (l == 0) break;
     if (*t == '\\') {
       t++;        /* skip the slash */
       l--;
@@ -1377,9 +1425,16 @@ char *string_quotemeta(const char *input, int &len) {
     return nullptr;
   }
 
+  // The input ends at its first NUL, so that's in the set too.
+  static const ByteSet special(".\\+*?[^]$()\0", 12);
   char *ret = (char *)malloc((len << 1) + 1);
   char *q = ret;
-  for (const char *p = input; *p; p++) {
+  for (const char *p = input, *end = input + len; *p; p++) {
+    const char *run = special.find(p, end);
+    memcpy(q, p, run - p);
+    q += run - p;
+    p = run;
+    if (p == end || !*p) break;
     char c = *p;
     switch (c) {
     case '.':
@@ -1522,6 +1577,28 @@ char *string_quoted_printable_decode(const char *input, int &len, bool is_q) {
   return str_out;
 }
 
+#ifdef __SSE2__
+/*
+ * Translates 16 hex digits to their values, failing if any of them isn't a
+ * hex digit.
+ */
+static inline bool hex_decode_digits(const char *in, __m128i &values) {
+  __m128i c = _mm_loadu_si128((const __m128i*)in);
+  __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('0' - 1)),
+                                _mm_cmpgt_epi8(_mm_set1_epi8('9' + 1), c));
+  // Folding case makes 'A'..'F' into 'a'..'f'; it only matters for letters.
+  __m128i folded = _mm_or_si128(c, _mm_set1_epi8(0x20));
+  __m128i letter = _mm_and_si128(
+    _mm_cmpgt_epi8(folded, _mm_set1_epi8('a' - 1)),
+    _mm_cmpgt_epi8(_mm_set1_epi8('f' + 1), folded));
+  if (_mm_movemask_epi8(_mm_or_si128(digit, letter)) != 0xffff) return false;
+  values = _mm_or_si128(
+    _mm_and_si128(digit, _mm_sub_epi8(c, _mm_set1_epi8('0'))),
+    _mm_and_si128(letter, _mm_sub_epi8(folded, _mm_set1_epi8('a' - 10))));
+  return true;
+}
+#endif
+
 char *string_hex2bin(const char *input, int &len) {
   if (len % 2 != 0) {
     throw InvalidArgumentException("hex2bin: odd length input");
@@ -1529,7 +1606,27 @@ char *string_hex2bin(const char *input, int &len) {
   len >>= 1;
   char *str = (char *)malloc(len + 1);
   int i, j;
-  for (i = j = 0; i < len; i++) {
+  i = j = 0;
+#ifdef __SSE2__
+  // 32 digits at a time; a block with anything else in it is left to the
+  // loop below, which reports where.
+  for (; len - i >= 16; i += 16, j += 32) {
+    __m128i lo, hi;
+    if (!hex_decode_digits(input + j, lo) ||
+        !hex_decode_digits(input + j + 16, hi)) {
+      break;
+    }
+    // Each 16-bit lane holds a high nibble in its low byte and a low nibble
+    // in its high byte.
+    const __m128i mask = _mm_set1_epi16(0x0f);
+    lo = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(lo, mask), 4),
+                      _mm_srli_epi16(lo, 8));
+    hi = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(hi, mask), 4),
+                      _mm_srli_epi16(hi, 8));
+    _mm_storeu_si128((__m128i*)(str + i), _mm_packus_epi16(lo, hi));
+  }
+#endif
+  for (; i < len; i++) {
     char c = input[j++];
     if (c >= '0' && c <= '9') {
       str[i] = (c - '0') << 4;
@@ -1825,6 +1922,94 @@ static const short base64_reverse_table[256] = {
   -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2
 };
 
+#ifdef __SSE2__
+/*
+ * SSE2 kernels for 12 octets <=> 16 characters. Each 32-bit lane holds one
+ * 3-octet quantum, with its four sextets in the lane's bytes in order.
+ */
+
+static inline uint32_t base64_load_quantum(const unsigned char *p) {
+  uint32_t w;
+  memcpy(&w, p, 4);
+  return __builtin_bswap32(w) >> 8;
+}
+
+static inline __m128i base64_split(const unsigned char *in) {
+  __m128i v = _mm_set_epi32(base64_load_quantum(in + 9),
+                            base64_load_quantum(in + 6),
+                            base64_load_quantum(in + 3),
+                            base64_load_quantum(in));
+  __m128i s0 = _mm_and_si128(_mm_srli_epi32(v, 18), _mm_set1_epi32(0x3f));
+  __m128i s1 = _mm_and_si128(_mm_srli_epi32(v, 4), _mm_set1_epi32(0x3f00));
+  __m128i s2 = _mm_and_si128(_mm_slli_epi32(v, 10), _mm_set1_epi32(0x3f0000));
+  __m128i s3 = _mm_slli_epi32(v, 24);
+  s3 = _mm_and_si128(s3, _mm_set1_epi32(0x3f000000));
+  return _mm_or_si128(_mm_or_si128(s0, s1), _mm_or_si128(s2, s3));
+}
+
+static inline __m128i base64_encode_sextets(__m128i s) {
+  /* 'A' + s, moved along for each range of base64_table[] s is past */
+  __m128i off = _mm_set1_epi8('A');
+  off = _mm_add_epi8(off, _mm_and_si128(_mm_cmpgt_epi8(s, _mm_set1_epi8(25)),
+                                        _mm_set1_epi8('a' - 26 - 'A')));
+  off = _mm_add_epi8(off, _mm_and_si128(_mm_cmpgt_epi8(s, _mm_set1_epi8(51)),
+                                        _mm_set1_epi8('0' - 52 - 'a' + 26)));
+  off = _mm_add_epi8(off, _mm_and_si128(_mm_cmpgt_epi8(s, _mm_set1_epi8(61)),
+                                        _mm_set1_epi8('+' - 62 - '0' + 52)));
+  off = _mm_add_epi8(off, _mm_and_si128(_mm_cmpgt_epi8(s, _mm_set1_epi8(62)),
+                                        _mm_set1_epi8('/' - '+' - 1)));
+  return _mm_add_epi8(s, off);
+}
+
+static inline __m128i base64_in_range(__m128i c, char lo, char hi) {
+  return _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8(lo - 1)),
+                       _mm_cmpgt_epi8(_mm_set1_epi8(hi + 1), c));
+}
+
+/*
+ * Translates 16 characters to sextets, failing if any of them is outside
+ * the alphabet (padding, whitespace, NUL or garbage), so that the scalar
+ * loop deals with it.
+ */
+static inline bool base64_decode_chars(const unsigned char *in,
+                                       __m128i &sextets) {
+  __m128i c = _mm_loadu_si128((const __m128i*)in);
+  __m128i upper = base64_in_range(c, 'A', 'Z');
+  __m128i lower = base64_in_range(c, 'a', 'z');
+  __m128i digit = base64_in_range(c, '0', '9');
+  __m128i plus = _mm_cmpeq_epi8(c, _mm_set1_epi8('+'));
+  __m128i slash = _mm_cmpeq_epi8(c, _mm_set1_epi8('/'));
+  __m128i valid = _mm_or_si128(_mm_or_si128(upper, lower),
+                               _mm_or_si128(digit, _mm_or_si128(plus, slash)));
+  if (_mm_movemask_epi8(valid) != 0xffff) return false;
+  __m128i off = _mm_and_si128(upper, _mm_set1_epi8(-'A'));
+  off = _mm_or_si128(off, _mm_and_si128(lower, _mm_set1_epi8(26 - 'a')));
+  off = _mm_or_si128(off, _mm_and_si128(digit, _mm_set1_epi8(52 - '0')));
+  off = _mm_or_si128(off, _mm_and_si128(plus, _mm_set1_epi8(62 - '+')));
+  off = _mm_or_si128(off, _mm_and_si128(slash, _mm_set1_epi8(63 - '/')));
+  sextets = _mm_add_epi8(c, off);
+  return true;
+}
+
+/*
+ * Writes the 12 octets of 16 sextets to out, which must have room for 13.
+ */
+static inline void base64_join(__m128i s, unsigned char *out) {
+  __m128i v = _mm_slli_epi32(_mm_and_si128(s, _mm_set1_epi32(0x3f)), 18);
+  v = _mm_or_si128(v, _mm_slli_epi32(_mm_and_si128(s, _mm_set1_epi32(0x3f00)),
+                                     4));
+  v = _mm_or_si128(v, _mm_srli_epi32(
+                        _mm_and_si128(s, _mm_set1_epi32(0x3f0000)), 10));
+  v = _mm_or_si128(v, _mm_srli_epi32(s, 24));
+  uint32_t quanta[4];
+  _mm_storeu_si128((__m128i*)quanta, v);
+  for (int k = 0; k < 4; k++) {
+    uint32_t w = __builtin_bswap32(quanta[k] << 8);
+    memcpy(out + 3 * k, &w, 4);
+  }
+}
+#endif
+
 static unsigned char *php_base64_encode(const unsigned char *str, int length,
                                         int *ret_length) {
   const unsigned char *current = str;
@@ -1841,6 +2026,17 @@ static unsigned char *php_base64_encode(const unsigned char *str, int length,
   result = (unsigned char *)malloc(((length + 2) / 3) * 4 + 1);
   p = result;
 
+#ifdef __SSE2__
+  /* 12 octets at a time; the loads read one octet past them */
+  while (length > 12) {
+    __m128i sextets = base64_split(current);
+    _mm_storeu_si128((__m128i*)p, base64_encode_sextets(sextets));
+    p += 16;
+    current += 12;
+    length -= 12;
+  }
+#endif
+
   while (length > 2) { /* keep going until we have less than 24 bits */
     *p++ = base64_table[current[0] >> 2];
     *p++ = base64_table[((current[0] & 0x03) << 4) + (current[1] >> 4)];
@@ -1882,7 +2078,22 @@ static unsigned char *php_base64_decode(const unsigned char *str,
   result = (unsigned char *)malloc(length + 1);
 
   /* run through the whole string, converting as we go */
-  while ((ch = *current++) != '\0' && length-- > 0) {
+  while (true) {
+#ifdef __SSE2__
+    /* whole blocks of 16 alphabet characters, between quanta */
+    if ((i % 4) == 0) {
+      while (length >= 16) {
+        __m128i sextets;
+        if (!base64_decode_chars(current, sextets)) break;
+        base64_join(sextets, result + j);
+        current += 16;
+        length -= 16;
+        i += 16;
+        j += 12;
+      }
+    }
+#endif
+    if ((ch = *current++) == '\0' || length-- <= 0) break;
     if (ch == base64_pad) {
       if (*current != '=' && (i % 4) == 1) {
         free(result);
@@ -17,6 +17,11 @@
 
 #include "hphp/runtime/base/zend/zend_url.h"
 #include "hphp/runtime/base/zend/zend_string.h"
+#include "hphp/util/byte_set.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 namespace HPHP {
 ///////////////////////////////////////////////////////////////////////////////
@@ -320,8 +325,50 @@ static int php_htoi(char *s) {
 
 static unsigned char hexchars[] = "0123456789ABCDEF";
 
-char *url_encode(const char *s, int &len) {
-  register unsigned char c;
+static inline bool url_unreserved(unsigned char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+    (c >= '0' && c <= '9') || c == '-' || c == '.' || c == '_';
+}
+
+/*
+ * Returns the first byte in [p, end) that has to be escaped, or end.
+ */
+static const unsigned char *url_unreserved_run(const unsigned char *p,
+                                               const unsigned char *end) {
+#ifdef __SSE2__
+  const __m128i digitLo = _mm_set1_epi8('0' - 1);
+  const __m128i digitHi = _mm_set1_epi8('9' + 1);
+  const __m128i alphaLo = _mm_set1_epi8('a' - 1);
+  const __m128i alphaHi = _mm_set1_epi8('z' + 1);
+  const __m128i lower = _mm_set1_epi8(0x20);
+  const __m128i dash = _mm_set1_epi8('-');
+  const __m128i dot = _mm_set1_epi8('.');
+  const __m128i underscore = _mm_set1_epi8('_');
+  for (; end - p >= 16; p += 16) {
+    __m128i c = _mm_loadu_si128((const __m128i*)p);
+    // Bytes from 0x80 up compare as negative, so fail both ranges.
+    __m128i ok = _mm_and_si128(_mm_cmpgt_epi8(c, digitLo),
+                               _mm_cmpgt_epi8(digitHi, c));
+    __m128i folded = _mm_or_si128(c, lower);
+    ok = _mm_or_si128(ok, _mm_and_si128(_mm_cmpgt_epi8(folded, alphaLo),
+                                        _mm_cmpgt_epi8(alphaHi, folded)));
+    ok = _mm_or_si128(ok, _mm_cmpeq_epi8(c, dash));
+    ok = _mm_or_si128(ok, _mm_cmpeq_epi8(c, dot));
+    ok = _mm_or_si128(ok, _mm_cmpeq_epi8(c, underscore));
+    int mask = _mm_movemask_epi8(ok) ^ 0xffff;
+    if (mask) return p + __builtin_ctz(mask);
+  }
+#endif
+  while (p < end && url_unreserved(*p)) ++p;
+  return p;
+}
+
+/*
+ * Shared by url_encode() and url_raw_encode(): runs of unreserved bytes are
+ * copied as they are, and everything else is %XX, except that a space
+ * becomes a '+' if plus is set.
+ */
+static char *url_encode_impl(const char *s, int &len, bool plus) {
   unsigned char *to, *start;
   unsigned char const *from, *end;
 
@@ -330,20 +377,20 @@ char *url_encode(const char *s, int &len) {
   start = to = (unsigned char *)malloc(3 * len + 1);
 
   while (from < end) {
-    c = *from++;
-
-    if (c == ' ') {
+    const unsigned char *run = url_unreserved_run(from, end);
+    memcpy(to, from, run - from);
+    to += run - from;
+    if (run == end) break;
+    unsigned char c = *run;
+    from = run + 1;
+
+    if (c == ' ' && plus) {
       *to++ = '+';
-    } else if ((c < '0' && c != '-' && c != '.') ||
-           (c < 'A' && c > '9') ||
-           (c > 'Z' && c < 'a' && c != '_') ||
-           (c > 'z')) {
+    } else {
       to[0] = '%';
       to[1] = hexchars[c >> 4];
       to[2] = hexchars[c & 15];
       to += 3;
-    } else {
-      *to++ = c;
     }
   }
   *to = 0;
@@ -351,20 +398,33 @@ char *url_encode(const char *s, int &len) {
   return (char *) start;
 }
 
-char *url_decode(const char *s, int &len) {
+char *url_encode(const char *s, int &len) {
+  return url_encode_impl(s, len, true);
+}
+
+/*
+ * Shared by url_decode() and url_raw_decode(): decodes in place, moving
+ * whole runs of bytes that need no decoding at once.
+ */
+static char *url_decode_impl(const char *s, int &len, const ByteSet &special) {
   char *str = string_duplicate(s, len);
   char *dest = str;
   char *data = str;
+  const char *end = str + len;
+
+  while (data < end) {
+    const char *run = special.find(data, end);
+    if (dest != data) memmove(dest, data, run - data);
+    dest += run - data;
+    data += run - data;
+    if (data == end) break;
 
-  while (len--) {
     if (*data == '+') {
       *dest = ' ';
-    }
-    else if (*data == '%' && len >= 2 && isxdigit((int) *(data + 1))
-         && isxdigit((int) *(data + 2))) {
+    } else if (end - data >= 3 && isxdigit((int) *(data + 1))
+               && isxdigit((int) *(data + 2))) {
       *dest = (char) php_htoi(data + 1);
       data += 2;
-      len -= 2;
     } else {
       *dest = *data;
     }
@@ -376,6 +436,13 @@ char *url_decode(const char *s, int &len) {
   return str;
 }
 
+static const ByteSet s_url_special("%+", 2);
+static const ByteSet s_url_raw_special("%", 1);
+
+char *url_decode(const char *s, int &len) {
+  return url_decode_impl(s, len, s_url_special);
+}
+
 // copied and re-factored from clearsilver-0.10.5/cgi/cgi.c
 int url_decode(char *value) {
   assert(value && *value); // check before calling this function
@@ -430,46 +497,11 @@ int url_decode_ex(char *value, int len) {
 }
 
 char *url_raw_encode(const char *s, int &len) {
-  register int x, y;
-  unsigned char *str;
-
-  str = (unsigned char *)malloc(3 * len + 1);
-  for (x = 0, y = 0; len--; x++, y++) {
-    str[y] = (unsigned char) s[x];
-    if ((str[y] < '0' && str[y] != '-' && str[y] != '.') ||
-      (str[y] < 'A' && str[y] > '9') ||
-        (str[y] > 'Z' && str[y] < 'a' && str[y] != '_') ||
-      (str[y] > 'z')) {
-      str[y++] = '%';
-      str[y++] = hexchars[(unsigned char) s[x] >> 4];
-      str[y] = hexchars[(unsigned char) s[x] & 15];
-    }
-  }
-  str[y] = '\0';
-  len = y;
-  return ((char *)str);
+  return url_encode_impl(s, len, false);
 }
 
 char *url_raw_decode(const char *s, int &len) {
-  char *str = string_duplicate(s, len);
-  char *dest = str;
-  char *data = str;
-
-  while (len--) {
-    if (*data == '%' && len >= 2 && isxdigit((int) *(data + 1))
-        && isxdigit((int) *(data + 2))) {
-      *dest = (char) php_htoi(data + 1);
-      data += 2;
-      len -= 2;
-    } else {
-      *dest = *data;
-    }
-    data++;
-    dest++;
-  }
-  *dest = '\0';
-  len = dest - str;
-  return str;
+  return url_decode_impl(s, len, s_url_raw_special);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -28,12 +28,17 @@ SOFTWARE.
 
 
 #include "hphp/runtime/ext/JSON_parser.h"
+
+#include <vector>
+
+#include "hphp/runtime/base/array/array_init.h"
 #include "hphp/runtime/base/complex_types.h"
 #include "hphp/runtime/base/type_conversions.h"
 #include "hphp/runtime/base/builtin_functions.h"
 #include "hphp/runtime/base/zend/utf8_decode.h"
 
 #include "hphp/system/systemlib.h"
+#include "hphp/util/byte_set.h"
 
 #define MAX_LENGTH_OF_LONG 20
 static const char long_min_digits[] = "9223372036854775808";
@@ -458,6 +463,79 @@ static void attach_zval(json_parser *json, CStrRef key,
   }
 }
 
+/**
+ * The bytes that aren't printable ASCII, and quotes and backslashes. Those
+ * are the bytes that leave state 3 either for another state or for an
+ * error.
+ */
+static const ByteRangeSet s_json_string_special(' ', "\x7f\"'\\", 4);
+
+/**
+ * Inputs shorter than this aren't worth a pre-pass: their arrays are small
+ * enough to grow cheaply.
+ */
+static const int kPresizeMinLength = 256;
+
+static const ByteSet s_json_structural("\"[]{},", 6);
+static const ByteSet s_json_string_end("\"\\", 2);
+
+/**
+ * Structural pre-pass over a strict JSON text: appends to counts the number
+ * of elements of every array and object, in the order of their opening
+ * brackets, so that JSON_parser() can create them at their final size
+ * instead of growing them one element at a time. Brackets, commas and
+ * quotes are found with a vector scan, and strings are skipped the same
+ * way. Nothing is validated here; on malformed input the counts are merely
+ * poor hints, and JSON_parser() rejects the text anyway.
+ */
+static void json_count_elements(const char *p, const char *end,
+                                std::vector<int> &counts) {
+  std::vector<int> open; // indexes in counts of the unclosed containers
+  for (;;) {
+    p = s_json_structural.find(p, end);
+    if (p == end) return;
+    switch (*p++) {
+    case '"':
+      for (;;) {
+        p = s_json_string_end.find(p, end);
+        if (p == end) return;
+        if (*p++ == '"') break;
+        if (p < end) p++; // the escaped character
+      }
+      break;
+    case '[':
+    case '{': {
+      if (open.size() == JSON_PARSER_MAX_DEPTH) return; // too deep to parse
+      open.push_back(counts.size());
+      const char *q = p;
+      while (q < end && (*q == ' ' || *q == '\t' || *q == '\n' ||
+                         *q == '\r')) {
+        q++;
+      }
+      counts.push_back(q < end && *q != ']' && *q != '}' ? 1 : 0);
+      break;
+    }
+    case ']':
+    case '}':
+      if (!open.empty()) open.pop_back();
+      break;
+    case ',':
+      if (!open.empty()) counts[open.back()]++;
+      break;
+    }
+  }
+}
+
+/**
+ * An empty array with room for the next pre-counted number of elements, if
+ * there is one.
+ */
+static Array json_make_array(const std::vector<int> &counts, size_t &next) {
+  int n = next < counts.size() ? counts[next] : 0;
+  next++;
+  return n ? Array(ArrayInit::CreateMap(n)) : Array::Create();
+}
+
 #define SWAP_BUFFERS(from, to) do { \
     StringBuffer *tmp = from;       \
     from = to;                      \
@@ -492,6 +570,14 @@ bool JSON_parser(Variant &z, const char *p, int length, bool assoc/*<fb>*/,
   }
   /*</fb>*/
 
+  // Element counts of the arrays and objects, in the order they open.
+  bool fast = RuntimeOption::EvalFastJsonDecode;
+  std::vector<int> counts;
+  size_t next_count = 0;
+  if (fast && !loose && length >= kPresizeMinLength) {
+    json_count_elements(p, p + length, counts);
+  }
+
   StringBuffer sb_buf(127), sb_key(127);
   StringBuffer *buf = &sb_buf;
   StringBuffer *key = &sb_key;
@@ -575,8 +661,9 @@ bool JSON_parser(Variant &z, const char *p, int length, bool assoc/*<fb>*/,
           }
           if (!assoc) {
             top = SystemLib::AllocStdClassObject();
+            next_count++;
           } else {
-            top = Array::Create();
+            top = json_make_array(counts, next_count);
           }
           JSON(the_kstack)[JSON(the_top)] = key->detach();
           JSON_RESET_TYPE();
@@ -632,7 +719,8 @@ bool JSON_parser(Variant &z, const char *p, int length, bool assoc/*<fb>*/,
           } else {
             JSON(the_zstack)[JSON(the_top)].unset();
           }
-          JSON(the_zstack)[JSON(the_top)] = Array::Create();
+          JSON(the_zstack)[JSON(the_top)] = json_make_array(counts,
+                                                             next_count);
           JSON(the_kstack)[JSON(the_top)] = key->detach();
           JSON_RESET_TYPE();
         }
@@ -808,6 +896,19 @@ bool JSON_parser(Variant &z, const char *p, int length, bool assoc/*<fb>*/,
       }
 
       the_state = s;
+
+      /*
+        Inside a string, the state machine would only append plain
+        characters to buf one by one, so copy a run of them at once.
+      */
+      if (fast && the_state == 3 && (b & 0xfc00) != 0xd800) {
+        const char *start = p + decoder.position();
+        int n = s_json_string_special.find(start, p + length) - start;
+        if (n) {
+          buf->append(start, n);
+          decoder.skip(n);
+        }
+      }
     }
   }
 
@@ -21,12 +21,15 @@
 #include "hphp/runtime/base/runtime_option.h"
 #include "hphp/util/async_job.h"
 #include "hphp/util/timer.h"
+#include "hphp/util/compatibility.h"
 #include <dlfcn.h>
 #include "hphp/runtime/base/program_functions.h"
 #include "hphp/runtime/base/builtin_functions.h"
 #include "hphp/runtime/base/variable_serializer.h"
 #include "hphp/util/alloc.h"
 #include "hphp/runtime/base/ini_setting.h"
+#include "hphp/runtime/base/shared/shared_store_snapshot.h"
+#include "hphp/runtime/base/shared/shared_store_stats.h"
 
 using HPHP::Util::ScopedMem;
 
@@ -122,6 +125,46 @@ Variant f_apc_fetch(CVarRef key, VRefParam success /* = null */,
   return v;
 }
 
+Variant f_apc_fetch_or_lease(CStrRef key, int64_t lease_ms /* = 1000 */,
+                             int64_t wait_ms /* = 0 */,
+                             VRefParam leased /* = null */,
+                             int64_t cache_id /* = 0 */) {
+  leased = false;
+  if (!RuntimeOption::EnableApc) return false;
+
+  if (cache_id < 0 || cache_id >= MAX_SHARED_STORE) {
+    throw_invalid_argument("cache_id: %d", cache_id);
+    return false;
+  }
+  if (lease_ms <= 0) {
+    throw_invalid_argument("lease_ms: %d", (int)lease_ms);
+    return false;
+  }
+
+  timespec begin;
+  gettime(CLOCK_MONOTONIC, &begin);
+  Variant v;
+  while (true) {
+    switch (s_apc_store[cache_id].getOrLease(key, v, lease_ms)) {
+    case SharedStore::FetchHit:
+    case SharedStore::FetchStale:
+      return v;
+    case SharedStore::FetchLeased:
+      leased = true;
+      return false;
+    case SharedStore::FetchBusy:
+      break;
+    }
+    // someone else is computing the value, poll for it for up to wait_ms
+    timespec now;
+    gettime(CLOCK_MONOTONIC, &now);
+    if (gettime_diff_us(begin, now) >= wait_ms * 1000) {
+      return false;
+    }
+    usleep(1000);
+  }
+}
+
 Variant f_apc_delete(CVarRef key, int64_t cache_id /* = 0 */) {
   if (!RuntimeOption::EnableApc) return false;
 
@@ -226,9 +269,18 @@ Variant f_apc_exists(CVarRef key, int64_t cache_id /* = 0 */) {
 }
 
 const StaticString s_start_time("start_time");
+const StaticString s_compressed_count("compressed_count");
+const StaticString s_compressed_raw_size("compressed_raw_size");
+const StaticString s_compressed_size("compressed_size");
 
 Variant f_apc_cache_info(int64_t cache_id /* = 0 */, bool limited /* = false */) {
-  return CREATE_MAP1(s_start_time, start_time());
+  return CREATE_MAP4(s_start_time, start_time(),
+                     s_compressed_count,
+                     SharedStoreStats::getCompressedCount(),
+                     s_compressed_raw_size,
+                     SharedStoreStats::getCompressedRawSize(),
+                     s_compressed_size,
+                     SharedStoreStats::getCompressedSize());
 }
 
 Array f_apc_sma_info(bool limited /* = false */) {
@@ -403,6 +455,22 @@ void apc_load(int thread) {
   dlclose(handle);
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// APC snapshots
+
+void apc_load_snapshot() {
+  if (RuntimeOption::ApcSnapshotFile.empty() || !RuntimeOption::EnableApc) {
+    return;
+  }
+  SharedStoreSnapshot::Load(s_apc_store[0],
+                            RuntimeOption::ApcSnapshotFile);
+}
+
+bool apc_write_snapshot(const std::string &filename, int waitSeconds) {
+  return SharedStoreSnapshot::Write(s_apc_store[0], filename,
+                                    waitSeconds) >= 0;
+}
+
 size_t get_const_map_size() {
   return s_const_map_size;
 }
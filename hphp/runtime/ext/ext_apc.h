@@ -28,6 +28,10 @@ namespace HPHP {
 bool f_apc_add(CStrRef key, CVarRef var, int64_t ttl = 0, int64_t cache_id = 0);
 bool f_apc_store(CStrRef key, CVarRef var, int64_t ttl = 0, int64_t cache_id = 0);
 Variant f_apc_fetch(CVarRef key, VRefParam success = uninit_null(), int64_t cache_id = 0);
+Variant f_apc_fetch_or_lease(CStrRef key, int64_t lease_ms = 1000,
+                             int64_t wait_ms = 0,
+                             VRefParam leased = uninit_null(),
+                             int64_t cache_id = 0);
 Variant f_apc_delete(CVarRef key, int64_t cache_id = 0);
 bool f_apc_clear_cache(int64_t cache_id = 0);
 Variant f_apc_inc(CStrRef key, int64_t step = 1, VRefParam success = uninit_null(), int64_t cache_id = 0);
@@ -60,6 +64,8 @@ bool f_apc_bin_loadfile(CStrRef filename, CObjRef context = uninit_null(),
 // loading APC from archive files
 
 void apc_load(int thread);
+void apc_load_snapshot();
+bool apc_write_snapshot(const std::string &filename, int waitSeconds);
 
 // needed by generated apc archive .cpp files
 void apc_load_impl(struct cache_info *info,
@@ -26,8 +26,13 @@
 #include "hphp/runtime/vm/jit/translator.h"
 #include "hphp/runtime/vm/jit/translator-inline.h"
 #include "hphp/runtime/base/array/hphp_array.h"
+#include "hphp/runtime/base/array/packed_array.h"
 #include "hphp/util/logger.h"
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 #define SORT_DESC               3
 #define SORT_ASC                4
 namespace HPHP {
@@ -76,6 +81,184 @@ using HPHP::Transl::EagerCallerFrame;
 
 #define getCheckedArray(input) getCheckedArrayRet(input, uninit_null())
 
+///////////////////////////////////////////////////////////////////////////////
+// Kernels for searching and summing the values of HphpArrays and
+// PackedArrays in place, without going through ArrayIter and Variants.
+// Other kinds of arrays take the generic paths.
+
+/*
+ * Calls match(cell) on the values of ad in order, and found(pos) on the
+ * position of each one it returns true for, until found() returns true.
+ * Returns whether it did.
+ */
+template <class Match, class Found>
+static bool scanValues(const ArrayData* ad, Match match, Found found) {
+  assert(ad->hasValueSlots());
+  if (ad->isPackedArray()) {
+    auto pa = static_cast<const PackedArray*>(ad);
+    for (uint32_t i = 0, n = pa->getSize(); i < n; ++i) {
+      if (match(tvToCell(pa->getElm(i))) && found(i)) return true;
+    }
+    return false;
+  }
+  auto ha = static_cast<const HphpArray*>(ad);
+  for (uint32_t i = 0, n = ha->iterLimit(); i < n; ++i) {
+    const TypedValue* tv = &ha->getElm(i)->data;
+    if (tv->m_type == HphpArray::KindOfTombstone) continue;
+    if (match(tvToCell(tv)) && found(i)) return true;
+  }
+  return false;
+}
+
+/*
+ * Runs scanValues() with a comparison against needle specialized on its
+ * type, falling back to tvSame() or tvEqual() for the values whose type
+ * makes the comparison anything but a plain equality test.
+ */
+template <class Found>
+static bool searchValues(const ArrayData* ad, const TypedValue* needle,
+                         bool strict, Found found) {
+  needle = tvToCell(needle);
+  switch (needle->m_type) {
+    case KindOfInt64: {
+      int64_t n = needle->m_data.num;
+      if (strict) {
+        return scanValues(ad, [&](const TypedValue* tv) {
+          return tv->m_type == KindOfInt64 && tv->m_data.num == n;
+        }, found);
+      }
+      return scanValues(ad, [&](const TypedValue* tv) {
+        return tv->m_type == KindOfInt64 ? tv->m_data.num == n :
+                                           tvEqual(tv, needle);
+      }, found);
+    }
+    case KindOfDouble: {
+      double d = needle->m_data.dbl;
+      if (strict) {
+        return scanValues(ad, [&](const TypedValue* tv) {
+          return tv->m_type == KindOfDouble && tv->m_data.dbl == d;
+        }, found);
+      }
+      return scanValues(ad, [&](const TypedValue* tv) {
+        return tv->m_type == KindOfDouble ? tv->m_data.dbl == d :
+                                            tvEqual(tv, needle);
+      }, found);
+    }
+    case KindOfStaticString:
+    case KindOfString: {
+      const StringData* str = needle->m_data.pstr;
+      const char* data = str->data();
+      int len = str->size();
+      // Strings are only ever == by value when both are numeric.
+      int64_t lval;
+      double dval;
+      bool bytewise = strict || str->isNumericWithVal(lval, dval, 0) ==
+                                KindOfNull;
+      return scanValues(ad, [&](const TypedValue* tv) {
+        if (!IS_STRING_TYPE(tv->m_type)) {
+          return !strict && tvEqual(tv, needle);
+        }
+        const StringData* s = tv->m_data.pstr;
+        if (!bytewise) return s->equal(str);
+        return s == str ||
+               (s->size() == len && memcmp(s->data(), data, len) == 0);
+      }, found);
+    }
+    default:
+      return scanValues(ad, [&](const TypedValue* tv) {
+        return strict ? tvSame(tv, needle) : tvEqual(tv, needle);
+      }, found);
+  }
+}
+
+/*
+ * ArrayUtil::Sum() over the values in place. Ints are added two at a time
+ * with SSE2 when they're next to each other in a PackedArray; doubles are
+ * added one at a time, in order, so the result is rounded the same way.
+ */
+static DataType sumValues(const ArrayData* ad, int64_t* isum, double* dsum) {
+  assert(ad->hasValueSlots());
+  const TypedValue* packed = nullptr;
+  const HphpArray* ha = nullptr;
+  uint32_t n;
+  if (ad->isPackedArray()) {
+    auto pa = static_cast<const PackedArray*>(ad);
+    packed = pa->getSize() ? pa->getElm(0) : nullptr;
+    n = pa->getSize();
+  } else {
+    ha = static_cast<const HphpArray*>(ad);
+    n = ha->iterLimit();
+  }
+  auto slot = [&](uint32_t i) -> const TypedValue* {
+    return packed ? &packed[i] : &ha->getElm(i)->data;
+  };
+
+  uint64_t i = 0; // unsigned, so that overflow wraps
+  uint32_t pos = 0;
+#ifdef __SSE2__
+  if (packed) {
+    __m128i acc = _mm_setzero_si128();
+    for (; pos + 1 < n; pos += 2) {
+      if (packed[pos].m_type != KindOfInt64 ||
+          packed[pos + 1].m_type != KindOfInt64) {
+        break;
+      }
+      __m128i tv0 = _mm_loadu_si128((const __m128i*)&packed[pos]);
+      __m128i tv1 = _mm_loadu_si128((const __m128i*)&packed[pos + 1]);
+      acc = _mm_add_epi64(acc, _mm_unpacklo_epi64(tv0, tv1));
+    }
+    uint64_t lanes[2];
+    _mm_storeu_si128((__m128i*)lanes, acc);
+    i = lanes[0] + lanes[1];
+  }
+#endif
+  for (; pos < n; ++pos) {
+    const TypedValue* tv = slot(pos);
+    if (tv->m_type == HphpArray::KindOfTombstone) continue;
+    tv = tvToCell(tv);
+    switch (tv->m_type) {
+      case KindOfInt64:
+        i += tv->m_data.num;
+        continue;
+      case KindOfDouble:
+        goto DOUBLE;
+      case KindOfStaticString:
+      case KindOfString: {
+        int64_t ti;
+        double td;
+        if (tv->m_data.pstr->isNumericWithVal(ti, td, 1) == KindOfInt64) {
+          i += ti;
+          continue;
+        }
+        goto DOUBLE;
+      }
+      case KindOfArray:
+      case KindOfObject:
+        continue;
+      default:
+        i += tvAsCVarRef(tv).toInt64();
+        continue;
+    }
+  }
+  *isum = i;
+  return KindOfInt64;
+
+DOUBLE:
+  double d = int64_t(i);
+  for (; pos < n; ++pos) {
+    const TypedValue* tv = slot(pos);
+    if (tv->m_type == HphpArray::KindOfTombstone) continue;
+    tv = tvToCell(tv);
+    if (tv->m_type == KindOfDouble) {
+      d += tv->m_data.dbl;
+    } else if (tv->m_type != KindOfArray && tv->m_type != KindOfObject) {
+      d += tvAsCVarRef(tv).toDouble();
+    }
+  }
+  *dsum = d;
+  return KindOfDouble;
+}
+
 Variant f_array_change_key_case(CVarRef input, bool upper /* = false */) {
   getCheckedArrayRet(input, false);
   return ArrayUtil::ChangeKeyCase(arr_input, !upper);
@@ -235,6 +418,15 @@ bool f_key_exists(CVarRef key, CVarRef search) {
 Variant f_array_keys(CVarRef input, CVarRef search_value /* = null_variant */,
                      bool strict /* = false */) {
   getCheckedArray(input);
+  if (search_value.isInitialized() && arr_input.get()->hasValueSlots()) {
+    ArrayData* ad = arr_input.get();
+    Array ret = Array::Create();
+    searchValues(ad, search_value.asTypedValue(), strict, [&](ssize_t pos) {
+      ret.append(ad->getKey(pos));
+      return false;
+    });
+    return ret;
+  }
   return arr_input.keys(search_value, strict);
 }
 
@@ -498,6 +690,15 @@ Variant f_array_reverse(CVarRef array, bool preserve_keys /* = false */) {
 Variant f_array_search(CVarRef needle, CVarRef haystack,
                        bool strict /* = false */) {
   getCheckedArrayRet(haystack, false);
+  ArrayData* ad = arr_haystack.get();
+  if (ad->hasValueSlots()) {
+    Variant ret = false;
+    searchValues(ad, needle.asTypedValue(), strict, [&](ssize_t pos) {
+      ret = ad->getKey(pos);
+      return true;
+    });
+    return ret;
+  }
   return arr_haystack.key(needle, strict);
 }
 
@@ -525,7 +726,9 @@ Variant f_array_sum(CVarRef array) {
   getCheckedArray(array);
   int64_t i;
   double d;
-  if (ArrayUtil::Sum(arr_array, &i, &d) == KindOfInt64) {
+  DataType type = arr_array.get()->hasValueSlots() ?
+    sumValues(arr_array.get(), &i, &d) : ArrayUtil::Sum(arr_array, &i, &d);
+  if (type == KindOfInt64) {
     return i;
   } else {
     return d;
@@ -717,6 +920,11 @@ Variant f_key(VRefParam array) {
 
 bool f_in_array(CVarRef needle, CVarRef haystack, bool strict /* = false */) {
   getCheckedArrayRet(haystack, false);
+  ArrayData* ad = arr_haystack.get();
+  if (ad->hasValueSlots()) {
+    return searchValues(ad, needle.asTypedValue(), strict,
+                        [](ssize_t) { return true; });
+  }
   return arr_haystack.valueExists(needle, strict);
 }
 
@@ -18,6 +18,8 @@
 #include "hphp/runtime/ext/ext_collections.h"
 #include "hphp/runtime/base/variable_serializer.h"
 #include "hphp/runtime/base/array/sort_helpers.h"
+#include "hphp/runtime/base/array/hphp_array.h"
+#include "hphp/runtime/base/array/packed_array.h"
 #include "hphp/runtime/ext/ext_array.h"
 #include "hphp/runtime/ext/ext_math.h"
 #include "hphp/runtime/ext/ext_intl.h"
@@ -91,6 +93,27 @@ static inline ArrayIter getArrayIterHelper(CVarRef v, size_t& sz) {
   throw e;
 }
 
+/*
+ * Copies the values of ad, which must have value slots, in order to dest,
+ * unboxing refs and bumping refcounts in the same pass.
+ */
+static void copyArrayValues(const ArrayData* ad, TypedValue* dest) {
+  assert(ad->hasValueSlots());
+  if (ad->isPackedArray()) {
+    auto pa = static_cast<const PackedArray*>(ad);
+    for (uint32_t i = 0, n = pa->getSize(); i < n; ++i) {
+      tvDupCell(tvToCell(pa->getElm(i)), dest++);
+    }
+    return;
+  }
+  auto ha = static_cast<const HphpArray*>(ad);
+  for (uint32_t i = 0, n = ha->iterLimit(); i < n; ++i) {
+    TypedValue* tv = &ha->getElm(i)->data;
+    if (tv->m_type == HphpArray::KindOfTombstone) continue;
+    tvDupCell(tvToCell(tv), dest++);
+  }
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 
 c_Vector::c_Vector(Class* cb) :
@@ -121,10 +144,32 @@ void c_Vector::t___construct(CVarRef iterable /* = null_variant */) {
   if (!iterable.isInitialized()) {
     return;
   }
+  addAllImpl(iterable);
+}
+
+void c_Vector::addAllImpl(CVarRef iterable) {
+  if (iterable.isArray()) {
+    addValues(iterable.getArrayData());
+    return;
+  }
+  if (iterable.isObject() &&
+      iterable.getObjectData()->getCollectionType() == Collection::VectorType) {
+    auto vec = static_cast<c_Vector*>(iterable.getObjectData());
+    uint sz = vec->m_size;
+    reserve(m_size + sz);
+    ++m_version;
+    // vec may be this Vector, so read its values only after reserving.
+    TypedValue* data = vec->m_data;
+    for (uint i = 0; i < sz; ++i) {
+      tvDupCell(&data[i], &m_data[m_size + i]);
+    }
+    m_size += sz;
+    return;
+  }
   size_t sz;
   ArrayIter iter = getArrayIterHelper(iterable, sz);
   if (sz) {
-    reserve(sz);
+    reserve(m_size + sz);
   }
   for (; iter; ++iter) {
     Variant v = iter.second();
@@ -133,6 +178,35 @@ void c_Vector::t___construct(CVarRef iterable /* = null_variant */) {
   }
 }
 
+void c_Vector::addValues(ArrayData* ad) {
+  uint sz = ad->size();
+  if (!sz) return;
+  ++m_version;
+  if (!m_size && ad->isPackedArray() && ad->getCount() == 1) {
+    // Nothing else can see ad, so take its values instead of copying them.
+    uint32_t size, capacity;
+    TypedValue* data =
+      static_cast<PackedArray*>(ad)->stealValues(size, capacity);
+    if (data) {
+      freeData();
+      m_data = data;
+      m_size = size;
+      m_capacity = capacity;
+      return;
+    }
+  }
+  reserve(m_size + sz);
+  if (ad->hasValueSlots()) {
+    copyArrayValues(ad, &m_data[m_size]);
+    m_size += sz;
+    return;
+  }
+  for (ssize_t pos = ad->iter_begin(); pos != ArrayData::invalid_index;
+       pos = ad->iter_advance(pos)) {
+    add(cvarToCell(&ad->getValueRef(pos)));
+  }
+}
+
 void c_Vector::grow() {
   if (m_capacity) {
     m_capacity += m_capacity;
@@ -175,12 +249,7 @@ void c_Vector::reserve(int64_t sz) {
 }
 
 Array c_Vector::toArrayImpl() const {
-  ArrayInit ai(m_size, ArrayInit::vectorInit);
-  uint sz = m_size;
-  for (uint i = 0; i < sz; ++i) {
-    ai.set(tvAsCVarRef(&m_data[i]));
-  }
-  return ai.create();
+  return ArrayData::MakeVector(m_size, m_data);
 }
 
 Array c_Vector::o_toArray() const {
@@ -207,16 +276,7 @@ Object c_Vector::t_add(CVarRef val) {
 }
 
 Object c_Vector::t_addall(CVarRef iterable) {
-  size_t sz;
-  ArrayIter iter = getArrayIterHelper(iterable, sz);
-  if (sz) {
-    reserve(m_size + sz);
-  }
-  for (; iter; ++iter) {
-    Variant v = iter.second();
-    TypedValue* tv = cvarToCell(&v);
-    add(tv);
-  }
+  addAllImpl(iterable);
   return this;
 }
 
@@ -647,19 +707,7 @@ Object c_Vector::ti_fromarray(CVarRef arr) {
   }
   c_Vector* target;
   Object ret = target = NEWOBJ(c_Vector)();
-  ArrayData* ad = arr.getArrayData();
-  uint sz = ad->size();
-  target->m_capacity = target->m_size = sz;
-  TypedValue* data;
-  target->m_data = data = (TypedValue*)smart_malloc(sz * sizeof(TypedValue));
-  ssize_t pos = ad->iter_begin();
-  for (uint i = 0; i < sz; ++i, pos = ad->iter_advance(pos)) {
-    assert(pos != ArrayData::invalid_index);
-    TypedValue* tv = cvarToCell(&ad->getValueRef(pos));
-    tvRefcountedIncRef(tv);
-    data[i].m_data.num = tv->m_data.num;
-    data[i].m_type = tv->m_type;
-  }
+  target->addValues(arr.getArrayData());
   return ret;
 }
 
@@ -999,7 +1047,9 @@ void c_VectorIterator::t_rewind() {
 
 ///////////////////////////////////////////////////////////////////////////////
 
-static const char emptyMapSlot[sizeof(c_Map::Bucket)] = { 0 };
+// The hash table of empty Maps and Sets: a single empty slot, so lookups
+// miss without checking for a table first.
+static const int32_t emptyHashTable[1] = { -1 };
 
 c_Map::c_Map(Class* cb) :
     ExtObjectDataFlags<ObjectData::MapAttrInit|
@@ -1007,8 +1057,9 @@ c_Map::c_Map(Class* cb) :
                        ObjectData::UseSet|
                        ObjectData::UseIsset|
                        ObjectData::UseUnset>(cb),
+    m_data(nullptr), m_hash(const_cast<int32_t*>(emptyHashTable)),
     m_size(0), m_load(0), m_nLastSlot(0), m_version(0) {
-  m_data = (Bucket*)emptyMapSlot;
+  setHasStrKeys(false);
 }
 
 c_Map::~c_Map() {
@@ -1017,15 +1068,16 @@ c_Map::~c_Map() {
 }
 
 void c_Map::freeData() {
-  if (m_data != (Bucket*)emptyMapSlot) {
+  if (m_data) {
     smart_free(m_data);
   }
-  m_data = (Bucket*)emptyMapSlot;
+  m_data = nullptr;
+  m_hash = const_cast<int32_t*>(emptyHashTable);
 }
 
 void c_Map::deleteBuckets() {
   if (!m_size) return;
-  for (uint i = 0; i <= m_nLastSlot; ++i) {
+  for (uint i = 0; i < m_load; ++i) {
     Bucket& p = m_data[i];
     if (p.validValue()) {
       tvRefcountedDecRef(&p.data);
@@ -1040,6 +1092,10 @@ void c_Map::t___construct(CVarRef iterable /* = null_variant */) {
   if (!iterable.isInitialized()) {
     return;
   }
+  if (iterable.isArray()) {
+    updateAll(iterable.getArrayData());
+    return;
+  }
   size_t sz;
   ArrayIter iter = getArrayIterHelper(iterable, sz);
   if (sz) {
@@ -1059,9 +1115,54 @@ void c_Map::t___construct(CVarRef iterable /* = null_variant */) {
   }
 }
 
+void c_Map::updateAll(ArrayData* ad) {
+  reserve(m_size + ad->size());
+  if (ad->isPackedArray()) {
+    auto pa = static_cast<PackedArray*>(ad);
+    for (uint32_t i = 0, n = pa->getSize(); i < n; ++i) {
+      update(int64_t(i), tvToCell(pa->getElm(i)));
+    }
+    return;
+  }
+  if (ad->isHphpArray()) {
+    auto ha = static_cast<HphpArray*>(ad);
+    for (uint32_t i = 0, n = ha->iterLimit(); i < n; ++i) {
+      HphpArray::Elm* e = ha->getElm(i);
+      if (e->data.m_type == HphpArray::KindOfTombstone) continue;
+      TypedValue* tv = tvToCell(&e->data);
+      if (e->hasIntKey()) {
+        update(e->ikey, tv);
+      } else {
+        update(e->key, tv);
+      }
+    }
+    return;
+  }
+  for (ssize_t pos = ad->iter_begin(); pos != ArrayData::invalid_index;
+       pos = ad->iter_advance(pos)) {
+    Variant k = ad->getKey(pos);
+    TypedValue* tv = cvarToCell(&ad->getValueRef(pos));
+    if (k.isInteger()) {
+      update(k.toInt64(), tv);
+    } else {
+      assert(k.isString());
+      update(k.getStringData(), tv);
+    }
+  }
+}
+
 Array c_Map::toArrayImpl() const {
   ArrayInit ai(m_size);
-  for (uint i = 0; i <= m_nLastSlot; ++i) {
+  if (!hasStrKeys()) {
+    for (uint i = 0; i < m_load; ++i) {
+      Bucket& p = m_data[i];
+      if (p.validValue()) {
+        ai.set((int64_t)p.ikey, tvAsCVarRef(&p.data));
+      }
+    }
+    return ai.create();
+  }
+  for (uint i = 0; i < m_load; ++i) {
     Bucket& p = m_data[i];
     if (p.validValue()) {
       if (p.hasIntKey()) {
@@ -1088,10 +1189,12 @@ c_Map* c_Map::clone() {
   target->m_size = m_size;
   target->m_load = m_load;
   target->m_nLastSlot = m_nLastSlot;
-  target->m_data = (Bucket*)smart_malloc(numSlots() * sizeof(Bucket));
-  memcpy(target->m_data, m_data, numSlots() * sizeof(Bucket));
+  target->allocTable();
+  target->setHasStrKeys(hasStrKeys());
+  memcpy(target->m_data, m_data, m_load * sizeof(Bucket));
+  memcpy(target->m_hash, m_hash, numSlots() * sizeof(int32_t));
 
-  for (uint i = 0; i <= m_nLastSlot; ++i) {
+  for (uint i = 0; i < m_load; ++i) {
     Bucket& p = m_data[i];
     if (p.validValue()) {
       tvRefcountedIncRef(&p.data);
@@ -1128,7 +1231,7 @@ Object c_Map::t_clear() {
   m_size = 0;
   m_load = 0;
   m_nLastSlot = 0;
-  m_data = (Bucket*)emptyMapSlot;
+  setHasStrKeys(false);
   return this;
 }
 
@@ -1148,7 +1251,7 @@ Object c_Map::t_keys() {
   c_Vector* vec;
   Object obj = vec = NEWOBJ(c_Vector)();
   vec->reserve(m_size);
-  for (uint i = 0, j = 0; i <= m_nLastSlot; ++i) {
+  for (uint i = 0, j = 0; i < m_load; ++i) {
     Bucket& p = m_data[i];
     if (!p.validValue()) continue;
     if (p.hasIntKey()) {
@@ -1173,7 +1276,7 @@ Object c_Map::t_kvzip() {
   c_Vector* vec;
   Object obj = vec = NEWOBJ(c_Vector)();
   vec->reserve(m_size);
-  for (uint i = 0, j = 0; i <= m_nLastSlot; ++i) {
+  for (uint i = 0, j = 0; i < m_load; ++i) {
     Bucket& p = m_data[i];
     if (!p.validValue()) continue;
     c_Pair* pair = NEWOBJ(c_Pair)();
@@ -1307,7 +1410,7 @@ Array c_Map::t_copyasarray() {
 
 Array c_Map::t_tokeysarray() {
   ArrayInit ai(m_size, ArrayInit::vectorInit);
-  for (uint i = 0; i <= m_nLastSlot; ++i) {
+  for (uint i = 0; i < m_load; ++i) {
     Bucket& p = m_data[i];
     if (!p.validValue()) continue;
     if (p.hasIntKey()) {
@@ -1331,7 +1434,7 @@ Object c_Map::t_values() {
   target->m_data = data = (TypedValue*)smart_malloc(sz * sizeof(TypedValue));
 
   int64_t j = 0;
-  for (uint i = 0; i <= m_nLastSlot; ++i) {
+  for (uint i = 0; i < m_load; ++i) {
     Bucket& p = m_data[i];
     if (!p.validValue()) continue;
     TypedValue* tv = &p.data;
@@ -1345,7 +1448,7 @@ Object c_Map::t_values() {
 
 Array c_Map::t_tovaluesarray() {
   ArrayInit ai(m_size, ArrayInit::vectorInit);
-  for (uint i = 0; i <= m_nLastSlot; ++i) {
+  for (uint i = 0; i < m_load; ++i) {
     Bucket& p = m_data[i];
     if (!p.validValue()) continue;
     ai.set(tvAsCVarRef(&p.data));
@@ -1359,18 +1462,7 @@ Object c_Map::t_updatefromarray(CVarRef arr) {
       "Expected arr to be an array"));
     throw e;
   }
-  ArrayData* ad = arr.getArrayData();
-  for (ssize_t pos = ad->iter_begin(); pos != ArrayData::invalid_index;
-       pos = ad->iter_advance(pos)) {
-    Variant k = ad->getKey(pos);
-    TypedValue* tv = cvarToCell(&ad->getValueRef(pos));
-    if (k.isInteger()) {
-      update(k.toInt64(), tv);
-    } else {
-      assert(k.isString());
-      update(k.getStringData(), tv);
-    }
-  }
+  updateAll(arr.getArrayData());
   return this;
 }
 
@@ -1383,7 +1475,7 @@ Object c_Map::t_updatefromiterable(CVarRef it) {
   ObjectData* obj = it.getObjectData();
   if (obj->getCollectionType() == Collection::MapType) {
     auto mp = static_cast<c_Map*>(obj);
-    for (uint i = 0; i <= mp->m_nLastSlot; ++i) {
+    for (uint i = 0; i < mp->m_load; ++i) {
       c_Map::Bucket& p = mp->m_data[i];
       if (!p.validValue()) continue;
       if (p.hasIntKey()) {
@@ -1419,7 +1511,7 @@ Object c_Map::t_differencebykey(CVarRef it) {
   Object ret = target = clone();
   if (obj->getCollectionType() == Collection::MapType) {
     auto mp = static_cast<c_Map*>(obj);
-    for (uint i = 0; i <= mp->m_nLastSlot; ++i) {
+    for (uint i = 0; i < mp->m_load; ++i) {
       c_Map::Bucket& p = mp->m_data[i];
       if (!p.validValue()) continue;
       if (p.hasIntKey()) {
@@ -1463,14 +1555,14 @@ Object c_Map::t_map(CVarRef callback) {
   if (!m_size) return obj;
   assert(m_nLastSlot != 0);
   mp->m_size = m_size;
-  mp->m_load = m_load;
-  mp->m_nLastSlot = 0;
-  mp->m_data = (Bucket*)smart_malloc(numSlots() * sizeof(Bucket));
-  // We need to zero out the first slot in case an exception
-  // is thrown during the first iteration, because ~c_Map()
-  // will decRef all slots up to (and including) m_nLastSlot.
-  mp->m_data[0].data.m_type = (DataType)0;
-  for (uint i = 0; i <= m_nLastSlot; mp->m_nLastSlot = i++) {
+  mp->m_nLastSlot = m_nLastSlot;
+  mp->allocTable();
+  mp->setHasStrKeys(hasStrKeys());
+  memcpy(mp->m_hash, m_hash, numSlots() * sizeof(int32_t));
+  // mp->m_load only counts the Buckets filled in so far, in case an
+  // exception is thrown part way through, because ~c_Map() will decRef
+  // all Buckets below m_load.
+  for (uint i = 0; i < m_load; mp->m_load = ++i) {
     Bucket& p = m_data[i];
     Bucket& np = mp->m_data[i];
     if (!p.validValue()) {
@@ -1506,7 +1598,7 @@ Object c_Map::t_filter(CVarRef callback) {
   c_Map* mp;
   Object obj = mp = NEWOBJ(c_Map)();
   if (!m_size) return obj;
-  for (uint i = 0; i <= m_nLastSlot; ++i) {
+  for (uint i = 0; i < m_load; ++i) {
     Bucket& p = m_data[i];
     if (!p.validValue()) continue;
     Variant ret;
@@ -1533,7 +1625,7 @@ Object c_Map::t_zip(CVarRef iterable) {
   c_Map* mp;
   Object obj = mp = NEWOBJ(c_Map)();
   mp->reserve(std::min(sz, size_t(m_size)));
-  for (uint i = 0; i <= m_nLastSlot && iter; ++i) {
+  for (uint i = 0; i < m_load && iter; ++i) {
     Bucket& p = m_data[i];
     if (!p.validValue()) continue;
     Variant v = iter.second();
@@ -1595,18 +1687,7 @@ Object c_Map::ti_fromarray(CVarRef arr) {
   }
   c_Map* mp;
   Object ret = mp = NEWOBJ(c_Map)();
-  ArrayData* ad = arr.getArrayData();
-  for (ssize_t pos = ad->iter_begin(); pos != ArrayData::invalid_index;
-       pos = ad->iter_advance(pos)) {
-    Variant k = ad->getKey(pos);
-    TypedValue* tv = cvarToCell(&ad->getValueRef(pos));
-    if (k.isInteger()) {
-      mp->update(k.toInt64(), tv);
-    } else {
-      assert(k.isString());
-      mp->update(k.getStringData(), tv);
-    }
-  }
+  mp->updateAll(arr.getArrayData());
   return ret;
 }
 
@@ -1690,89 +1771,82 @@ bool inline hitIntKey(const c_Map::Bucket* p, int64_t ki) {
 #define FIND_BODY(h0, hit) \
   size_t tableMask = m_nLastSlot; \
   size_t probeIndex = size_t(h0) & tableMask; \
-  Bucket* p = fetchBucket(probeIndex); \
-  if (LIKELY(p->validValue() && (hit))) { \
-    return p; \
-  } \
-  if (LIKELY(p->empty())) { \
-    return nullptr; \
-  } \
   for (size_t i = 1;; ++i) { \
+    int32_t pos = m_hash[probeIndex]; \
+    if (LIKELY(pos >= 0)) { \
+      Bucket* p = fetchBucket(pos); \
+      if (hit) { \
+        return p; \
+      } \
+    } else if (LIKELY(pos == HashEmpty)) { \
+      return nullptr; \
+    } \
     assert(i <= tableMask); \
     probeIndex = (probeIndex + i) & tableMask; \
     assert(((size_t(h0)+((i + i*i) >> 1)) & tableMask) == probeIndex); \
-    p = fetchBucket(probeIndex); \
-    if (p->validValue() && (hit)) { \
-      return p; \
-    } \
-    if (p->empty()) { \
-      return nullptr; \
-    } \
   }
 
 #define FIND_FOR_INSERT_BODY(h0, hit) \
   size_t tableMask = m_nLastSlot; \
   size_t probeIndex = size_t(h0) & tableMask; \
-  Bucket* p = fetchBucket(h0 & tableMask); \
-  if (LIKELY((p->validValue() && (hit)) || \
-             p->empty())) { \
-    return p; \
-  } \
-  Bucket* ts = nullptr; \
+  int32_t* ts = nullptr; \
   for (size_t i = 1;; ++i) { \
-    if (UNLIKELY(p->tombstone() && !ts)) { \
-      ts = p; \
+    int32_t* ei = &m_hash[probeIndex]; \
+    int32_t pos = *ei; \
+    if (LIKELY(pos >= 0)) { \
+      Bucket* p = fetchBucket(pos); \
+      if (hit) { \
+        return ei; \
+      } \
+    } else if (LIKELY(pos == HashEmpty)) { \
+      return LIKELY(!ts) ? ei : ts; \
+    } else if (!ts) { \
+      ts = ei; \
     } \
     assert(i <= tableMask); \
     probeIndex = (probeIndex + i) & tableMask; \
     assert(((size_t(h0)+((i + i*i) >> 1)) & tableMask) == probeIndex); \
-    p = fetchBucket(probeIndex); \
-    if (LIKELY(p->validValue() && (hit))) { \
-      return p; \
-    } \
-    if (LIKELY(p->empty())) { \
-      if (LIKELY(!ts)) { \
-        return p; \
-      } \
-      return ts; \
-    } \
   }
 
 c_Map::Bucket* c_Map::find(int64_t h) const {
+  if (!hasStrKeys()) {
+    FIND_BODY(h, p->ikey == h);
+  }
   FIND_BODY(h, hitIntKey(p, h));
 }
 
 c_Map::Bucket* c_Map::find(const char* k, int len, strhash_t prehash) const {
+  if (!hasStrKeys()) return nullptr;
   FIND_BODY(prehash, hitStringKey(p, k, len, STRING_HASH(prehash)));
 }
 
-c_Map::Bucket* c_Map::findForInsert(int64_t h) const {
+int32_t* c_Map::findForInsert(int64_t h) const {
+  if (!hasStrKeys()) {
+    FIND_FOR_INSERT_BODY(h, p->ikey == h);
+  }
   FIND_FOR_INSERT_BODY(h, hitIntKey(p, h));
 }
 
-c_Map::Bucket* c_Map::findForInsert(const char* k, int len,
-                                    strhash_t prehash) const {
+int32_t* c_Map::findForInsert(const char* k, int len,
+                              strhash_t prehash) const {
   FIND_FOR_INSERT_BODY(prehash, hitStringKey(p, k, len, STRING_HASH(prehash)));
 }
 
 // findForNewInsert() is only safe to use if you know for sure that the
-// key is not already present in the Map.
+// key is not already present in the Map, and that the hash table has no
+// tombstones.
 inline ALWAYS_INLINE
-c_Map::Bucket* c_Map::findForNewInsert(size_t h0) const {
+int32_t* c_Map::findForNewInsert(size_t h0) const {
   size_t tableMask = m_nLastSlot;
   size_t probeIndex = h0 & tableMask;
-  Bucket* p = fetchBucket(probeIndex);
-  if (LIKELY(p->empty())) {
-    return p;
-  }
   for (size_t i = 1;; ++i) {
+    int32_t* ei = &m_hash[probeIndex];
+    if (LIKELY(*ei == HashEmpty)) {
+      return ei;
+    }
     assert(i <= tableMask);
     probeIndex = (probeIndex + i) & tableMask;
     assert(((size_t(h0)+((i + i*i) >> 1)) & tableMask) == probeIndex);
-    p = fetchBucket(probeIndex);
-    if (LIKELY(p->empty())) {
-      return p;
-    }
   }
 }
 
@@ -1780,11 +1854,23 @@ c_Map::Bucket* c_Map::findForNewInsert(size_t h0) const {
 #undef FIND_BODY
 #undef FIND_FOR_INSERT_BODY
 
+// Appends a Bucket for a key that findForInsert() returned ei for, growing
+// the table first if the Bucket array is full. The caller fills it in.
+c_Map::Bucket* c_Map::allocBucket(int32_t* ei, size_t h0) {
+  if (UNLIKELY(m_load >= computeMaxLoad())) {
+    adjustCapacityImpl(m_size + 1);
+    ei = findForNewInsert(h0);
+  }
+  *ei = m_load;
+  ++m_size;
+  return fetchBucket(m_load++);
+}
+
 bool c_Map::update(int64_t h, TypedValue* data) {
   assert(data->m_type != KindOfRef);
-  Bucket* p = findForInsert(h);
-  assert(p);
-  if (p->validValue()) {
+  int32_t* ei = findForInsert(h);
+  if (*ei >= 0) {
+    Bucket* p = fetchBucket(*ei);
     tvRefcountedIncRef(data);
     tvRefcountedDecRef(&p->data);
     p->data.m_data.num = data->m_data.num;
@@ -1792,14 +1878,7 @@ bool c_Map::update(int64_t h, TypedValue* data) {
     return true;
   }
   ++m_version;
-  ++m_size;
-  if (!p->tombstone()) {
-    if (UNLIKELY(++m_load >= computeMaxLoad())) {
-      adjustCapacity();
-      p = findForInsert(h);
-      assert(p);
-    }
-  }
+  Bucket* p = allocBucket(ei, h);
   tvRefcountedIncRef(data);
   p->data.m_data.num = data->m_data.num;
   p->data.m_type = data->m_type;
@@ -1809,9 +1888,9 @@ bool c_Map::update(int64_t h, TypedValue* data) {
 
 bool c_Map::update(StringData *key, TypedValue* data) {
   strhash_t h = key->hash();
-  Bucket* p = findForInsert(key->data(), key->size(), h);
-  assert(p);
-  if (p->validValue()) {
+  int32_t* ei = findForInsert(key->data(), key->size(), h);
+  if (*ei >= 0) {
+    Bucket* p = fetchBucket(*ei);
     tvRefcountedIncRef(data);
     tvRefcountedDecRef(&p->data);
     p->data.m_data.num = data->m_data.num;
@@ -1819,18 +1898,12 @@ bool c_Map::update(StringData *key, TypedValue* data) {
     return true;
   }
   ++m_version;
-  ++m_size;
-  if (!p->tombstone()) {
-    if (UNLIKELY(++m_load >= computeMaxLoad())) {
-      adjustCapacity();
-      p = findForInsert(key->data(), key->size(), h);
-      assert(p);
-    }
-  }
+  Bucket* p = allocBucket(ei, h);
   tvRefcountedIncRef(data);
   p->data.m_data.num = data->m_data.num;
   p->data.m_type = data->m_type;
   p->setStrKey(key, h);
+  setHasStrKeys(true);
   return true;
 }
 
@@ -1839,6 +1912,14 @@ void c_Map::erase(Bucket* p) {
     return;
   }
   if (p->validValue()) {
+    int32_t pos = p - m_data;
+    size_t tableMask = m_nLastSlot;
+    size_t probeIndex = size_t(p->hashKey()) & tableMask;
+    for (size_t i = 1; m_hash[probeIndex] != pos; ++i) {
+      assert(i <= tableMask);
+      probeIndex = (probeIndex + i) & tableMask;
+    }
+    m_hash[probeIndex] = HashTombstone;
     m_size--;
     tvRefcountedDecRef(&p->data);
     if (p->hasStrKey() && p->skey->decRefCount() == 0) {
@@ -1851,36 +1932,47 @@ void c_Map::erase(Bucket* p) {
   }
 }
 
+void c_Map::allocTable() {
+  size_t maxLoad = computeMaxLoad();
+  m_data = (Bucket*)smart_malloc(maxLoad * sizeof(Bucket) +
+                                 numSlots() * sizeof(int32_t));
+  m_hash = (int32_t*)(m_data + maxLoad);
+  memset(m_hash, 0xff, numSlots() * sizeof(int32_t));
+}
+
 void c_Map::adjustCapacityImpl(int64_t sz) {
   ++m_version;
   if (sz < 2) {
     if (sz <= 0) return;
     sz = 2;
   }
-  if (m_nLastSlot == 0) {
-    assert(m_data == (Bucket*)emptyMapSlot);
-    m_nLastSlot = Util::roundUpToPowerOfTwo(sz << 1) - 1;
-    m_data = (Bucket*)smart_calloc(numSlots(), sizeof(Bucket));
+  sz = std::max(sz, int64_t(m_size));
+  Bucket* oldBuckets = m_data;
+  uint oldLoad = m_load;
+  m_nLastSlot = Util::roundUpToPowerOfTwo(sz << 1) - 1;
+  m_load = 0;
+  allocTable();
+  if (!oldBuckets) {
     return;
   }
-  size_t oldNumSlots = numSlots();
-  m_nLastSlot = Util::roundUpToPowerOfTwo(sz << 1) - 1;
-  m_load = m_size;
-  Bucket* oldBuckets = m_data;
-  m_data = (Bucket*)smart_calloc(numSlots(), sizeof(Bucket));
-  for (uint i = 0; i < oldNumSlots; ++i) {
+  // Copy the live Buckets over in order, dropping tombstones.
+  bool strKeys = false;
+  for (uint i = 0; i < oldLoad; ++i) {
     Bucket* p = &oldBuckets[i];
     if (p->validValue()) {
-      Bucket* np = findForNewInsert(p->hasIntKey() ? p->ikey : p->hash());
-      memcpy(np, p, sizeof(Bucket));
+      strKeys |= p->hasStrKey();
+      *findForNewInsert(p->hashKey()) = m_load;
+      memcpy(fetchBucket(m_load++), p, sizeof(Bucket));
     }
   }
+  assert(m_load == m_size);
+  setHasStrKeys(strKeys);
   smart_free(oldBuckets);
 }
 
 ssize_t c_Map::iter_begin() const {
   if (!m_size) return 0;
-  for (uint i = 0; i <= m_nLastSlot; ++i) {
+  for (uint i = 0; i < m_load; ++i) {
     Bucket* p = fetchBucket(i);
     if (p->validValue()) {
       return reinterpret_cast<ssize_t>(p);
@@ -1894,7 +1986,7 @@ ssize_t c_Map::iter_next(ssize_t pos) const {
     return 0;
   }
   Bucket* p = reinterpret_cast<Bucket*>(pos);
-  Bucket* pLast = fetchBucket(m_nLastSlot);
+  Bucket* pLast = fetchBucket(m_load - 1);
   ++p;
   while (p <= pLast) {
     if (p->validValue()) {
@@ -2049,7 +2141,7 @@ bool c_Map::Equals(ObjectData* obj1, ObjectData* obj2) {
   auto mp1 = static_cast<c_Map*>(obj1);
   auto mp2 = static_cast<c_Map*>(obj2);
   if (mp1->m_size != mp2->m_size) return false;
-  for (uint i = 0; i <= mp1->m_nLastSlot; ++i) {
+  for (uint i = 0; i < mp1->m_load; ++i) {
     c_Map::Bucket& p = mp1->m_data[i];
     if (p.validValue()) {
       TypedValue* tv2;
@@ -2082,22 +2174,29 @@ void c_Map::Unserialize(ObjectData* obj,
     Bucket* p;
     if (k.isInteger()) {
       auto h = k.toInt64();
-      p = mp->findForInsert(h);
-      if (UNLIKELY(p->validValue())) goto do_unserialize;
-      p->setIntKey(h);
+      int32_t* ei = mp->findForInsert(h);
+      if (UNLIKELY(*ei >= 0)) {
+        p = mp->fetchBucket(*ei);
+      } else {
+        p = mp->allocBucket(ei, h);
+        p->setIntKey(h);
+        p->data.m_type = KindOfNull;
+      }
     } else if (k.isString()) {
       auto key = k.getStringData();
       auto h = key->hash();
-      p = mp->findForInsert(key->data(), key->size(), h);
-      if (UNLIKELY(p->validValue())) goto do_unserialize;
-      p->setStrKey(key, h);
+      int32_t* ei = mp->findForInsert(key->data(), key->size(), h);
+      if (UNLIKELY(*ei >= 0)) {
+        p = mp->fetchBucket(*ei);
+      } else {
+        p = mp->allocBucket(ei, h);
+        p->setStrKey(key, h);
+        p->data.m_type = KindOfNull;
+        mp->setHasStrKeys(true);
+      }
     } else {
       throw Exception("Invalid key");
     }
-    ++mp->m_size;
-    ++mp->m_load;
-    p->data.m_type = KindOfNull;
-do_unserialize:
     tvAsVariant(&p->data).unserialize(uns, Uns::ColValueMode);
   }
 }
@@ -3437,16 +3536,15 @@ void c_StableMapIterator::t_rewind() {
 
 ///////////////////////////////////////////////////////////////////////////////
 
-static const char emptySetSlot[sizeof(c_Set::Bucket)] = { 0 };
-
 c_Set::c_Set(Class* cb) :
     ExtObjectDataFlags<ObjectData::SetAttrInit|
                        ObjectData::UseGet|
                        ObjectData::UseSet|
                        ObjectData::UseIsset|
                        ObjectData::UseUnset>(cb),
+    m_data(nullptr), m_hash(const_cast<int32_t*>(emptyHashTable)),
     m_size(0), m_load(0), m_nLastSlot(0), m_version(0) {
-  m_data = (Bucket*)emptySetSlot;
+  setHasStrs(false);
 }
 
 c_Set::~c_Set() {
@@ -3455,15 +3553,16 @@ c_Set::~c_Set() {
 }
 
 void c_Set::freeData() {
-  if (m_data != (Bucket*)emptySetSlot) {
+  if (m_data) {
     smart_free(m_data);
   }
-  m_data = (Bucket*)emptySetSlot;
+  m_data = nullptr;
+  m_hash = const_cast<int32_t*>(emptyHashTable);
 }
 
 void c_Set::deleteBuckets() {
   if (!m_size) return;
-  for (uint i = 0; i <= m_nLastSlot; ++i) {
+  for (uint i = 0; i < m_load; ++i) {
     Bucket& p = m_data[i];
     if (p.validValue()) {
       tvRefcountedDecRef(&p.data);
@@ -3491,7 +3590,7 @@ void c_Set::t___construct(CVarRef iterable /* = null_variant */) {
 
 Array c_Set::toArrayImpl() const {
   ArrayInit ai(m_size, ArrayInit::vectorInit);
-  for (uint i = 0; i <= m_nLastSlot; ++i) {
+  for (uint i = 0; i < m_load; ++i) {
     Bucket& p = m_data[i];
     if (p.validValue()) {
       ai.set(tvAsCVarRef(&p.data));
@@ -3514,10 +3613,12 @@ c_Set* c_Set::clone() {
   target->m_size = m_size;
   target->m_load = m_load;
   target->m_nLastSlot = m_nLastSlot;
-  target->m_data = (Bucket*)smart_malloc(numSlots() * sizeof(Bucket));
-  memcpy(target->m_data, m_data, numSlots() * sizeof(Bucket));
+  target->allocTable();
+  target->setHasStrs(hasStrs());
+  memcpy(target->m_data, m_data, m_load * sizeof(Bucket));
+  memcpy(target->m_hash, m_hash, numSlots() * sizeof(int32_t));
 
-  for (uint i = 0; i <= m_nLastSlot; ++i) {
+  for (uint i = 0; i < m_load; ++i) {
     Bucket& p = m_data[i];
     if (p.validValue()) {
       tvRefcountedIncRef(&p.data);
@@ -3550,7 +3651,7 @@ Object c_Set::t_clear() {
   m_size = 0;
   m_load = 0;
   m_nLastSlot = 0;
-  m_data = (Bucket*)emptySetSlot;
+  setHasStrs(false);
   return this;
 }
 
@@ -3619,14 +3720,14 @@ Object c_Set::t_map(CVarRef callback) {
   if (!m_size) return obj;
   assert(m_nLastSlot != 0);
   st->m_size = m_size;
-  st->m_load = m_load;
-  st->m_nLastSlot = 0;
-  st->m_data = (Bucket*)smart_malloc(numSlots() * sizeof(Bucket));
-  // We need to zero out the first slot in case an exception
-  // is thrown during the first iteration, because ~c_Set()
-  // will decRef all slots up to (and including) m_nLastSlot.
-  st->m_data[0].data.m_type = (DataType)0;
-  for (uint i = 0; i <= m_nLastSlot; st->m_nLastSlot = i++) {
+  st->m_nLastSlot = m_nLastSlot;
+  st->allocTable();
+  st->setHasStrs(hasStrs());
+  memcpy(st->m_hash, m_hash, numSlots() * sizeof(int32_t));
+  // st->m_load only counts the Buckets filled in so far, in case an
+  // exception is thrown part way through, because ~c_Set() will decRef
+  // all Buckets below m_load.
+  for (uint i = 0; i < m_load; st->m_load = ++i) {
     Bucket& p = m_data[i];
     Bucket& np = st->m_data[i];
     if (!p.validValue()) {
@@ -3658,7 +3759,7 @@ Object c_Set::t_filter(CVarRef callback) {
   c_Set* st;
   Object obj = st = NEWOBJ(c_Set)();
   if (!m_size) return obj;
-  for (uint i = 0; i <= m_nLastSlot; ++i) {
+  for (uint i = 0; i < m_load; ++i) {
     Bucket& p = m_data[i];
     if (!p.validValue()) continue;
     Variant ret;
@@ -3863,89 +3964,82 @@ bool inline hitInt(const c_Set::Bucket* p, int64_t ki) {
 #define FIND_BODY(h0, hit) \
   size_t tableMask = m_nLastSlot; \
   size_t probeIndex = size_t(h0) & tableMask; \
-  Bucket* p = fetchBucket(probeIndex); \
-  if (LIKELY(p->validValue() && (hit))) { \
-    return p; \
-  } \
-  if (LIKELY(p->empty())) { \
-    return nullptr; \
-  } \
   for (size_t i = 1;; ++i) { \
+    int32_t pos = m_hash[probeIndex]; \
+    if (LIKELY(pos >= 0)) { \
+      Bucket* p = fetchBucket(pos); \
+      if (hit) { \
+        return p; \
+      } \
+    } else if (LIKELY(pos == HashEmpty)) { \
+      return nullptr; \
+    } \
     assert(i <= tableMask); \
     probeIndex = (probeIndex + i) & tableMask; \
     assert(((size_t(h0)+((i + i*i) >> 1)) & tableMask) == probeIndex); \
-    p = fetchBucket(probeIndex); \
-    if (p->validValue() && (hit)) { \
-      return p; \
-    } \
-    if (p->empty()) { \
-      return nullptr; \
-    } \
   }
 
 #define FIND_FOR_INSERT_BODY(h0, hit) \
   size_t tableMask = m_nLastSlot; \
   size_t probeIndex = size_t(h0) & tableMask; \
-  Bucket* p = fetchBucket(h0 & tableMask); \
-  if (LIKELY((p->validValue() && (hit)) || \
-             p->empty())) { \
-    return p; \
-  } \
-  Bucket* ts = nullptr; \
+  int32_t* ts = nullptr; \
   for (size_t i = 1;; ++i) { \
-    if (UNLIKELY(p->tombstone() && !ts)) { \
-      ts = p; \
+    int32_t* ei = &m_hash[probeIndex]; \
+    int32_t pos = *ei; \
+    if (LIKELY(pos >= 0)) { \
+      Bucket* p = fetchBucket(pos); \
+      if (hit) { \
+        return ei; \
+      } \
+    } else if (LIKELY(pos == HashEmpty)) { \
+      return LIKELY(!ts) ? ei : ts; \
+    } else if (!ts) { \
+      ts = ei; \
     } \
     assert(i <= tableMask); \
     probeIndex = (probeIndex + i) & tableMask; \
     assert(((size_t(h0)+((i + i*i) >> 1)) & tableMask) == probeIndex); \
-    p = fetchBucket(probeIndex); \
-    if (LIKELY(p->validValue() && (hit))) { \
-      return p; \
-    } \
-    if (LIKELY(p->empty())) { \
-      if (LIKELY(!ts)) { \
-        return p; \
-      } \
-      return ts; \
-    } \
   }
 
 c_Set::Bucket* c_Set::find(int64_t h) const {
+  if (!hasStrs()) {
+    FIND_BODY(h, p->data.m_data.num == h);
+  }
   FIND_BODY(h, hitInt(p, h));
 }
 
 c_Set::Bucket* c_Set::find(const char* k, int len, strhash_t prehash) const {
+  if (!hasStrs()) return nullptr;
   FIND_BODY(prehash, hitString(p, k, len, STRING_HASH(prehash)));
 }
 
-c_Set::Bucket* c_Set::findForInsert(int64_t h) const {
+int32_t* c_Set::findForInsert(int64_t h) const {
+  if (!hasStrs()) {
+    FIND_FOR_INSERT_BODY(h, p->data.m_data.num == h);
+  }
   FIND_FOR_INSERT_BODY(h, hitInt(p, h));
 }
 
-c_Set::Bucket* c_Set::findForInsert(const char* k, int len,
-                                    strhash_t prehash) const {
+int32_t* c_Set::findForInsert(const char* k, int len,
+                              strhash_t prehash) const {
   FIND_FOR_INSERT_BODY(prehash, hitString(p, k, len, STRING_HASH(prehash)));
 }
 
 // findForNewInsert() is only safe to use if you know for sure that the
-// value is not already present in the Set.
+// value is not already present in the Set, and that the hash table has no
+// tombstones.
 inline ALWAYS_INLINE
-c_Set::Bucket* c_Set::findForNewInsert(size_t h0) const {
+int32_t* c_Set::findForNewInsert(size_t h0) const {
   size_t tableMask = m_nLastSlot;
   size_t probeIndex = h0 & tableMask;
-  Bucket* p = fetchBucket(probeIndex);
-  if (LIKELY(p->empty())) {
-    return p;
-  }
   for (size_t i = 1;; ++i) {
+    int32_t* ei = &m_hash[probeIndex];
+    if (LIKELY(*ei == HashEmpty)) {
+      return ei;
+    }
     assert(i <= tableMask);
     probeIndex = (probeIndex + i) & tableMask;
     assert(((size_t(h0)+((i + i*i) >> 1)) & tableMask) == probeIndex);
-    p = fetchBucket(probeIndex);
-    if (LIKELY(p->empty())) {
-      return p;
-    }
   }
 }
 
@@ -3953,41 +4047,37 @@ c_Set::Bucket* c_Set::findForNewInsert(size_t h0) const {
 #undef FIND_BODY
 #undef FIND_FOR_INSERT_BODY
 
+// Appends a Bucket for a value that findForInsert() returned ei for,
+// growing the table first if the Bucket array is full. The caller fills
+// it in.
+c_Set::Bucket* c_Set::allocBucket(int32_t* ei, size_t h0) {
+  if (UNLIKELY(m_load >= computeMaxLoad())) {
+    adjustCapacityImpl(m_size + 1);
+    ei = findForNewInsert(h0);
+  }
+  *ei = m_load;
+  ++m_size;
+  return fetchBucket(m_load++);
+}
+
 void c_Set::update(int64_t h) {
-  Bucket* p = findForInsert(h);
-  assert(p);
-  if (p->validValue()) {
+  int32_t* ei = findForInsert(h);
+  if (*ei >= 0) {
     return;
   }
   ++m_version;
-  ++m_size;
-  if (!p->tombstone()) {
-    if (UNLIKELY(++m_load >= computeMaxLoad())) {
-      adjustCapacity();
-      p = findForInsert(h);
-      assert(p);
-    }
-  }
-  p->setInt(h);
+  allocBucket(ei, h)->setInt(h);
 }
 
 void c_Set::update(StringData *key) {
   strhash_t h = key->hash();
-  Bucket* p = findForInsert(key->data(), key->size(), h);
-  assert(p);
-  if (p->validValue()) {
+  int32_t* ei = findForInsert(key->data(), key->size(), h);
+  if (*ei >= 0) {
     return;
   }
   ++m_version;
-  ++m_size;
-  if (!p->tombstone()) {
-    if (UNLIKELY(++m_load >= computeMaxLoad())) {
-      adjustCapacity();
-      p = findForInsert(key->data(), key->size(), h);
-      assert(p);
-    }
-  }
-  p->setStr(key, h);
+  allocBucket(ei, h)->setStr(key, h);
+  setHasStrs(true);
 }
 
 void c_Set::erase(Bucket* p) {
@@ -3995,6 +4085,15 @@ void c_Set::erase(Bucket* p) {
     return;
   }
   if (p->validValue()) {
+    int32_t pos = p - m_data;
+    size_t h0 = p->hasInt() ? p->data.m_data.num : p->hash();
+    size_t tableMask = m_nLastSlot;
+    size_t probeIndex = h0 & tableMask;
+    for (size_t i = 1; m_hash[probeIndex] != pos; ++i) {
+      assert(i <= tableMask);
+      probeIndex = (probeIndex + i) & tableMask;
+    }
+    m_hash[probeIndex] = HashTombstone;
     m_size--;
     tvRefcountedDecRef(&p->data);
     p->data.m_type = (DataType)KindOfTombstone;
@@ -4004,37 +4103,48 @@ void c_Set::erase(Bucket* p) {
   }
 }
 
+void c_Set::allocTable() {
+  size_t maxLoad = computeMaxLoad();
+  m_data = (Bucket*)smart_malloc(maxLoad * sizeof(Bucket) +
+                                 numSlots() * sizeof(int32_t));
+  m_hash = (int32_t*)(m_data + maxLoad);
+  memset(m_hash, 0xff, numSlots() * sizeof(int32_t));
+}
+
 void c_Set::adjustCapacityImpl(int64_t sz) {
   ++m_version;
   if (sz < 2) {
     if (sz <= 0) return;
     sz = 2;
   }
-  if (m_nLastSlot == 0) {
-    assert(m_data == (Bucket*)emptySetSlot);
-    m_nLastSlot = Util::roundUpToPowerOfTwo(sz << 1) - 1;
-    m_data = (Bucket*)smart_calloc(numSlots(), sizeof(Bucket));
+  sz = std::max(sz, int64_t(m_size));
+  Bucket* oldBuckets = m_data;
+  uint oldLoad = m_load;
+  m_nLastSlot = Util::roundUpToPowerOfTwo(sz << 1) - 1;
+  m_load = 0;
+  allocTable();
+  if (!oldBuckets) {
     return;
   }
-  size_t oldNumSlots = numSlots();
-  m_nLastSlot = Util::roundUpToPowerOfTwo(sz << 1) - 1;
-  m_load = m_size;
-  Bucket* oldBuckets = m_data;
-  m_data = (Bucket*)smart_calloc(numSlots(), sizeof(Bucket));
-  for (uint i = 0; i < oldNumSlots; ++i) {
+  // Copy the live Buckets over in order, dropping tombstones.
+  bool strs = false;
+  for (uint i = 0; i < oldLoad; ++i) {
     Bucket* p = &oldBuckets[i];
     if (p->validValue()) {
-      Bucket* np =
-        findForNewInsert(p->hasInt() ? p->data.m_data.num : p->hash());
-      memcpy(np, p, sizeof(Bucket));
+      strs |= p->hasStr();
+      *findForNewInsert(p->hasInt() ? p->data.m_data.num : p->hash()) =
+        m_load;
+      memcpy(fetchBucket(m_load++), p, sizeof(Bucket));
     }
   }
+  assert(m_load == m_size);
+  setHasStrs(strs);
   smart_free(oldBuckets);
 }
 
 ssize_t c_Set::iter_begin() const {
   if (!m_size) return 0;
-  for (uint i = 0; i <= m_nLastSlot; ++i) {
+  for (uint i = 0; i < m_load; ++i) {
     Bucket* p = fetchBucket(i);
     if (p->validValue()) {
       return reinterpret_cast<ssize_t>(p);
@@ -4048,7 +4158,7 @@ ssize_t c_Set::iter_next(ssize_t pos) const {
     return 0;
   }
   Bucket* p = reinterpret_cast<Bucket*>(pos);
-  Bucket* pLast = fetchBucket(m_nLastSlot);
+  Bucket* pLast = fetchBucket(m_load - 1);
   ++p;
   while (p <= pLast) {
     if (p->validValue()) {
@@ -4130,7 +4240,7 @@ bool c_Set::Equals(ObjectData* obj1, ObjectData* obj2) {
   auto st1 = static_cast<c_Set*>(obj1);
   auto st2 = static_cast<c_Set*>(obj2);
   if (st1->m_size != st2->m_size) return false;
-  for (uint i = 0; i <= st1->m_nLastSlot; ++i) {
+  for (uint i = 0; i < st1->m_load; ++i) {
     c_Set::Bucket& p = st1->m_data[i];
     if (p.validValue()) {
       if (p.hasInt()) {
@@ -4162,23 +4272,21 @@ void c_Set::Unserialize(ObjectData* obj,
     // This will make the unserializer to reserve an id for the element
     // but won't allow referencing the element via 'r' or 'R'.
     k.unserialize(uns, Uns::ColKeyMode);
-    Bucket* p;
     if (k.isInteger()) {
       auto h = k.toInt64();
-      p = st->findForInsert(h);
-      if (UNLIKELY(p->validValue())) continue;
-      p->setInt(h);
+      int32_t* ei = st->findForInsert(h);
+      if (UNLIKELY(*ei >= 0)) continue;
+      st->allocBucket(ei, h)->setInt(h);
     } else if (k.isString()) {
       auto key = k.getStringData();
       auto h = key->hash();
-      p = st->findForInsert(key->data(), key->size(), h);
-      if (UNLIKELY(p->validValue())) continue;
-      p->setStr(key, h);
+      int32_t* ei = st->findForInsert(key->data(), key->size(), h);
+      if (UNLIKELY(*ei >= 0)) continue;
+      st->allocBucket(ei, h)->setStr(key, h);
+      st->setHasStrs(true);
     } else {
       throw Exception("Set values must be integers or strings");
     }
-    ++st->m_size;
-    ++st->m_load;
   }
 }
 
@@ -4702,8 +4810,8 @@ ObjectData* collectionDeepCopyVector(c_Vector* vec) {
 
 ObjectData* collectionDeepCopyMap(c_Map* mp) {
   Object o = mp = mp->clone();
-  uint lastSlot = mp->m_nLastSlot;
-  for (uint i = 0; i <= lastSlot; ++i) {
+  uint load = mp->m_load;
+  for (uint i = 0; i < load; ++i) {
     c_Map::Bucket* p = mp->fetchBucket(i);
     if (p->validValue()) {
       collectionDeepCopyTV(&p->data);
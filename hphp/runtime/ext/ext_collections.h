@@ -139,6 +139,13 @@ class c_Vector : public ExtObjectDataFlags<ObjectData::VectorAttrInit|
     return m_size;
   }
 
+  /**
+   * Appends the values of ad. If this Vector is empty and ad is an unshared
+   * PackedArray, its value buffer is taken over instead of copied, leaving
+   * ad empty.
+   */
+  void addValues(ArrayData* ad);
+
 
   Array toArrayImpl() const;
 
@@ -168,6 +175,7 @@ class c_Vector : public ExtObjectDataFlags<ObjectData::VectorAttrInit|
 
  private:
   void grow();
+  void addAllImpl(CVarRef iterable);
   static void throwBadKeyType() ATTRIBUTE_COLD ATTRIBUTE_NORETURN;
 
   TypedValue* m_data;
@@ -319,6 +327,9 @@ class c_Map : public ExtObjectDataFlags<ObjectData::MapAttrInit|
       adjustCapacityImpl(sz);
     }
   }
+
+  // Sets each key of ad to its value, the way updateFromArray() does.
+  void updateAll(ArrayData* ad);
   int getVersion() {
     return m_version;
   }
@@ -391,43 +402,46 @@ class c_Map : public ExtObjectDataFlags<ObjectData::MapAttrInit|
 
  private:
   /**
-   * Map uses a power of two for the table size and quadratic probing to
-   * resolve hash collisions.
-   *
-   * When an element is removed from the table, a marker called a "tombstone"
-   * is left behind in the slot that the element used to occupy. The tombstone
-   * will remain in that slot until either (a) the table is resized, or (b) a
-   * new element is inserted into that slot.
+   * Map keeps its Buckets in a dense array in insertion order, followed by
+   * a hash table of int32_t indexes into that array (the layout HphpArray
+   * uses). The hash table size is a power of two, and hash collisions are
+   * resolved with quadratic probing.
    *
-   * To ensure that hash lookups are efficient, Map keeps the load factor
-   * of the table below 75%. If adding a new element causes the load to
-   * increase to 75% or greater, we grow the table to lower the load. Note
-   * that tombstones count towards load.
+   * When an element is removed, its Bucket becomes a tombstone and so does
+   * its slot in the hash table. Both stay until the table is rebuilt, which
+   * happens when the Bucket array fills up. m_load counts the Buckets used
+   * so far, tombstones included; the Bucket array has room for 75% of the
+   * number of hash slots, so the load factor of the hash table stays below
+   * 75%.
    *
-   * To ensure that iteration performance is efficient, Map keeps the ratio
-   * of # elements / # slots to be at least 18.75%. If removing an element
-   * causes the ratio to drop below 18.75%, we shrink the table to increase
-   * the ratio.
+   * To keep iteration efficient, Map keeps the ratio of # elements / # slots
+   * at least 18.75%. If removing an element causes the ratio to drop below
+   * 18.75%, we shrink the table to increase the ratio.
    *
-   * When a Map has never had any removals performed, the load factor is
-   * guaranteed to be between 37.5% and 75% (as long as the Map has at least
-   * 2 elements).
+   * Maps that have never held a string key are flagged (hasStrKeys() is
+   * false), so int lookups can skip the key type check and string lookups
+   * fail without probing.
    */
 
   Bucket* m_data;
+  int32_t* m_hash;
   uint m_size;
   uint m_load;
   uint m_nLastSlot;
   int32_t m_version;
 
+  static const int32_t HashEmpty = -1;
+  static const int32_t HashTombstone = -2;
+
   size_t numSlots() const {
     return m_nLastSlot + 1;
   }
 
-  // The maximum load factor is 75%.
+  // The Bucket array holds 75% of the number of slots; the empty Map has
+  // no Bucket array at all.
   size_t computeMaxLoad() const {
     size_t n = numSlots();
-    return (n - (n >> 2));
+    return m_nLastSlot ? (n - (n >> 2)) : 0;
   }
 
   // When the map is not empty, the minimum allowed ratio
@@ -437,12 +451,15 @@ class c_Map : public ExtObjectDataFlags<ObjectData::MapAttrInit|
     return ((n >> 3) + ((n+8) >> 4));
   }
 
+  bool hasStrKeys() const { return o_subclassData.u8[0]; }
+  void setHasStrKeys(bool b) { o_subclassData.u8[0] = b; }
+
   // We use this funny-looking helper to make g++ use lea and shl
   // instructions instead of imul when indexing into m_data
   Bucket* fetchBucket(Bucket* data, intptr_t slot) const {
     assert(sizeof(Bucket) == 24);
     assert(sizeof(int64_t) == 8);
-    assert(slot >= 0 && slot <= m_nLastSlot);
+    assert(slot >= 0 && slot < computeMaxLoad());
     intptr_t index = slot + (slot<<1);
     int64_t* ptr = (int64_t*)data;
     return (Bucket*)(&ptr[index]);
@@ -454,14 +471,16 @@ class c_Map : public ExtObjectDataFlags<ObjectData::MapAttrInit|
 
   Bucket* find(int64_t h) const;
   Bucket* find(const char* k, int len, strhash_t prehash) const;
-  Bucket* findForInsert(int64_t h) const;
-  Bucket* findForInsert(const char* k, int len, strhash_t prehash) const;
-  Bucket* findForNewInsert(size_t h0) const;
+  int32_t* findForInsert(int64_t h) const;
+  int32_t* findForInsert(const char* k, int len, strhash_t prehash) const;
+  int32_t* findForNewInsert(size_t h0) const;
+  Bucket* allocBucket(int32_t* ei, size_t h0);
 
   bool update(int64_t h, TypedValue* data);
   bool update(StringData* key, TypedValue* data);
   void erase(Bucket* prev);
 
+  void allocTable();
   void adjustCapacityImpl(int64_t sz);
   void adjustCapacity() {
     adjustCapacityImpl(m_size);
@@ -900,26 +919,32 @@ class c_Set : public ExtObjectDataFlags<ObjectData::SetAttrInit|
 
  private:
   /**
-   * Set uses a power of two for the table size and quadratic probing to
-   * resolve hash collisions, similar to the Map class. See the comments
-   * in the Map class for more details on how the hashtable works and how
-   * we decide when to grow or shrink the table.
+   * Set uses the same layout as Map: a dense array of Buckets in insertion
+   * order followed by a hash table of indexes into it. See the comments in
+   * the Map class for more details on how the hashtable works and how we
+   * decide when to grow or shrink the table. Sets that have never held a
+   * string are flagged the same way Maps without string keys are.
    */
 
   Bucket* m_data;
+  int32_t* m_hash;
   uint m_size;
   uint m_load;
   uint m_nLastSlot;
   int32_t m_version;
 
+  static const int32_t HashEmpty = -1;
+  static const int32_t HashTombstone = -2;
+
   size_t numSlots() const {
     return m_nLastSlot + 1;
   }
 
-  // The maximum load factor is 75%.
+  // The Bucket array holds 75% of the number of slots; the empty Set has
+  // no Bucket array at all.
   size_t computeMaxLoad() const {
     size_t n = numSlots();
-    return (n - (n >> 2));
+    return m_nLastSlot ? (n - (n >> 2)) : 0;
   }
 
   // When the map is not empty, the minimum allowed ratio
@@ -929,7 +954,11 @@ class c_Set : public ExtObjectDataFlags<ObjectData::SetAttrInit|
     return ((n >> 3) + ((n+8) >> 4));
   }
 
+  bool hasStrs() const { return o_subclassData.u8[0]; }
+  void setHasStrs(bool b) { o_subclassData.u8[0] = b; }
+
   Bucket* fetchBucket(Bucket* data, intptr_t slot) const {
+    assert(slot >= 0 && slot < computeMaxLoad());
     return &data[slot];
   }
 
@@ -939,14 +968,16 @@ class c_Set : public ExtObjectDataFlags<ObjectData::SetAttrInit|
 
   Bucket* find(int64_t h) const;
   Bucket* find(const char* k, int len, strhash_t prehash) const;
-  Bucket* findForInsert(int64_t h) const;
-  Bucket* findForInsert(const char* k, int len, strhash_t prehash) const;
-  Bucket* findForNewInsert(size_t h0) const;
+  int32_t* findForInsert(int64_t h) const;
+  int32_t* findForInsert(const char* k, int len, strhash_t prehash) const;
+  int32_t* findForNewInsert(size_t h0) const;
+  Bucket* allocBucket(int32_t* ei, size_t h0);
 
   void update(int64_t h);
   void update(StringData* key);
   void erase(Bucket* prev);
 
+  void allocTable();
   void adjustCapacityImpl(int64_t sz);
   void adjustCapacity() {
     adjustCapacityImpl(m_size);
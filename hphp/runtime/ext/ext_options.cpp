@@ -31,6 +31,7 @@
 #include <pwd.h>
 
 #include "hphp/runtime/vm/request_arena.h"
+#include "hphp/runtime/vm/cycle_collector.h"
 
 namespace HPHP {
 ///////////////////////////////////////////////////////////////////////////////
@@ -1003,23 +1004,19 @@ Variant f_version_compare(CStrRef version1, CStrRef version2,
 }
 
 bool f_gc_enabled() {
-  return false;
+  return CycleCollector::IsTracking();
 }
 
 void f_gc_enable() {
-  raise_warning("HipHop currently does not support circular reference "
-                "collection");
+  CycleCollector::Enable();
 }
 
 void f_gc_disable() {
-  raise_warning("HipHop currently does not support circular reference "
-                "collection");
+  CycleCollector::Disable();
 }
 
 int64_t f_gc_collect_cycles() {
-  raise_warning("HipHop currently does not support circular reference "
-                "collection");
-  return 0;
+  return CycleCollector::Collect();
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -24,7 +24,9 @@
 #include "hphp/runtime/base/bstring.h"
 #include "hphp/runtime/base/util/request_local.h"
 #include "hphp/util/lock.h"
+#include "hphp/util/byte_set.h"
 #include <locale.h>
+#include <memory>
 #include "hphp/runtime/base/server/http_request_handler.h"
 #include "hphp/runtime/base/server/http_protocol.h"
 
@@ -920,6 +922,179 @@ String f_sha1(CStrRef str, bool raw_output /* = false */) {
   return StringUtil::SHA1(str, raw_output);
 }
 
+/*
+ * The keys of a strtr() replacement array compiled into a trie, so that the
+ * longest key at a position of the input is found in one walk from the
+ * root instead of a hash lookup for every candidate length. Runs of bytes
+ * that don't start any key are copied without walking at all.
+ *
+ * A matcher holds on to its array, so the array can't change while it's
+ * cached; a later call with the same ArrayData gets the same keys.
+ */
+class StrtrMatcher {
+public:
+  explicit StrtrMatcher(CArrRef arr);
+
+  bool compiledFrom(CArrRef arr) const { return m_arr.get() == arr.get(); }
+  String translate(CStrRef str) const;
+
+private:
+  struct Node {
+    ssize_t value;     // position of the key's replacement in m_arr, or
+                       // ArrayData::invalid_index if no key ends here
+    uint32_t edges;    // first of this node's edges in m_edgeBytes
+    uint32_t numEdges;
+  };
+
+  int32_t child(const Node& node, char c) const {
+    const unsigned char* bytes = &m_edgeBytes[node.edges];
+    auto edge = (const unsigned char*)memchr(bytes, c, node.numEdges);
+    return edge ? m_edgeNodes[node.edges + (edge - bytes)] : -1;
+  }
+
+  Array m_arr;
+  std::vector<Node> m_nodes;
+  std::vector<unsigned char> m_edgeBytes;
+  std::vector<int32_t> m_edgeNodes;
+  int32_t m_root[256];  // children of the root, -1 for none
+  ByteSet m_first;      // bytes that start a key
+};
+
+StrtrMatcher::StrtrMatcher(CArrRef arr) : m_arr(arr) {
+  std::vector<std::map<unsigned char, int32_t>> edges(1);
+  std::vector<ssize_t> values(1, ArrayData::invalid_index);
+  ArrayData* ad = arr.get();
+  for (ssize_t pos = ad->iter_begin(); pos != ArrayData::invalid_index;
+       pos = ad->iter_advance(pos)) {
+    String key = ad->getKey(pos).toString();
+    int32_t n = 0;
+    for (int i = 0; i < key.size(); i++) {
+      unsigned char c = key.data()[i];
+      auto it = edges[n].find(c);
+      if (it != edges[n].end()) {
+        n = it->second;
+        continue;
+      }
+      int32_t next = edges.size();
+      edges[n][c] = next;
+      edges.emplace_back();
+      values.push_back(ArrayData::invalid_index);
+      n = next;
+    }
+    values[n] = pos;
+  }
+
+  m_nodes.resize(edges.size());
+  for (size_t n = 0; n < edges.size(); n++) {
+    m_nodes[n].value = values[n];
+    m_nodes[n].edges = m_edgeBytes.size();
+    m_nodes[n].numEdges = edges[n].size();
+    for (auto& edge : edges[n]) {
+      m_edgeBytes.push_back(edge.first);
+      m_edgeNodes.push_back(edge.second);
+    }
+  }
+  for (int c = 0; c < 256; c++) {
+    m_root[c] = -1;
+  }
+  for (auto& edge : edges[0]) {
+    m_root[edge.first] = edge.second;
+    m_first.add(edge.first);
+  }
+}
+
+String StrtrMatcher::translate(CStrRef str) const {
+  const char* p = str.data();
+  const char* end = p + str.size();
+  StringBuffer result(str.size());
+  while (p < end) {
+    const char* run = m_first.find(p, end);
+    result.append(p, run - p);
+    p = run;
+    if (p == end) break;
+
+    const char* q = p + 1;
+    const char* matchEnd = nullptr;
+    ssize_t value = ArrayData::invalid_index;
+    int32_t n = m_root[(unsigned char)*p];
+    while (true) {
+      const Node& node = m_nodes[n];
+      if (node.value != ArrayData::invalid_index) {
+        value = node.value;
+        matchEnd = q;
+      }
+      if (q == end || (n = child(node, *q)) < 0) break;
+      q++;
+    }
+    if (value == ArrayData::invalid_index) {
+      result.append(*p++);
+      continue;
+    }
+    String replace = m_arr->getValueRef(value).toString();
+    if (!replace.empty()) {
+      result.append(replace);
+    }
+    p = matchEnd;
+  }
+  return result.detach();
+}
+
+/*
+ * The last few strtr() arrays seen by this request, compiled.
+ *
+ * Only static arrays and arrays passed to strtr() twice in a row are
+ * cached, so a one-off array (and anything in it) isn't kept alive until
+ * the end of the request. Matchers are shared so that one stays alive while
+ * it is translating, even if a __toString() called from translate() pushes
+ * it out of the cache.
+ */
+class StrtrCache : public RequestEventHandler {
+public:
+  StrtrCache() : m_next(0), m_lastMiss(nullptr) {}
+
+  virtual void requestInit() {
+    m_matchers.clear();
+    m_next = 0;
+    m_lastMiss = nullptr;
+  }
+  virtual void requestShutdown() {
+    requestInit();
+  }
+
+  std::shared_ptr<StrtrMatcher> find(CArrRef arr) const {
+    for (auto& matcher : m_matchers) {
+      if (matcher->compiledFrom(arr)) return matcher;
+    }
+    return nullptr;
+  }
+
+  std::shared_ptr<StrtrMatcher> add(CArrRef arr) {
+    auto matcher = std::make_shared<StrtrMatcher>(arr);
+    // m_lastMiss is only compared, never dereferenced; if it has been freed
+    // and reused, the worst that happens is one array cached too eagerly.
+    if (!arr->isStatic() && arr.get() != m_lastMiss) {
+      m_lastMiss = arr.get();
+      return matcher;
+    }
+    m_lastMiss = nullptr;
+    if (m_matchers.size() < kMaxMatchers) {
+      m_matchers.push_back(matcher);
+    } else {
+      // Replace the oldest.
+      m_matchers[m_next] = matcher;
+      m_next = (m_next + 1) % kMaxMatchers;
+    }
+    return matcher;
+  }
+
+private:
+  static const size_t kMaxMatchers = 4;
+  std::vector<std::shared_ptr<StrtrMatcher>> m_matchers;
+  size_t m_next;
+  const ArrayData* m_lastMiss;
+};
+IMPLEMENT_STATIC_REQUEST_LOCAL(StrtrCache, s_strtr_cache);
+
 Variant f_strtr(CStrRef str, CVarRef from, CVarRef to /* = null_variant */) {
   if (str.empty()) {
     return str;
@@ -934,8 +1109,6 @@ Variant f_strtr(CStrRef str, CVarRef from, CVarRef to /* = null_variant */) {
     return false;
   }
 
-  int maxlen = 0;
-  int minlen = -1;
   Array arr = from.toArray();
 
   if (arr.empty()) {
@@ -943,42 +1116,15 @@ Variant f_strtr(CStrRef str, CVarRef from, CVarRef to /* = null_variant */) {
     return str;
   }
 
-  for (ArrayIter iter(arr); iter; ++iter) {
-    String search = iter.first();
-    int len = search.size();
-    if (len < 1) return false;
-    if (maxlen < len) maxlen = len;
-    if (minlen == -1 || minlen > len) minlen = len;
-  }
-
-  const char *s = str.data();
-  int slen = str.size();
-  String key(maxlen, ReserveString);
-
-  StringBuffer result(slen);
-  for (int pos = 0; pos < slen; ) {
-    if ((pos + maxlen) > slen) {
-      maxlen = slen - pos;
-    }
-    bool found = false;
-    memcpy(key.mutableSlice().ptr, s + pos, maxlen);
-    for (int len = maxlen; len >= minlen; len--) {
-      key.setSize(len);
-      if (arr.exists(key)) {
-        String replace = arr[key].toString();
-        if (!replace.empty()) {
-          result += replace;
-        }
-        pos += len;
-        found = true;
-        break;
-      }
-    }
-    if (!found) {
-      result += s[pos++];
+  std::shared_ptr<StrtrMatcher> matcher = s_strtr_cache->find(arr);
+  if (!matcher) {
+    for (ArrayIter iter(arr); iter; ++iter) {
+      String search = iter.first();
+      if (search.empty()) return false;
     }
+    matcher = s_strtr_cache->add(arr);
   }
-  return result.detach();
+  return matcher->translate(str);
 }
 
 void f_parse_str(CStrRef str, VRefParam arr /* = null */) {
@@ -657,6 +657,9 @@ void flush_evaluation_stack() {
     }
     Transl::TargetCache::flush();
   }
+  if (!MemoryManager::TlsWrapper::isNull()) {
+    MemoryManager::TheMemoryManager()->trimSlabPool();
+  }
 }
 
 static std::string toStringElm(const TypedValue* tv) {
@@ -3479,7 +3482,7 @@ inline void OPTBLD_INLINE VMExecutionContext::iopNewTuple(PC& pc) {
   NEXT();
   DECODE_IVA(n);
   // This constructor moves values, no inc/decref is necessary.
-  HphpArray* arr = ArrayData::Make(n, m_stack.topC());
+  ArrayData* arr = ArrayData::MakeTuple(n, m_stack.topC());
   m_stack.ndiscard(n);
   m_stack.pushArray(arr);
 }
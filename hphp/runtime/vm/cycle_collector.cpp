@@ -0,0 +1,391 @@
+/*
+   +----------------------------------------------------------------------+
+   | HipHop for PHP                                                       |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2010-2013 Facebook, Inc. (http://www.facebook.com)     |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 3.01 of the PHP license,      |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available through the world-wide-web at the following url:           |
+   | http://www.php.net/license/3_01.txt                                  |
+   | If you did not receive a copy of the PHP license and are unable to   |
+   | obtain it through the world-wide-web, please send a note to          |
+   | license@php.net so we can mail you a copy immediately.               |
+   +----------------------------------------------------------------------+
+*/
+#include "hphp/runtime/vm/cycle_collector.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "hphp/util/base.h"
+#include "hphp/util/compatibility.h"
+#include "hphp/util/trace.h"
+#include "hphp/runtime/base/complex_types.h"
+#include "hphp/runtime/base/runtime_option.h"
+#include "hphp/runtime/base/array/array_data.h"
+#include "hphp/runtime/base/memory/memory_manager.h"
+#include "hphp/runtime/base/server/server_stats.h"
+#include "hphp/runtime/vm/class.h"
+
+namespace HPHP {
+
+TRACE_SET_MOD(gc);
+
+__thread bool CycleCollector::s_tracking = false;
+
+//////////////////////////////////////////////////////////////////////
+
+namespace {
+
+// root => KindOfObject or KindOfRef
+typedef hphp_hash_map<void*, DataType, pointer_hash<void> > RootSet;
+
+__thread RootSet* tl_roots;
+__thread bool tl_collecting;
+
+struct Node {
+  explicit Node(DataType t) : type(t), internal(0), live(false) {}
+  DataType type;
+  int32_t internal;   // references held by other nodes
+  bool live;
+};
+
+typedef hphp_hash_map<void*, Node, pointer_hash<void> > NodeMap;
+typedef std::pair<void*, Node*> WorkItem;
+
+/*
+ * The collector only looks inside objects' declared and dynamic properties,
+ * HphpArrays, PackedArrays and refs. References from anywhere else
+ * (resources, the native storage of collections and closures, generator
+ * frames, other kinds of arrays) are not seen, so whatever they point to
+ * counts as referenced from outside and is kept.
+ */
+bool isNode(const TypedValue* tv) {
+  switch (tv->m_type) {
+    case KindOfObject:
+      return !tv->m_data.pobj->isResource();
+    case KindOfArray:
+      return (tv->m_data.parr->isHphpArray() ||
+              tv->m_data.parr->isPackedArray()) &&
+             !tv->m_data.parr->isStatic();
+    case KindOfRef:
+      return true;
+    default:
+      return false;
+  }
+}
+
+int32_t countOf(void* p, DataType type) {
+  switch (type) {
+    case KindOfObject: return static_cast<ObjectData*>(p)->getCount();
+    case KindOfArray:  return static_cast<ArrayData*>(p)->getCount();
+    case KindOfRef:    return static_cast<RefData*>(p)->getCount();
+    default:           not_reached();
+  }
+}
+
+TypedValue* declProps(ObjectData* obj) {
+  return (TypedValue*)(uintptr_t(obj) + sizeof(ObjectData) +
+                       obj->getVMClass()->builtinPropSize());
+}
+
+bool hasPendingDestructor(ObjectData* obj) {
+  return !obj->noDestruct() && obj->getVMClass()->getDtor();
+}
+
+template <class F>
+void forEachChild(void* p, DataType type, F f) {
+  switch (type) {
+    case KindOfObject: {
+      ObjectData* obj = static_cast<ObjectData*>(p);
+      if (obj->isCollection()) return;
+      TypedValue* props = declProps(obj);
+      for (size_t i = 0, n = obj->getVMClass()->numDeclProperties(); i < n;
+           i++) {
+        f(&props[i]);
+      }
+      if (ArrayData* dyn = obj->getProperties().get()) {
+        TypedValue tv;
+        tv.m_type = KindOfArray;
+        tv.m_data.parr = dyn;
+        f(&tv);
+      }
+      break;
+    }
+    case KindOfArray: {
+      ArrayData* arr = static_cast<ArrayData*>(p);
+      for (ssize_t pos = arr->iter_begin(); pos != ArrayData::invalid_index;
+           pos = arr->iter_advance(pos)) {
+        f(arr->getValueRef(pos).asTypedValue());
+      }
+      break;
+    }
+    case KindOfRef:
+      f(static_cast<RefData*>(p)->tv());
+      break;
+    default:
+      not_reached();
+  }
+}
+
+void clearSlot(TypedValue* tv) {
+  if (!IS_REFCOUNTED_TYPE(tv->m_type)) return;
+  TypedValue old = *tv;
+  tvWriteNull(tv);
+  tvRefcountedDecRef(&old);
+}
+
+/*
+ * Drops the references a garbage node holds to other nodes, except for an
+ * object's dynamic property array, which is a node of its own and gets
+ * emptied in turn.
+ */
+void clearNode(void* p, DataType type) {
+  switch (type) {
+    case KindOfObject: {
+      ObjectData* obj = static_cast<ObjectData*>(p);
+      if (obj->isCollection()) return;
+      TypedValue* props = declProps(obj);
+      for (size_t i = 0, n = obj->getVMClass()->numDeclProperties(); i < n;
+           i++) {
+        clearSlot(&props[i]);
+      }
+      break;
+    }
+    case KindOfArray: {
+      ArrayData* arr = static_cast<ArrayData*>(p);
+      for (ssize_t pos = arr->iter_begin(); pos != ArrayData::invalid_index;
+           pos = arr->iter_advance(pos)) {
+        clearSlot(const_cast<TypedValue*>(
+                    arr->getValueRef(pos).asTypedValue()));
+      }
+      break;
+    }
+    case KindOfRef:
+      clearSlot(static_cast<RefData*>(p)->tv());
+      break;
+    default:
+      not_reached();
+  }
+}
+
+void hold(void* p, DataType type) {
+  switch (type) {
+    case KindOfObject: static_cast<ObjectData*>(p)->incRefCount(); break;
+    case KindOfArray:  static_cast<ArrayData*>(p)->incRefCount(); break;
+    case KindOfRef:    static_cast<RefData*>(p)->incRefCount(); break;
+    default:           not_reached();
+  }
+}
+
+void unhold(void* p, DataType type) {
+  switch (type) {
+    case KindOfObject: decRefObj(static_cast<ObjectData*>(p)); break;
+    case KindOfArray:  decRefArr(static_cast<ArrayData*>(p)); break;
+    case KindOfRef:    decRefRef(static_cast<RefData*>(p)); break;
+    default:           not_reached();
+  }
+}
+
+/*
+ * Returns the nodes reachable from the roots that are only referenced by
+ * other nodes and can't be reached from a node with outside references.
+ * With keepDestructible, objects that still have to run __destruct() are
+ * treated as referenced from outside.
+ */
+std::vector<std::pair<void*, DataType> > findGarbage(bool keepDestructible) {
+  NodeMap nodes;
+  std::vector<WorkItem> work;
+
+  // Count the references each node gets from inside the subgraph.
+  for (RootSet::const_iterator it = tl_roots->begin(); it != tl_roots->end();
+       ++it) {
+    std::pair<NodeMap::iterator, bool> ins =
+      nodes.insert(std::make_pair(it->first, Node(it->second)));
+    if (ins.second) work.push_back(WorkItem(ins.first->first,
+                                            &ins.first->second));
+  }
+  while (!work.empty()) {
+    WorkItem item = work.back();
+    work.pop_back();
+    forEachChild(item.first, item.second->type, [&](const TypedValue* tv) {
+      if (!isNode(tv)) return;
+      std::pair<NodeMap::iterator, bool> ins =
+        nodes.insert(std::make_pair(tv->m_data.pref, Node(tv->m_type)));
+      ins.first->second.internal++;
+      if (ins.second) work.push_back(WorkItem(ins.first->first,
+                                              &ins.first->second));
+    });
+  }
+
+  // Nodes with outside references, and everything they reach, are live.
+  // Objects under construction or destruction may not hold a reference to
+  // themselves yet, so a zero count also means live.
+  for (NodeMap::iterator it = nodes.begin(); it != nodes.end(); ++it) {
+    Node& n = it->second;
+    int32_t count = countOf(it->first, n.type);
+    if (count > n.internal || count <= 0 ||
+        (keepDestructible && n.type == KindOfObject &&
+         hasPendingDestructor(static_cast<ObjectData*>(it->first)))) {
+      n.live = true;
+      work.push_back(WorkItem(it->first, &n));
+    }
+  }
+  while (!work.empty()) {
+    WorkItem item = work.back();
+    work.pop_back();
+    forEachChild(item.first, item.second->type, [&](const TypedValue* tv) {
+      if (!isNode(tv)) return;
+      Node& n = nodes.find(tv->m_data.pref)->second;
+      if (n.live) return;
+      n.live = true;
+      work.push_back(WorkItem(tv->m_data.pref, &n));
+    });
+  }
+
+  std::vector<std::pair<void*, DataType> > garbage;
+  for (NodeMap::const_iterator it = nodes.begin(); it != nodes.end(); ++it) {
+    if (!it->second.live) {
+      garbage.push_back(std::make_pair(it->first, it->second.type));
+    }
+  }
+  TRACE(1, "cycle collector: %zu nodes, %zu garbage\n",
+        nodes.size(), garbage.size());
+  return garbage;
+}
+
+/*
+ * Runs __destruct() on the garbage objects that have one. Returns false if
+ * there were none.
+ */
+bool destructGarbage(const std::vector<std::pair<void*, DataType> >& garbage) {
+  std::vector<ObjectData*> destructible;
+  for (size_t i = 0; i < garbage.size(); i++) {
+    if (garbage[i].second == KindOfObject &&
+        hasPendingDestructor(static_cast<ObjectData*>(garbage[i].first))) {
+      destructible.push_back(static_cast<ObjectData*>(garbage[i].first));
+    }
+  }
+  if (destructible.empty()) return false;
+
+  // Destructors may free parts of the cycle or make it reachable again, so
+  // keep all of it around until they are done.
+  for (size_t i = 0; i < garbage.size(); i++) {
+    hold(garbage[i].first, garbage[i].second);
+  }
+  for (size_t i = 0; i < destructible.size(); i++) {
+    destructible[i]->destruct();
+  }
+  for (size_t i = 0; i < garbage.size(); i++) {
+    unhold(garbage[i].first, garbage[i].second);
+  }
+  return true;
+}
+
+void freeGarbage(const std::vector<std::pair<void*, DataType> >& garbage) {
+  // Hold every node while the edges between them are cut, so that nothing
+  // is freed with some of its children already gone.
+  for (size_t i = 0; i < garbage.size(); i++) {
+    hold(garbage[i].first, garbage[i].second);
+  }
+  for (size_t i = 0; i < garbage.size(); i++) {
+    clearNode(garbage[i].first, garbage[i].second);
+  }
+  for (size_t i = 0; i < garbage.size(); i++) {
+    unhold(garbage[i].first, garbage[i].second);
+  }
+}
+
+void resetThreshold() {
+  MemoryManager* mm = MemoryManager::TheMemoryManager();
+  int64_t usage = mm->getStats().usage;
+  int64_t step = RuntimeOption::EvalCycleCollectorThreshold;
+  mm->setCycleCollectThreshold(usage + std::max(usage, step));
+}
+
+}
+
+//////////////////////////////////////////////////////////////////////
+
+void CycleCollector::AddRoot(ObjectData* obj) {
+  assert(s_tracking && tl_roots);
+  obj->setAttribute(ObjectData::IsCycleRoot);
+  (*tl_roots)[obj] = KindOfObject;
+}
+
+void CycleCollector::RemoveRoot(ObjectData* obj) {
+  if (tl_roots) tl_roots->erase(obj);
+}
+
+void CycleCollector::AddRoot(RefData* ref) {
+  assert(s_tracking && tl_roots);
+  (*tl_roots)[ref] = KindOfRef;
+}
+
+void CycleCollector::RemoveRoot(RefData* ref) {
+  if (tl_roots) tl_roots->erase(ref);
+}
+
+void CycleCollector::RequestInit() {
+  if (RuntimeOption::EvalEnableCycleCollector) Enable();
+}
+
+void CycleCollector::RequestExit() {
+  Disable();
+}
+
+void CycleCollector::Enable() {
+  if (s_tracking) return;
+  if (!tl_roots) tl_roots = new RootSet();
+  s_tracking = true;
+  resetThreshold();
+}
+
+void CycleCollector::Disable() {
+  s_tracking = false;
+  delete tl_roots;
+  tl_roots = nullptr;
+  MemoryManager::TheMemoryManager()->setCycleCollectThreshold(INT64_MAX);
+}
+
+int64_t CycleCollector::Collect() {
+  if (!s_tracking || tl_collecting) return 0;
+  tl_collecting = true;
+
+  timespec start;
+  gettime(CLOCK_MONOTONIC, &start);
+
+  int64_t freed = 0;
+  try {
+    std::vector<std::pair<void*, DataType> > garbage = findGarbage(false);
+    if (destructGarbage(garbage)) {
+      // Destructors ran PHP code, which may have changed anything.
+      garbage = findGarbage(true);
+    }
+    freeGarbage(garbage);
+    freed = garbage.size();
+  } catch (...) {
+    tl_collecting = false;
+    throw;
+  }
+  tl_collecting = false;
+  resetThreshold();
+
+  timespec end;
+  gettime(CLOCK_MONOTONIC, &end);
+  int64_t pause = gettime_diff_us(start, end);
+  TRACE(1, "cycle collector: freed %" PRId64 " in %" PRId64 "us\n",
+        freed, pause);
+  ServerStats::Log("gc.collections", 1);
+  ServerStats::Log("gc.freed", freed);
+  ServerStats::Log("gc.pause_us", pause);
+  return freed;
+}
+
+void CycleCollector::CollectPending() {
+  Collect();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+}
@@ -0,0 +1,86 @@
+/*
+   +----------------------------------------------------------------------+
+   | HipHop for PHP                                                       |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2010-2013 Facebook, Inc. (http://www.facebook.com)     |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 3.01 of the PHP license,      |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available through the world-wide-web at the following url:           |
+   | http://www.php.net/license/3_01.txt                                  |
+   | If you did not receive a copy of the PHP license and are unable to   |
+   | obtain it through the world-wide-web, please send a note to          |
+   | license@php.net so we can mail you a copy immediately.               |
+   +----------------------------------------------------------------------+
+*/
+
+#ifndef incl_HPHP_CYCLE_COLLECTOR_H_
+#define incl_HPHP_CYCLE_COLLECTOR_H_
+
+#include <cstdint>
+
+namespace HPHP {
+///////////////////////////////////////////////////////////////////////////////
+
+class ObjectData;
+class RefData;
+
+/**
+ * Synchronous collector for reference cycles in the request heap.
+ *
+ * While tracking is on, every object and ref created is buffered as a
+ * possible cycle root (the TC inlines decrefs, so we can't buffer roots when
+ * their count drops the way Bacon and Rajan do). Arrays are never buffered:
+ * they hold values, so a cycle through arrays has to pass through an object
+ * or a ref as well. Buffering costs a hash set insert when an object or ref
+ * is created and an erase when it is destroyed.
+ *
+ * A collection computes, for everything reachable from the roots through
+ * object properties, arrays and refs, how many of its references come from
+ * inside that subgraph (trial deletion on a side table, so live counts are
+ * never touched). Whatever is reachable from a node with outside references
+ * is live; the rest is garbage and is freed after running any pending
+ * __destruct() methods.
+ *
+ * Collections run at a surprise check once request memory usage goes past a
+ * threshold, which is then moved to twice the usage left after collecting
+ * (and at least Eval.CycleCollectorThreshold more), so that the cost stays
+ * proportional to allocation. gc_collect_cycles() collects right away.
+ */
+class CycleCollector {
+public:
+  static bool IsTracking() { return s_tracking; }
+  static void AddRoot(ObjectData* obj);
+  static void RemoveRoot(ObjectData* obj);
+  static void AddRoot(RefData* ref);
+  static void RemoveRoot(RefData* ref);
+
+  static void RequestInit();
+  static void RequestExit();
+
+  /**
+   * gc_enable() and gc_disable(). Disabling drops the buffered roots.
+   */
+  static void Enable();
+  static void Disable();
+
+  /**
+   * Frees unreachable cycles, returning the number of objects, arrays and
+   * refs freed.
+   */
+  static int64_t Collect();
+
+  /**
+   * Called from the surprise check after the MemoryManager asked for a
+   * collection.
+   */
+  static void CollectPending();
+
+private:
+  static __thread bool s_tracking;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+}
+
+#endif // incl_HPHP_CYCLE_COLLECTOR_H_
@@ -15,6 +15,7 @@
 */
 
 #include "hphp/runtime/base/strings.h"
+#include "hphp/runtime/base/array/packed_array.h"
 #include "hphp/runtime/vm/member_operations.h"
 #include "hphp/runtime/vm/jit/hhbctranslator.h"
 #include "hphp/runtime/vm/jit/ir.h"
@@ -1479,8 +1480,13 @@ static inline TypedValue* checkedGetCell(ArrayData* a, int64_t key) {
 template<KeyType keyType, bool checkForInt>
 static inline TypedValue arrayGetImpl(
   ArrayData* a, typename KeyTypeTraits<keyType>::rawType key) {
-  TypedValue* ret = checkForInt ? checkedGetCell(a, key)
-                                : a->nvGetCell(key);
+  // Int keys into a PackedArray are an index and a bounds check; skip the
+  // virtual call.
+  TypedValue* ret =
+    keyType == IntKey && a->isPackedArray()
+      ? static_cast<PackedArray*>(a)->PackedArray::nvGetCell(key)
+      : checkForInt ? checkedGetCell(a, key)
+                    : a->nvGetCell(key);
   tvRefcountedIncRef(ret);
   return *ret;
 }
@@ -1759,8 +1765,11 @@ static inline TypedValue* checkedGet(ArrayData* a, int64_t key) {
 template<KeyType keyType, bool checkForInt>
 static inline uint64_t arrayIssetImpl(
   ArrayData* a, typename KeyTypeTraits<keyType>::rawType key) {
-  TypedValue* value = checkForInt ? checkedGet(a, key)
-                                  : a->nvGet(key);
+  TypedValue* value =
+    keyType == IntKey && a->isPackedArray()
+      ? static_cast<PackedArray*>(a)->PackedArray::nvGet(key)
+      : checkForInt ? checkedGet(a, key)
+                    : a->nvGet(key);
   Variant* var = &tvAsVariant(value);
   return var && !var->isNull();
 }
@@ -71,7 +71,7 @@ ArrayData* new_array(int capacity) {
 }
 
 ArrayData* new_tuple(int n, const TypedValue* values) {
-  auto a = ArrayData::Make(n, values);
+  auto a = ArrayData::MakeTuple(n, values);
   a->incRefCount();
   TRACE(2, "new_tuple: size %d\n", n);
   return a;
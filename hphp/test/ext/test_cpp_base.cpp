@@ -24,8 +24,11 @@
 #include "hphp/runtime/ext/ext_mysql.h"
 #include "hphp/runtime/ext/ext_curl.h"
 #include "hphp/runtime/base/shared/shared_store_base.h"
+#include "hphp/runtime/base/shared/sharded_shared_store.h"
+#include "hphp/runtime/base/shared/shared_store_snapshot.h"
 #include "hphp/runtime/base/runtime_option.h"
 #include "hphp/runtime/base/server/ip_block_map.h"
+#include "hphp/util/process.h"
 #include "hphp/test/ext/test_mysql_info.h"
 #include "hphp/system/systemlib.h"
 
@@ -44,6 +47,8 @@ bool TestCppBase::RunTests(const std::string &which) {
   RUN_TEST(TestObject);
   RUN_TEST(TestVariant);
   RUN_TEST(TestIpBlockMap);
+  RUN_TEST(TestShardedSharedStore);
+  RUN_TEST(TestSharedStoreSnapshot);
   RUN_TEST(TestEqualAsStr);
   return ret;
 }
@@ -943,6 +948,64 @@ bool TestCppBase::TestIpBlockMap() {
   return Count(true);
 }
 
+bool TestCppBase::TestShardedSharedStore() {
+  const int shardCounts[] = { 2, 8 };
+  for (unsigned int c = 0; c < sizeof(shardCounts) / sizeof(int); c++) {
+    ShardedSharedStore store(0, shardCounts[c]);
+    for (int i = 0; i < 1000; i++) {
+      store.store(String("key_") + String((int64_t)i), i, 0);
+    }
+    VS(store.size(), 1000);
+    VS(store.shardCount(), shardCounts[c]);
+    for (int i = 0; i < store.shardCount(); i++) {
+      VERIFY(store.shardSize(i) > 0);
+    }
+  }
+  return Count(true);
+}
+
+bool TestCppBase::TestSharedStoreSnapshot() {
+  std::string path = "/tmp/test_apc_snapshot." +
+    boost::lexical_cast<std::string>(Process::GetProcessId());
+  {
+    ConcurrentTableSharedStore store(0, 0);
+    store.store("snap_string", String("value"), 0);
+    store.store("snap_array", CREATE_VECTOR2(1, "two"), 0);
+    store.store("snap_ttl", 42, 2);
+    VS(SharedStoreSnapshot::Write(store, path, 0), 3);
+  }
+
+  ConcurrentTableSharedStore store(0, 1 << 20);
+  VS(SharedStoreSnapshot::Load(store, path), 3);
+  unlink(path.c_str());
+  VS(store.size(), 3);
+
+  // values are unserialized from the mapping on first fetch
+  Variant v;
+  VERIFY(store.get("snap_string", v));
+  VS(v, "value");
+  VERIFY(store.get("snap_array", v));
+  VS(v, CREATE_VECTOR2(1, "two"));
+  VERIFY(store.get("snap_ttl", v));
+  VS(v, 42);
+
+  // keys from a snapshot aren't charged until they get a value of their own
+  VS(store.memUsage(), 0);
+  store.store("snap_string", String("overwritten"), 0);
+  VERIFY(store.memUsage() > 0);
+  VERIFY(store.get("snap_string", v));
+  VS(v, "overwritten");
+  store.erase("snap_string");
+  VS(store.memUsage(), 0);
+
+  // an expired snapshot key drops its file copy instead of falling back to it
+  sleep(3);
+  VERIFY(!store.get("snap_ttl", v));
+  VERIFY(!store.exists("snap_ttl"));
+  VS(store.size(), 1);
+  return Count(true);
+}
+
 bool TestCppBase::TestEqualAsStr() {
 
   const int arr_len = 18;
@@ -40,6 +40,8 @@ class TestCppBase : public TestBase {
   // building blocks
   bool TestSmartAllocator();
   bool TestIpBlockMap();
+  bool TestShardedSharedStore();
+  bool TestSharedStoreSnapshot();
 
   /**
    * Date types. This in turn tests StringData, ArrayData, String,
@@ -29,6 +29,7 @@
 #include "hphp/runtime/base/util/http_client.h"
 #include "hphp/runtime/base/runtime_option.h"
 #include "hphp/runtime/base/server/libevent_server.h"
+#include "hphp/runtime/base/server/libevent_server_with_takeover.h"
 
 #include <boost/make_shared.hpp>
 
@@ -225,6 +226,7 @@ bool TestServer::RunTests(const std::string &which) {
   RUN_TEST(TestSetCookie);
   //RUN_TEST(TestRequestHandling);
   RUN_TEST(TestHttpClient);
+  RUN_TEST(TestTakeoverServer);
   RUN_TEST(TestRPCServer);
   RUN_TEST(TestXboxServer);
   RUN_TEST(TestPageletServer);
@@ -643,6 +645,76 @@ bool TestServer::TestHttpClient() {
   return Count(true);
 }
 
+static bool get_echo(int port) {
+  string url = "http://127.0.0.1:" + lexical_cast<string>(port) +
+    "/echo?name=value";
+  HttpClient http;
+  StringBuffer response;
+  int code = http.get(url.c_str(), response);
+  return code == 200 &&
+    strstr(response.data(), "GET param: name = value") != nullptr;
+}
+
+bool TestServer::TestTakeoverServer() {
+  // Both servers run extra acceptors, which accept from dups of the listen
+  // socket, so the new server must get every connection the old one queued.
+  string fname = "/tmp/test_server_takeover." +
+    lexical_cast<string>(Process::GetProcessId());
+
+  boost::shared_ptr<LibEventServerWithTakeover> oldServer;
+  for (s_server_port = PORT_MIN; s_server_port <= PORT_MAX; s_server_port++) {
+    try {
+      oldServer = boost::make_shared<LibEventServerWithTakeover>(
+          "127.0.0.1", s_server_port, 50, -1, 4);
+      oldServer->setRequestHandlerFactory<EchoHandler>();
+      oldServer->setTransferFilename(fname);
+      oldServer->start();
+      break;
+    } catch (const FailedToListenException& e) {
+      if (s_server_port == PORT_MAX) throw;
+    }
+  }
+  for (int i = 0; i < 10; i++) {
+    VERIFY(get_echo(s_server_port));
+  }
+
+  // keep requests coming while the new server takes the socket over
+  AsyncFunc<TestServer> client(this, &TestServer::RunTakeoverClient);
+  m_takeoverFailures = 0;
+  m_takeoverDone = false;
+  client.start();
+
+  auto newServer = boost::make_shared<LibEventServerWithTakeover>(
+      "127.0.0.1", s_server_port, 50, -1, 4);
+  newServer->setRequestHandlerFactory<EchoHandler>();
+  newServer->setTransferFilename(fname);
+  newServer->start();
+
+  // the old server has closed its socket; only the new one can answer now
+  int served = 0;
+  for (int i = 0; i < 10; i++) {
+    if (get_echo(s_server_port)) served++;
+  }
+  m_takeoverDone = true;
+  client.waitForEnd();
+
+  oldServer->stop();
+  oldServer->waitForEnd();
+  newServer->stop();
+  newServer->waitForEnd();
+  unlink(fname.c_str());
+
+  VS(served, 10);
+  VS(m_takeoverFailures.load(), 0);
+  return Count(true);
+}
+
+void TestServer::RunTakeoverClient() {
+  while (!m_takeoverDone) {
+    if (!get_echo(s_server_port)) m_takeoverFailures++;
+  }
+}
+
 bool TestServer::TestRPCServer() {
   // the simplest case
   VSGETP("<?php\n"
@@ -20,6 +20,8 @@
 #include "hphp/test/ext/test_code_run.h"
 #include "hphp/runtime/base/complex_types.h"
 
+#include <atomic>
+
 ///////////////////////////////////////////////////////////////////////////////
 
 /**
@@ -56,6 +58,9 @@ public:
   // test HttpClient class that proxy server uses
   bool TestHttpClient();
 
+  // test taking over a server's socket while it runs extra acceptors
+  bool TestTakeoverServer();
+
   // test RPCServer
   bool TestRPCServer();
 
@@ -87,6 +92,10 @@ protected:
                             int port = 0);
   bool PreBindSocket();
   void CleanupPreBoundSocket();
+
+  void RunTakeoverClient();
+  std::atomic<bool> m_takeoverDone;
+  std::atomic<int> m_takeoverFailures;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
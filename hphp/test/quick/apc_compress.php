@@ -0,0 +1,22 @@
+<?php
+
+$str = str_repeat('abcdefgh', 1000);
+apc_store('str', $str);
+var_dump(apc_fetch('str') === $str);
+
+// arrays with internal references are kept serialized
+$a = array(str_repeat('x', 5000));
+$a[1] = &$a[0];
+apc_store('arr', $a);
+$b = apc_fetch('arr');
+var_dump($b[0] === $a[0]);
+$b[1] = 'y';
+var_dump($b[0]);
+
+// too small to be compressed
+apc_store('small', 'abc');
+var_dump(apc_fetch('small'));
+
+$info = apc_cache_info();
+var_dump($info['compressed_count']);
+var_dump($info['compressed_size'] < $info['compressed_raw_size']);
@@ -0,0 +1,12 @@
+<?php
+
+var_dump(apc_fetch_or_lease('key', 1000, 0, $leased));
+var_dump($leased);
+
+// someone else holds the lease and there is nothing stale to serve
+var_dump(apc_fetch_or_lease('key', 1000, 0, $leased));
+var_dump($leased);
+
+apc_store('key', 'value');
+var_dump(apc_fetch_or_lease('key', 1000, 0, $leased));
+var_dump($leased);
@@ -0,0 +1,18 @@
+<?php
+
+$value = str_repeat('x', 1000);
+apc_store('hot', $value);
+for ($i = 0; $i < 500; $i++) {
+  apc_store("cold$i", $value);
+  // keep the reference bit of 'hot' set
+  apc_fetch('hot');
+}
+
+$left = 0;
+for ($i = 0; $i < 500; $i++) {
+  if (apc_exists("cold$i")) $left++;
+}
+var_dump($left > 0 && $left < 500);
+var_dump(apc_exists('cold0'));
+var_dump(apc_exists('cold499'));
+var_dump(apc_fetch('hot') === $value);
@@ -0,0 +1,39 @@
+<?php
+
+// Hash tables around the size where group probing starts, through growth,
+// deletes and reinserts; every key must stay findable and in order.
+function check($n) {
+  $s = array();
+  $i = array();
+  for ($k = 0; $k < $n; $k++) {
+    $s['key' . $k] = $k;
+    $i[$k * 7919 - 50000] = $k;
+  }
+  for ($k = 0; $k < $n; $k += 2) {
+    unset($s['key' . $k]);
+    unset($i[$k * 7919 - 50000]);
+  }
+  for ($k = 0; $k < $n; $k += 4) {
+    $s['key' . $k] = -$k;
+    $i[$k * 7919 - 50000] = -$k;
+  }
+  $ok = true;
+  for ($k = 0; $k < $n; $k++) {
+    $want = $k % 2 ? $k : ($k % 4 ? null : -$k);
+    $gs = isset($s['key' . $k]) ? $s['key' . $k] : null;
+    $gi = isset($i[$k * 7919 - 50000]) ? $i[$k * 7919 - 50000] : null;
+    $ok = $ok && $gs === $want && $gi === $want;
+    $ok = $ok && !isset($s['missing' . $k]) && !isset($i[$k * 7919 + 1]);
+  }
+  $prev = -1;
+  foreach ($s as $v) {
+    // odd keys keep their places, reinserted ones come after all of them
+    if ($v > 0 && $v < $prev) $ok = false;
+    $prev = $v > 0 ? $v : PHP_INT_MAX;
+  }
+  echo $n, ": ", count($s), " ", count($i), " ", $ok ? "ok" : "WRONG", "\n";
+}
+
+foreach (array(1, 11, 12, 13, 16, 17, 100, 5000) as $n) {
+  check($n);
+}
@@ -0,0 +1,41 @@
+<?php
+
+function test($a) {
+  var_dump(in_array(2, $a));
+  var_dump(in_array("2", $a));
+  var_dump(in_array("2", $a, true));
+  var_dump(in_array(2.0, $a));
+  var_dump(in_array(2.0, $a, true));
+  var_dump(in_array("abc", $a));
+  var_dump(in_array("ABC", $a));
+  var_dump(array_search(0, $a));
+  var_dump(array_search("1e0", $a));
+  var_dump(array_search(null, $a, true));
+  echo implode(',', array_keys($a, 2)), "\n";
+  echo implode(',', array_keys($a, "abc", true)), "\n";
+  var_dump(array_sum($a));
+}
+
+test(array(1, 2, "2", 2.0, "abc", null, true));
+$h = array('x' => 1, 'y' => 2, 'z' => "2", 3 => 2.0, 'w' => "abc",
+           'v' => null, 'u' => true);
+test($h);
+unset($h['y']);
+$h['y'] = 2;
+test($h);
+
+var_dump(in_array("1.0", array("1", "x")));
+var_dump(in_array("1.0", array("1", "x"), true));
+var_dump(in_array("abc", array("ABC")));
+var_dump(array_search(3, array()));
+
+var_dump(array_sum(array(1, 2, 3, 4, 5)));
+var_dump(array_sum(range(1, 1000)));
+var_dump(array_sum(array(1, 2.5, "3")));
+var_dump(array_sum(array("1.5", 2)));
+
+echo implode(',', range(1, 5)), "\n";
+echo implode(',', range(0, 1, 0.25)), "\n";
+echo implode(',', range(5, 1, 2)), "\n";
+echo implode(',', range('a', 'e')), "\n";
+var_dump(count(range(1, 100000)));
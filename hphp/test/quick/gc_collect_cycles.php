@@ -0,0 +1,62 @@
+<?php
+
+class Node {
+  public $other;
+  public $name;
+  function __construct($name) { $this->name = $name; }
+}
+
+class Noisy {
+  public $self;
+  function __destruct() { echo "destruct\n"; }
+}
+
+function make_cycle() {
+  $a = new Node('a');
+  $b = new Node('b');
+  $a->other = $b;
+  $b->other = $a;
+}
+
+function make_array_cycle() {
+  $a = array();
+  $a[0] = new Node('c');
+  $a[0]->other = &$a;
+}
+
+function make_ref_cycle() {
+  $a = array();
+  $a[0] = &$a;
+}
+
+var_dump(gc_enabled());
+var_dump(gc_collect_cycles());
+
+make_cycle();
+make_array_cycle();
+var_dump(gc_collect_cycles() > 0);
+var_dump(gc_collect_cycles());
+
+// an array and the ref it holds to itself, without any objects
+make_ref_cycle();
+var_dump(gc_collect_cycles());
+$r = array();
+$r[0] = &$r;
+var_dump(gc_collect_cycles());
+var_dump(count($r[0]));
+
+$live = new Node('live');
+$live->other = $live;
+var_dump(gc_collect_cycles());
+var_dump($live->other->name);
+
+$n = new Noisy;
+$n->self = $n;
+unset($n);
+echo "collect\n";
+var_dump(gc_collect_cycles() > 0);
+
+gc_disable();
+var_dump(gc_enabled());
+make_cycle();
+var_dump(gc_collect_cycles());
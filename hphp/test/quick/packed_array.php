@@ -0,0 +1,70 @@
+<?php
+
+function make($a, $b, $c) {
+  return array($a, $b, $c);
+}
+
+function show($a) {
+  echo json_encode($a), "\n";
+}
+
+$a = make(1, 2, 3);
+$a[] = 4;
+$a[1] = 20;
+$a[4] = 5;
+show($a);
+var_dump(isset($a[3]), isset($a[5]), isset($a['x']), $a[0]);
+
+// copy on write
+$b = $a;
+$b[] = 6;
+show($a);
+show($b);
+
+// stack and queue functions
+$c = make('x', 'y', 'z');
+var_dump(array_pop($c));
+$c[] = 'w';
+show($c);
+var_dump(array_shift($c));
+array_unshift($c, 'v');
+show($c);
+
+// escalation
+$d = make(1, 2, 3);
+$d['k'] = 4;
+show($d);
+$d = make(1, 2, 3);
+$d[7] = 4;
+$d[] = 5;
+show($d);
+$d = make(1, 2, 3);
+unset($d[2]);
+$d[] = 4;
+show($d);
+$d = make(3, 1, 2);
+sort($d);
+show($d);
+
+// references
+$e = make(1, 2, 3);
+$r = &$e[1];
+$r = 10;
+show($e);
+foreach ($e as &$v) {
+  $v *= 2;
+}
+unset($v);
+show($e);
+
+// iteration and the internal cursor
+$f = make('a', 'b', 'c');
+foreach ($f as $k => $v) {
+  echo "$k=$v ";
+}
+echo "\n";
+$g = make('a', 'b', 'c');
+var_dump(current($g), next($g), key($g), end($g));
+show(array_merge($f, make('d', 'e', 'f')));
+show(array_merge($f, array('x' => 'y')));
+show(make(1, 2, 3) + array(3 => "z", 0 => "q"));
@@ -0,0 +1,59 @@
+<?php
+
+function make($n) {
+  $a = array();
+  for ($i = 0; $i < $n; $i++) {
+    $a[] = "v$i";
+  }
+  return $a;
+}
+
+function show($c) {
+  foreach ($c as $k => $v) {
+    echo "$k=$v ";
+  }
+  echo "\n";
+}
+
+// Temporaries can hand over their values.
+$v = new Vector(make(5));
+show($v);
+$v = Vector::fromArray(make(3));
+show($v);
+
+// Arrays that are still in use must be left alone.
+$a = make(4);
+$v = new Vector($a);
+$v[0] = 'x';
+$v->addAll($a);
+show($v);
+echo implode(',', $a), "\n";
+
+// Holes, string keys and refs.
+$a = array(3 => 'a', 'k' => 'b', 7 => 'c');
+unset($a['k']);
+$x = 'r';
+$a[] = &$x;
+$v = Vector::fromArray($a);
+$x = 'changed';
+show($v);
+
+$v = Vector {1, 2};
+$v->addAll($v);
+$v->addAll(Vector {3});
+show($v);
+show(new Vector($v));
+
+$arr = $v->toArray();
+$v[0] = 'y';
+echo implode(',', $arr), "\n";
+$e = Vector {};
+var_dump($e->toArray());
+
+$m = Map::fromArray(array('a' => 1, 5 => 2, 'b' => &$x));
+$m->updateFromArray(make(2));
+$m->updateFromArray(array('a' => 'A'));
+show($m);
+show(new Map(array(1 => 'one', 'two' => 2)));
+show($m->values());
+echo implode(',', $m->toValuesArray()), "\n";
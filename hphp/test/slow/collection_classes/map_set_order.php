@@ -0,0 +1,56 @@
+<?php
+
+$m = Map {};
+for ($i = 0; $i < 20; $i++) {
+  $m[$i * 7] = $i;
+}
+for ($i = 0; $i < 20; $i += 2) {
+  $m->remove($i * 7);
+}
+$m['x'] = 'a';
+$m[3] = 'b';
+$m->remove(21);
+foreach ($m as $k => $v) {
+  echo "$k=$v ";
+}
+echo "\n";
+var_dump(count($m), $m->contains(7), $m->contains(14), $m->contains('x'));
+
+$s = Set {};
+foreach (array(5, 'five', 3, 'three', 5, 1) as $v) {
+  $s->add($v);
+}
+$s->remove(3);
+$s->add(3);
+foreach ($s as $v) {
+  echo "$v ";
+}
+echo "\n";
+var_dump($s->contains('five'), $s->contains(3), $s->contains('3'));
+
+$s = Set {};
+for ($i = 0; $i < 1000; $i++) {
+  $s->add($i * 3);
+}
+for ($i = 0; $i < 1000; $i++) {
+  if ($i % 3) $s->remove($i * 3);
+}
+var_dump(count($s), $s->contains(0), $s->contains(9), $s->contains(3),
+         $s->contains('9'));
+
+$m = Map {'a' => 1, 2 => 'b'};
+$m2 = unserialize(serialize($m));
+$m2['c'] = 3;
+foreach ($m2 as $k => $v) {
+  echo "$k=$v ";
+}
+echo "\n";
+$m3 = clone $m2;
+$m3->remove('a');
+echo implode(',', $m3->toKeysArray()), "\n";
+$m4 = $m2->map(function ($v) { return $v . '!'; });
+foreach ($m4 as $k => $v) {
+  echo "$k=$v ";
+}
+echo "\n";
+var_dump($m4['c'], isset($m4['a']), isset($m3['a']));
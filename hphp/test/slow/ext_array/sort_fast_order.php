@@ -0,0 +1,58 @@
+<?php
+
+/**
+ * The radix and parallel sorts must leave arrays in the same order as the
+ * comparison sort, which uasort() and usort() always use.
+ */
+
+function cmp($a, $b) {
+  return $a < $b ? -1 : ($a > $b ? 1 : 0);
+}
+
+function rcmp($a, $b) {
+  return cmp($b, $a);
+}
+
+function same($name, $a, $b) {
+  echo $name, ": ", $a === $b ? "same" : "different", "\n";
+}
+
+function main() {
+  // Equal values with different keys.
+  $ints = array();
+  $strs = array();
+  for ($i = 0; $i < 1000; $i++) {
+    $ints['k' . $i] = $i * 7 % 13;
+    $strs[$i] = 'v' . ($i * 11 % 17);
+  }
+  $a = $ints; asort($a);
+  $b = $ints; uasort($b, 'cmp');
+  same("asort ints", $a, $b);
+  $a = $ints; arsort($a);
+  $b = $ints; uasort($b, 'rcmp');
+  same("arsort ints", $a, $b);
+  $a = $strs; asort($a);
+  $b = $strs; uasort($b, 'cmp');
+  same("asort strings", $a, $b);
+
+  // Values of mixed types don't compare consistently.
+  $mixed = array();
+  $doubles = array();
+  for ($i = 0; $i < 140000; $i++) {
+    switch ($i % 4) {
+      case 0: $mixed[] = $i * 31 % 1009; break;
+      case 1: $mixed[] = ($i * 17 % 1013) + 0.5; break;
+      case 2: $mixed[] = (string)($i * 13 % 1019); break;
+      case 3: $mixed[] = 'x' . ($i % 23); break;
+    }
+    $doubles[] = ($i * 29 % 4099) / 4;
+  }
+  $a = $mixed; sort($a);
+  $b = $mixed; usort($b, 'cmp');
+  same("sort mixed", $a, $b);
+  $a = $doubles; sort($a);
+  $b = $doubles; usort($b, 'cmp');
+  same("sort doubles", $a, $b);
+}
+
+main();
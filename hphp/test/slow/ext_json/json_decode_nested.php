@@ -0,0 +1,26 @@
+<?php
+
+// Texts long enough to be counted before parsing, with brackets, commas and
+// escaped quotes inside strings, empty and nested containers, and repeated
+// keys, so element counts that miss any of them would show up here.
+$pad = str_repeat("plain text ", 30);
+$data = array(
+  'empty' => array(),
+  'strings' => array('[', ']', '{', '}', ',', '"', '\\', '\\"', '"[,]"'),
+  'nested' => array(array(1, array(2, array()), 3), array(), array(array())),
+  'map' => array('a' => 1, 'b' => array('c' => 2.5, 'd' => null)),
+  'pad' => $pad,
+);
+$json = json_encode($data);
+var_dump(json_decode($json, true) === $data);
+var_dump(json_decode(" \n" . $json . "\t ", true) === $data);
+
+$obj = json_decode($json);
+var_dump(count($obj->strings), count($obj->nested), $obj->map->b->c);
+
+$a = json_decode('{"k": 1, "k": 2, "p": "' . $pad . '"}', true);
+var_dump($a['k']);
+$a = json_decode('[[ ], [1 ,2], {"x" : [ ]}, "' . $pad . '"]', true);
+var_dump($a[1]);
+var_dump(json_decode('[1, 2, "' . $pad . '"', true));
+var_dump(json_decode('[1, 2], "' . $pad . '"]', true));
@@ -0,0 +1,16 @@
+<?php
+
+// Strings long enough to be scanned in blocks, with escapes, multibyte
+// characters and bad bytes at different offsets.
+$pad = str_repeat("plain text ", 3);
+
+var_dump(json_decode(
+  '["' . $pad . '\"quoted\" \\\\ \/ new\nline café 😀",' .
+  ' "' . "caf\xc3\xa9 \xf0\x9f\x98\x80 " . $pad . '", "short"]', true));
+var_dump(json_decode('{"a key that is longer than sixteen bytes": "v"}', true));
+var_dump(json_decode('["' . $pad . "\t" . '"]', true));
+var_dump(json_decode('["' . $pad . "\x01" . '"]', true));
+var_dump(json_decode('["' . $pad . "\xc3(" . '"]', true));
+var_dump(json_decode('["' . $pad . '"', true));
+var_dump(json_decode("{'k': 'say \"hi\" " . $pad . "'}", true, JSON_FB_LOOSE));
+var_dump(json_decode("{'k': 'say \"hi\" " . $pad . "'}", true));
@@ -0,0 +1,32 @@
+<?php
+
+// Strings long enough to be scanned in blocks, with something to escape at
+// different offsets.
+$pad = str_repeat("plain text ", 3);
+$strings = array(
+  $pad,
+  $pad . "\"quoted\" and \\slashed/",
+  "tab\there" . $pad . "new\nline\r\x01\x1f",
+  "<a href='x'>&amp; @ 100%</a>" . $pad,
+  $pad . "caf\xc3\xa9 \xe2\x82\xac5 \xf0\x9f\x98\x80" . $pad,
+  $pad . "bad \xc3( byte",
+  $pad . "truncated \xe2\x82",
+);
+$options = array(
+  0,
+  JSON_HEX_TAG | JSON_HEX_AMP | JSON_HEX_APOS | JSON_HEX_QUOT,
+  JSON_UNESCAPED_SLASHES | JSON_UNESCAPED_UNICODE,
+  JSON_FB_LOOSE,
+  JSON_FB_LOOSE | JSON_UNESCAPED_UNICODE,
+  JSON_FB_EXTRA_ESCAPES,
+);
+foreach ($strings as $s) {
+  foreach ($options as $o) {
+    echo json_encode($s, $o), "\n";
+  }
+}
+
+$a = array(1, "two", array("a" => array(3, 4)), null);
+echo json_encode($a), "\n";
+echo json_encode($a, JSON_FORCE_OBJECT), "\n";
+echo json_encode($a, JSON_PRETTY_PRINT), "\n";
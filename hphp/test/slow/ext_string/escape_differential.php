@@ -0,0 +1,84 @@
+<?php
+
+// Compares the escaping builtins against byte-at-a-time versions on
+// random strings, with clean runs of every length between the bytes
+// they escape.
+
+function random_string($special, $density) {
+  $s = 'x';
+  $len = mt_rand(0, 100);
+  for ($i = 0; $i < $len; $i++) {
+    if (mt_rand(0, 7) < $density) {
+      $s .= $special[mt_rand(0, strlen($special) - 1)];
+    } else {
+      $s .= chr(mt_rand(ord('a'), ord('z')));
+    }
+  }
+  return $s;
+}
+
+function ref_stripslashes($s) {
+  $ret = '';
+  $n = strlen($s);
+  for ($i = 0; $i < $n; $i++) {
+    if ($s[$i] == '\\') {
+      if (++$i < $n) $ret .= $s[$i] == '0' ? "\0" : $s[$i];
+    } else {
+      $ret .= $s[$i];
+    }
+  }
+  return $ret;
+}
+
+function ref_addcslashes($s) {
+  static $named = array("\n" => 'n', "\t" => 't', "\r" => 'r', "\x07" => 'a',
+                        "\x0b" => 'v', "\x08" => 'b', "\x0c" => 'f');
+  $ret = '';
+  for ($i = 0; $i < strlen($s); $i++) {
+    $c = $s[$i];
+    $o = ord($c);
+    if ($o < 32 || $o > 126) {
+      $ret .= '\\' . (isset($named[$c]) ? $named[$c] : sprintf('%03o', $o));
+    } else if ($c == '!' || $c == '@') {
+      $ret .= '\\' . $c;
+    } else {
+      $ret .= $c;
+    }
+  }
+  return $ret;
+}
+
+$slashes = array("\0" => '\\0', "'" => "\\'", '"' => '\\"', '\\' => '\\\\');
+$meta = array();
+foreach (str_split('.\\+*?[^]$()') as $c) {
+  $meta[$c] = '\\' . $c;
+}
+$html = array('&' => '&amp;', '<' => '&lt;', '>' => '&gt;');
+$htmlq = $html + array('"' => '&quot;', "'" => '&#039;');
+
+$special = "\0'\"\\.+*?[^]$()&<>!@\n\t\x07\xc2\xa0\xff";
+$nonul = substr($special, 1);
+$bad = array();
+mt_srand(42);
+for ($i = 0; $i < 3000; $i++) {
+  $density = $i % 8;
+  $s = random_string($special, $density);
+  $t = random_string($nonul, $density);
+  if (addslashes($s) !== strtr($s, $slashes)) $bad['addslashes'] = $s;
+  if (stripslashes($s) !== ref_stripslashes($s)) $bad['stripslashes'] = $s;
+  if (stripslashes(addslashes($s)) !== $s) $bad['round trip'] = $s;
+  if (quotemeta($t) !== strtr($t, $meta)) $bad['quotemeta'] = $t;
+  if (addcslashes($s, "\0..\37!@\177..\377") !== ref_addcslashes($s)) {
+    $bad['addcslashes'] = $s;
+  }
+  if (htmlspecialchars($s, ENT_NOQUOTES) !== strtr($s, $html)) {
+    $bad['htmlspecialchars'] = $s;
+  }
+  if (htmlspecialchars($s, ENT_QUOTES) !== strtr($s, $htmlq)) {
+    $bad['htmlspecialchars quotes'] = $s;
+  }
+}
+foreach ($bad as $what => $s) {
+  echo "$what: ", bin2hex($s), "\n";
+}
+echo "done\n";
@@ -0,0 +1,92 @@
+<?php
+
+// strtr() with an array against the longest-key-first definition, and
+// strpos()/str_replace() against a plain scan, on random strings.
+
+function ref_strtr($s, $pairs) {
+  $maxlen = 0;
+  foreach ($pairs as $k => $v) {
+    $maxlen = max($maxlen, strlen($k));
+  }
+  $ret = '';
+  for ($pos = 0; $pos < strlen($s); ) {
+    for ($len = min($maxlen, strlen($s) - $pos); $len > 0; $len--) {
+      $key = substr($s, $pos, $len);
+      if (isset($pairs[$key])) {
+        $ret .= $pairs[$key];
+        $pos += $len;
+        continue 2;
+      }
+    }
+    $ret .= $s[$pos++];
+  }
+  return $ret;
+}
+
+function ref_strpos($s, $needle, $offset) {
+  for ($i = $offset; $i + strlen($needle) <= strlen($s); $i++) {
+    if (substr($s, $i, strlen($needle)) === $needle) return $i;
+  }
+  return false;
+}
+
+function random_string($alphabet, $len) {
+  $s = '';
+  for ($i = 0; $i < $len; $i++) {
+    $s .= $alphabet[mt_rand(0, strlen($alphabet) - 1)];
+  }
+  return $s;
+}
+
+mt_srand(7);
+$bad = array();
+$tables = array();
+for ($t = 0; $t < 6; $t++) {
+  $pairs = array();
+  $n = mt_rand(1, 300);
+  for ($i = 0; $i < $n; $i++) {
+    $pairs[random_string('abc12', mt_rand(1, 6))] = random_string('XY', $i % 3);
+  }
+  $tables[] = $pairs;
+}
+for ($i = 0; $i < 600; $i++) {
+  $s = random_string('abcd12', mt_rand(0, 120));
+  $pairs = $tables[$i % 6];
+  if (strtr($s, $pairs) !== ref_strtr($s, $pairs)) $bad['strtr'] = $s;
+  $needle = random_string('abc', mt_rand(1, 4));
+  $offset = mt_rand(0, strlen($s));
+  if (strpos($s, $needle, $offset) !== ref_strpos($s, $needle, $offset)) {
+    $bad['strpos'] = "$s $needle $offset";
+  }
+  if (str_replace($needle, '-', $s) !== implode('-', explode($needle, $s))) {
+    $bad['str_replace'] = "$s $needle";
+  }
+}
+foreach ($bad as $what => $s) {
+  echo "$what: $s\n";
+}
+
+// A changed array must not get the replacements of the old one.
+$pairs = array('a' => 'A', 'ab' => 'AB', 12 => 'twelve');
+var_dump(strtr('xaby12a1', $pairs));
+$pairs['y1'] = 'Y';
+var_dump(strtr('xaby12a1', $pairs));
+unset($pairs['ab']);
+var_dump(strtr('xaby12a1', $pairs));
+var_dump(strtr('abc', array('a' => 'x', '' => 'y')));
+
+// A replacement whose __toString() pushes the array being translated out
+// of the cache.
+class Evict {
+  function __toString() {
+    strtr('a', array('a' => '1'));
+    strtr('a', array('a' => '2'));
+    strtr('a', array('a' => '3'));
+    strtr('a', array('a' => '4'));
+    strtr('a', array('a' => '5'));
+    return 'E';
+  }
+}
+$pairs = array('e' => new Evict, 'f' => 'F');
+var_dump(strtr('efef', $pairs));
+var_dump(strtr('efef', $pairs));
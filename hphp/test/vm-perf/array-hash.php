@@ -0,0 +1,81 @@
+<?php
+
+/**
+ * Insert, lookup and delete throughput of large hash-keyed arrays.
+ */
+
+function build_str($n) {
+  $a = array();
+  for ($i = 0; $i < $n; $i++) {
+    $a['key' . $i] = $i;
+  }
+  return $a;
+}
+
+function build_int($n) {
+  $a = array();
+  for ($i = 0; $i < $n; $i++) {
+    $a[$i * 7919] = $i;
+  }
+  return $a;
+}
+
+// Half of the lookups miss.
+function lookup_str($a, $n, $rounds) {
+  $hits = 0;
+  $sum = 0;
+  for ($r = 0; $r < $rounds; $r++) {
+    for ($i = 0; $i < $n; $i++) {
+      $k = 'key' . ($i * 2);
+      if (isset($a[$k])) {
+        $hits++;
+        $sum += $a[$k];
+      }
+    }
+  }
+  echo "str hits: ", $hits, ", sum: ", $sum, "\n";
+}
+
+function lookup_int($a, $n, $rounds) {
+  $hits = 0;
+  $sum = 0;
+  for ($r = 0; $r < $rounds; $r++) {
+    for ($i = 0; $i < 2 * $n; $i++) {
+      $k = $i * 7919;
+      if (isset($a[$k])) {
+        $hits++;
+        $sum += $a[$k];
+      }
+    }
+  }
+  echo "int hits: ", $hits, ", sum: ", $sum, "\n";
+}
+
+function churn($a, $n) {
+  for ($i = 0; $i < $n; $i += 2) {
+    unset($a['key' . $i]);
+  }
+  echo "after unset: ", count($a), "\n";
+  for ($i = 0; $i < $n; $i += 2) {
+    $a['key' . $i] = $i;
+  }
+  echo "after re-add: ", count($a), "\n";
+  $sum = 0;
+  for ($i = 0; $i < $n; $i++) {
+    $sum += $a['key' . $i];
+  }
+  echo "sum: ", $sum, "\n";
+}
+
+function main() {
+  $n = 100000;
+  $s = build_str($n);
+  echo "str count: ", count($s), "\n";
+  $t = build_int($n);
+  echo "int count: ", count($t), "\n";
+  lookup_str($s, $n, 10);
+  lookup_int($t, $n, 10);
+  churn($s, $n);
+}
+
+main();
@@ -0,0 +1,57 @@
+<?php
+
+/**
+ * Sorts large arrays of ints, strings and doubles.
+ */
+
+include __DIR__."/lcg.inc";
+
+function check($name, $a, $desc = false) {
+  $ok = true;
+  $prev = null;
+  foreach ($a as $v) {
+    if ($prev !== null && ($desc ? $v > $prev : $v < $prev)) {
+      $ok = false;
+    }
+    $prev = $v;
+  }
+  echo $name, ": ", count($a), " ", reset($a), " ", end($a), " ",
+       $ok ? "sorted" : "NOT SORTED", "\n";
+}
+
+function main() {
+  $x = 1;
+  $ints = array();
+  for ($i = 0; $i < 1000000; $i++) {
+    $ints[] = lcg($x);
+  }
+  $a = $ints;
+  sort($a);
+  check("sort ints", $a);
+  $a = $ints;
+  rsort($a);
+  check("rsort ints", $a, true);
+
+  $keyed = array();
+  for ($i = 0; $i < 500000; $i++) {
+    $keyed[lcg($x) - 1073741824] = $i;
+  }
+  ksort($keyed);
+  check("ksort ints", array_keys($keyed));
+
+  $strs = array();
+  for ($i = 0; $i < 300000; $i++) {
+    $strs[] = 'k' . lcg($x);
+  }
+  sort($strs);
+  check("sort strings", $strs);
+
+  $doubles = array();
+  for ($i = 0; $i < 1000000; $i++) {
+    $doubles[] = lcg($x) + 0.5;
+  }
+  sort($doubles);
+  check("sort doubles", $doubles);
+}
+
+main();
@@ -0,0 +1,52 @@
+<?php
+
+/**
+ * Round-trips 16 byte to 1 megabyte strings through base64, hex and URL
+ * encoding, doing about the same amount of work at each size.
+ */
+
+include __DIR__."/lcg.inc";
+
+function binary($n, &$x) {
+  $s = '';
+  for ($i = 0; $i < $n; $i++) {
+    $s .= chr((lcg($x) >> 16) & 255);
+  }
+  return $s;
+}
+
+function text($n, &$x) {
+  $chars = 'abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789' .
+           '-._ /?=&%+~';
+  $len = strlen($chars);
+  $s = '';
+  for ($i = 0; $i < $n; $i++) {
+    $s .= $chars[(lcg($x) >> 16) % $len];
+  }
+  return $s;
+}
+
+function main() {
+  $x = 1;
+  foreach (array(16, 256, 4096, 65536, 1048576) as $size) {
+    $bin = binary($size, $x);
+    $txt = text($size, $x);
+    $rounds = max(1, (int)(8388608 / $size));
+    $ok = true;
+    for ($i = 0; $i < $rounds; $i++) {
+      $b64 = base64_encode($bin);
+      $hex = bin2hex($bin);
+      $url = urlencode($txt);
+      $raw = rawurlencode($txt);
+      $ok = $ok && base64_decode($b64, true) === $bin &&
+            hex2bin($hex) === $bin &&
+            urldecode($url) === $txt &&
+            rawurldecode($raw) === $txt;
+    }
+    printf("%d: base64 %08x hex %08x url %08x raw %08x %s\n", $size,
+           crc32($b64), crc32($hex), crc32($url), crc32($raw),
+           $ok ? "ok" : "MISMATCH");
+  }
+}
+
+main();
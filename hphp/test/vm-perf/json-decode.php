@@ -0,0 +1,71 @@
+<?php
+
+/**
+ * Decodes a few megabytes of string-heavy JSON, as arrays and as objects,
+ * and of number-heavy JSON with many small arrays.
+ */
+
+include __DIR__."/lcg.inc";
+
+function corpus($n) {
+  $x = 1;
+  $words = array('alpha', 'beta', 'gamma', 'delta', 'caf' . "\xc3\xa9",
+                 'say "hi"', 'a/b', "tab\there", 'back\\slash', 'plain');
+  $records = array();
+  for ($i = 0; $i < $n; $i++) {
+    $text = '';
+    for ($j = 0; $j < 12; $j++) {
+      $text .= $words[lcg($x) % count($words)] . ' ';
+    }
+    $records[] = array(
+      'id' => $i,
+      'name' => 'user number ' . lcg($x),
+      'score' => (lcg($x) % 10000) / 100,
+      'active' => $i % 3 == 0,
+      'tags' => array($words[$i % 10], $words[($i + 3) % 10]),
+      'profile' => array('bio' => $text, 'location' => null),
+    );
+  }
+  return $records;
+}
+
+function numbers($n) {
+  $x = 1;
+  $rows = array();
+  for ($i = 0; $i < $n; $i++) {
+    $row = array();
+    for ($j = 0; $j < 16; $j++) {
+      $row[] = $j % 2 ? lcg($x) : (lcg($x) % 100000) / 100;
+    }
+    $rows[] = $row;
+  }
+  return $rows;
+}
+
+function main() {
+  $data = corpus(20000);
+  $json = json_encode($data);
+  $ok = true;
+  for ($i = 0; $i < 10; $i++) {
+    $ok = $ok && json_decode($json, true) == $data;
+  }
+  echo "arrays: ", $ok ? "ok" : "MISMATCH", "\n";
+
+  for ($i = 0; $i < 10; $i++) {
+    $objs = json_decode($json);
+  }
+  $last = $objs[count($objs) - 1];
+  $ok = $last->profile->bio === $data[19999]['profile']['bio'];
+  echo "objects: ", count($objs), " ", $last->id, " ",
+       $ok ? "ok" : "MISMATCH", "\n";
+
+  $rows = numbers(40000);
+  $json = json_encode($rows);
+  $ok = true;
+  for ($i = 0; $i < 10; $i++) {
+    $ok = $ok && json_decode($json, true) == $rows;
+  }
+  echo "numbers: ", count($rows), " ", $ok ? "ok" : "MISMATCH", "\n";
+}
+
+main();
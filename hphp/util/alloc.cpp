@@ -16,10 +16,14 @@
 #include "hphp/util/alloc.h"
 
 #include <atomic>
+#include <vector>
 
 #include <sys/mman.h>
+#include <sys/syscall.h>
 #include <stdlib.h>
 #include <errno.h>
+#include <pthread.h>
+#include <sched.h>
 #include "hphp/util/util.h"
 #include "hphp/util/logger.h"
 
@@ -91,6 +95,106 @@ void flush_thread_stack() {
   }
 }
 
+__thread int s_numaNode = -1;
+
+namespace {
+
+// From <numaif.h>; glibc has no wrapper for set_mempolicy(), and libnuma
+// isn't worth a dependency for one call.
+const int kMpolPreferred = 1;
+const int kMaxNumaNodes = 64;
+
+struct NumaTopology {
+  NumaTopology() {
+#ifdef __linux__
+    for (int node = 0; node < kMaxNumaNodes; node++) {
+      char path[64];
+      snprintf(path, sizeof(path),
+               "/sys/devices/system/node/node%d/cpulist", node);
+      FILE* f = fopen(path, "r");
+      if (!f) break;
+      char buf[4096];
+      size_t len = fread(buf, 1, sizeof(buf) - 1, f);
+      fclose(f);
+      buf[len] = '\0';
+
+      // e.g. "0-7,16-23"
+      cpu_set_t cpus;
+      CPU_ZERO(&cpus);
+      for (char* p = buf; ; ) {
+        char* end;
+        long lo = strtol(p, &end, 10);
+        if (end == p) break;
+        long hi = lo;
+        if (*end == '-') {
+          p = end + 1;
+          hi = strtol(p, &end, 10);
+        }
+        for (long cpu = lo; cpu <= hi && cpu < CPU_SETSIZE; cpu++) {
+          CPU_SET(cpu, &cpus);
+        }
+        p = *end == ',' ? end + 1 : end;
+      }
+      cpuSets.push_back(cpus);
+    }
+#endif
+#ifdef USE_JEMALLOC
+    if (mallctl && cpuSets.size() > 1) {
+      for (size_t i = 0; i < cpuSets.size(); i++) {
+        unsigned arena;
+        size_t sz = sizeof(arena);
+        if (mallctl("arenas.extend", &arena, &sz, nullptr, 0) != 0) {
+          arenas.clear();
+          break;
+        }
+        arenas.push_back(arena);
+      }
+    }
+#endif
+  }
+
+  std::vector<cpu_set_t> cpuSets;
+  std::vector<unsigned> arenas;
+};
+
+NumaTopology& numa_topology() {
+  static NumaTopology topology;
+  return topology;
+}
+
+}
+
+int numa_num_nodes() {
+  int count = numa_topology().cpuSets.size();
+  return count ? count : 1;
+}
+
+void numa_bind_thread(int node) {
+  NumaTopology& topology = numa_topology();
+  if (node < 0 || node >= (int)topology.cpuSets.size()) return;
+  s_numaNode = node;
+#ifdef __linux__
+  if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t),
+                             &topology.cpuSets[node]) != 0) {
+    Logger::Warning("Unable to bind thread to NUMA node %d", node);
+  }
+  unsigned long mask = 1UL << node;
+  if (syscall(SYS_set_mempolicy, kMpolPreferred, &mask,
+              sizeof(mask) * 8 + 1) != 0) {
+    Logger::Warning("Unable to prefer memory of NUMA node %d", node);
+  }
+#endif
+#ifdef USE_JEMALLOC
+  if (node < (int)topology.arenas.size()) {
+    unsigned arena = topology.arenas[node];
+    if (mallctl("tcache.flush", nullptr, nullptr, nullptr, 0)
+        || mallctl("thread.arena", nullptr, nullptr, &arena, sizeof(arena))) {
+      // Error; keep the shared arena.
+    }
+  }
+#endif
+}
+
 #ifdef USE_JEMALLOC
 unsigned low_arena = 0;
 std::atomic<void*> highest_lowmall_addr;
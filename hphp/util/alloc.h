@@ -135,6 +135,25 @@ void flush_thread_caches();
  */
 void flush_thread_stack();
 
+/**
+ * Number of NUMA nodes, 1 if the machine or the kernel has no notion of
+ * them. The topology is read from sysfs on first use.
+ */
+int numa_num_nodes();
+
+/**
+ * Run the calling thread on the cpus of NUMA node "node" only, and have the
+ * kernel prefer that node for the pages it faults in. With jemalloc, the
+ * thread also switches to an arena of the node's own, so that memory it
+ * mallocs and frees isn't shared with threads on other nodes.
+ */
+void numa_bind_thread(int node);
+
+/**
+ * The node numa_bind_thread() bound the current thread to, or -1.
+ */
+extern __thread int s_numaNode;
+
 /**
  * Like scoped_ptr, but calls free() on destruct
  */
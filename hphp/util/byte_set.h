@@ -0,0 +1,154 @@
+/*
+   +----------------------------------------------------------------------+
+   | HipHop for PHP                                                       |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2010-2013 Facebook, Inc. (http://www.facebook.com)     |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 3.01 of the PHP license,      |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available through the world-wide-web at the following url:           |
+   | http://www.php.net/license/3_01.txt                                  |
+   | If you did not receive a copy of the PHP license and are unable to   |
+   | obtain it through the world-wide-web, please send a note to          |
+   | license@php.net so we can mail you a copy immediately.               |
+   +----------------------------------------------------------------------+
+*/
+
+#ifndef incl_HPHP_UTIL_BYTE_SET_H_
+#define incl_HPHP_UTIL_BYTE_SET_H_
+
+#include <assert.h>
+#include <stddef.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace HPHP {
+
+//////////////////////////////////////////////////////////////////////
+
+/*
+ * A set of bytes that can find the next of its members in a string.
+ *
+ * Escaping routines use find() to skip to the next byte that needs work
+ * and copy the run before it in one go. Sets of up to kMaxVectorSize
+ * bytes are searched 16 bytes at a time with SSE2; bigger sets, and the
+ * tail of the string, go a byte at a time.
+ */
+class ByteSet {
+public:
+  static const int kMaxVectorSize = 12;
+
+  ByteSet() : m_size(0) {
+    memset(m_member, 0, sizeof m_member);
+  }
+
+  ByteSet(const char* bytes, size_t n) : ByteSet() {
+    for (size_t i = 0; i < n; ++i) add(bytes[i]);
+  }
+
+  void add(unsigned char c) {
+    if (m_member[c]) return;
+    m_member[c] = true;
+#ifdef __SSE2__
+    if (m_size < kMaxVectorSize) m_vectors[m_size] = _mm_set1_epi8(c);
+#endif
+    ++m_size;
+  }
+
+  bool contains(unsigned char c) const { return m_member[c]; }
+
+  /*
+   * Returns the first byte in [p, end) that is in the set, or end.
+   */
+  const char* find(const char* p, const char* end) const {
+#ifdef __SSE2__
+    if (m_size <= kMaxVectorSize) {
+      for (; end - p >= 16; p += 16) {
+        __m128i bytes = _mm_loadu_si128((const __m128i*)p);
+        __m128i hits = _mm_setzero_si128();
+        for (int i = 0; i < m_size; ++i) {
+          hits = _mm_or_si128(hits, _mm_cmpeq_epi8(bytes, m_vectors[i]));
+        }
+        if (int mask = _mm_movemask_epi8(hits)) {
+          return p + __builtin_ctz(mask);
+        }
+      }
+    }
+#endif
+    while (p < end && !m_member[(unsigned char)*p]) ++p;
+    return p;
+  }
+
+private:
+#ifdef __SSE2__
+  __m128i m_vectors[kMaxVectorSize];
+#endif
+  int m_size;
+  bool m_member[256];
+};
+
+/*
+ * The bytes below lo or from 0x80 up, plus up to ByteSet::kMaxVectorSize
+ * others. That is the shape of the bytes JSON encoding and decoding can't
+ * copy as they are: control characters, non-ASCII bytes, and a few
+ * punctuation characters. With SSE2, the bytes from 0x80 up compare as
+ * negative, so a single signed compare against lo covers both ends of the
+ * range, and find() goes 16 bytes at a time however wide the range is.
+ */
+class ByteRangeSet {
+public:
+  ByteRangeSet(unsigned char lo, const char* bytes, size_t n)
+      : m_lo(lo), m_size(0) {
+    assert(lo < 0x80 && n <= (size_t)ByteSet::kMaxVectorSize);
+    for (int c = 0; c < 256; ++c) m_member[c] = c < lo || c >= 0x80;
+    for (size_t i = 0; i < n; ++i) {
+      unsigned char c = bytes[i];
+      if (m_member[c]) continue;
+      m_member[c] = true;
+#ifdef __SSE2__
+      m_vectors[m_size] = _mm_set1_epi8(c);
+#endif
+      ++m_size;
+    }
+  }
+
+  bool contains(unsigned char c) const { return m_member[c]; }
+
+  /*
+   * Returns the first byte in [p, end) that is in the set, or end.
+   */
+  const char* find(const char* p, const char* end) const {
+#ifdef __SSE2__
+    const __m128i lo = _mm_set1_epi8(m_lo);
+    for (; end - p >= 16; p += 16) {
+      __m128i bytes = _mm_loadu_si128((const __m128i*)p);
+      __m128i hits = _mm_cmplt_epi8(bytes, lo);
+      for (int i = 0; i < m_size; ++i) {
+        hits = _mm_or_si128(hits, _mm_cmpeq_epi8(bytes, m_vectors[i]));
+      }
+      if (int mask = _mm_movemask_epi8(hits)) {
+        return p + __builtin_ctz(mask);
+      }
+    }
+#endif
+    while (p < end && !m_member[(unsigned char)*p]) ++p;
+    return p;
+  }
+
+private:
+#ifdef __SSE2__
+  __m128i m_vectors[ByteSet::kMaxVectorSize];
+#endif
+  unsigned char m_lo;
+  int m_size;
+  bool m_member[256];
+};
+
+//////////////////////////////////////////////////////////////////////
+
+}
+
+#endif // incl_HPHP_UTIL_BYTE_SET_H_
@@ -0,0 +1,107 @@
+/*
+   +----------------------------------------------------------------------+
+   | HipHop for PHP                                                       |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2010-2013 Facebook, Inc. (http://www.facebook.com)     |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 3.01 of the PHP license,      |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available through the world-wide-web at the following url:           |
+   | http://www.php.net/license/3_01.txt                                  |
+   | If you did not receive a copy of the PHP license and are unable to   |
+   | obtain it through the world-wide-web, please send a note to          |
+   | license@php.net so we can mail you a copy immediately.               |
+   +----------------------------------------------------------------------+
+*/
+
+#include "hphp/util/codel.h"
+#include "hphp/util/compatibility.h"
+
+namespace HPHP {
+///////////////////////////////////////////////////////////////////////////////
+
+void QueueDelayHistogram::clear() {
+  for (int i = 0; i < kBuckets; i++) {
+    m_buckets[i].store(0, std::memory_order_relaxed);
+  }
+}
+
+int64_t QueueDelayHistogram::count() const {
+  int64_t total = 0;
+  for (int i = 0; i < kBuckets; i++) {
+    total += m_buckets[i].load(std::memory_order_relaxed);
+  }
+  return total;
+}
+
+int64_t QueueDelayHistogram::percentile(double p) const {
+  int64_t counts[kBuckets];
+  int64_t total = 0;
+  for (int i = 0; i < kBuckets; i++) {
+    counts[i] = m_buckets[i].load(std::memory_order_relaxed);
+    total += counts[i];
+  }
+  if (total == 0) return 0;
+
+  int64_t rank = (int64_t)(total * p / 100);
+  if (rank >= total) rank = total - 1;
+  int64_t seen = 0;
+  for (int i = 0; i < kBuckets; i++) {
+    seen += counts[i];
+    if (seen > rank) return 1LL << i;
+  }
+  return 1LL << (kBuckets - 1);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+CoDel::CoDel(int targetMs, int intervalMs)
+    : m_targetUs(targetMs * 1000LL), m_intervalUs(intervalMs * 1000LL),
+      m_intervalEnd(0),
+      m_minDelay(0),
+      m_resetMinDelay(false), m_overloaded(false), m_shedCount(0),
+      m_current(0) {
+}
+
+bool CoDel::onDequeue(const timespec &queueTime) {
+  timespec now;
+  gettime(CLOCK_MONOTONIC, &now);
+  return onDequeue(gettime_diff_us(queueTime, now),
+                   now.tv_sec * 1000000LL + now.tv_nsec / 1000);
+}
+
+bool CoDel::onDequeue(int64_t delayUs, int64_t nowUs) {
+  m_histograms[m_current.load(std::memory_order_relaxed)].add(delayUs);
+
+  // The first worker to get here after an interval ended judges it, and the
+  // next dequeue starts tracking a fresh minimum.
+  if (nowUs > m_intervalEnd.load(std::memory_order_acquire) &&
+      !m_resetMinDelay.exchange(true)) {
+    m_intervalEnd.store(nowUs + m_intervalUs, std::memory_order_release);
+    m_overloaded.store(m_minDelay.load(std::memory_order_relaxed) > m_targetUs,
+                       std::memory_order_relaxed);
+
+    int next = 1 - m_current.load(std::memory_order_relaxed);
+    m_histograms[next].clear();
+    m_current.store(next, std::memory_order_release);
+  }
+
+  if (m_resetMinDelay.load(std::memory_order_acquire) &&
+      m_resetMinDelay.exchange(false)) {
+    m_minDelay.store(delayUs, std::memory_order_relaxed);
+    // a single job is not enough to start shedding in a new interval
+    return false;
+  }
+  if (delayUs < m_minDelay.load(std::memory_order_relaxed)) {
+    m_minDelay.store(delayUs, std::memory_order_relaxed);
+  }
+
+  if (isOverloaded() && delayUs > 2 * m_targetUs) {
+    m_shedCount.fetch_add(1, std::memory_order_relaxed);
+    return true;
+  }
+  return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+}
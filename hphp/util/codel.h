@@ -0,0 +1,118 @@
+/*
+   +----------------------------------------------------------------------+
+   | HipHop for PHP                                                       |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2010-2013 Facebook, Inc. (http://www.facebook.com)     |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 3.01 of the PHP license,      |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available through the world-wide-web at the following url:           |
+   | http://www.php.net/license/3_01.txt                                  |
+   | If you did not receive a copy of the PHP license and are unable to   |
+   | obtain it through the world-wide-web, please send a note to          |
+   | license@php.net so we can mail you a copy immediately.               |
+   +----------------------------------------------------------------------+
+*/
+
+#ifndef incl_HPHP_UTIL_CODEL_H_
+#define incl_HPHP_UTIL_CODEL_H_
+
+#include <atomic>
+#include <cstdint>
+#include <time.h>
+
+namespace HPHP {
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Lock-free histogram of queueing delays in power-of-two microsecond
+ * buckets; bucket i counts delays in [2^(i-1), 2^i).
+ */
+class QueueDelayHistogram {
+public:
+  static const int kBuckets = 32;
+
+  QueueDelayHistogram() { clear(); }
+
+  void add(int64_t delayUs) {
+    m_buckets[bucketFor(delayUs)].fetch_add(1, std::memory_order_relaxed);
+  }
+  void clear();
+
+  int64_t count() const;
+
+  /**
+   * Upper bound, in microseconds, of the bucket holding the given
+   * percentile (0 to 100), or 0 if nothing was recorded.
+   */
+  int64_t percentile(double p) const;
+
+private:
+  static int bucketFor(int64_t delayUs) {
+    if (delayUs <= 0) return 0;
+    int bucket = 64 - __builtin_clzll(delayUs);
+    return bucket < kBuckets ? bucket : kBuckets - 1;
+  }
+
+  std::atomic<int64_t> m_buckets[kBuckets];
+};
+
+/**
+ * Queue-delay based load shedding, after CoDel ("Controlling Queue Delay",
+ * Nichols and Jacobson).
+ *
+ * Workers report how long every job sat in the queue. A queue is overloaded
+ * when even the shortest delay seen during the last interval exceeded the
+ * target, i.e. it never drained; a transient burst doesn't count. While
+ * overloaded, jobs that waited more than twice the target are shed, so the
+ * queue drains and the jobs that are served still have a chance to finish in
+ * time. Unlike CoDel proper the drop rate doesn't ramp up; sloughing off old
+ * jobs is enough for request queues whose consumers are busy CPUs.
+ *
+ * Also keeps histograms of the delays seen during the current and the last
+ * complete interval for reporting.
+ */
+class CoDel {
+public:
+  CoDel(int targetMs, int intervalMs);
+
+  /**
+   * Called when a job is dequeued. Returns true if it should be rejected
+   * instead of processed.
+   */
+  bool onDequeue(const timespec &queueTime);
+  bool onDequeue(int64_t delayUs, int64_t nowUs);
+
+  bool isOverloaded() const {
+    return m_overloaded.load(std::memory_order_relaxed);
+  }
+  int64_t getShedCount() const {
+    return m_shedCount.load(std::memory_order_relaxed);
+  }
+  int64_t getTargetUs() const { return m_targetUs; }
+
+  /**
+   * Delays seen during the last complete interval.
+   */
+  const QueueDelayHistogram &getLastInterval() const {
+    return m_histograms[1 - m_current.load(std::memory_order_acquire)];
+  }
+
+private:
+  const int64_t m_targetUs;
+  const int64_t m_intervalUs;
+
+  std::atomic<int64_t> m_intervalEnd;
+  std::atomic<int64_t> m_minDelay;
+  std::atomic<bool> m_resetMinDelay;
+  std::atomic<bool> m_overloaded;
+  std::atomic<int64_t> m_shedCount;
+
+  std::atomic<int> m_current;
+  QueueDelayHistogram m_histograms[2];
+};
+
+///////////////////////////////////////////////////////////////////////////////
+}
+
+#endif // incl_HPHP_UTIL_CODEL_H_
@@ -463,6 +463,17 @@ char *FileCache::read(const char *name, int &len, bool &compressed) const {
   return nullptr;
 }
 
+bool FileCache::readRange(const char *name, int &fd, off_t &offset,
+                          int &len, bool &compressed) const {
+  if (m_fd == -1 || !m_addr) return false;
+  char *data = read(name, len, compressed);
+  if (!data || len <= 0) return false;
+  assert(data >= (char*)m_addr && data + len <= (char*)m_addr + m_size);
+  fd = m_fd;
+  offset = data - (char*)m_addr;
+  return true;
+}
+
 int64_t FileCache::fileSize(const char *name, bool isRelative) const {
   if (!name || !*name) return -1;
   if (isRelative) {
@@ -53,6 +53,13 @@ public:
   bool dirExists(const char *name, bool isRelative = true) const;
   bool exists(const char *name, bool isRelative = true) const;
   char *read(const char *name, int &len, bool &compressed) const;
+
+  /**
+   * Only after loadMmap(): like read(), but finds where the data lives in
+   * the archive file, so it can be sent with sendfile(2) from fd.
+   */
+  bool readRange(const char *name, int &fd, off_t &offset, int &len,
+                 bool &compressed) const;
   int64_t fileSize(const char *name, bool isRelative) const;
   void dump();
 
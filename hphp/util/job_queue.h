@@ -17,6 +17,8 @@
 #ifndef incl_HPHP_UTIL_JOB_QUEUE_H_
 #define incl_HPHP_UTIL_JOB_QUEUE_H_
 
+#include <atomic>
+#include <memory>
 #include <vector>
 #include <set>
 #include "hphp/util/async_func.h"
@@ -25,6 +27,7 @@
 #include "hphp/util/atomic.h"
 #include "hphp/util/alloc.h"
 #include "hphp/util/exception.h"
+#include "hphp/util/work_stealing_queue.h"
 
 namespace HPHP {
 ///////////////////////////////////////////////////////////////////////////////
@@ -73,6 +76,15 @@ namespace detail {
 
 /**
  * A job queue that's suitable for multiple threads to work on.
+ *
+ * By default all jobs live in one deque behind the queue's lock. With
+ * workStealing, jobs are kept in a WorkStealingQueue instead and the lock is
+ * only taken by workers going idle and by producers waking them up.
+ *
+ * With numaNodes > 1, the locked queue is split into one deque per NUMA node
+ * and worker "id" belongs to node id % numaNodes. A job goes to the first
+ * node with an idle worker, starting from the node of the thread enqueueing
+ * it, and workers drain their own node's deque before helping the others.
  */
 template<typename TJob,
          bool waitable = false,
@@ -87,21 +99,35 @@ public:
    * Constructor.
    */
   JobQueue(int threadCount, bool threadRoundRobin, int dropCacheTimeout,
-           bool dropStack, bool lifo)
-      : SynchronizableMulti(threadRoundRobin ? 1 : threadCount),
-        m_jobCount(0), m_stopped(false), m_workerCount(0),
+           bool dropStack, bool lifo, bool workStealing = false,
+           int numaNodes = 1)
+      : SynchronizableMulti(threadRoundRobin ? 1 : threadCount,
+                            threadRoundRobin ? 1 : numaNodes),
+        m_jobCount(0), m_jobs(numaNodes), m_stopped(false), m_workerCount(0),
         m_dropCacheTimeout(dropCacheTimeout), m_dropStack(dropStack),
-        m_lifo(lifo) {
+        m_lifo(lifo), m_idleCount(0) {
+    assert(numaNodes >= 1);
+    if (workStealing) {
+      m_stealing.reset(new WorkStealingQueue<TJob>(threadCount, lifo));
+    }
   }
 
   /**
    * Put a job into the queue and notify a worker to pick it up.
    */
   void enqueue(TJob job) {
+    if (m_stealing) {
+      // count the job before a worker can pop it and decrement the count
+      atomic_inc(m_jobCount);
+      m_stealing->push(job);
+      wakeIdleWorker();
+      return;
+    }
     Lock lock(this);
-    m_jobs.push_back(job);
-    m_jobCount = m_jobs.size();
-    notify();
+    int node = pickNode();
+    m_jobs[node].push_back(job);
+    m_jobCount++;
+    notify(node);
   }
 
   /**
@@ -110,9 +136,10 @@ public:
    * the job object correctly.
    */
   TJob dequeue(int id, bool inc = false) {
+    if (m_stealing) return dequeueStealing(id, inc);
     Lock lock(this);
     bool flushed = false;
-    while (m_jobs.empty()) {
+    while (!m_jobCount) {
       if (m_stopped) {
         throw StopSignal();
       }
@@ -120,26 +147,26 @@ public:
         wait(id, false);
       } else if (!wait(id, true, m_dropCacheTimeout)) {
         // since we timed out, maybe we can turn idle without holding memory
-        if (m_jobs.empty()) {
+        if (!m_jobCount) {
           ScopedUnlock unlock(this);
-          Util::flush_thread_caches();
-          if (m_dropStack && Util::s_stackLimit) {
-            Util::flush_thread_stack();
-          }
-          DropCachePolicy::dropCache();
+          dropCaches();
           flushed = true;
         }
       }
     }
     if (inc) incActiveWorker();
-    m_jobCount = m_jobs.size() - 1;
+    m_jobCount--;
+    std::deque<TJob> *jobs = &m_jobs[id % m_jobs.size()];
+    for (unsigned i = 1; jobs->empty(); i++) {
+      jobs = &m_jobs[(id + i) % m_jobs.size()];
+    }
     if (m_lifo) {
-      TJob job = m_jobs.back();
-      m_jobs.pop_back();
+      TJob job = jobs->back();
+      jobs->pop_back();
       return job;
     }
-    TJob job = m_jobs.front();
-    m_jobs.pop_front();
+    TJob job = jobs->front();
+    jobs->pop_front();
     return job;
   }
 
@@ -177,23 +204,102 @@ public:
 
  private:
   int m_jobCount;
-  std::deque<TJob> m_jobs;
+  std::vector<std::deque<TJob> > m_jobs; // one per NUMA node
   bool m_stopped;
   int m_workerCount;
   int m_dropCacheTimeout;
   bool m_dropStack;
   bool m_lifo;
+
+  // work-stealing mode only
+  std::unique_ptr<WorkStealingQueue<TJob> > m_stealing;
+  std::atomic<int> m_idleCount;
+
+  /**
+   * Deque for the next job: the first node with an idle worker, looking at
+   * the enqueueing thread's own node first, or else the least loaded one.
+   */
+  int pickNode() const {
+    int count = m_jobs.size();
+    if (count == 1) return 0;
+    int local = Util::s_numaNode >= 0 ? Util::s_numaNode % count : 0;
+    int best = local;
+    for (int i = 0; i < count; i++) {
+      int node = (local + i) % count;
+      if (hasWaiters(node)) return node;
+      if (m_jobs[node].size() < m_jobs[best].size()) best = node;
+    }
+    return best;
+  }
+
+  void dropCaches() {
+    Util::flush_thread_caches();
+    if (m_dropStack && Util::s_stackLimit) {
+      Util::flush_thread_stack();
+    }
+    DropCachePolicy::dropCache();
+  }
+
+  /**
+   * Idle workers bump m_idleCount under the lock before their final look at
+   * the queue, and producers publish a job before reading m_idleCount. The
+   * fences order those two steps, so either the worker sees the job or the
+   * producer sees the worker and signals it.
+   */
+  void wakeIdleWorker() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_idleCount.load(std::memory_order_relaxed) > 0) {
+      Lock lock(this);
+      notify();
+    }
+  }
+
+  TJob dequeueStealing(int id, bool inc) {
+    TJob job;
+    bool flushed = false;
+    while (!m_stealing->pop(id, job)) {
+      Lock lock(this);
+      m_idleCount.fetch_add(1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      bool found = m_stealing->pop(id, job);
+      if (!found && !m_stopped) {
+        if (m_dropCacheTimeout <= 0 || flushed) {
+          wait(id, false);
+        } else if (!wait(id, true, m_dropCacheTimeout)) {
+          // since we timed out, maybe we can turn idle without holding memory
+          m_idleCount.fetch_sub(1, std::memory_order_relaxed);
+          ScopedUnlock unlock(this);
+          dropCaches();
+          flushed = true;
+          continue;
+        }
+      }
+      m_idleCount.fetch_sub(1, std::memory_order_relaxed);
+      if (found) break;
+      if (m_stopped) {
+        throw StopSignal();
+      }
+    }
+    if (inc) incActiveWorker();
+    atomic_dec(m_jobCount);
+    // we may have pulled a batch; let a sleeping worker steal the rest
+    if (m_stealing->localSize(id)) wakeIdleWorker();
+    return job;
+  }
 };
 
 template<class TJob, class Policy>
 struct JobQueue<TJob,true,Policy> : JobQueue<TJob,false,Policy> {
   JobQueue(int threadCount, bool threadRoundRobin, int dropCacheTimeout,
-           bool dropStack, bool lifo) :
+           bool dropStack, bool lifo, bool workStealing = false,
+           int numaNodes = 1) :
     JobQueue<TJob,false,Policy>(threadCount,
                                 threadRoundRobin,
                                 dropCacheTimeout,
                                 dropStack,
-                                lifo) {
+                                lifo,
+                                workStealing,
+                                numaNodes) {
     pthread_cond_init(&m_cond, nullptr);
   }
   ~JobQueue() {
@@ -321,11 +427,12 @@ public:
    */
   JobQueueDispatcher(int threadCount, bool threadRoundRobin,
                      int dropCacheTimeout, bool dropStack, void *opaque,
-                     bool lifo = false)
+                     bool lifo = false, bool workStealing = false,
+                     int numaNodes = 1)
       : m_stopped(true), m_id(0), m_opaque(opaque),
         m_maxThreadCount(threadCount),
         m_queue(threadCount, threadRoundRobin, dropCacheTimeout, dropStack,
-                lifo) {
+                lifo, workStealing, numaNodes) {
     assert(threadCount >= 1);
     if (!TWorker::CountActive) {
       // If TWorker does not support counting the number of
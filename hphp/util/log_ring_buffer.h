@@ -0,0 +1,154 @@
+/*
+   +----------------------------------------------------------------------+
+   | HipHop for PHP                                                       |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2010-2013 Facebook, Inc. (http://www.facebook.com)     |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 3.01 of the PHP license,      |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available through the world-wide-web at the following url:           |
+   | http://www.php.net/license/3_01.txt                                  |
+   | If you did not receive a copy of the PHP license and are unable to   |
+   | obtain it through the world-wide-web, please send a note to          |
+   | license@php.net so we can mail you a copy immediately.               |
+   +----------------------------------------------------------------------+
+*/
+
+#ifndef incl_HPHP_UTIL_LOG_RING_BUFFER_H_
+#define incl_HPHP_UTIL_LOG_RING_BUFFER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "hphp/util/assertions.h"
+
+namespace HPHP {
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Single-producer single-consumer ring of variable sized records, used to
+ * hand formatted log lines from a request thread to a background writer.
+ *
+ * Every record is stored contiguously as an 8-byte header (a caller defined
+ * tag plus the payload length) followed by the payload, padded to 8 bytes.
+ * A record that doesn't fit before the end of the buffer is preceded by a
+ * wrap marker, so the consumer can point iovecs straight into the ring.
+ *
+ * write() never blocks: it fails when the ring is full. The consumer reads a
+ * batch of records with read(), which leaves them in place, and hands the
+ * space back with consume() once it is done with the payloads.
+ */
+class LogRingBuffer {
+public:
+  struct Record {
+    uint32_t tag;
+    uint32_t len;
+    const char *data;
+  };
+
+  explicit LogRingBuffer(uint32_t capacity)
+      : m_writePos(0), m_readPos(0), m_peekPos(0) {
+    uint32_t size = 64;
+    while (size < capacity) size <<= 1;
+    m_mask = size - 1;
+    m_buffer.reset(new char[size]);
+  }
+
+  uint32_t capacity() const { return m_mask + 1; }
+
+  /**
+   * Producer side. Returns false, leaving the ring untouched, if the record
+   * doesn't fit in the space the consumer has released so far.
+   */
+  bool write(uint32_t tag, const char *data, uint32_t len) {
+    uint64_t size = kHeaderSize + pad(len);
+    if (size > capacity()) return false;
+
+    uint64_t pos = m_writePos.load(std::memory_order_relaxed);
+    uint64_t free =
+      capacity() - (pos - m_readPos.load(std::memory_order_acquire));
+    uint32_t offset = pos & m_mask;
+    uint32_t tail = capacity() - offset;
+    uint32_t skip = tail < size ? tail : 0;
+    if (skip + size > free) return false;
+
+    if (skip) {
+      writeHeader(offset, 0, kWrapMarker);
+      pos += skip;
+      offset = 0;
+    }
+    writeHeader(offset, tag, len);
+    memcpy(&m_buffer[offset + kHeaderSize], data, len);
+    m_writePos.store(pos + size, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * Consumer side. Appends up to maxRecords records written so far, and not
+   * yet returned by an earlier read(), to out. The payloads stay valid until
+   * the next consume().
+   */
+  size_t read(std::vector<Record> &out, size_t maxRecords) {
+    uint64_t end = m_writePos.load(std::memory_order_acquire);
+    size_t count = 0;
+    while (m_peekPos < end && count < maxRecords) {
+      uint32_t offset = m_peekPos & m_mask;
+      Record rec;
+      memcpy(&rec.tag, &m_buffer[offset], sizeof(rec.tag));
+      memcpy(&rec.len, &m_buffer[offset + sizeof(rec.tag)], sizeof(rec.len));
+      if (rec.len == kWrapMarker) {
+        m_peekPos += capacity() - offset;
+        continue;
+      }
+      rec.data = &m_buffer[offset + kHeaderSize];
+      out.push_back(rec);
+      m_peekPos += kHeaderSize + pad(rec.len);
+      count++;
+    }
+    return count;
+  }
+
+  /**
+   * Releases everything returned by read() back to the producer.
+   */
+  void consume() {
+    m_readPos.store(m_peekPos, std::memory_order_release);
+  }
+
+  /**
+   * True if there is nothing for read() to return. Only exact on the
+   * consumer thread.
+   */
+  bool empty() const {
+    return m_peekPos == m_writePos.load(std::memory_order_acquire);
+  }
+
+private:
+  static const uint32_t kHeaderSize = 8;
+  static const uint32_t kWrapMarker = 0xffffffff;
+
+  static uint64_t pad(uint32_t len) {
+    return (uint64_t(len) + 7) & ~uint64_t(7);
+  }
+
+  void writeHeader(uint32_t offset, uint32_t tag, uint32_t len) {
+    memcpy(&m_buffer[offset], &tag, sizeof(tag));
+    memcpy(&m_buffer[offset + sizeof(tag)], &len, sizeof(len));
+  }
+
+  std::unique_ptr<char[]> m_buffer;
+  uint32_t m_mask;
+  char m_pad0[64];
+  std::atomic<uint64_t> m_writePos;
+  char m_pad1[64];
+  std::atomic<uint64_t> m_readPos;
+  uint64_t m_peekPos; // consumer only
+};
+
+///////////////////////////////////////////////////////////////////////////////
+}
+
+#endif // incl_HPHP_UTIL_LOG_RING_BUFFER_H_
@@ -0,0 +1,153 @@
+/*
+   +----------------------------------------------------------------------+
+   | HipHop for PHP                                                       |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2010-2013 Facebook, Inc. (http://www.facebook.com)     |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 3.01 of the PHP license,      |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available through the world-wide-web at the following url:           |
+   | http://www.php.net/license/3_01.txt                                  |
+   | If you did not receive a copy of the PHP license and are unable to   |
+   | obtain it through the world-wide-web, please send a note to          |
+   | license@php.net so we can mail you a copy immediately.               |
+   +----------------------------------------------------------------------+
+*/
+
+#ifndef incl_HPHP_UTIL_RADIX_SORT_H_
+#define incl_HPHP_UTIL_RADIX_SORT_H_
+
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+namespace HPHP {
+namespace Sort {
+
+//////////////////////////////////////////////////////////////////////
+
+/*
+ * Radix sorts for element types that can be moved with memcpy. Both are
+ * stable and take a scratch buffer with room for end - begin elements.
+ */
+
+/*
+ * Sorts [begin, end) in ascending order of key(elm), an int64_t.
+ *
+ * This is an LSD sort on bytes; passes where every key has the same byte
+ * are skipped, so keys in a small range take only a few passes.
+ */
+template <class T, class KeyFn>
+void radix_sort_int(T* begin, T* end, T* scratch, KeyFn key) {
+  const size_t n = end - begin;
+  if (n < 2) return;
+  size_t counts[8][256];
+  memset(counts, 0, sizeof counts);
+  for (T* p = begin; p != end; ++p) {
+    uint64_t k = uint64_t(key(*p)) ^ (1ULL << 63);
+    for (int pass = 0; pass < 8; ++pass) {
+      ++counts[pass][(k >> (pass * 8)) & 0xff];
+    }
+  }
+  T* from = begin;
+  T* to = scratch;
+  for (int pass = 0; pass < 8; ++pass) {
+    size_t* count = counts[pass];
+    uint64_t k = uint64_t(key(*from)) ^ (1ULL << 63);
+    if (count[(k >> (pass * 8)) & 0xff] == n) continue;
+    size_t offset = 0;
+    for (int b = 0; b < 256; ++b) {
+      size_t c = count[b];
+      count[b] = offset;
+      offset += c;
+    }
+    for (size_t i = 0; i < n; ++i) {
+      uint64_t ki = uint64_t(key(from[i])) ^ (1ULL << 63);
+      memcpy(&to[count[(ki >> (pass * 8)) & 0xff]++], &from[i], sizeof(T));
+    }
+    std::swap(from, to);
+  }
+  if (from != begin) memcpy(begin, from, n * sizeof(T));
+}
+
+struct RadixString {
+  const char* data;
+  size_t len;
+};
+
+/*
+ * Sorts [begin, end) in ascending order of str(elm), a RadixString,
+ * comparing bytes as unsigned chars, with a string ordered before the
+ * strings it is a proper prefix of (the order of memcmp() followed by a
+ * length comparison).
+ *
+ * This is an MSD sort on bytes. Buckets of up to kSmallSortSize elements
+ * are finished with a comparison sort on the remaining bytes.
+ */
+const size_t kSmallSortSize = 32;
+
+template <class T, class StrFn>
+void radix_sort_str(T* begin, T* end, T* scratch, StrFn str) {
+  struct Bucket {
+    size_t start;
+    size_t count;
+    size_t depth;
+  };
+  std::vector<Bucket> work;
+  work.push_back(Bucket{0, size_t(end - begin), 0});
+  size_t counts[257];
+  while (!work.empty()) {
+    Bucket bucket = work.back();
+    work.pop_back();
+    T* elms = begin + bucket.start;
+    size_t depth = bucket.depth;
+    if (bucket.count <= kSmallSortSize) {
+      std::stable_sort(elms, elms + bucket.count,
+                       [&](const T& a, const T& b) {
+        RadixString sa = str(a);
+        RadixString sb = str(b);
+        size_t len = std::min(sa.len, sb.len);
+        int c = memcmp(sa.data + depth, sb.data + depth, len - depth);
+        return c ? c < 0 : sa.len < sb.len;
+      });
+      continue;
+    }
+    // Bucket 0 holds the strings that end at this depth.
+    auto byteAt = [&](const T& elm) -> size_t {
+      RadixString s = str(elm);
+      return depth < s.len ? (unsigned char)s.data[depth] + 1 : 0;
+    };
+    memset(counts, 0, sizeof counts);
+    for (size_t i = 0; i < bucket.count; ++i) {
+      ++counts[byteAt(elms[i])];
+    }
+    size_t first = byteAt(elms[0]);
+    if (counts[first] == bucket.count) {
+      // Common prefix; nothing moves at this depth.
+      if (first) {
+        work.push_back(Bucket{bucket.start, bucket.count, depth + 1});
+      }
+      continue;
+    }
+    size_t offset = 0;
+    for (int b = 0; b < 257; ++b) {
+      size_t c = counts[b];
+      counts[b] = offset;
+      offset += c;
+      if (b && c > 1) {
+        work.push_back(Bucket{bucket.start + counts[b], c, depth + 1});
+      }
+    }
+    for (size_t i = 0; i < bucket.count; ++i) {
+      memcpy(&scratch[counts[byteAt(elms[i])]++], &elms[i], sizeof(T));
+    }
+    memcpy(elms, scratch, bucket.count * sizeof(T));
+  }
+}
+
+//////////////////////////////////////////////////////////////////////
+
+}}
+
+#endif // incl_HPHP_UTIL_RADIX_SORT_H_
@@ -20,9 +20,11 @@
 namespace HPHP {
 ///////////////////////////////////////////////////////////////////////////////
 
-SynchronizableMulti::SynchronizableMulti(int size) : m_mutex(RankLeaf) {
-  assert(size > 0);
+SynchronizableMulti::SynchronizableMulti(int size, int groups)
+    : m_mutex(RankLeaf) {
+  assert(size > 0 && groups > 0);
   m_conds.resize(size);
+  m_cond_lists.resize(groups);
   for (unsigned int i = 0; i < m_conds.size(); i++) {
     pthread_cond_init(&m_conds[i], nullptr);
   }
@@ -55,13 +57,15 @@ bool SynchronizableMulti::waitImpl(int id, bool front, timespec *ts) {
   assert(id >= 0);
   int index = id % m_conds.size();
   pthread_cond_t *cond = &m_conds[index];
+  int group = id % m_cond_lists.size();
+  std::list<pthread_cond_t*> &condList = m_cond_lists[group];
 
   if (front) {
-    m_cond_list.push_front(cond);
-    m_cond_map.insert(make_pair(cond, m_cond_list.begin()));
+    condList.push_front(cond);
+    m_cond_map.insert(make_pair(cond, CondPos(group, condList.begin())));
   } else {
-    m_cond_list.push_back(cond);
-    m_cond_map.insert(make_pair(cond, --m_cond_list.end()));
+    condList.push_back(cond);
+    m_cond_map.insert(make_pair(cond, CondPos(group, --condList.end())));
   }
 
   int ret;
@@ -75,7 +79,7 @@ bool SynchronizableMulti::waitImpl(int id, bool front, timespec *ts) {
   if (ret) {
     CondIterMap::iterator iter = m_cond_map.find(cond);
     if (iter != m_cond_map.end()) {
-      m_cond_list.erase(iter->second);
+      m_cond_lists[iter->second.first].erase(iter->second.second);
       m_cond_map.erase(iter);
     }
   }
@@ -84,18 +88,30 @@ bool SynchronizableMulti::waitImpl(int id, bool front, timespec *ts) {
 }
 
 void SynchronizableMulti::notify() {
-  if (!m_cond_list.empty()) {
-    pthread_cond_t *cond = m_cond_list.front();
-    pthread_cond_signal(cond);
-    m_cond_list.pop_front();
-    m_cond_map.erase(cond);
+  notify(0);
+}
+
+void SynchronizableMulti::notify(int group) {
+  for (unsigned int i = 0; i < m_cond_lists.size(); i++) {
+    std::list<pthread_cond_t*> &condList =
+      m_cond_lists[(group + i) % m_cond_lists.size()];
+    if (!condList.empty()) {
+      pthread_cond_t *cond = condList.front();
+      pthread_cond_signal(cond);
+      condList.pop_front();
+      m_cond_map.erase(cond);
+      return;
+    }
   }
 }
 
 void SynchronizableMulti::notifyAll() {
-  while (!m_cond_list.empty()) {
-    pthread_cond_signal(m_cond_list.front());
-    m_cond_list.pop_front();
+  for (unsigned int i = 0; i < m_cond_lists.size(); i++) {
+    std::list<pthread_cond_t*> &condList = m_cond_lists[i];
+    while (!condList.empty()) {
+      pthread_cond_signal(condList.front());
+      condList.pop_front();
+    }
   }
   m_cond_map.clear();
 }
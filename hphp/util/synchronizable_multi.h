@@ -29,10 +29,13 @@ namespace HPHP {
  * is, notify() can choose to notify the most recently waited conditional
  * variable for an altered scheduling that potentially wakes up a thread with
  * better thread caching.
+ *
+ * Waiters can further be split into "groups" (by id % groups), e.g. one per
+ * NUMA node, so that notify(group) wakes up a thread of that group first.
  */
 class SynchronizableMulti {
 public:
-  explicit SynchronizableMulti(int size);
+  explicit SynchronizableMulti(int size, int groups = 1);
   virtual ~SynchronizableMulti();
 
   /**
@@ -49,15 +52,28 @@ public:
   void notify();
   void notifyAll();
 
+  /**
+   * Wake up a waiter of "group", or of any other group if it has none.
+   */
+  void notify(int group);
+
+  /**
+   * Whether any thread of "group" is waiting.
+   */
+  bool hasWaiters(int group) const {
+    return !m_cond_lists[group % m_cond_lists.size()].empty();
+  }
+
   Mutex &getMutex() { return m_mutex;}
 
  private:
   Mutex m_mutex;
   std::vector<pthread_cond_t> m_conds;
-  std::list<pthread_cond_t*> m_cond_list;
+  std::vector<std::list<pthread_cond_t*> > m_cond_lists; // one per group
 
   // iterators in std::list are valid even after element removal
-  typedef hphp_hash_map<pthread_cond_t*, std::list<pthread_cond_t*>::iterator,
+  typedef std::pair<int, std::list<pthread_cond_t*>::iterator> CondPos;
+  typedef hphp_hash_map<pthread_cond_t*, CondPos,
                         pointer_hash<pthread_cond_t> > CondIterMap;
   CondIterMap m_cond_map;
 
@@ -0,0 +1,143 @@
+/*
+   +----------------------------------------------------------------------+
+   | HipHop for PHP                                                       |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2010-2013 Facebook, Inc. (http://www.facebook.com)     |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 3.01 of the PHP license,      |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available through the world-wide-web at the following url:           |
+   | http://www.php.net/license/3_01.txt                                  |
+   | If you did not receive a copy of the PHP license and are unable to   |
+   | obtain it through the world-wide-web, please send a note to          |
+   | license@php.net so we can mail you a copy immediately.               |
+   +----------------------------------------------------------------------+
+*/
+
+#include "hphp/util/byte_set.h"
+#include "hphp/util/zend/zend_html.h"
+#include "gtest/gtest.h"
+
+#include <stdlib.h>
+#include <string>
+
+namespace HPHP {
+
+namespace {
+
+uint64_t nextRand(uint64_t& state) {
+  state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+  return state >> 16;
+}
+
+/*
+ * Random strings of letters sprinkled with bytes from special, more
+ * thickly as density goes up.
+ */
+std::string randomString(uint64_t& state, const std::string& special,
+                         int density) {
+  std::string s;
+  size_t len = nextRand(state) % 80;
+  for (size_t i = 0; i < len; i++) {
+    if (int(nextRand(state) % 8) < density) {
+      s += special[nextRand(state) % special.size()];
+    } else {
+      s += char('a' + nextRand(state) % 26);
+    }
+  }
+  return s;
+}
+
+/*
+ * string_html_encode() the slow way, one byte at a time.
+ */
+std::string htmlEncode(const std::string& s, bool dq, bool sq, bool utf8,
+                       bool nbsp) {
+  std::string ret;
+  for (size_t i = 0; i < s.size(); i++) {
+    char c = s[i];
+    if (c == '"' && dq) {
+      ret += "&quot;";
+    } else if (c == '\'' && sq) {
+      ret += "&#039;";
+    } else if (c == '<') {
+      ret += "&lt;";
+    } else if (c == '>') {
+      ret += "&gt;";
+    } else if (c == '&') {
+      ret += "&amp;";
+    } else if (c == '\xc2' && nbsp && utf8 && s.c_str()[i + 1] == '\xa0') {
+      ret += "&nbsp;";
+      i++;
+    } else if (c == '\xa0' && nbsp && !utf8) {
+      ret += "&nbsp;";
+    } else {
+      ret += c;
+    }
+  }
+  return ret;
+}
+
+}
+
+TEST(ByteSetTest, Find) {
+  uint64_t state = 1;
+  const std::string small("\0'\"\\", 4);
+  std::string large;
+  for (int c = 0; c < 32; c++) large += char(c);
+  large += "\x7f\x80\xff";
+  for (auto& special : { small, large }) {
+    ByteSet set(special.data(), special.size());
+    for (int c = 0; c < 256; c++) {
+      EXPECT_EQ(special.find(char(c)) != std::string::npos,
+                set.contains(c));
+    }
+    for (int density = 0; density < 8; density++) {
+      std::string s = randomString(state, special, density);
+      for (size_t start = 0; start <= s.size(); start++) {
+        size_t expected = s.find_first_of(special, start);
+        if (expected == std::string::npos) expected = s.size();
+        const char* found = set.find(s.data() + start, s.data() + s.size());
+        EXPECT_EQ(expected, found - s.data());
+      }
+    }
+  }
+}
+
+TEST(ByteSetTest, RangeFind) {
+  uint64_t state = 1;
+  const std::string extra("\x7f\"'\\");
+  ByteRangeSet set(' ', extra.data(), extra.size());
+  std::string special = extra;
+  for (int c = 0; c < 256; c++) {
+    if (c < ' ' || c >= 0x80) special += char(c);
+  }
+  for (int c = 0; c < 256; c++) {
+    EXPECT_EQ(special.find(char(c)) != std::string::npos, set.contains(c));
+  }
+  for (int density = 0; density < 8; density++) {
+    std::string s = randomString(state, special, density);
+    for (size_t start = 0; start <= s.size(); start++) {
+      size_t expected = s.find_first_of(special, start);
+      if (expected == std::string::npos) expected = s.size();
+      const char* found = set.find(s.data() + start, s.data() + s.size());
+      EXPECT_EQ(expected, found - s.data());
+    }
+  }
+}
+
+TEST(ByteSetTest, HtmlEncode) {
+  uint64_t state = 1;
+  const std::string special("\"'<>&\xc2\xa0");
+  for (int i = 0; i < 2000; i++) {
+    std::string s = randomString(state, special, i % 8);
+    int flags = nextRand(state);
+    bool dq = flags & 1, sq = flags & 2, utf8 = flags & 4, nbsp = flags & 8;
+    int len = s.size();
+    char* ret = string_html_encode(s.c_str(), len, dq, sq, utf8, nbsp);
+    EXPECT_EQ(htmlEncode(s, dq, sq, utf8, nbsp), std::string(ret, len));
+    free(ret);
+  }
+}
+
+}
@@ -0,0 +1,63 @@
+/*
+   +----------------------------------------------------------------------+
+   | HipHop for PHP                                                       |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2010-2013 Facebook, Inc. (http://www.facebook.com)     |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 3.01 of the PHP license,      |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available through the world-wide-web at the following url:           |
+   | http://www.php.net/license/3_01.txt                                  |
+   | If you did not receive a copy of the PHP license and are unable to   |
+   | obtain it through the world-wide-web, please send a note to          |
+   | license@php.net so we can mail you a copy immediately.               |
+   +----------------------------------------------------------------------+
+*/
+#include "hphp/util/codel.h"
+#include "gtest/gtest.h"
+
+namespace HPHP {
+
+TEST(QueueDelayHistogram, Percentiles) {
+  QueueDelayHistogram h;
+  EXPECT_EQ(0, h.percentile(50));
+  h.add(0);
+  h.add(1);
+  h.add(2);
+  h.add(3);
+  h.add(1000);
+  EXPECT_EQ(5, h.count());
+  EXPECT_EQ(1, h.percentile(0));
+  EXPECT_EQ(4, h.percentile(50));
+  EXPECT_EQ(1024, h.percentile(99));
+  h.clear();
+  EXPECT_EQ(0, h.count());
+}
+
+TEST(CoDel, ShedsOnlyWhileQueueNeverDrains) {
+  // 10ms target, 100ms interval; times below are in microseconds
+  CoDel codel(10, 100);
+  EXPECT_FALSE(codel.onDequeue(50000, 1000));
+  // a burst within the first interval is tolerated
+  EXPECT_FALSE(codel.onDequeue(30000, 2000));
+  EXPECT_FALSE(codel.onDequeue(40000, 3000));
+  EXPECT_FALSE(codel.isOverloaded());
+
+  // the whole interval stayed above target
+  EXPECT_FALSE(codel.onDequeue(25000, 102000));
+  EXPECT_TRUE(codel.isOverloaded());
+  EXPECT_TRUE(codel.onDequeue(25000, 103000));
+  EXPECT_FALSE(codel.onDequeue(15000, 104000));
+  EXPECT_EQ(3, codel.getLastInterval().count());
+
+  EXPECT_FALSE(codel.onDequeue(5000, 203000));
+  EXPECT_TRUE(codel.isOverloaded());
+
+  // the queue drained below target once, so the next interval is fine
+  EXPECT_FALSE(codel.onDequeue(50000, 304000));
+  EXPECT_FALSE(codel.isOverloaded());
+  EXPECT_FALSE(codel.onDequeue(50000, 305000));
+  EXPECT_EQ(1, codel.getShedCount());
+}
+
+}
@@ -0,0 +1,48 @@
+/*
+   +----------------------------------------------------------------------+
+   | HipHop for PHP                                                       |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2010-2013 Facebook, Inc. (http://www.facebook.com)     |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 3.01 of the PHP license,      |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available through the world-wide-web at the following url:           |
+   | http://www.php.net/license/3_01.txt                                  |
+   | If you did not receive a copy of the PHP license and are unable to   |
+   | obtain it through the world-wide-web, please send a note to          |
+   | license@php.net so we can mail you a copy immediately.               |
+   +----------------------------------------------------------------------+
+*/
+#include "hphp/util/job_queue.h"
+#include "gtest/gtest.h"
+
+namespace HPHP {
+
+TEST(JobQueue, NumaPartitions) {
+  JobQueue<int> q(2, false, 0, false, false, false, 2);
+  // without idle workers, jobs go to the least loaded node
+  for (int i = 0; i < 4; i++) q.enqueue(i);
+  EXPECT_EQ(4, q.getQueuedJobs());
+  // worker 1 belongs to node 1
+  EXPECT_EQ(1, q.dequeue(1));
+  EXPECT_EQ(3, q.dequeue(1));
+  // then helps out node 0
+  EXPECT_EQ(0, q.dequeue(1));
+  EXPECT_EQ(2, q.dequeue(0));
+  EXPECT_EQ(0, q.getQueuedJobs());
+}
+
+TEST(JobQueue, NumaLocalNode) {
+  JobQueue<int> q(2, false, 0, false, false, false, 2);
+  int saved = Util::s_numaNode;
+  // enqueued from node 1, and from an unbound thread, i.e. node 0
+  Util::s_numaNode = 1;
+  q.enqueue(7);
+  Util::s_numaNode = -1;
+  q.enqueue(8);
+  Util::s_numaNode = saved;
+  EXPECT_EQ(8, q.dequeue(0));
+  EXPECT_EQ(7, q.dequeue(3));
+}
+
+}
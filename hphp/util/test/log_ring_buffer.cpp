@@ -0,0 +1,93 @@
+/*
+   +----------------------------------------------------------------------+
+   | HipHop for PHP                                                       |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2010-2013 Facebook, Inc. (http://www.facebook.com)     |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 3.01 of the PHP license,      |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available through the world-wide-web at the following url:           |
+   | http://www.php.net/license/3_01.txt                                  |
+   | If you did not receive a copy of the PHP license and are unable to   |
+   | obtain it through the world-wide-web, please send a note to          |
+   | license@php.net so we can mail you a copy immediately.               |
+   +----------------------------------------------------------------------+
+*/
+#include "hphp/util/log_ring_buffer.h"
+#include "gtest/gtest.h"
+
+#include <string>
+#include <thread>
+
+namespace HPHP {
+
+TEST(LogRingBuffer, ReadAndConsume) {
+  LogRingBuffer ring(64);
+  EXPECT_TRUE(ring.empty());
+  EXPECT_TRUE(ring.write(1, "hello", 5));
+  EXPECT_TRUE(ring.write(2, "world!", 6));
+
+  std::vector<LogRingBuffer::Record> recs;
+  EXPECT_EQ(2, ring.read(recs, 10));
+  EXPECT_TRUE(ring.empty());
+  EXPECT_EQ(1, recs[0].tag);
+  EXPECT_EQ("hello", std::string(recs[0].data, recs[0].len));
+  EXPECT_EQ(2, recs[1].tag);
+  EXPECT_EQ("world!", std::string(recs[1].data, recs[1].len));
+  EXPECT_EQ(0, ring.read(recs, 10));
+  ring.consume();
+}
+
+TEST(LogRingBuffer, FullAndWrap) {
+  LogRingBuffer ring(64);
+  std::string rec(20, 'x'); // 32 bytes with header and padding
+  EXPECT_TRUE(ring.write(0, rec.data(), rec.size()));
+  EXPECT_TRUE(ring.write(0, rec.data(), rec.size()));
+  EXPECT_FALSE(ring.write(0, "y", 1));
+
+  // reading alone doesn't free any space
+  std::vector<LogRingBuffer::Record> recs;
+  EXPECT_EQ(1, ring.read(recs, 1));
+  EXPECT_FALSE(ring.write(0, "y", 1));
+  ring.consume();
+
+  // 8 bytes left at the end of the buffer; this one has to wrap
+  std::string big(24, 'z');
+  EXPECT_TRUE(ring.write(3, big.data(), big.size()));
+  recs.clear();
+  EXPECT_EQ(2, ring.read(recs, 10));
+  EXPECT_EQ(rec, std::string(recs[0].data, recs[0].len));
+  EXPECT_EQ(3, recs[1].tag);
+  EXPECT_EQ(big, std::string(recs[1].data, recs[1].len));
+  ring.consume();
+
+  std::string huge(64, 'h');
+  EXPECT_FALSE(ring.write(0, huge.data(), huge.size()));
+}
+
+TEST(LogRingBuffer, Threaded) {
+  const uint32_t kRecords = 20000;
+  LogRingBuffer ring(1024);
+  std::thread producer([&] {
+    for (uint32_t i = 0; i < kRecords; ) {
+      std::string s = std::to_string(i);
+      if (ring.write(i, s.data(), s.size())) i++;
+    }
+  });
+
+  uint32_t next = 0;
+  std::vector<LogRingBuffer::Record> recs;
+  while (next < kRecords) {
+    recs.clear();
+    ring.read(recs, 16);
+    for (auto &rec : recs) {
+      EXPECT_EQ(next, rec.tag);
+      EXPECT_EQ(std::to_string(next), std::string(rec.data, rec.len));
+      next++;
+    }
+    ring.consume();
+  }
+  producer.join();
+}
+
+}
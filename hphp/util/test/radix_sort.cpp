@@ -0,0 +1,105 @@
+/*
+   +----------------------------------------------------------------------+
+   | HipHop for PHP                                                       |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2010-2013 Facebook, Inc. (http://www.facebook.com)     |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 3.01 of the PHP license,      |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available through the world-wide-web at the following url:           |
+   | http://www.php.net/license/3_01.txt                                  |
+   | If you did not receive a copy of the PHP license and are unable to   |
+   | obtain it through the world-wide-web, please send a note to          |
+   | license@php.net so we can mail you a copy immediately.               |
+   +----------------------------------------------------------------------+
+*/
+
+#include "hphp/util/radix_sort.h"
+#include "gtest/gtest.h"
+
+#include <string>
+#include <vector>
+
+namespace HPHP {
+
+namespace {
+
+struct IntElm {
+  int64_t key;
+  int order;
+};
+
+struct StrElm {
+  const std::string* key;
+  int order;
+};
+
+uint64_t nextRand(uint64_t& state) {
+  state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+  return state >> 16;
+}
+
+}
+
+TEST(RadixSortTest, Ints) {
+  uint64_t state = 1;
+  for (int range : { 2, 1000, 1 << 20, 0 }) {
+    std::vector<IntElm> elms;
+    for (int i = 0; i < 5000; i++) {
+      int64_t k = nextRand(state) * 0x9e3779b97f4a7c15ULL;
+      if (range) k = k % range - range / 2;
+      elms.push_back(IntElm{k, i});
+    }
+    elms.push_back(IntElm{INT64_MIN, -1});
+    elms.push_back(IntElm{INT64_MAX, -2});
+    auto expected = elms;
+    std::stable_sort(expected.begin(), expected.end(),
+                     [](const IntElm& a, const IntElm& b) {
+                       return a.key < b.key;
+                     });
+    std::vector<IntElm> scratch(elms.size());
+    Sort::radix_sort_int(&elms[0], &elms[0] + elms.size(), &scratch[0],
+                         [](const IntElm& e) { return e.key; });
+    for (size_t i = 0; i < elms.size(); i++) {
+      EXPECT_EQ(expected[i].key, elms[i].key);
+      EXPECT_EQ(expected[i].order, elms[i].order);
+    }
+  }
+}
+
+TEST(RadixSortTest, Strings) {
+  uint64_t state = 1;
+  std::vector<std::string> keys;
+  for (int i = 0; i < 5000; i++) {
+    // Short strings over a small alphabet, to get shared prefixes,
+    // duplicates, and strings that are prefixes of others.
+    std::string s = i % 3 ? "prefix" : "";
+    size_t len = nextRand(state) % 6;
+    for (size_t j = 0; j < len; j++) {
+      s += "a\0\xff"[nextRand(state) % 3];
+    }
+    keys.push_back(s);
+  }
+  std::vector<StrElm> elms;
+  for (size_t i = 0; i < keys.size(); i++) {
+    elms.push_back(StrElm{&keys[i], int(i)});
+  }
+  auto expected = elms;
+  std::stable_sort(expected.begin(), expected.end(),
+                   [](const StrElm& a, const StrElm& b) {
+                     // std::string compares bytes as unsigned chars.
+                     return *a.key < *b.key;
+                   });
+  std::vector<StrElm> scratch(elms.size());
+  Sort::radix_sort_str(&elms[0], &elms[0] + elms.size(), &scratch[0],
+                       [](const StrElm& e) {
+                         return Sort::RadixString{e.key->data(),
+                                                  e.key->size()};
+                       });
+  for (size_t i = 0; i < elms.size(); i++) {
+    EXPECT_EQ(*expected[i].key, *elms[i].key);
+    EXPECT_EQ(expected[i].order, elms[i].order);
+  }
+}
+
+}
@@ -0,0 +1,142 @@
+/*
+   +----------------------------------------------------------------------+
+   | HipHop for PHP                                                       |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2010-2013 Facebook, Inc. (http://www.facebook.com)     |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 3.01 of the PHP license,      |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available through the world-wide-web at the following url:           |
+   | http://www.php.net/license/3_01.txt                                  |
+   | If you did not receive a copy of the PHP license and are unable to   |
+   | obtain it through the world-wide-web, please send a note to          |
+   | license@php.net so we can mail you a copy immediately.               |
+   +----------------------------------------------------------------------+
+*/
+#include "hphp/util/work_stealing_queue.h"
+#include "gtest/gtest.h"
+
+#include <thread>
+
+namespace HPHP {
+
+TEST(MPMCRing, FullAndEmpty) {
+  MPMCRing<int> ring(4);
+  int v;
+  EXPECT_FALSE(ring.tryPop(v));
+  for (int i = 0; i < 4; i++) {
+    EXPECT_TRUE(ring.tryPush(i));
+  }
+  EXPECT_FALSE(ring.tryPush(4));
+  for (int i = 0; i < 4; i++) {
+    EXPECT_TRUE(ring.tryPop(v));
+    EXPECT_EQ(i, v);
+  }
+  EXPECT_FALSE(ring.tryPop(v));
+}
+
+TEST(WorkStealingQueue, Fifo) {
+  WorkStealingQueue<int> q(1, false, 4);
+  // overflows the ring
+  for (int i = 0; i < 10; i++) q.push(i);
+  int v;
+  for (int i = 0; i < 10; i++) {
+    EXPECT_TRUE(q.pop(0, v));
+    EXPECT_EQ(i, v);
+  }
+  EXPECT_FALSE(q.pop(0, v));
+}
+
+TEST(WorkStealingQueue, OverflowKeepsOrder) {
+  WorkStealingQueue<int> q(4, false, 4);
+  for (int i = 0; i < 10; i++) q.push(i);
+  int v;
+  // takes 0, 1 and 2 out of the ring, leaving 3 there and 4-9 overflowed
+  EXPECT_TRUE(q.pop(0, v));
+  EXPECT_EQ(0, v);
+  // must queue up behind the overflowed jobs even though the ring has room
+  q.push(10);
+  for (int i = 3; i <= 10; i++) {
+    EXPECT_TRUE(q.pop(1, v));
+    EXPECT_EQ(i, v);
+  }
+}
+
+TEST(WorkStealingQueue, LifoWithinBatch) {
+  WorkStealingQueue<int> q(1, true);
+  for (int i = 0; i < 4; i++) q.push(i);
+  int v;
+  for (int i = 3; i >= 0; i--) {
+    EXPECT_TRUE(q.pop(0, v));
+    EXPECT_EQ(i, v);
+  }
+}
+
+TEST(WorkStealingQueue, LifoUnderBacklog) {
+  WorkStealingQueue<int> q(4, true);
+  for (int i = 0; i < 200; i++) q.push(i);
+  int v;
+  EXPECT_TRUE(q.pop(0, v));
+  EXPECT_EQ(199, v);
+  // a new job beats everything queued and parked before it
+  q.push(200);
+  EXPECT_TRUE(q.pop(1, v));
+  EXPECT_EQ(200, v);
+  q.push(201);
+  EXPECT_TRUE(q.pop(0, v));
+  EXPECT_EQ(201, v);
+}
+
+TEST(WorkStealingQueue, Steal) {
+  WorkStealingQueue<int> q(2, false);
+  for (int i = 0; i < 8; i++) q.push(i);
+  int v;
+  // worker 0 pulls its fair share of the backlog into its deque
+  EXPECT_TRUE(q.pop(0, v));
+  EXPECT_EQ(0, v);
+  EXPECT_EQ(4, q.localSize(0));
+  // worker 1 drains the ring, then steals the older half of worker 0's jobs
+  for (int i = 5; i < 8; i++) {
+    EXPECT_TRUE(q.pop(1, v));
+    EXPECT_EQ(i, v);
+  }
+  EXPECT_TRUE(q.pop(1, v));
+  EXPECT_EQ(1, v);
+  EXPECT_EQ(2, q.localSize(0));
+  EXPECT_EQ(1, q.localSize(1));
+}
+
+static void runThreaded(bool lifo) {
+  const int kJobs = 100000;
+  const int kThreads = 4;
+  WorkStealingQueue<int> q(kThreads, lifo, 256);
+  std::atomic<int> done(0);
+  std::atomic<long> sum(0);
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; t++) {
+    threads.emplace_back([&, t] {
+      int v;
+      while (done.load() < kJobs) {
+        if (q.pop(t, v)) {
+          sum += v;
+          done++;
+        }
+      }
+    });
+  }
+  for (int i = 0; i < kJobs; i++) q.push(i);
+  for (auto& t : threads) t.join();
+
+  EXPECT_EQ((long)kJobs * (kJobs - 1) / 2, sum.load());
+}
+
+TEST(WorkStealingQueue, Threaded) {
+  runThreaded(false);
+}
+
+TEST(WorkStealingQueue, ThreadedLifo) {
+  runThreaded(true);
+}
+
+}
@@ -0,0 +1,311 @@
+/*
+   +----------------------------------------------------------------------+
+   | HipHop for PHP                                                       |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2010-2013 Facebook, Inc. (http://www.facebook.com)     |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 3.01 of the PHP license,      |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available through the world-wide-web at the following url:           |
+   | http://www.php.net/license/3_01.txt                                  |
+   | If you did not receive a copy of the PHP license and are unable to   |
+   | obtain it through the world-wide-web, please send a note to          |
+   | license@php.net so we can mail you a copy immediately.               |
+   +----------------------------------------------------------------------+
+*/
+
+#ifndef incl_HPHP_UTIL_WORK_STEALING_QUEUE_H_
+#define incl_HPHP_UTIL_WORK_STEALING_QUEUE_H_
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "hphp/util/assertions.h"
+#include "hphp/util/smalllocks.h"
+
+namespace HPHP {
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Bounded multi-producer multi-consumer ring. Every slot carries a sequence
+ * number that tells producers and consumers whose turn it is, so neither side
+ * ever takes a lock (D. Vyukov's bounded MPMC queue). tryPush() fails when
+ * the ring is full and tryPop() fails when it is empty.
+ */
+template<typename T>
+class MPMCRing {
+public:
+  explicit MPMCRing(size_t capacity) {
+    size_t size = 2;
+    while (size < capacity) size <<= 1;
+    m_mask = size - 1;
+    m_cells.reset(new Cell[size]);
+    for (size_t i = 0; i < size; i++) {
+      m_cells[i].seq.store(i, std::memory_order_relaxed);
+    }
+    m_pushPos.store(0, std::memory_order_relaxed);
+    m_popPos.store(0, std::memory_order_relaxed);
+  }
+
+  bool tryPush(const T& value) {
+    Cell* cell;
+    size_t pos = m_pushPos.load(std::memory_order_relaxed);
+    for (;;) {
+      cell = &m_cells[pos & m_mask];
+      size_t seq = cell->seq.load(std::memory_order_acquire);
+      intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+      if (diff == 0) {
+        if (m_pushPos.compare_exchange_weak(pos, pos + 1,
+                                            std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false; // full
+      } else {
+        pos = m_pushPos.load(std::memory_order_relaxed);
+      }
+    }
+    cell->data = value;
+    cell->seq.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool tryPop(T& value) {
+    Cell* cell;
+    size_t pos = m_popPos.load(std::memory_order_relaxed);
+    for (;;) {
+      cell = &m_cells[pos & m_mask];
+      size_t seq = cell->seq.load(std::memory_order_acquire);
+      intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+      if (diff == 0) {
+        if (m_popPos.compare_exchange_weak(pos, pos + 1,
+                                           std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false; // empty
+      } else {
+        pos = m_popPos.load(std::memory_order_relaxed);
+      }
+    }
+    value = std::move(cell->data);
+    cell->data = T();
+    cell->seq.store(pos + m_mask + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * Racy estimate, only good for sizing batches.
+   */
+  size_t approxSize() const {
+    size_t push = m_pushPos.load(std::memory_order_relaxed);
+    size_t pop = m_popPos.load(std::memory_order_relaxed);
+    return push > pop ? push - pop : 0;
+  }
+
+private:
+  struct Cell {
+    std::atomic<size_t> seq;
+    T data;
+  };
+
+  std::unique_ptr<Cell[]> m_cells;
+  size_t m_mask;
+  char m_pad0[64];
+  std::atomic<size_t> m_pushPos;
+  char m_pad1[64];
+  std::atomic<size_t> m_popPos;
+  char m_pad2[64];
+};
+
+/**
+ * Job storage for JobQueue's work-stealing mode.
+ *
+ * Producers push into a lock-free injection ring, so the libevent dispatcher
+ * never contends with workers. Each worker owns a local deque that it refills
+ * from the ring in batches sized to its fair share of the backlog; a worker
+ * whose deque and the ring are both empty steals the older half of another
+ * worker's deque. Local deques are guarded by per-worker SmallLocks, which
+ * are only contended while stealing. Jobs that don't fit in the ring go to a
+ * locked overflow deque, and so do all jobs pushed after them until it has
+ * drained, so that the ring followed by the overflow is always in order.
+ *
+ * With lifo, producers push onto the locked deque instead, used as a stack:
+ * a FIFO ring can't hand out the newest job first. Workers refill from the
+ * top of that stack before serving their own deques, so the newest job
+ * waiting anywhere is served next even with a deep backlog, and each worker
+ * serves the newest job it holds first; thieves always take the oldest.
+ *
+ * This class only stores jobs; blocking and waking idle workers is left to
+ * JobQueue.
+ */
+template<typename TJob>
+class WorkStealingQueue {
+public:
+  static const size_t kMaxBatch = 16;
+
+  WorkStealingQueue(int workerCount, bool lifo, size_t ringCapacity = 4096)
+      : m_lifo(lifo), m_ring(ringCapacity), m_overflowCount(0) {
+    assert(workerCount > 0);
+    m_locals.reserve(workerCount);
+    for (int i = 0; i < workerCount; i++) {
+      m_locals.push_back(std::unique_ptr<Local>(new Local()));
+    }
+  }
+
+  void push(const TJob& job) {
+    if (!m_lifo && !m_overflowCount.load(std::memory_order_acquire) &&
+        m_ring.tryPush(job)) {
+      return;
+    }
+    std::lock_guard<SmallLock> guard(m_overflowLock);
+    m_overflow.push_back(job);
+    m_overflowCount.fetch_add(1, std::memory_order_release);
+  }
+
+  /**
+   * Find a job for worker "id": from its own deque first, then the
+   * injection ring, then other workers' deques. With lifo the shared stack
+   * holds the newest jobs, so it comes before the worker's own deque.
+   * Returns false only if all of them looked empty.
+   */
+  bool pop(int id, TJob& job) {
+    Local& local = localFor(id);
+    if (m_lifo) {
+      if (refill(local, job) || popLocal(local, job)) return true;
+    } else {
+      if (popLocal(local, job) || refill(local, job)) return true;
+    }
+    return steal(id, local, job);
+  }
+
+  /**
+   * Number of jobs parked in worker "id"'s deque, i.e. work that idle
+   * workers could steal.
+   */
+  int localSize(int id) {
+    return localFor(id).size.load(std::memory_order_relaxed);
+  }
+
+private:
+  struct Local {
+    Local() : size(0) {}
+    SmallLock lock;
+    std::atomic<int> size;
+    std::deque<TJob> jobs;
+    char pad[64];
+  };
+
+  Local& localFor(int id) {
+    assert(id >= 0);
+    // Workers added on the fly beyond the initial thread count share deques,
+    // which is safe since every deque is locked anyway.
+    return *m_locals[id % m_locals.size()];
+  }
+
+  bool popLocal(Local& local, TJob& job) {
+    if (!local.size.load(std::memory_order_acquire)) return false;
+    std::lock_guard<SmallLock> guard(local.lock);
+    if (local.jobs.empty()) return false;
+    if (m_lifo) {
+      job = local.jobs.back();
+      local.jobs.pop_back();
+    } else {
+      job = local.jobs.front();
+      local.jobs.pop_front();
+    }
+    local.size.store(local.jobs.size(), std::memory_order_release);
+    return true;
+  }
+
+  bool refill(Local& local, TJob& job) {
+    size_t overflow = m_overflowCount.load(std::memory_order_acquire);
+    size_t batch = (m_ring.approxSize() + overflow) / m_locals.size() + 1;
+    if (batch > kMaxBatch) batch = kMaxBatch;
+
+    // jobs[0] is served now, the rest in order after it.
+    TJob jobs[kMaxBatch];
+    size_t n = 0;
+    if (m_lifo) {
+      if (overflow) {
+        std::lock_guard<SmallLock> guard(m_overflowLock);
+        while (n < batch && !m_overflow.empty()) {
+          jobs[n++] = m_overflow.back();
+          m_overflow.pop_back();
+        }
+        m_overflowCount.store(m_overflow.size(), std::memory_order_release);
+      }
+    } else {
+      while (n < batch && m_ring.tryPop(jobs[n])) n++;
+      // Overflowed jobs are all newer than the ring's, so they top up the
+      // batch after it.
+      if (n < batch && overflow) {
+        std::lock_guard<SmallLock> guard(m_overflowLock);
+        while (n < batch && !m_overflow.empty()) {
+          jobs[n++] = m_overflow.front();
+          m_overflow.pop_front();
+        }
+        m_overflowCount.store(m_overflow.size(), std::memory_order_release);
+      }
+    }
+    if (n == 0) return false;
+
+    job = jobs[0];
+    if (n > 1) {
+      // popLocal() takes from the back with lifo and from the front without.
+      std::lock_guard<SmallLock> guard(local.lock);
+      for (size_t i = 1; i < n; i++) {
+        local.jobs.push_back(jobs[m_lifo ? n - i : i]);
+      }
+      local.size.store(local.jobs.size(), std::memory_order_release);
+    }
+    return true;
+  }
+
+  bool steal(int id, Local& local, TJob& job) {
+    size_t count = m_locals.size();
+    size_t self = id % count;
+    for (size_t i = 1; i < count; i++) {
+      Local& victim = *m_locals[(self + i) % count];
+      if (!victim.size.load(std::memory_order_acquire)) continue;
+
+      std::deque<TJob> stolen;
+      {
+        std::lock_guard<SmallLock> guard(victim.lock);
+        size_t n = (victim.jobs.size() + 1) / 2;
+        for (size_t j = 0; j < n; j++) {
+          stolen.push_back(victim.jobs.front());
+          victim.jobs.pop_front();
+        }
+        victim.size.store(victim.jobs.size(), std::memory_order_release);
+      }
+      if (stolen.empty()) continue;
+
+      job = stolen.front();
+      stolen.pop_front();
+      if (!stolen.empty()) {
+        std::lock_guard<SmallLock> guard(local.lock);
+        local.jobs.insert(local.jobs.begin(), stolen.begin(), stolen.end());
+        local.size.store(local.jobs.size(), std::memory_order_release);
+      }
+      return true;
+    }
+    return false;
+  }
+
+  bool m_lifo;
+  MPMCRing<TJob> m_ring;
+  std::vector<std::unique_ptr<Local> > m_locals;
+
+  SmallLock m_overflowLock;
+  std::atomic<size_t> m_overflowCount;
+  std::deque<TJob> m_overflow;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+}
+
+#endif // incl_HPHP_UTIL_WORK_STEALING_QUEUE_H_
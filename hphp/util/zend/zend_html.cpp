@@ -17,6 +17,7 @@
 
 #include "hphp/util/zend/zend_html.h"
 #include "hphp/util/lock.h"
+#include "hphp/util/byte_set.h"
 #include "unicode/uchar.h"
 #include "unicode/utf8.h"
 
@@ -474,8 +475,15 @@ char *string_html_encode(const char *input, int &len, bool encode_double_quote,
   if (!ret) {
     return nullptr;
   }
+  // Every byte that may need encoding; runs without any are copied whole.
+  static const ByteSet special("\"'<>&\xc2\xa0", 7);
   char *q = ret;
   for (const char *p = input, *end = input + len; p < end; p++) {
+    const char *run = special.find(p, end);
+    memcpy(q, p, run - p);
+    q += run - p;
+    p = run;
+    if (p == end) break;
     char c = *p;
     switch (c) {
     case '"':
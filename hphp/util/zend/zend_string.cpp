@@ -21,6 +21,10 @@
 #include "hphp/util/mutex.h"
 #include "hphp/util/lock.h"
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 namespace HPHP {
 
 //////////////////////////////////////////////////////////////////////
@@ -209,7 +213,29 @@ char *string_bin2hex(const char *input, int &len) {
   int i, j;
   char *result = (char *)malloc((len << 1) + 1);
 
-  for (i = j = 0; i < len; i++) {
+  i = j = 0;
+#ifdef __SSE2__
+  // Nibbles of 16 bytes at a time, interleaved high first, then mapped to
+  // '0'..'9' or 'a'..'f'.
+  const __m128i mask = _mm_set1_epi8(0x0f);
+  const __m128i nine = _mm_set1_epi8(9);
+  const __m128i zero = _mm_set1_epi8('0');
+  const __m128i letter = _mm_set1_epi8('a' - '0' - 10);
+  for (; len - i >= 16; i += 16, j += 32) {
+    __m128i v = _mm_loadu_si128((const __m128i*)(input + i));
+    __m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), mask);
+    __m128i lo = _mm_and_si128(v, mask);
+    __m128i a = _mm_unpacklo_epi8(hi, lo);
+    __m128i b = _mm_unpackhi_epi8(hi, lo);
+    a = _mm_add_epi8(_mm_add_epi8(a, zero),
+                     _mm_and_si128(_mm_cmpgt_epi8(a, nine), letter));
+    b = _mm_add_epi8(_mm_add_epi8(b, zero),
+                     _mm_and_si128(_mm_cmpgt_epi8(b, nine), letter));
+    _mm_storeu_si128((__m128i*)(result + j), a);
+    _mm_storeu_si128((__m128i*)(result + j + 16), b);
+  }
+#endif
+  for (; i < len; i++) {
     result[j++] = hexconvtab[(unsigned char)input[i] >> 4];
     result[j++] = hexconvtab[(unsigned char)input[i] & 15];
   }